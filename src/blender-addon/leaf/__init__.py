@@ -47,11 +47,14 @@ class LeafRenderEngine(bpy.types.RenderEngine):
     def export(self, data, prefix=""):
         global engine
 
+        # mesh simplification is the slowest part of the export
+        generate_lods = bpy.context.user_preferences.addons[__package__].preferences.live_link_lods
+
         with io.BytesIO() as f:
             if self.is_preview:
-                export.export_data(f, data, prefix, False)
+                export.export_data(f, data, prefix, False, generate_lods)
             else:
-                export.export_data(f, data, prefix, not engine.full_data_send)
+                export.export_data(f, data, prefix, not engine.full_data_send, generate_lods)
                 engine.full_data_send = False
 
             data_bytes = f.getvalue()
@@ -183,6 +186,7 @@ def register():
     
     cooking.cooker = cooking.Cooker()
     cooking.cooker.register_processor("image", cooking.ImageProcessor())
+    cooking.mesh_cooker = cooking.MeshCooker()
 
     # register callbacks
     bpy.app.handlers.load_post.append(load_post)
@@ -203,6 +207,8 @@ def unregister():
     bpy.utils.unregister_module(__name__)
 
     cooking.cooker = None
+    cooking.mesh_cooker.unload()
+    cooking.mesh_cooker = None
 
     # unregister callbacks
     bpy.app.handlers.load_post.remove(load_post)
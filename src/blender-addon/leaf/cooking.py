@@ -5,8 +5,12 @@ import os.path
 import hashlib
 import subprocess
 import json
+import shutil
+import ctypes
+import _ctypes
 
 cooker = None
+mesh_cooker = None
 
 class Cooker():
     def __init__(self):
@@ -102,3 +106,80 @@ class ImageProcessor():
 
         print("running: " + str(args))
         subprocess.run(args)
+
+class MeshCookingInput(ctypes.Structure):
+    _fields_ = [
+        ("vertexCount", ctypes.c_int),
+        ("positions", ctypes.POINTER(ctypes.c_float)),
+        ("loopCount", ctypes.c_int),
+        ("loopVertexIndices", ctypes.POINTER(ctypes.c_int)),
+        ("loopNormals", ctypes.POINTER(ctypes.c_float)),
+        ("loopTangents", ctypes.POINTER(ctypes.c_float)),
+        ("loopBitangentSigns", ctypes.POINTER(ctypes.c_float)),
+        ("loopUVs", ctypes.POINTER(ctypes.c_float)),
+        ("polygonCount", ctypes.c_int),
+        ("polygonLoopStarts", ctypes.POINTER(ctypes.c_int)),
+        ("polygonLoopTotals", ctypes.POINTER(ctypes.c_int)),
+        ("polygonMaterialIndices", ctypes.POINTER(ctypes.c_int)),
+        ("materialCount", ctypes.c_int),
+        ("materialNames", ctypes.POINTER(ctypes.c_char_p))
+    ]
+
+class MeshCookingStats(ctypes.Structure):
+    _fields_ = [
+        ("vertex_count_before", ctypes.c_int),
+        ("vertex_count_after", ctypes.c_int),
+        ("acmr_before", ctypes.c_float),
+        ("acmr_after", ctypes.c_float),
+        ("lod_count", ctypes.c_int),
+        ("lod_triangle_counts", ctypes.c_int * 5),
+        ("raw_size", ctypes.c_int),
+        ("compressed_size", ctypes.c_int),
+        ("cluster_count", ctypes.c_int)
+    ]
+
+class MeshCookingOutput(ctypes.Structure):
+    _fields_ = [
+        ("data", ctypes.c_void_p),
+        ("size", ctypes.c_size_t),
+        ("stats", MeshCookingStats)
+    ]
+
+class MeshCooker():
+    def __init__(self):
+        script_dir = os.path.dirname(__file__)
+        self.dll_name = os.path.join(script_dir, "LeafMeshCooker.dll")
+        self.loaded_dll_name = os.path.join(bpy.app.tempdir, "LeafMeshCooker-Loaded.dll")
+
+        # copy the dll, to allow hot reload after rebuild
+        shutil.copy(self.dll_name, self.loaded_dll_name)
+        self.dll = ctypes.CDLL(self.loaded_dll_name)
+
+        self.dll.leaf_cook_meshes.argtypes = [ctypes.POINTER(MeshCookingInput), ctypes.c_int, ctypes.c_int, ctypes.POINTER(MeshCookingOutput)]
+        self.dll.leaf_free_mesh.argtypes = [ctypes.c_void_p]
+
+    def unload(self):
+        _ctypes.FreeLibrary(self.dll._handle)
+        del self.dll
+
+        os.remove(self.loaded_dll_name)
+
+    # returns one mesh blob per input, or None if the input is invalid
+    def cook(self, inputs, names, generate_lods=True):
+        outputs = (MeshCookingOutput * len(inputs))()
+        self.dll.leaf_cook_meshes(inputs, len(inputs), 1 if generate_lods else 0, outputs)
+
+        buffers = []
+        for name, output in zip(names, outputs):
+            if not output.data:
+                buffers.append(None)
+                continue
+
+            buffers.append(ctypes.string_at(output.data, output.size))
+            self.dll.leaf_free_mesh(output.data)
+
+            stats = output.stats
+            lods = " -> ".join(str(stats.lod_triangle_counts[i]) for i in range(stats.lod_count + 1))
+            print("Cooked mesh '%s': %d -> %d vertices, ACMR %.3f -> %.3f, LOD triangles %s, %d clusters, %d -> %d bytes" % (name, stats.vertex_count_before, stats.vertex_count_after, stats.acmr_before, stats.acmr_after, lods, stats.cluster_count, stats.raw_size, stats.compressed_size))
+
+        return buffers
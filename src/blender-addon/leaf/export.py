@@ -1,6 +1,7 @@
 import bpy
 import math
 import mathutils
+import numpy
 import ctypes
 import json
 import io
@@ -12,7 +13,8 @@ import tempfile
 
 from . import cooking
 
-def export_data(output_file, data, prefix, updated_only=False):
+# generate_lods can be disabled for quicker live link updates, meshes are then always drawn at full detail
+def export_data(output_file, data, prefix, updated_only=False, generate_lods=True):
 
     class Demo():
         pass
@@ -27,7 +29,7 @@ def export_data(output_file, data, prefix, updated_only=False):
         ("Material", data.materials, export_material),
         ("Texture", data.textures, export_texture),
         ("Image", data.images, export_image),
-        ("Mesh", data.meshes, export_mesh),
+        ("Mesh", data.meshes, export_meshes),
         ("Action", data.actions, export_action),
         ("Light", data.lamps, export_light),
         ("Camera", data.cameras, export_camera),
@@ -36,14 +38,21 @@ def export_data(output_file, data, prefix, updated_only=False):
     )
 
     def export_data_type(type_name, collection, export_function):
+        blocks = [block for block in collection if block.is_updated or not updated_only or type_name == "Scene"]
+        export_reference = lambda ref: prefix + ref.name
+
+        # meshes are exported all at once
+        if type_name == "Mesh":
+            buffers = export_function(blocks, export_reference, generate_lods)
+        else:
+            buffers = [export_function(block, export_reference) for block in blocks]
+
         exported_blocks = {}
-        for block in collection:
-            if block.is_updated or not updated_only or type_name == "Scene":
-                buffer = export_function(block, lambda ref: prefix + ref.name)
-                if buffer is not None:
-                    exported_blocks[prefix + block.name] = buffer
-                else:
-                    print("Failed to export %s: '%s'" % (type_name, block.name))
+        for block, buffer in zip(blocks, buffers):
+            if buffer is not None:
+                exported_blocks[prefix + block.name] = buffer
+            else:
+                print("Failed to export %s: '%s'" % (type_name, block.name))
         
         return exported_blocks
 
@@ -116,6 +125,12 @@ def export_scene(scene, export_reference):
     if scene.animation_data:
         data["animation"] = export_animation(scene.animation_data, export_reference)
 
+    if leaf_scene.visibility:
+        data["visibility"] = json.loads(leaf_scene.visibility)
+
+    if leaf_scene.static_batching:
+        data["staticBatching"] = {"cellSize": leaf_scene.static_batching_cell_size}
+
     return json.dumps(data).encode("utf-8")
 
 def compute_parent_depth(obj):
@@ -258,104 +273,79 @@ def export_image(img, export_reference):
     return cooking.cooker.cook("image", img.filepath, options)
 
 
-def export_mesh(mesh, export_reference):
-    #min_bound = (math.inf, math.inf, math.inf)
-    #max_bound = (-math.inf, -math.inf, -math.inf)
-
-    uv_layer_data = None
-    
+def export_meshes(meshes, export_reference, generate_lods):
     import time
     t0 = time.perf_counter()
-    
-    if len(mesh.uv_layers) > 0 and len(mesh.uv_layers[0].data) > 0:
-        uv_layer_data = mesh.uv_layers[0].data
 
-        # will also compute split tangents according to sharp edges
-        try:
-            mesh.calc_tangents()
-        except:
-            print("Failed to compute tangents for mesh '%s': %s" % (mesh.name, sys.exc_info()[0]))
+    # flat arrays for all meshes, cooked in a single call to spread them over threads
+    inputs = (cooking.MeshCookingInput * len(meshes))()
+    arrays = [export_mesh_arrays(mesh, export_reference, inputs[i]) for i, mesh in enumerate(meshes)]
 
     t1 = time.perf_counter()
 
-    vertexCount = len(mesh.loops)
-    if vertexCount == 0:
-        return None
-
-    output = io.BytesIO()
-
-    # vertex (loop) count
-    output.write(struct.pack("=I", len(mesh.loops)))
-
-    # export all loops
-    default_uv = (0.0, 0.0)
-    vertices = mesh.vertices[:]
-    for loop in mesh.loops:
-        vertex = vertices[loop.vertex_index]
-        uv = uv_layer_data[loop.index].uv if uv_layer_data else default_uv
-
-        #min_bound = min(min_bound[0], vertex.co.x), min(min_bound[1], vertex.co.y), min(min_bound[2], vertex.co.y)
-        #max_bound = max(max_bound[0], vertex.co.x), max(max_bound[1], vertex.co.y), max(max_bound[2], vertex.co.y)
-        
-        position = vertex.co.to_3d()
-        normal = loop.normal.to_3d()
-        tangent = loop.tangent.to_3d()
-        
-        output.write(struct.pack(
-            "=ffffffffffff",
-            position[0],
-            position[1],
-            position[2],
-            normal[0],
-            normal[1],
-            normal[2],
-            tangent[0],
-            tangent[1],
-            tangent[2],
-            loop.bitangent_sign,
-            uv[0],
-            uv[1]
-        ))
+    buffers = cooking.mesh_cooker.cook(inputs, [mesh.name for mesh in meshes], generate_lods)
 
     t2 = time.perf_counter()
 
-    polygons = mesh.polygons
-    
-    # build per-material index lists
-    indices = []
-    for material_index in range(len(mesh.materials)):
-        indices.append([])
-        for face in (polygon for polygon in polygons if polygon.material_index == material_index):
-            face_indices = face.loop_indices
-            for i in range(len(face_indices) - 2):
-                indices[material_index].append(face_indices[0])
-                indices[material_index].append(face_indices[i + 1])
-                indices[material_index].append(face_indices[i + 2])
-    
-    # output each material as a separate index buffer
-    output.write(struct.pack("=I", len(mesh.materials)))
-    for material_index, material in enumerate(mesh.materials):
-        index_list = indices[material_index]
-
-        # material name
-        material_name_bytes = export_reference(material).encode("utf-8") if material else "__default".encode("utf-8")
-        output.write(struct.pack("=I", len(material_name_bytes)))
-        output.write(material_name_bytes)
+    print("Mesh export timings (seconds):")
+    print("  Arrays    " + str(t1 - t0))
+    print("  Cooking   " + str(t2 - t1))
+    print("  Total     " + str(t2 - t0))
 
-        # index buffer
-        output.write(struct.pack("=I", len(index_list)))
-        for index in index_list:
-            output.write(struct.pack("=I", index))
+    return buffers
 
-    t3 = time.perf_counter()
+def export_mesh_arrays(mesh, export_reference, mesh_input):
+    uv_layer_data = None
+    if len(mesh.uv_layers) > 0 and len(mesh.uv_layers[0].data) > 0:
+        uv_layer_data = mesh.uv_layers[0].data
 
-    print("Mesh export timings (seconds):")
-    print("  Tangents  " + str(t1 - t0))
-    print("  Vertices  " + str(t2 - t1))
-    print("  Indices   " + str(t3 - t2))
-    print("  Total     " + str(t3 - t0))
+        # will also compute split tangents according to sharp edges
+        try:
+            mesh.calc_tangents()
+        except:
+            print("Failed to compute tangents for mesh '%s': %s" % (mesh.name, sys.exc_info()[0]))
 
-    return output.getvalue()
+    def get_array(collection, attribute, dtype, components=1):
+        array = numpy.empty(len(collection) * components, dtype=dtype)
+        collection.foreach_get(attribute, array)
+        return array
+
+    positions = get_array(mesh.vertices, "co", numpy.float32, 3)
+    loop_vertex_indices = get_array(mesh.loops, "vertex_index", numpy.int32)
+    loop_normals = get_array(mesh.loops, "normal", numpy.float32, 3)
+    loop_tangents = get_array(mesh.loops, "tangent", numpy.float32, 3)
+    loop_bitangent_signs = get_array(mesh.loops, "bitangent_sign", numpy.float32)
+    loop_uvs = get_array(uv_layer_data, "uv", numpy.float32, 2) if uv_layer_data else None
+    polygon_loop_starts = get_array(mesh.polygons, "loop_start", numpy.int32)
+    polygon_loop_totals = get_array(mesh.polygons, "loop_total", numpy.int32)
+    polygon_material_indices = get_array(mesh.polygons, "material_index", numpy.int32)
+
+    material_names = [(export_reference(material) if material else "__default").encode("utf-8") for material in mesh.materials]
+    material_name_pointers = (ctypes.c_char_p * len(material_names))(*material_names)
+
+    float_pointer = lambda array: array.ctypes.data_as(ctypes.POINTER(ctypes.c_float)) if array is not None else None
+    int_pointer = lambda array: array.ctypes.data_as(ctypes.POINTER(ctypes.c_int))
+
+    mesh_input.vertexCount = len(mesh.vertices)
+    mesh_input.positions = float_pointer(positions)
+    mesh_input.loopCount = len(mesh.loops)
+    mesh_input.loopVertexIndices = int_pointer(loop_vertex_indices)
+    mesh_input.loopNormals = float_pointer(loop_normals)
+    mesh_input.loopTangents = float_pointer(loop_tangents)
+    mesh_input.loopBitangentSigns = float_pointer(loop_bitangent_signs)
+    mesh_input.loopUVs = float_pointer(loop_uvs)
+    mesh_input.polygonCount = len(mesh.polygons)
+    mesh_input.polygonLoopStarts = int_pointer(polygon_loop_starts)
+    mesh_input.polygonLoopTotals = int_pointer(polygon_loop_totals)
+    mesh_input.polygonMaterialIndices = int_pointer(polygon_material_indices)
+    mesh_input.materialCount = len(material_names)
+    mesh_input.materialNames = material_name_pointers
+
+    # the input only points to the arrays, they must stay alive until cooked
+    return (
+        positions, loop_vertex_indices, loop_normals, loop_tangents, loop_bitangent_signs, loop_uvs,
+        polygon_loop_starts, polygon_loop_totals, polygon_material_indices, material_names, material_name_pointers
+    )
 
 def export_action(action, export_reference):
     data = {
@@ -14,6 +14,13 @@ class LeafPreferences(bpy.types.AddonPreferences):
         default=True,
     )
 
+    live_link_lods = BoolProperty(
+        name="Mesh levels of detail in the viewport",
+        description="Simplify meshes sent to the viewport; slower updates when editing meshes, final exports always include levels of detail",
+        default=False,
+    )
+
     def draw(self, context):
         layout = self.layout
         layout.prop(self, "cuda_enabled")
+        layout.prop(self, "live_link_lods")
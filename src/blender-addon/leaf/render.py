@@ -1,3 +1,5 @@
+import ctypes
+import io
 import os
 import shutil
 
@@ -7,7 +9,8 @@ from bpy.props import (BoolProperty,
                        EnumProperty,
                        FloatProperty,
                        IntProperty,
-                       PointerProperty)
+                       PointerProperty,
+                       StringProperty)
 
 engine = None
 
@@ -63,6 +66,40 @@ class LEAF_OT_refresh(Operator):
 
         return {"FINISHED"}
 
+class LEAF_OT_bake_visibility(Operator):
+    bl_idname = "leaf.bake_visibility"
+    bl_label = "Bake Visibility"
+
+    def execute(self, context):
+        global engine
+
+        scene = context.scene
+        rd = scene.render
+
+        # make sure the engine has up-to-date scene data
+        with io.BytesIO() as f:
+            from . import export
+            export.export_data(f, bpy.data, "", False)
+            data_bytes = f.getvalue()
+
+        engine.acquire()
+        engine.dll.leaf_load_data(data_bytes, len(data_bytes))
+        engine.dll.leaf_bake_visibility.restype = ctypes.c_char_p
+        visibility = engine.dll.leaf_bake_visibility(scene.name.encode("utf-8"), rd.resolution_x, rd.resolution_y)
+        engine.release()
+
+        scene.leaf.visibility = visibility.decode("utf-8")
+
+        return {"FINISHED"}
+
+class LEAF_OT_clear_visibility(Operator):
+    bl_idname = "leaf.clear_visibility"
+    bl_label = "Clear Visibility"
+
+    def execute(self, context):
+        context.scene.leaf.visibility = ""
+        return {"FINISHED"}
+
 class LeafRenderSettings(bpy.types.PropertyGroup):
     @classmethod
     def register(cls):
@@ -87,6 +124,23 @@ class LeafRenderSettings(bpy.types.PropertyGroup):
             description="Save a detailed performance analysis for further inspection",
             default=False,
         )
+        cls.visibility = StringProperty(
+            name="Baked visibility",
+            description="Precomputed visibility sets along the camera timeline (json)",
+            default="",
+            options={"HIDDEN"}
+        )
+        cls.static_batching = BoolProperty(
+            name="Static batching",
+            description="Merge non-animated meshes sharing a material at load, grouped by spatial cell",
+            default=False,
+        )
+        cls.static_batching_cell_size = FloatProperty(
+            name="Static batching cell size",
+            description="Size of the cells in which static meshes are merged, to keep them cullable",
+            min=0.1,
+            default=32.0
+        )
         cls.bloom_threshold = FloatProperty(
             name="Bloom threshold",
             min=0.0, max=100.0,
@@ -174,6 +228,17 @@ class LeafRender_PT_export(LeafRenderButtonsPanel, Panel):
         row = layout.row(align=True)
         row.operator("leaf.refresh", text="Refresh")
 
+        row = layout.row(align=True)
+        row.operator("leaf.bake_visibility", text="Bake Visibility")
+        row.operator("leaf.clear_visibility", text="", icon='X')
+        layout.label(text="Visibility: " + ("baked" if lrd.visibility else "dynamic culling"))
+
+        row = layout.row(align=True)
+        row.prop(lrd, "static_batching", text="Static Batching")
+        sub = row.row(align=True)
+        sub.active = lrd.static_batching
+        sub.prop(lrd, "static_batching_cell_size", text="Cell Size")
+
 class LeafRender_PT_bloom(LeafRenderButtonsPanel, Panel):
     bl_label = "Bloom"
 
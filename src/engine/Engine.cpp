@@ -1,21 +1,25 @@
 #include <engine/Engine.h>
 
+#include <chrono>
 #include <cstdio>
 
 #include <windows.h>
 #include <mmsystem.h>
 
 #include <engine/Demo.h>
+#include <engine/FramePipeline.h>
 #include <engine/animation/Action.h>
 #include <engine/render/Camera.h>
 #include <engine/render/Image.h>
 #include <engine/render/Material.h>
 #include <engine/render/Mesh.h>
+#include <engine/render/MeshCodec.h>
 #include <engine/render/Renderer.h>
 #include <engine/resource/ResourceManager.h>
 #include <engine/scene/ParticleSettings.h>
 #include <engine/scene/Scene.h>
 #include <engine/render/Texture.h>
+#include <engine/thread/TaskScheduler.h>
 
 Engine *Engine::instance = nullptr;
 
@@ -24,6 +28,9 @@ void Engine::initialize(int backbufferWidth, int backbufferHeight, bool capture,
     printf("LeafEngine started\n");
 
     ResourceManager::create();
+    TaskScheduler::create();
+
+    this->capture = capture;
 
     // hide window when capturing
     this->hwnd = CreateWindow("static", "Leaf", WS_POPUP | (capture ? 0 : WS_VISIBLE), 0, 0, backbufferWidth, backbufferHeight, NULL, NULL, NULL, 0);
@@ -36,6 +43,9 @@ void Engine::shutdown()
 {
     printf("LeafEngine stopped\n");
 
+    delete this->framePipeline;
+    this->framePipeline = nullptr;
+
     ResourceManager::getInstance()->releaseResource(this->demo);
 
     delete this->renderer;
@@ -43,45 +53,105 @@ void Engine::shutdown()
 
     DestroyWindow(this->hwnd);
 
+    TaskScheduler::destroy();
     ResourceManager::destroy();
 }
 
 void Engine::loadData(const void *buffer, size_t size)
 {
+    // resources are reloaded while the update thread is idle
+    if (this->framePipeline)
+        this->framePipeline->dropFrame();
+
     const unsigned char *readPosition = (const unsigned char *)buffer;
     const unsigned char *bufferEnd = readPosition + size;
 
+    struct Entry
+    {
+        std::string typeName;
+        std::string resourceName;
+        const unsigned char *blob;
+        unsigned int blobSize;
+    };
+    std::vector<Entry> entries;
+
     while (readPosition < bufferEnd)
     {
+        Entry entry;
+
         unsigned int typeNameSize = *(unsigned int *)readPosition;
         readPosition += sizeof(unsigned int);
 
-        std::string typeName((const char *)readPosition, typeNameSize);
+        entry.typeName = std::string((const char *)readPosition, typeNameSize);
         readPosition += typeNameSize;
 
         unsigned int resourceNameSize = *(unsigned int *)readPosition;
         readPosition += sizeof(unsigned int);
 
-        std::string resourceName((const char *)readPosition, resourceNameSize);
+        entry.resourceName = std::string((const char *)readPosition, resourceNameSize);
         readPosition += resourceNameSize;
 
-        unsigned int blobSize = *(unsigned int *)readPosition;
+        entry.blobSize = *(unsigned int *)readPosition;
         readPosition += sizeof(unsigned int);
 
+        entry.blob = readPosition;
+        readPosition += entry.blobSize;
+
+        entries.push_back(entry);
+    }
+
+    // compressed meshes are decoded up front, in parallel
+    std::chrono::high_resolution_clock::time_point decodeStart = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::vector<unsigned char>> decodedBlobs(entries.size());
+    TaskScheduler::getInstance()->parallelFor((int)entries.size(), 1, [&](int begin, int end, int chunkIndex)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            if ((entries[i].typeName == "Mesh") && MeshCodec::isCompressed(entries[i].blob, entries[i].blobSize))
+                MeshCodec::decode(entries[i].blob, entries[i].blobSize, decodedBlobs[i]);
+        }
+    });
+
+    size_t compressedSize = 0;
+    size_t decodedSize = 0;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (!decodedBlobs[i].empty())
+        {
+            compressedSize += entries[i].blobSize;
+            decodedSize += decodedBlobs[i].size();
+
+            entries[i].blob = decodedBlobs[i].data();
+            entries[i].blobSize = (unsigned int)decodedBlobs[i].size();
+        }
+    }
+
+    if (decodedSize > 0)
+    {
+        double decodeTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - decodeStart).count();
+        printf("Decoded meshes, %d -> %d bytes in %.2f ms\n", (int)compressedSize, (int)decodedSize, decodeTime * 1000.0);
+    }
+
+    for (const Entry &entry : entries)
+    {
+        const std::string &typeName = entry.typeName;
+        const std::string &resourceName = entry.resourceName;
+        const unsigned char *blob = entry.blob;
+        unsigned int blobSize = entry.blobSize;
+
         printf("Loading resource %s (%s), %d bytes\n", resourceName.c_str(), typeName.c_str(), blobSize);
 
-        if (typeName == "Action") ResourceManager::getInstance()->updateResourceData<Action>(resourceName, readPosition, blobSize);
-        if (typeName == "Light") ResourceManager::getInstance()->updateResourceData<Light>(resourceName, readPosition, blobSize);
-        if (typeName == "Camera") ResourceManager::getInstance()->updateResourceData<Camera>(resourceName, readPosition, blobSize);
-        if (typeName == "Image") ResourceManager::getInstance()->updateResourceData<Image>(resourceName, readPosition, blobSize);
-        if (typeName == "Texture") ResourceManager::getInstance()->updateResourceData<Texture>(resourceName, readPosition, blobSize);
-        if (typeName == "Material") ResourceManager::getInstance()->updateResourceData<Material>(resourceName, readPosition, blobSize);
-        if (typeName == "Mesh") ResourceManager::getInstance()->updateResourceData<Mesh>(resourceName, readPosition, blobSize);
-        if (typeName == "ParticleSettings") ResourceManager::getInstance()->updateResourceData<ParticleSettings>(resourceName, readPosition, blobSize);
-        if (typeName == "Scene") ResourceManager::getInstance()->updateResourceData<Scene>(resourceName, readPosition, blobSize);
-        if (typeName == "Demo") ResourceManager::getInstance()->updateResourceData<Demo>(resourceName, readPosition, blobSize);
-
-        readPosition += blobSize;
+        if (typeName == "Action") ResourceManager::getInstance()->updateResourceData<Action>(resourceName, blob, blobSize);
+        if (typeName == "Light") ResourceManager::getInstance()->updateResourceData<Light>(resourceName, blob, blobSize);
+        if (typeName == "Camera") ResourceManager::getInstance()->updateResourceData<Camera>(resourceName, blob, blobSize);
+        if (typeName == "Image") ResourceManager::getInstance()->updateResourceData<Image>(resourceName, blob, blobSize);
+        if (typeName == "Texture") ResourceManager::getInstance()->updateResourceData<Texture>(resourceName, blob, blobSize);
+        if (typeName == "Material") ResourceManager::getInstance()->updateResourceData<Material>(resourceName, blob, blobSize);
+        if (typeName == "Mesh") ResourceManager::getInstance()->updateResourceData<Mesh>(resourceName, blob, blobSize);
+        if (typeName == "ParticleSettings") ResourceManager::getInstance()->updateResourceData<ParticleSettings>(resourceName, blob, blobSize);
+        if (typeName == "Scene") ResourceManager::getInstance()->updateResourceData<Scene>(resourceName, blob, blobSize);
+        if (typeName == "Demo") ResourceManager::getInstance()->updateResourceData<Demo>(resourceName, blob, blobSize);
     }
 }
 
@@ -95,18 +165,13 @@ void Engine::update(float time)
     if (!scene)
         return;
 
+    scene->refreshStaticGeometry();
     scene->update(time);
 }
 
 void Engine::render(int width, int height, float deltaTime)
 {
-    // process window events to avoid the window turning unresponsive
-    MSG msg;
-    while (PeekMessage(&msg, this->hwnd, 0, 0, PM_REMOVE))
-    {
-        TranslateMessage(&msg);
-        DispatchMessage(&msg);
-    }
+    this->processWindowMessages();
 
     Scene *scene = Scene::findCurrentScene(this->currentTime);
     if (!scene)
@@ -116,6 +181,38 @@ void Engine::render(int width, int height, float deltaTime)
     this->renderer->render(scene, renderSettings, deltaTime);
 }
 
+void Engine::updateAndRender(float time, int width, int height, float deltaTime)
+{
+    this->processWindowMessages();
+
+    if (!this->framePipeline)
+        this->framePipeline = new FramePipeline(!this->capture);
+
+    this->currentTime = time;
+
+    // frame updated during the previous call, rendered while the next one is updated
+    FramePipeline::Frame *frame = this->framePipeline->acquireFrame();
+
+    // resources are unloaded from the render thread, as they release device objects, and
+    // before the next request, as loading registers animations the update thread plays
+    ResourceManager::getInstance()->update();
+
+    // static batches are rebuilt here too, and used from the next update on
+    Scene *scene = Scene::findCurrentScene(time);
+    if (scene)
+        scene->refreshStaticGeometry();
+
+    this->framePipeline->requestFrame(time, width, height, deltaTime);
+
+    if (!frame)
+        return;
+
+    if (frame->scene)
+        this->renderer->render(&frame->renderList, frame->renderSettings, frame->deltaTime);
+
+    this->framePipeline->releaseFrame(frame);
+}
+
 void Engine::renderBlenderViewport(int width, int height, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix)
 {
     Scene *scene = Scene::findCurrentScene(this->currentTime);
@@ -152,3 +249,27 @@ void Engine::renderBlenderFrame(const char *sceneName, int width, int height, fl
 
     ResourceManager::getInstance()->releaseResource(renderScene);
 }
+
+void Engine::processWindowMessages()
+{
+    // process window events to avoid the window turning unresponsive
+    MSG msg;
+    while (PeekMessage(&msg, this->hwnd, 0, 0, PM_REMOVE))
+    {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+}
+
+const char *Engine::bakeVisibility(const char *sceneName, int width, int height)
+{
+    Scene *bakeScene = ResourceManager::getInstance()->requestResource<Scene>(sceneName);
+
+    printf("Baking visibility for scene %s\n", sceneName);
+    // the scene is restored to its time before the bake
+    this->bakedVisibility = bakeScene->bakeVisibility(width, height);
+
+    ResourceManager::getInstance()->releaseResource(bakeScene);
+
+    return this->bakedVisibility.c_str();
+}
@@ -8,8 +8,9 @@
 #include <glm/glm.hpp>
 
 struct cJSON;
-class Renderer;
 class Demo;
+class FramePipeline;
+class Renderer;
 
 class Engine
 {
@@ -22,20 +23,35 @@ class Engine
         void update(float time);
 
         void render(int width, int height, float deltaTime);
+
+        // pipelined alternative to update() and render(); the scene is updated on another thread, and
+        // the frame rendered is the one requested by the previous call (so there is one frame of latency)
+        // update() must not be called anymore once this is used
+        void updateAndRender(float time, int width, int height, float deltaTime);
         void renderBlenderViewport(int width, int height, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix);
         void renderBlenderFrame(const char *sceneName, int width, int height, float *outputBuffer, float time);
 
+        // returned string is valid until the next bake
+        const char *bakeVisibility(const char *sceneName, int width, int height);
+
     private:
         static Engine *instance;
 
+        void processWindowMessages();
+
         HWND hwnd;
+        bool capture;
 
         Renderer *renderer;
 
         Demo *demo;
 
+        FramePipeline *framePipeline = nullptr; // created on first use
+
         float currentTime = 0.0f;
 
+        std::string bakedVisibility;
+
     public:
         // singleton implementation
         static void create() { assert(!Engine::instance); Engine::instance = new Engine; }
@@ -0,0 +1,115 @@
+#include <engine/FramePipeline.h>
+
+#include <algorithm>
+#include <cassert>
+
+#include <engine/render/graph/GPUProfiler.h>
+#include <engine/scene/Scene.h>
+
+namespace
+{
+    size_t elapsedMicroseconds(std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now())
+    {
+        return (end > start) ? (size_t)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() : 0;
+    }
+}
+
+FramePipeline::FramePipeline(bool useBakedVisibility)
+    : useBakedVisibility(useBakedVisibility)
+{
+    this->updateThread = std::thread(&FramePipeline::updateMain, this);
+}
+
+FramePipeline::~FramePipeline()
+{
+    // frames still in flight are dropped
+    this->requestedFrames.push(nullptr);
+    this->updateThread.join();
+}
+
+void FramePipeline::requestFrame(float time, int width, int height, float deltaTime)
+{
+    assert(this->framesInFlight < FRAME_COUNT);
+
+    Frame *frame = &this->frames[this->nextFrameIndex];
+    this->nextFrameIndex = (this->nextFrameIndex + 1) % FRAME_COUNT;
+    this->framesInFlight++;
+
+    frame->time = time;
+    frame->width = width;
+    frame->height = height;
+    frame->deltaTime = deltaTime;
+    frame->requestTime = std::chrono::high_resolution_clock::now();
+
+    this->requestedFrames.push(frame);
+}
+
+FramePipeline::Frame *FramePipeline::acquireFrame()
+{
+    if (this->framesInFlight == 0)
+        return nullptr;
+
+    // only waits when the update is slower than the rendering
+    std::chrono::high_resolution_clock::time_point waitStart = std::chrono::high_resolution_clock::now();
+    Frame *frame = this->updatedFrames.pop();
+    GPUProfiler::getInstance()->addCounter("UpdateWaitUs", elapsedMicroseconds(waitStart));
+
+    // time both threads actually worked at once, the update of this frame against the rendering of the previous one
+    GPUProfiler::getInstance()->addCounter("UpdateUs", elapsedMicroseconds(frame->updateStartTime, frame->updateEndTime));
+    GPUProfiler::getInstance()->addCounter("UpdateRenderOverlapUs", elapsedMicroseconds(std::max(frame->updateStartTime, this->renderStartTime), std::min(frame->updateEndTime, this->renderEndTime)));
+
+    this->renderStartTime = std::chrono::high_resolution_clock::now();
+    return frame;
+}
+
+void FramePipeline::releaseFrame(Frame *frame)
+{
+    this->renderEndTime = std::chrono::high_resolution_clock::now();
+
+    // from the update request to the end of the rendering
+    GPUProfiler::getInstance()->addCounter("FrameLatencyUs", elapsedMicroseconds(frame->requestTime, this->renderEndTime));
+
+    this->framesInFlight--;
+}
+
+void FramePipeline::dropFrame()
+{
+    if (this->framesInFlight == 0)
+        return;
+
+    this->updatedFrames.pop();
+    this->framesInFlight--;
+}
+
+void FramePipeline::updateMain()
+{
+    while (true)
+    {
+        Frame *frame = this->requestedFrames.pop();
+        if (frame == nullptr)
+            return;
+
+        frame->updateStartTime = std::chrono::high_resolution_clock::now();
+        this->updateFrame(frame);
+        frame->updateEndTime = std::chrono::high_resolution_clock::now();
+
+        this->updatedFrames.push(frame);
+    }
+}
+
+void FramePipeline::updateFrame(Frame *frame)
+{
+    frame->renderList.clear();
+
+    Scene *scene = Scene::findCurrentScene(frame->time);
+    frame->scene = scene;
+    if (!scene)
+        return;
+
+    scene->update(frame->time);
+
+    frame->renderSettings = scene->updateRenderSettings(frame->width, frame->height);
+
+    const CameraSettings &camera = frame->renderSettings.camera;
+    scene->fillRenderList(&frame->renderList, camera.viewMatrix, camera.projectionMatrix, this->useBakedVisibility);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+
+#include <engine/render/RenderList.h>
+#include <engine/render/RenderSettings.h>
+#include <engine/thread/SpscQueue.h>
+
+class Scene;
+
+/**
+ * Runs the scene update on its own thread, one frame ahead of rendering.
+ * Each update produces a frame that is not modified afterwards (render list,
+ * render settings); frames are double-buffered, so that frame N+1 is updated
+ * while frame N is rendered. The scene transform arrays referenced by the
+ * render list are double-buffered the same way.
+ */
+class FramePipeline
+{
+    public:
+        struct Frame
+        {
+            const Scene *scene = nullptr; // null when no scene is active at this time
+            RenderSettings renderSettings;
+            RenderList renderList;
+
+            float time;
+            int width;
+            int height;
+            float deltaTime;
+
+            std::chrono::high_resolution_clock::time_point requestTime;
+
+            // set by the update thread
+            std::chrono::high_resolution_clock::time_point updateStartTime;
+            std::chrono::high_resolution_clock::time_point updateEndTime;
+        };
+
+        FramePipeline(bool useBakedVisibility);
+        ~FramePipeline(); // waits for the update in progress
+
+        // only one frame can be requested while the previous one is not released
+        void requestFrame(float time, int width, int height, float deltaTime);
+
+        // waits for the update of the last requested frame, or returns null if there is none; the update
+        // thread is then idle until the next request, so that resources can be loaded and unloaded
+        // (rendering the acquired frame after the next request overlaps it with the next update)
+        Frame *acquireFrame();
+        void releaseFrame(Frame *frame);
+
+        // waits for the update of the last requested frame and drops it, for resource changes
+        // outside of the frame loop (live editing) that may invalidate its render list
+        void dropFrame();
+
+    private:
+        void updateMain();
+        void updateFrame(Frame *frame);
+
+        bool useBakedVisibility;
+
+        static const int FRAME_COUNT = 2;
+        Frame frames[FRAME_COUNT];
+
+        // only used by the render thread
+        int nextFrameIndex = 0;
+        int framesInFlight = 0; // requested and not released yet
+
+        // rendering of the previous frame, overlapped by the update of the next one
+        std::chrono::high_resolution_clock::time_point renderStartTime;
+        std::chrono::high_resolution_clock::time_point renderEndTime;
+
+        // handoff between the threads; a null frame stops the update thread
+        SpscQueue<Frame *, 4> requestedFrames;
+        SpscQueue<Frame *, 4> updatedFrames;
+
+        std::thread updateThread;
+};
@@ -34,6 +34,11 @@ LEAFENGINE_API void leaf_render(int width, int height, float deltaTime)
     Engine::getInstance()->render(width, height, deltaTime);
 }
 
+LEAFENGINE_API void leaf_update_and_render(float time, int width, int height, float deltaTime)
+{
+    Engine::getInstance()->updateAndRender(time, width, height, deltaTime);
+}
+
 LEAFENGINE_API void leaf_render_blender_viewport(int width, int height, float view_matrix[], float projection_matrix[])
 {
     glm::mat4 viewMatrix(
@@ -78,3 +83,8 @@ LEAFENGINE_API void leaf_render_blender_frame(const char *sceneName, void *pass,
 
     Engine::getInstance()->renderBlenderFrame(sceneName, renderPass->rectx, renderPass->recty, renderPass->rect, time);
 }
+
+LEAFENGINE_API const char *leaf_bake_visibility(const char *sceneName, int width, int height)
+{
+    return Engine::getInstance()->bakeVisibility(sceneName, width, height);
+}
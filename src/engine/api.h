@@ -14,5 +14,8 @@ LEAFENGINE_API void leaf_load_data(const void *data, size_t size);
 LEAFENGINE_API void leaf_update(float time);
 
 LEAFENGINE_API void leaf_render(int width, int height, float deltaTime);
+LEAFENGINE_API void leaf_update_and_render(float time, int width, int height, float deltaTime);
 LEAFENGINE_API void leaf_render_blender_viewport(int width, int height, float view_matrix[], float projection_matrix[]);
 LEAFENGINE_API void leaf_render_blender_frame(const char *sceneName, void *pass, float time);
+
+LEAFENGINE_API const char *leaf_bake_visibility(const char *sceneName, int width, int height);
@@ -0,0 +1,79 @@
+#include <engine/memory/FrameAllocator.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+FrameAllocator::FrameAllocator(size_t blockSize)
+    : blockSize(blockSize)
+{
+}
+
+FrameAllocator::~FrameAllocator()
+{
+    for (auto &block : this->blocks)
+        delete[] block.memory;
+}
+
+void *FrameAllocator::allocate(size_t size, size_t alignment)
+{
+    assert((alignment & (alignment - 1)) == 0);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (!this->blocks.empty())
+    {
+        Block &block = this->blocks.back();
+
+        uintptr_t address = (uintptr_t)(block.memory + block.offset);
+        uintptr_t alignedAddress = (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        size_t alignedOffset = block.offset + (size_t)(alignedAddress - address);
+
+        if (alignedOffset + size <= block.size)
+        {
+            block.offset = alignedOffset + size;
+            return block.memory + alignedOffset;
+        }
+    }
+
+    // start a new block; the alignment padding always fits in the extra bytes
+    Block block;
+    block.size = std::max(this->blockSize, size + alignment);
+    block.memory = new unsigned char[block.size];
+
+    uintptr_t address = (uintptr_t)block.memory;
+    uintptr_t alignedAddress = (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    block.offset = (size_t)(alignedAddress - address) + size;
+
+    this->blocks.push_back(block);
+
+    return (void *)alignedAddress;
+}
+
+void FrameAllocator::reset()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    // merge blocks into a single one, big enough for the whole previous frame
+    if (this->blocks.size() > 1)
+    {
+        size_t totalSize = 0;
+        for (auto &block : this->blocks)
+        {
+            totalSize += block.size;
+            delete[] block.memory;
+        }
+
+        this->blocks.clear();
+        this->blockSize = std::max(this->blockSize, totalSize);
+
+        Block block;
+        block.size = this->blockSize;
+        block.memory = new unsigned char[block.size];
+        block.offset = 0;
+        this->blocks.push_back(block);
+    }
+
+    for (auto &block : this->blocks)
+        block.offset = 0;
+}
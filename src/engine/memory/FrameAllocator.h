@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+// linear allocator for data living only during one frame; everything
+// is released at once by reset(), and memory is recycled from frame to frame
+class FrameAllocator
+{
+    public:
+        FrameAllocator(size_t blockSize = 1024 * 1024);
+        ~FrameAllocator();
+
+        // thread-safe
+        void *allocate(size_t size, size_t alignment = 16);
+
+        // no constructor is called, only use with plain data
+        template <typename T>
+        T *allocate(size_t count) { return static_cast<T *>(this->allocate(sizeof(T) * count, alignof(T))); }
+
+        // the destructor of the object is never called, so it must not own any other memory
+        template <typename T, typename... Args>
+        T *create(Args&&... args) { return new (this->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...); }
+
+        template <typename T>
+        T *copy(std::initializer_list<T> list)
+        {
+            T *data = this->allocate<T>(list.size());
+            std::copy(list.begin(), list.end(), data);
+            return data;
+        }
+
+        // invalidates all previous allocations
+        void reset();
+
+    private:
+        struct Block
+        {
+            unsigned char *memory;
+            size_t size;
+            size_t offset;
+        };
+
+        size_t blockSize;
+        std::vector<Block> blocks;
+        std::mutex mutex;
+};
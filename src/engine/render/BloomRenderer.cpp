@@ -5,6 +5,7 @@
 #include <engine/render/RenderSettings.h>
 #include <engine/render/RenderTarget.h>
 #include <engine/render/Shaders.h>
+#include <engine/render/VertexFormat.h>
 #include <engine/render/graph/Batch.h>
 #include <engine/render/graph/FrameGraph.h>
 #include <engine/render/graph/Job.h>
@@ -18,15 +19,7 @@ BloomRenderer::BloomRenderer(int backbufferWidth, int backbufferHeight)
 	this->backbufferWidth = backbufferWidth;
 	this->backbufferHeight = backbufferHeight;
 
-	D3D11_INPUT_ELEMENT_DESC layout[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 40, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-	};
-	HRESULT res = Device::device->CreateInputLayout(layout, 4, bloomVS, sizeof(bloomVS), &this->inputLayout);
-	CHECK_HRESULT(res);
+	this->inputLayout = VertexFormat::createInputLayout(bloomVS, sizeof(bloomVS), false);
 
 	int width = backbufferWidth;
 	int height = backbufferHeight;
@@ -35,8 +28,8 @@ BloomRenderer::BloomRenderer(int backbufferWidth, int backbufferHeight)
 		width >>= 1;
 		height >>= 1;
 
-		this->downsampleTargets[i] = new RenderTarget(width, height, DXGI_FORMAT_R16G16B16A16_FLOAT);
-		this->blurTargets[i] = new RenderTarget(width, height, DXGI_FORMAT_R16G16B16A16_FLOAT);
+		this->downsampleTargets[i] = new RenderTarget(width, height, DXGI_FORMAT_R16G16B16A16_FLOAT, false, true);
+		this->blurTargets[i] = new RenderTarget(width, height, DXGI_FORMAT_R16G16B16A16_FLOAT, false, true);
 	}
 
 	D3D11_BUFFER_DESC cbDesc;
@@ -47,13 +40,13 @@ BloomRenderer::BloomRenderer(int backbufferWidth, int backbufferHeight)
 	cbDesc.MiscFlags = 0;
 	cbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 
-	res = Device::device->CreateBuffer(&cbDesc, nullptr, &this->constantBuffer);
+	HRESULT res = Device::device->CreateBuffer(&cbDesc, nullptr, &this->constantBuffer);
 	CHECK_HRESULT(res);
 }
 
 BloomRenderer::~BloomRenderer()
 {
-	this->inputLayout->Release();
+	StateObjects::release(this->inputLayout);
 
 	for (int i = 0; i < DOWNSAMPLE_LEVELS; i++)
 	{
@@ -80,38 +73,38 @@ void BloomRenderer::render(FrameGraph *frameGraph, const RenderSettings &setting
 	if (settings.bloom.debug)
 	{
 		Pass *pass = frameGraph->addPass("BloomDebug");
-		pass->setTargets({ outputTarget->getTarget() }, nullptr);
+		pass->setRenderTargets({ outputTarget }, nullptr);
 		pass->setViewport((float)outputTarget->getWidth(), (float)outputTarget->getHeight(), glm::mat4(1.0f), glm::mat4(1.0f));
 
 		Batch *batch = pass->addBatch("");
 		batch->setShaderConstants(this->constantBuffer);
-		batch->setResources({ inputTarget->getSRV() });
+		batch->setResources({ inputTarget });
 		batch->setSamplers({ inputTarget->getSamplerState() });
 		batch->setVertexShader(Shaders::vertex.bloom);
 		batch->setPixelShader(Shaders::pixel.bloomDebug);
 		batch->setInputLayout(this->inputLayout);
 
 		Job *job = batch->addJob();
-        job->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexCount);
+        job->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexFormat, quadSubMesh.firstIndex, quadSubMesh.indexCount);
         job->addInstance();
 
 		return;
 	}
 
 	Pass *thresholdPass = frameGraph->addPass("BloomThreshold");
-	thresholdPass->setTargets({ this->downsampleTargets[0]->getTarget() }, nullptr);
+	thresholdPass->setRenderTargets({ this->downsampleTargets[0] }, nullptr);
 	thresholdPass->setViewport((float)this->downsampleTargets[0]->getWidth(), (float)this->downsampleTargets[0]->getHeight(), glm::mat4(1.0f), glm::mat4(1.0f));
 
 	Batch *thresholdBatch = thresholdPass->addBatch("");
 	thresholdBatch->setShaderConstants(this->constantBuffer);
-	thresholdBatch->setResources({ inputTarget->getSRV() });
+	thresholdBatch->setResources({ inputTarget });
 	thresholdBatch->setSamplers({ inputTarget->getSamplerState() });
 	thresholdBatch->setVertexShader(Shaders::vertex.bloom);
 	thresholdBatch->setPixelShader(Shaders::pixel.bloomThreshold);
 	thresholdBatch->setInputLayout(this->inputLayout);
 
     Job *thresholdJob = thresholdBatch->addJob();
-    thresholdJob->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexCount);
+    thresholdJob->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexFormat, quadSubMesh.firstIndex, quadSubMesh.indexCount);
     thresholdJob->addInstance();
 
 	// downsample
@@ -121,19 +114,19 @@ void BloomRenderer::render(FrameGraph *frameGraph, const RenderSettings &setting
 		RenderTarget *destination = this->downsampleTargets[i];
 
 		Pass *pass = frameGraph->addPass("BloomDownsample");
-		pass->setTargets({ destination->getTarget() }, nullptr);
+		pass->setRenderTargets({ destination }, nullptr);
 		pass->setViewport((float)destination->getWidth(), (float)destination->getHeight(), glm::mat4(1.0f), glm::mat4(1.0f));
 
 		Batch *batch = pass->addBatch("");
 		batch->setShaderConstants(this->constantBuffer);
-		batch->setResources({ source->getSRV() });
+		batch->setResources({ source });
 		batch->setSamplers({ source->getSamplerState() });
 		batch->setVertexShader(Shaders::vertex.bloom);
 		batch->setPixelShader(Shaders::pixel.bloomDownsample);
 		batch->setInputLayout(this->inputLayout);
 
 		Job *job = batch->addJob();
-        job->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexCount);
+        job->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexFormat, quadSubMesh.firstIndex, quadSubMesh.indexCount);
         job->addInstance();
 	}
 
@@ -145,19 +138,19 @@ void BloomRenderer::render(FrameGraph *frameGraph, const RenderSettings &setting
 		RenderTarget *destination = (i == 0) ? outputTarget : this->blurTargets[i];
 
 		Pass *pass = frameGraph->addPass("BloomUpsample");
-		pass->setTargets({ destination->getTarget() }, nullptr);
+		pass->setRenderTargets({ destination }, nullptr);
 		pass->setViewport((float)destination->getWidth(), (float)destination->getHeight(), glm::mat4(1.0f), glm::mat4(1.0f));
 
 		Batch *batch = pass->addBatch("");
 		batch->setShaderConstants(this->constantBuffer);
-		batch->setResources({ source->getSRV(), accumulator->getSRV() });
+		batch->setResources({ source, accumulator });
 		batch->setSamplers({ source->getSamplerState(), accumulator->getSamplerState() });
 		batch->setVertexShader(Shaders::vertex.bloom);
 		batch->setPixelShader(Shaders::pixel.bloomAccumulation);
 		batch->setInputLayout(this->inputLayout);
 
 		Job *job = batch->addJob();
-        job->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexCount);
+        job->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexFormat, quadSubMesh.firstIndex, quadSubMesh.indexCount);
         job->addInstance();
 	}
 }
@@ -3,6 +3,7 @@
 #include <d3d11.h>
 
 #include <engine/render/Mesh.h>
+#include <engine/render/StateObjects.h>
 
 class FrameGraph;
 struct RenderSettings;
@@ -20,7 +21,7 @@ class BloomRenderer
 		int backbufferWidth;
 		int backbufferHeight;
 
-		ID3D11InputLayout *inputLayout;
+		StateObjects::Id inputLayout;
 
 		static const int DOWNSAMPLE_LEVELS = 8;
 		RenderTarget *downsampleTargets[DOWNSAMPLE_LEVELS];
@@ -2,11 +2,13 @@
 
 #include <d3d11.h>
 
+#include <engine/render/StateObjects.h>
+#include <engine/render/graph/Job.h>
+
 class AnimationData;
 class Batch;
 class PropertyMapping;
 struct RenderSettings;
-struct ShadowConstants;
 class Texture;
 
 class Bsdf
@@ -15,5 +17,20 @@ class Bsdf
         virtual ~Bsdf() {}
 
         virtual void registerAnimatedProperties(PropertyMapping &properties) {}
-        virtual void setupBatch(Batch *batch, const RenderSettings &settings, ID3D11ShaderResourceView *shadowSRV, ID3D11SamplerState *shadowSampler, ShadowConstants *shadowConstants) {}
+        // shaders and resources; constants are given per job (see uploadConstants())
+        virtual void setupBatch(Batch *batch, const RenderSettings &settings, ID3D11ShaderResourceView *shadowSRV, StateObjects::Id shadowSampler) {}
+
+        // animated properties are written by the scene update, so the render thread uploads a copy
+        // captured right after it; the size is the same for all instances of a bsdf
+        virtual size_t getConstantsSize() const = 0;
+        virtual void captureConstants(void *constants) const = 0;
+
+        // copies captured constants to the shader constant ring buffer
+        virtual Job::ShaderConstants uploadConstants(const void *constants) const = 0;
+
+        // true if the batch set up by the other bsdf can be used as is, only the constants differ
+        virtual bool canShareBatch(const Bsdf *other) const { return false; }
+
+        // projected size of an object using the bsdf, in NDC units, for texture streaming; thread safe
+        virtual void requestScreenSize(float screenSize) const {}
 };
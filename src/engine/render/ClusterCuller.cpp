@@ -0,0 +1,87 @@
+#include <engine/render/ClusterCuller.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+namespace
+{
+    // visibility of the clusters of the submesh being culled
+    thread_local std::vector<uint8_t> visibleClusters;
+}
+
+ClusterCuller::ClusterCuller(const glm::mat4 &viewProjectionMatrix, const glm::mat4 *transforms)
+    : frustum(viewProjectionMatrix)
+    , transforms(transforms)
+{
+    // the camera projects to w = 0 with x = y = 0, a point at infinity for parallel projections
+    glm::vec4 camera = glm::inverse(viewProjectionMatrix) * glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+    this->perspective = glm::abs(camera.w) > 1e-12f;
+    this->cameraPosition = this->perspective ? glm::vec3(camera) / camera.w : glm::vec3(0.0f);
+}
+
+RenderList::ClusterDraw *ClusterCuller::cull(RenderList *renderList, const Mesh *mesh, const Mesh::SubMesh &subMesh, int transformIndex, int &culledTriangleCount) const
+{
+    culledTriangleCount = 0;
+
+    const glm::mat4 &transform = this->transforms[transformIndex];
+    const Mesh::Cluster *clusters = mesh->getClusters().data() + subMesh.firstCluster;
+
+    // spheres are scaled by the largest axis; cones are tested in local space, where facing is the same
+    // unless the transform mirrors the triangles
+    float scale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    bool testCones = this->perspective && (glm::determinant(glm::mat3(transform)) > 0.0f);
+    glm::vec3 localCamera = testCones ? glm::vec3(glm::affineInverse(transform) * glm::vec4(this->cameraPosition, 1.0f)) : glm::vec3(0.0f);
+
+    std::vector<uint8_t> &visible = visibleClusters;
+    visible.resize(subMesh.clusterCount);
+
+    int visibleIndexCount = 0;
+    for (int i = 0; i < subMesh.clusterCount; i++)
+    {
+        const Mesh::Cluster &cluster = clusters[i];
+
+        bool inside = this->frustum.intersects(glm::vec3(transform * glm::vec4(cluster.center, 1.0f)), cluster.radius * scale);
+
+        if (inside && testCones)
+        {
+            glm::vec3 direction = cluster.center - localCamera;
+            inside = glm::dot(direction, cluster.coneAxis) < cluster.coneCutoff * glm::length(direction) + cluster.radius;
+        }
+
+        visible[i] = inside ? 1 : 0;
+        if (inside)
+            visibleIndexCount += cluster.indexCount;
+        else
+            culledTriangleCount += cluster.indexCount / 3;
+    }
+
+    if (culledTriangleCount == 0)
+        return nullptr;
+
+    // visible clusters are ranges of the submesh, neighbours are copied together
+    RenderList::ClusterDraw *clusterDraw = renderList->allocateClusterDraw(visibleIndexCount);
+    const uint32_t *indices = mesh->getClusterIndices().data();
+
+    int writeIndex = 0;
+    for (int i = 0; i < subMesh.clusterCount; )
+    {
+        if (!visible[i])
+        {
+            i++;
+            continue;
+        }
+
+        int firstIndex = clusters[i].firstIndex;
+        int indexCount = 0;
+        for (; (i < subMesh.clusterCount) && visible[i]; i++)
+            indexCount += clusters[i].indexCount;
+
+        memcpy(clusterDraw->indices + writeIndex, indices + firstIndex, sizeof(uint32_t) * indexCount);
+        writeIndex += indexCount;
+    }
+
+    return clusterDraw;
+}
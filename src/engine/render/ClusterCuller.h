@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <engine/render/Frustum.h>
+#include <engine/render/Mesh.h>
+#include <engine/render/RenderList.h>
+
+// culls the clusters of full detail submeshes against the camera: bounding spheres outside of the
+// frustum, and normal cones facing away from the camera position
+class ClusterCuller
+{
+    public:
+        ClusterCuller(const glm::mat4 &viewProjectionMatrix, const glm::mat4 *transforms);
+
+        // thread-safe; returns the indices of the visible clusters of a submesh placed by the given
+        // transform, or null when nothing is culled and the submesh can be drawn as is
+        RenderList::ClusterDraw *cull(RenderList *renderList, const Mesh *mesh, const Mesh::SubMesh &subMesh, int transformIndex, int &culledTriangleCount) const;
+
+    private:
+        Frustum frustum; // spheres are tested in world space
+
+        glm::vec3 cameraPosition;
+        bool perspective; // cones can't cull under parallel projections
+
+        const glm::mat4 *transforms;
+};
@@ -0,0 +1,358 @@
+#include <engine/render/ClusteredLights.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include <xmmintrin.h>
+
+#include <engine/render/Device.h>
+#include <engine/render/RenderList.h>
+#include <engine/render/graph/GPUProfiler.h>
+#include <engine/render/shaders/constants/SceneConstants.h>
+#include <engine/thread/TaskScheduler.h>
+
+static const int MIN_LIGHT_CAPACITY = 64;
+static const int MIN_LIGHT_INDEX_CAPACITY = 1024;
+static const int CLUSTER_COUNT = LIGHT_CLUSTER_COUNT_X * LIGHT_CLUSTER_COUNT_Y * LIGHT_CLUSTER_COUNT_Z;
+
+ClusteredLights::ClusteredLights()
+{
+    this->lightBuffer.stride = sizeof(LightData);
+    this->clusterBuffer.stride = sizeof(LightClusterData);
+    this->lightIndexBuffer.stride = sizeof(uint32_t);
+
+    resizeBuffer(this->lightBuffer, MIN_LIGHT_CAPACITY);
+    resizeBuffer(this->clusterBuffer, CLUSTER_COUNT);
+    resizeBuffer(this->lightIndexBuffer, MIN_LIGHT_INDEX_CAPACITY);
+}
+
+ClusteredLights::~ClusteredLights()
+{
+    releaseBuffer(this->lightBuffer);
+    releaseBuffer(this->clusterBuffer);
+    releaseBuffer(this->lightIndexBuffer);
+}
+
+void ClusteredLights::update(const RenderList *renderList, const std::vector<int> &shadowIndices, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix, SceneConstants *sceneConstants)
+{
+    std::chrono::high_resolution_clock::time_point buildStart = std::chrono::high_resolution_clock::now();
+
+    // scattering lights come first, so the in-scattering loop doesn't need the clusters
+    const std::vector<RenderList::Light> &renderLights = renderList->getLights();
+    std::vector<int> order;
+    order.reserve(renderLights.size());
+    for (int i = 0; i < renderLights.size(); i++)
+    {
+        if (renderLights[i].spot && renderLights[i].scattering != 0.0f)
+            order.push_back(i);
+    }
+
+    int scatteringLightCount = (int)order.size();
+    for (int i = 0; i < renderLights.size(); i++)
+    {
+        if (!renderLights[i].spot || renderLights[i].scattering == 0.0f)
+            order.push_back(i);
+    }
+
+    int lightCount = (int)order.size();
+    this->lights.resize(lightCount);
+    this->clusterLights.resize(lightCount);
+    for (int i = 0; i < lightCount; i++)
+    {
+        const RenderList::Light &renderLight = renderLights[order[i]];
+
+        LightData &light = this->lights[i];
+        light.position = renderLight.position;
+        light.radius = renderLight.radius;
+        light.color = renderLight.color;
+        light.direction = renderLight.direction;
+        light.scattering = renderLight.scattering;
+        light.shadowIndex = shadowIndices[order[i]];
+        light._padding0 = 0.0f;
+        light._padding1 = 0.0f;
+
+        glm::vec3 viewPosition = glm::vec3(viewMatrix * glm::vec4(renderLight.position, 1.0f));
+
+        ClusterLight &clusterLight = this->clusterLights[i];
+        clusterLight.position = glm::vec3(viewPosition.x, viewPosition.y, -viewPosition.z);
+        clusterLight.radius = renderLight.radius;
+        clusterLight.spot = renderLight.spot;
+
+        if (renderLight.spot)
+        {
+            // angle falloff precomputations
+            float cosOuterAngle = cosf(renderLight.angle * 0.5f);
+            float cosInnerAngle = glm::mix(cosOuterAngle + 0.001f, 1.0f, renderLight.blend);
+            light.cosAngleScale = 1.0f / (cosInnerAngle - cosOuterAngle);
+            light.cosAngleOffset = -cosOuterAngle * light.cosAngleScale;
+
+            glm::vec3 viewDirection = glm::vec3(viewMatrix * glm::vec4(renderLight.direction, 0.0f));
+            clusterLight.direction = glm::vec3(viewDirection.x, viewDirection.y, -viewDirection.z);
+            clusterLight.cosHalfAngle = cosOuterAngle;
+            clusterLight.sinHalfAngle = sinf(renderLight.angle * 0.5f);
+        }
+        else
+        {
+            light.cosAngleScale = 0.0f;
+            light.cosAngleOffset = 1.0f;
+
+            clusterLight.direction = glm::vec3(0.0f, 0.0f, 1.0f);
+            clusterLight.cosHalfAngle = 0.0f;
+            clusterLight.sinHalfAngle = 1.0f;
+        }
+    }
+
+    // depth range of the camera, sliced exponentially
+    float nearDepth, farDepth;
+    if (projectionMatrix[2][3] != 0.0f)
+    {
+        nearDepth = projectionMatrix[3][2] / (projectionMatrix[2][2] - 1.0f);
+        farDepth = projectionMatrix[3][2] / (projectionMatrix[2][2] + 1.0f);
+    }
+    else
+    {
+        nearDepth = (projectionMatrix[3][2] + 1.0f) / projectionMatrix[2][2];
+        farDepth = (projectionMatrix[3][2] - 1.0f) / projectionMatrix[2][2];
+    }
+
+    nearDepth = std::max(nearDepth, 0.01f);
+    farDepth = std::max(farDepth, nearDepth * 2.0f);
+
+    float logDepthRange = logf(farDepth / nearDepth);
+    sceneConstants->lightCount = lightCount;
+    sceneConstants->scatteringLightCount = scatteringLightCount;
+    sceneConstants->lightClusterDepthScale = (float)LIGHT_CLUSTER_COUNT_Z / logDepthRange;
+    sceneConstants->lightClusterDepthBias = -(float)LIGHT_CLUSTER_COUNT_Z * logf(nearDepth) / logDepthRange;
+
+    TaskScheduler::getInstance()->parallelFor(LIGHT_CLUSTER_COUNT_Z, 1, [&](int begin, int end, int chunkIndex)
+    {
+        for (int i = begin; i < end; i++)
+            this->buildSlice(this->slices[i], i, projectionMatrix, nearDepth, farDepth);
+    });
+
+    // gather the slices
+    LightClusterData clusters[CLUSTER_COUNT];
+    uint32_t indexCount = 0;
+    for (int i = 0; i < LIGHT_CLUSTER_COUNT_Z; i++)
+    {
+        const Slice &slice = this->slices[i];
+
+        uint32_t offset = indexCount;
+        for (int j = 0; j < CLUSTER_COUNT_PER_SLICE; j++)
+        {
+            LightClusterData &cluster = clusters[i * CLUSTER_COUNT_PER_SLICE + j];
+            cluster.lightOffset = offset;
+            cluster.lightCount = slice.clusterLightCounts[j];
+            offset += slice.clusterLightCounts[j];
+        }
+
+        indexCount += (uint32_t)slice.lightIndices.size();
+    }
+
+    this->lightIndices.clear();
+    for (int i = 0; i < LIGHT_CLUSTER_COUNT_Z; i++)
+        this->lightIndices.insert(this->lightIndices.end(), this->slices[i].lightIndices.begin(), this->slices[i].lightIndices.end());
+
+    uploadBuffer(this->lightBuffer, this->lights.data(), lightCount);
+    uploadBuffer(this->clusterBuffer, clusters, CLUSTER_COUNT);
+    uploadBuffer(this->lightIndexBuffer, this->lightIndices.data(), indexCount);
+
+    size_t buildTime = (size_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - buildStart).count();
+    GPUProfiler::getInstance()->addCounter("LightClusterBuildUs", buildTime);
+    GPUProfiler::getInstance()->addCounter("LightClusterIndexCount", indexCount);
+}
+
+void ClusteredLights::buildSlice(Slice &slice, int sliceIndex, const glm::mat4 &projectionMatrix, float nearDepth, float farDepth)
+{
+    // the first and last slices also hold what is in front of and behind the depth range
+    float depthRatio = farDepth / nearDepth;
+    slice.minDepth = (sliceIndex > 0) ? nearDepth * powf(depthRatio, (float)sliceIndex / LIGHT_CLUSTER_COUNT_Z) : 0.0f;
+    slice.maxDepth = (sliceIndex < LIGHT_CLUSTER_COUNT_Z - 1) ? nearDepth * powf(depthRatio, (float)(sliceIndex + 1) / LIGHT_CLUSTER_COUNT_Z) : FLT_MAX;
+
+    // tile bounds: x = (ndc + P20) * depth / P00 in perspective, x = (ndc - P30) / P00 in orthographic
+    bool perspective = (projectionMatrix[2][3] != 0.0f);
+    float farthestDepth = std::min(slice.maxDepth, farDepth * 2.0f);
+    for (int x = 0; x < LIGHT_CLUSTER_COUNT_X; x++)
+    {
+        float ndc0 = (float)x / LIGHT_CLUSTER_COUNT_X * 2.0f - 1.0f;
+        float ndc1 = (float)(x + 1) / LIGHT_CLUSTER_COUNT_X * 2.0f - 1.0f;
+        if (perspective)
+        {
+            float slope0 = (ndc0 + projectionMatrix[2][0]) / projectionMatrix[0][0];
+            float slope1 = (ndc1 + projectionMatrix[2][0]) / projectionMatrix[0][0];
+            slice.minX[x] = std::min(slope0 * slice.minDepth, slope0 * farthestDepth);
+            slice.maxX[x] = std::max(slope1 * slice.minDepth, slope1 * farthestDepth);
+        }
+        else
+        {
+            slice.minX[x] = (ndc0 - projectionMatrix[3][0]) / projectionMatrix[0][0];
+            slice.maxX[x] = (ndc1 - projectionMatrix[3][0]) / projectionMatrix[0][0];
+        }
+    }
+
+    // rows go from the top of the screen
+    for (int y = 0; y < LIGHT_CLUSTER_COUNT_Y; y++)
+    {
+        float ndc0 = 1.0f - (float)(y + 1) / LIGHT_CLUSTER_COUNT_Y * 2.0f;
+        float ndc1 = 1.0f - (float)y / LIGHT_CLUSTER_COUNT_Y * 2.0f;
+        if (perspective)
+        {
+            float slope0 = (ndc0 + projectionMatrix[2][1]) / projectionMatrix[1][1];
+            float slope1 = (ndc1 + projectionMatrix[2][1]) / projectionMatrix[1][1];
+            slice.minY[y] = std::min(slope0 * slice.minDepth, slope0 * farthestDepth);
+            slice.maxY[y] = std::max(slope1 * slice.minDepth, slope1 * farthestDepth);
+        }
+        else
+        {
+            slice.minY[y] = (ndc0 - projectionMatrix[3][1]) / projectionMatrix[1][1];
+            slice.maxY[y] = (ndc1 - projectionMatrix[3][1]) / projectionMatrix[1][1];
+        }
+    }
+
+    slice.clusterLights.clear();
+
+    const __m128 zero = _mm_setzero_ps();
+    float centerDepth = (slice.minDepth + farthestDepth) * 0.5f;
+    float halfDepth = (farthestDepth - slice.minDepth) * 0.5f;
+
+    for (int i = 0; i < (int)this->clusterLights.size(); i++)
+    {
+        const ClusterLight &light = this->clusterLights[i];
+        if (light.position.z + light.radius < slice.minDepth || light.position.z - light.radius > slice.maxDepth)
+            continue;
+
+        float dz = std::max(0.0f, std::max(slice.minDepth - light.position.z, light.position.z - farthestDepth));
+        float radiusSquared = light.radius * light.radius;
+
+        const __m128 lightX = _mm_set1_ps(light.position.x);
+        const __m128 radiusSquared4 = _mm_set1_ps(radiusSquared);
+
+        for (int y = 0; y < LIGHT_CLUSTER_COUNT_Y; y++)
+        {
+            float dy = std::max(0.0f, std::max(slice.minY[y] - light.position.y, light.position.y - slice.maxY[y]));
+            float distanceSquaredYZ = dy * dy + dz * dz;
+            if (distanceSquaredYZ > radiusSquared)
+                continue;
+
+            const __m128 distanceSquaredYZ4 = _mm_set1_ps(distanceSquaredYZ);
+            for (int x = 0; x < LIGHT_CLUSTER_COUNT_X; x += 4)
+            {
+                // sphere vs box
+                __m128 minX = _mm_loadu_ps(&slice.minX[x]);
+                __m128 maxX = _mm_loadu_ps(&slice.maxX[x]);
+                __m128 dx = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(minX, lightX), _mm_sub_ps(lightX, maxX)));
+                __m128 distanceSquared = _mm_add_ps(_mm_mul_ps(dx, dx), distanceSquaredYZ4);
+                int mask = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, radiusSquared4));
+
+                if (mask != 0 && light.spot)
+                {
+                    // cone vs bounding sphere of the clusters
+                    float centerY = (slice.minY[y] + slice.maxY[y]) * 0.5f;
+                    float halfY = (slice.maxY[y] - slice.minY[y]) * 0.5f;
+
+                    __m128 half = _mm_mul_ps(_mm_sub_ps(maxX, minX), _mm_set1_ps(0.5f));
+                    __m128 sphereRadius = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(half, half), _mm_set1_ps(halfY * halfY + halfDepth * halfDepth)));
+
+                    __m128 vx = _mm_sub_ps(_mm_add_ps(minX, half), lightX);
+                    __m128 vy = _mm_set1_ps(centerY - light.position.y);
+                    __m128 vz = _mm_set1_ps(centerDepth - light.position.z);
+                    __m128 lengthSquared = _mm_add_ps(_mm_mul_ps(vx, vx), _mm_add_ps(_mm_mul_ps(vy, vy), _mm_mul_ps(vz, vz)));
+                    __m128 axisLength = _mm_add_ps(_mm_mul_ps(vx, _mm_set1_ps(light.direction.x)), _mm_add_ps(_mm_mul_ps(vy, _mm_set1_ps(light.direction.y)), _mm_mul_ps(vz, _mm_set1_ps(light.direction.z))));
+                    __m128 axisDistance = _mm_sqrt_ps(_mm_max_ps(zero, _mm_sub_ps(lengthSquared, _mm_mul_ps(axisLength, axisLength))));
+                    __m128 closestDistance = _mm_sub_ps(_mm_mul_ps(axisDistance, _mm_set1_ps(light.cosHalfAngle)), _mm_mul_ps(axisLength, _mm_set1_ps(light.sinHalfAngle)));
+
+                    __m128 culled = _mm_or_ps(_mm_cmpgt_ps(closestDistance, sphereRadius), _mm_cmplt_ps(axisLength, _mm_sub_ps(zero, sphereRadius)));
+                    mask &= ~_mm_movemask_ps(culled);
+                }
+
+                for (int j = 0; j < 4; j++)
+                {
+                    if (mask & (1 << j))
+                        slice.clusterLights.push_back(((uint32_t)(y * LIGHT_CLUSTER_COUNT_X + x + j) << 24) | (uint32_t)i);
+                }
+            }
+        }
+    }
+
+    // counting sort by cluster, lights keep their order inside each cluster
+    std::fill(slice.clusterLightCounts, slice.clusterLightCounts + CLUSTER_COUNT_PER_SLICE, 0);
+    for (uint32_t clusterLight : slice.clusterLights)
+        slice.clusterLightCounts[clusterLight >> 24]++;
+
+    uint32_t offsets[CLUSTER_COUNT_PER_SLICE];
+    uint32_t offset = 0;
+    for (int i = 0; i < CLUSTER_COUNT_PER_SLICE; i++)
+    {
+        offsets[i] = offset;
+        offset += slice.clusterLightCounts[i];
+    }
+
+    slice.lightIndices.resize(slice.clusterLights.size());
+    for (uint32_t clusterLight : slice.clusterLights)
+        slice.lightIndices[offsets[clusterLight >> 24]++] = clusterLight & 0xffffff;
+}
+
+void ClusteredLights::resizeBuffer(StructuredBuffer &buffer, int capacity)
+{
+    releaseBuffer(buffer);
+
+    buffer.capacity = capacity;
+
+    D3D11_BUFFER_DESC bufferDesc;
+    bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+    bufferDesc.ByteWidth = capacity * buffer.stride;
+    bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    bufferDesc.StructureByteStride = buffer.stride;
+    bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+    HRESULT res = Device::device->CreateBuffer(&bufferDesc, NULL, &buffer.buffer);
+    CHECK_HRESULT(res);
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+    ZeroMemory(&srvDesc, sizeof(srvDesc));
+    srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+    srvDesc.Buffer.FirstElement = 0;
+    srvDesc.Buffer.NumElements = capacity;
+
+    res = Device::device->CreateShaderResourceView(buffer.buffer, &srvDesc, &buffer.srv);
+    CHECK_HRESULT(res);
+}
+
+void ClusteredLights::releaseBuffer(StructuredBuffer &buffer)
+{
+    if (buffer.buffer)
+    {
+        buffer.buffer->Release();
+        buffer.srv->Release();
+        buffer.buffer = nullptr;
+        buffer.srv = nullptr;
+    }
+}
+
+void ClusteredLights::uploadBuffer(StructuredBuffer &buffer, const void *data, int count)
+{
+    if (count == 0)
+        return;
+
+    if (count > buffer.capacity)
+    {
+        int capacity = buffer.capacity;
+        while (capacity < count)
+            capacity *= 2;
+
+        resizeBuffer(buffer, capacity);
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mappedResource;
+    HRESULT res = Device::context->Map(buffer.buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+    CHECK_HRESULT(res);
+
+    memcpy(mappedResource.pData, data, count * buffer.stride);
+
+    Device::context->Unmap(buffer.buffer, 0);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <d3d11.h>
+#include <glm/glm.hpp>
+
+#include <engine/render/shaders/constants/LightData.h>
+
+class RenderList;
+struct SceneConstants;
+
+/**
+ * Assigns the lights of the frame to the froxels of the camera on the CPU, so that
+ * each pixel only shades the lights touching its cluster (see shaders/lights.h).
+ * Slices are processed in parallel, and lights are tested against four clusters
+ * at a time (sphere vs box for all lights, then cone vs sphere for spot lights).
+ */
+class ClusteredLights
+{
+    public:
+        ClusteredLights();
+        ~ClusteredLights();
+
+        // also fills the light fields of the scene constants; shadow indices are given per light of the list
+        void update(const RenderList *renderList, const std::vector<int> &shadowIndices, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix, SceneConstants *sceneConstants);
+
+        ID3D11ShaderResourceView *getLightSRV() const { return this->lightBuffer.srv; }
+        ID3D11ShaderResourceView *getClusterSRV() const { return this->clusterBuffer.srv; }
+        ID3D11ShaderResourceView *getLightIndexSRV() const { return this->lightIndexBuffer.srv; }
+
+    private:
+        struct StructuredBuffer
+        {
+            ID3D11Buffer *buffer = nullptr;
+            ID3D11ShaderResourceView *srv = nullptr;
+            int capacity = 0;
+            int stride = 0;
+        };
+
+        static void resizeBuffer(StructuredBuffer &buffer, int capacity);
+        static void releaseBuffer(StructuredBuffer &buffer);
+        static void uploadBuffer(StructuredBuffer &buffer, const void *data, int count); // grows when needed
+
+        // in the cluster space: view space with depth instead of z (x, y, -z)
+        struct ClusterLight
+        {
+            glm::vec3 position;
+            float radius;
+            glm::vec3 direction;
+            float cosHalfAngle; // 0 for point lights
+            float sinHalfAngle;
+            bool spot;
+        };
+
+        static const int CLUSTER_COUNT_PER_SLICE = LIGHT_CLUSTER_COUNT_X * LIGHT_CLUSTER_COUNT_Y;
+        static_assert(LIGHT_CLUSTER_COUNT_X % 4 == 0, "clusters are tested four at a time along x");
+        static_assert(CLUSTER_COUNT_PER_SLICE <= 256, "cluster index must fit in 8 bits");
+
+        struct Slice
+        {
+            // view space bounds of the clusters, x and y are given per column and row
+            float minX[LIGHT_CLUSTER_COUNT_X];
+            float maxX[LIGHT_CLUSTER_COUNT_X];
+            float minY[LIGHT_CLUSTER_COUNT_Y];
+            float maxY[LIGHT_CLUSTER_COUNT_Y];
+            float minDepth;
+            float maxDepth;
+
+            // cluster index in the slice (8 bits) and light index (24 bits)
+            std::vector<uint32_t> clusterLights;
+
+            // light indices sorted by cluster
+            std::vector<uint32_t> lightIndices;
+            uint32_t clusterLightCounts[CLUSTER_COUNT_PER_SLICE];
+        };
+
+        void buildSlice(Slice &slice, int sliceIndex, const glm::mat4 &projectionMatrix, float nearDepth, float farDepth);
+
+        std::vector<LightData> lights;
+        std::vector<ClusterLight> clusterLights;
+        Slice slices[LIGHT_CLUSTER_COUNT_Z];
+        std::vector<uint32_t> lightIndices;
+
+
+        StructuredBuffer lightBuffer;
+        StructuredBuffer clusterBuffer;
+        StructuredBuffer lightIndexBuffer;
+};
@@ -0,0 +1,52 @@
+#include <engine/render/Frustum.h>
+
+Frustum::Frustum(const glm::mat4 &viewProjectionMatrix)
+{
+    // Gribb-Hartmann extraction; uses the [-1, 1] depth range of glm
+    // projections, which is also conservative for a [0, 1] range
+    glm::mat4 m = glm::transpose(viewProjectionMatrix);
+    this->planes[0] = m[3] + m[0]; // left
+    this->planes[1] = m[3] - m[0]; // right
+    this->planes[2] = m[3] + m[1]; // bottom
+    this->planes[3] = m[3] - m[1]; // top
+    this->planes[4] = m[3] + m[2]; // near
+    this->planes[5] = m[3] - m[2]; // far
+
+    for (int i = 0; i < 6; i++)
+        this->planes[i] /= glm::length(glm::vec3(this->planes[i]));
+}
+
+bool Frustum::intersects(const glm::vec3 &minBound, const glm::vec3 &maxBound, const glm::mat4 &transform) const
+{
+    // world space OBB as center and half axes
+    glm::vec3 localCenter = (minBound + maxBound) * 0.5f;
+    glm::vec3 localExtent = (maxBound - minBound) * 0.5f;
+
+    glm::vec3 center = glm::vec3(transform * glm::vec4(localCenter, 1.0f));
+    glm::vec3 axisX = glm::vec3(transform[0]) * localExtent.x;
+    glm::vec3 axisY = glm::vec3(transform[1]) * localExtent.y;
+    glm::vec3 axisZ = glm::vec3(transform[2]) * localExtent.z;
+
+    for (int i = 0; i < 6; i++)
+    {
+        glm::vec3 normal = glm::vec3(this->planes[i]);
+
+        // projected radius of the box on the plane normal
+        float radius = glm::abs(glm::dot(normal, axisX)) + glm::abs(glm::dot(normal, axisY)) + glm::abs(glm::dot(normal, axisZ));
+        if (glm::dot(normal, center) + this->planes[i].w < -radius)
+            return false;
+    }
+
+    return true;
+}
+
+bool Frustum::intersects(const glm::vec3 &center, float radius) const
+{
+    for (int i = 0; i < 6; i++)
+    {
+        if (glm::dot(glm::vec3(this->planes[i]), center) + this->planes[i].w < -radius)
+            return false;
+    }
+
+    return true;
+}
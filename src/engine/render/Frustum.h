@@ -0,0 +1,19 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// view volume as 6 planes, extracted from a view-projection matrix
+class Frustum
+{
+    public:
+        Frustum(const glm::mat4 &viewProjectionMatrix);
+
+        // conservative test of a local space AABB, placed in the world by transform
+        bool intersects(const glm::vec3 &minBound, const glm::vec3 &maxBound, const glm::mat4 &transform) const;
+
+        bool intersects(const glm::vec3 &center, float radius) const;
+
+    private:
+        // plane equations (xyz = normal pointing inside, w = distance)
+        glm::vec4 planes[6];
+};
@@ -1,5 +1,10 @@
 #include <engine/render/Image.h>
 
+#include <algorithm>
+#include <cstring>
+
+#include <engine/render/TextureArrays.h>
+#include <engine/render/TextureStreamer.h>
 #include <engine/resource/ResourceManager.h>
 
 #include <DDSTextureLoader/DDSTextureLoader.h>
@@ -7,10 +12,163 @@
 const std::string Image::resourceClassName = "Image";
 const std::string Image::defaultResourceData = "";
 
+// levels up to this size stay resident, finer ones are streamed
+static const int STREAMING_TAIL_SIZE = 64;
+
+static const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+static const uint32_t DDS_FOURCC = 0x4;
+static const uint32_t DDS_HEADER_FLAGS_VOLUME = 0x800000;
+static const uint32_t DDS_CUBEMAP = 0x200;
+
+static uint32_t makeFourCC(char a, char b, char c, char d)
+{
+    return (uint32_t)(unsigned char)a | ((uint32_t)(unsigned char)b << 8) | ((uint32_t)(unsigned char)c << 16) | ((uint32_t)(unsigned char)d << 24);
+}
+
+// the parts of the DDS headers read to plan streaming, creation is left to DDSTextureLoader
+struct DdsHeader
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+
+    // pixel format
+    uint32_t formatSize;
+    uint32_t formatFlags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t masks[4];
+
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+struct DdsHeaderDx10
+{
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+// bytes per block of compressed formats, 0 for the others
+static int getBlockBytes(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+        case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB:
+        case DXGI_FORMAT_BC4_TYPELESS: case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM:
+            return 8;
+
+        case DXGI_FORMAT_BC2_TYPELESS: case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB:
+        case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB:
+        case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM:
+        case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16: case DXGI_FORMAT_BC6H_SF16:
+        case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB:
+            return 16;
+
+        default:
+            return 0;
+    }
+}
+
+// common uncompressed formats, the others are counted as 32 bits; only used for budgets
+static int getTexelBits(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+        case DXGI_FORMAT_R32G32B32A32_FLOAT: return 128;
+        case DXGI_FORMAT_R16G16B16A16_FLOAT: case DXGI_FORMAT_R16G16B16A16_UNORM: case DXGI_FORMAT_R32G32_FLOAT: return 64;
+        case DXGI_FORMAT_R8G8_UNORM: case DXGI_FORMAT_R16_FLOAT: case DXGI_FORMAT_R16_UNORM: return 16;
+        case DXGI_FORMAT_R8_UNORM: case DXGI_FORMAT_A8_UNORM: return 8;
+        default: return 32;
+    }
+}
+
 void Image::load(const unsigned char *buffer, size_t size)
 {
+    this->streamed = false;
+
+    const size_t headerSize = sizeof(uint32_t) + sizeof(DdsHeader);
+    if ((size >= headerSize) && (*(const uint32_t *)buffer == DDS_MAGIC))
+    {
+        DdsHeader header;
+        memcpy(&header, buffer + sizeof(uint32_t), sizeof(header));
+
+        bool plain2D = ((header.flags & DDS_HEADER_FLAGS_VOLUME) == 0) && ((header.caps2 & DDS_CUBEMAP) == 0);
+        bool dx10 = ((header.formatFlags & DDS_FOURCC) != 0) && (header.fourCC == makeFourCC('D', 'X', '1', '0'));
+
+        if (dx10 && (size >= headerSize + sizeof(DdsHeaderDx10)))
+        {
+            DdsHeaderDx10 headerDx10;
+            memcpy(&headerDx10, buffer + headerSize, sizeof(headerDx10));
+
+            DXGI_FORMAT format = (DXGI_FORMAT)headerDx10.dxgiFormat;
+            plain2D = (headerDx10.resourceDimension == D3D11_RESOURCE_DIMENSION_TEXTURE2D) && (headerDx10.arraySize == 1) && ((headerDx10.miscFlag & D3D11_RESOURCE_MISC_TEXTURECUBE) == 0);
+            this->blockBytes = getBlockBytes(format);
+            this->texelBits = getTexelBits(format);
+        }
+        else if (dx10)
+        {
+            plain2D = false;
+        }
+        else if ((header.formatFlags & DDS_FOURCC) != 0)
+        {
+            uint32_t fourCC = header.fourCC;
+            bool bc1 = (fourCC == makeFourCC('D', 'X', 'T', '1')) || (fourCC == makeFourCC('A', 'T', 'I', '1')) || (fourCC == makeFourCC('B', 'C', '4', 'U')) || (fourCC == makeFourCC('B', 'C', '4', 'S'));
+            bool bc3 = (fourCC == makeFourCC('D', 'X', 'T', '2')) || (fourCC == makeFourCC('D', 'X', 'T', '3')) || (fourCC == makeFourCC('D', 'X', 'T', '4')) || (fourCC == makeFourCC('D', 'X', 'T', '5'))
+                || (fourCC == makeFourCC('A', 'T', 'I', '2')) || (fourCC == makeFourCC('B', 'C', '5', 'U')) || (fourCC == makeFourCC('B', 'C', '5', 'S'));
+
+            // other codes are D3DFMT values of float formats
+            this->blockBytes = bc1 ? 8 : (bc3 ? 16 : 0);
+            this->texelBits = 64;
+        }
+        else
+        {
+            this->blockBytes = 0;
+            this->texelBits = (int)header.rgbBitCount;
+        }
+
+        this->blockCompressed = (this->blockBytes > 0);
+        this->width = (int)header.width;
+        this->height = (int)header.height;
+        this->fullMipLevels = std::max((int)header.mipMapCount, 1);
+
+        // levels of the tail
+        this->tailMip = 0;
+        while ((this->tailMip < this->fullMipLevels - 1) && (std::max(this->width, this->height) >> this->tailMip > STREAMING_TAIL_SIZE))
+            this->tailMip++;
+
+        this->streamed = plain2D && (this->tailMip > 0);
+    }
+
+    if (this->streamed)
+    {
+        this->data = buffer;
+        this->dataSize = size;
+
+        this->setResidentMip(this->tailMip);
+        TextureStreamer::addImage(this);
+
+        // arrays holding the previous texture are rebuilt
+        TextureArrays::invalidate(this);
+        return;
+    }
+
     DirectX::CreateDDSTextureFromMemory(Device::device, buffer, size, &this->texture, &this->srv);
 
+    // arrays holding the previous texture are rebuilt
+    TextureArrays::invalidate(this);
+
     if (!srv)
         return;
 
@@ -22,6 +180,15 @@ void Image::load(const unsigned char *buffer, size_t size)
 
 void Image::unload()
 {
+    if (this->streamed)
+    {
+        TextureStreamer::removeImage(this);
+
+        this->streamed = false;
+        this->data = nullptr;
+        this->dataSize = 0;
+    }
+
     if (this->texture != nullptr)
     {
         this->texture->Release();
@@ -35,4 +202,89 @@ void Image::unload()
     }
 
     this->mipLevels = 0;
+
+    TextureArrays::invalidate(this);
+}
+
+void Image::releaseTexture()
+{
+    if (this->texture != nullptr)
+    {
+        this->texture->Release();
+        this->texture = nullptr;
+    }
+
+    if (this->srv != nullptr)
+    {
+        this->srv->Release();
+        this->srv = nullptr;
+    }
+}
+
+size_t Image::computeMipSize(int mip) const
+{
+    size_t mipWidth = std::max(this->width >> mip, 1);
+    size_t mipHeight = std::max(this->height >> mip, 1);
+
+    if (this->blockCompressed)
+        return ((mipWidth + 3) / 4) * ((mipHeight + 3) / 4) * this->blockBytes;
+
+    return mipWidth * mipHeight * this->texelBits / 8;
+}
+
+void Image::setResidentMip(int mip)
+{
+    ID3D11Resource *texture = nullptr;
+    ID3D11ShaderResourceView *srv = nullptr;
+
+    // the loader skips the levels larger than maxsize
+    size_t maxSize = (size_t)std::max(std::max(this->width >> mip, this->height >> mip), 1);
+    HRESULT res = DirectX::CreateDDSTextureFromMemoryEx(Device::device, this->data, this->dataSize, maxSize, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0, false, &texture, &srv);
+    CHECK_HRESULT(res);
+
+    // the previous levels stay in use if the new texture can't be created
+    if (srv == nullptr)
+    {
+        if (texture != nullptr)
+            texture->Release();
+        return;
+    }
+
+    if (this->texture != nullptr)
+        this->texture->Release();
+
+    if (this->srv != nullptr)
+        this->srv->Release();
+
+    this->texture = texture;
+    this->srv = srv;
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC desc;
+    srv->GetDesc(&desc);
+    this->mipLevels = desc.Texture2D.MipLevels;
+
+    // texture arrays view streamed images in place
+    TextureArrays::updateStreamedImage(this);
+}
+
+void Image::requestScreenSize(float screenSize)
+{
+    if (!(screenSize > 0.0f))
+        return;
+
+    uint32_t bits;
+    memcpy(&bits, &screenSize, sizeof(bits));
+
+    uint32_t current = this->requestedScreenSize.load(std::memory_order_relaxed);
+    while ((bits > current) && !this->requestedScreenSize.compare_exchange_weak(current, bits, std::memory_order_relaxed))
+        ;
+}
+
+float Image::consumeRequestedScreenSize()
+{
+    uint32_t bits = this->requestedScreenSize.exchange(0, std::memory_order_relaxed);
+
+    float screenSize;
+    memcpy(&screenSize, &bits, sizeof(screenSize));
+    return screenSize;
 }
@@ -1,28 +1,83 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 
 #include <engine/render/Device.h>
 #include <engine/resource/Resource.h>
 
+/**
+ * DDS image. 2D images with large mips are streamed: only their mip tail is
+ * created at load time, finer mips are made resident by TextureStreamer from
+ * the projected sizes requested during the frame.
+ */
 class Image: public Resource
 {
     public:
         static const std::string resourceClassName;
         static const std::string defaultResourceData;
 
-        Image(): texture(nullptr) {}
+        Image(): texture(nullptr), srv(nullptr), requestedScreenSize(0) {}
 
         virtual void load(const unsigned char *buffer, size_t size) override;
         virtual void unload() override;
 
         ID3D11Resource *getTexture() const { return this->texture; }
         ID3D11ShaderResourceView *getSRV() const { return this->srv; }
+
+        // resident levels
         int getMipLevels() const { return this->mipLevels; }
 
+        // called by texture arrays once the image is copied, they become its only storage (see TextureArrays)
+        void releaseTexture();
+
+        // streaming, levels are counted from the full size image
+        bool isStreamed() const { return this->streamed; }
+        int getWidth() const { return this->width; }
+        int getHeight() const { return this->height; }
+        int getFullMipLevels() const { return this->fullMipLevels; }
+        int getResidentMip() const { return this->fullMipLevels - this->mipLevels; }
+        int getTailMip() const { return this->tailMip; }
+
+        // estimated memory of a single level
+        size_t computeMipSize(int mip) const;
+
+        // recreates the texture with the levels from mip down to the last one, and its view in
+        // texture arrays; uses the immediate context
+        void setResidentMip(int mip);
+
+        // projected size of the image in NDC units, the largest request of the frame is kept; thread safe
+        void requestScreenSize(float screenSize);
+        float consumeRequestedScreenSize();
+
+        // pinned images keep all their mips resident, as for environment maps
+        void pin() { this->pinCount++; }
+        void unpin() { this->pinCount--; }
+        bool isPinned() const { return this->pinCount > 0; }
+
     private:
         ID3D11Resource *texture;
         ID3D11ShaderResourceView *srv;
 
         int mipLevels = 0;
+
+        // DDS blob of streamed images, kept by the resource manager while the image is loaded
+        const unsigned char *data = nullptr;
+        size_t dataSize = 0;
+
+        bool streamed = false;
+        int width = 0;
+        int height = 0;
+        int fullMipLevels = 0;
+        int tailMip = 0;
+
+        // bytes per 4x4 block of compressed formats, else bits per texel
+        bool blockCompressed = false;
+        int blockBytes = 0;
+        int texelBits = 0;
+
+        // float bits, positive floats order like their bits
+        std::atomic<uint32_t> requestedScreenSize;
+        int pinCount = 0;
 };
@@ -0,0 +1,59 @@
+#include <engine/render/LodSelector.h>
+
+#include <cfloat>
+
+#include <engine/render/Mesh.h>
+
+// projected simplification error allowed, in NDC units (about a pixel at 1080p)
+static const float LOD_MAX_SCREEN_ERROR = 0.002f;
+
+// a coarser level must be this much under the limit before switching to it
+static const float LOD_HYSTERESIS = 0.2f;
+
+LodSelector::LodSelector(const glm::mat4 &viewProjectionMatrix, const glm::mat4 *transforms, uint8_t *lods)
+    : transforms(transforms)
+    , lods(lods)
+{
+    glm::mat4 m = glm::transpose(viewProjectionMatrix);
+    this->depthRow = m[3];
+    this->projectionScale = glm::length(glm::vec3(m[1]));
+}
+
+float LodSelector::computeScreenRadius(const glm::vec3 &center, float radius) const
+{
+    float w = glm::dot(this->depthRow, glm::vec4(center, 1.0f));
+    return (w > 0.0f) ? radius * this->projectionScale / w : FLT_MAX;
+}
+
+float LodSelector::computeScreenRadius(const Mesh *mesh, int transformIndex) const
+{
+    const glm::mat4 &transform = this->transforms[transformIndex];
+    glm::vec3 center = glm::vec3(transform * glm::vec4(mesh->getBoundingCenter(), 1.0f));
+    float scale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+    return this->computeScreenRadius(center, mesh->getBoundingRadius() * scale);
+}
+
+int LodSelector::select(const Mesh *mesh, int transformIndex, uint8_t &previousLod) const
+{
+    int lod = 0;
+
+    // meshes around or behind the camera keep full detail
+    float screenRadius = (mesh->getLodCount() > 1) ? this->computeScreenRadius(mesh, transformIndex) : FLT_MAX;
+    if (screenRadius < FLT_MAX)
+    {
+        // coarsest level within the error limit
+        int currentLod = previousLod;
+        for (int i = 1; i < mesh->getLodCount(); i++)
+        {
+            float limit = LOD_MAX_SCREEN_ERROR * ((i > currentLod) ? (1.0f - LOD_HYSTERESIS) : 1.0f);
+            if (mesh->getLodError(i) * screenRadius > limit)
+                break;
+
+            lod = i;
+        }
+    }
+
+    previousLod = (uint8_t)lod;
+    return lod;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+class Mesh;
+
+// picks mesh levels of detail from the projected size of their bounding sphere; the level
+// chosen for a transform index is kept by the caller, to avoid popping back and forth
+class LodSelector
+{
+    public:
+        // lods has one entry per transform, holding the levels of the previous selection
+        LodSelector(const glm::mat4 &viewProjectionMatrix, const glm::mat4 *transforms, uint8_t *lods);
+
+        // selects and stores the level of a mesh placed by the given transform
+        int select(const Mesh *mesh, int transformIndex) const { return this->select(mesh, transformIndex, this->lods[transformIndex]); }
+
+        // same, with the level of the previous selection kept by the caller, for objects whose
+        // transform index isn't stable from frame to frame (particles)
+        int select(const Mesh *mesh, int transformIndex, uint8_t &lod) const;
+
+        // level stored by the last select() for a transform
+        int getLod(int transformIndex) const { return this->lods[transformIndex]; }
+
+        // projected radius of a world space sphere in NDC units, FLT_MAX around or behind the camera
+        float computeScreenRadius(const glm::vec3 &center, float radius) const;
+
+        // of the bounding sphere of a mesh placed by the given transform
+        float computeScreenRadius(const Mesh *mesh, int transformIndex) const;
+
+    private:
+        glm::vec4 depthRow; // w of clip space positions
+        float projectionScale; // vertical, from view space lengths to NDC
+
+        const glm::mat4 *transforms;
+        uint8_t *lods;
+};
@@ -12,6 +12,8 @@
 const std::string Material::resourceClassName = "Material";
 const std::string Material::defaultResourceData = "{\"bsdf\": \"UNLIT\", \"emissive\": [4.0, 0.0, 3.0], \"emissiveMap\": \"__default_white\", \"uvScale\": [1.0, 1.0], \"uvOffset\": [0.0, 0.0]}";
 
+IndexRegistry<Material> Material::registry;
+
 void Material::load(const unsigned char *buffer, size_t size)
 {
     cJSON *json = cJSON_Parse((const char *)buffer);
@@ -33,10 +35,15 @@ void Material::load(const unsigned char *buffer, size_t size)
     }
 
     cJSON_Delete(json);
+
+    this->index = Material::registry.add(this);
 }
 
 void Material::unload()
 {
+    Material::registry.remove(this->index);
+    this->index = -1;
+
     if (this->animation)
     {
         AnimationPlayer::globalPlayer.unregisterAnimation(this->animation);
@@ -47,7 +54,32 @@ void Material::unload()
     delete this->bsdf;
 }
 
-void Material::setupBatch(Batch *batch, const RenderSettings &settings, ID3D11ShaderResourceView *shadowSRV, ID3D11SamplerState *shadowSampler, ShadowConstants *shadowConstants)
+void Material::setupBatch(Batch *batch, const RenderSettings &settings, ID3D11ShaderResourceView *shadowSRV, StateObjects::Id shadowSampler)
+{
+    this->bsdf->setupBatch(batch, settings, shadowSRV, shadowSampler);
+}
+
+size_t Material::getConstantsSize() const
+{
+    return this->bsdf->getConstantsSize();
+}
+
+void Material::captureConstants(void *constants) const
+{
+    this->bsdf->captureConstants(constants);
+}
+
+Job::ShaderConstants Material::uploadConstants(const void *constants) const
+{
+    return this->bsdf->uploadConstants(constants);
+}
+
+bool Material::canShareBatch(const Material *other) const
+{
+    return this->bsdf->canShareBatch(other->bsdf);
+}
+
+void Material::requestScreenSize(float screenSize) const
 {
-    this->bsdf->setupBatch(batch, settings, shadowSRV, shadowSampler, shadowConstants);
+    this->bsdf->requestScreenSize(screenSize);
 }
@@ -4,13 +4,16 @@
 
 #include <d3d11.h>
 
+#include <engine/render/StateObjects.h>
+#include <engine/render/graph/Job.h>
+
+#include <engine/resource/IndexRegistry.h>
 #include <engine/resource/Resource.h>
 
 class AnimationData;
 class Batch;
 class Bsdf;
 struct RenderSettings;
-struct ShadowConstants;
 
 class Material: public Resource
 {
@@ -21,9 +24,22 @@ class Material: public Resource
         virtual void load(const unsigned char *buffer, size_t size) override;
         virtual void unload() override;
 
-        void setupBatch(Batch *batch, const RenderSettings &settings, ID3D11ShaderResourceView *shadowSRV, ID3D11SamplerState *shadowSampler, ShadowConstants *shadowConstants);
+        void setupBatch(Batch *batch, const RenderSettings &settings, ID3D11ShaderResourceView *shadowSRV, StateObjects::Id shadowSampler);
+        size_t getConstantsSize() const;
+        void captureConstants(void *constants) const;
+        Job::ShaderConstants uploadConstants(const void *constants) const;
+        bool canShareBatch(const Material *other) const;
+        void requestScreenSize(float screenSize) const;
+
+        // index in the global material registry, as referenced by render jobs
+        int getIndex() const { return this->index; }
+        static Material *getMaterial(int index) { return Material::registry.get(index); }
+        static int getMaterialIndexCount() { return Material::registry.getIndexCount(); } // including free indices
 
     private:
         AnimationData *animation = nullptr;
         Bsdf *bsdf = nullptr;
+        int index = -1;
+
+        static IndexRegistry<Material> registry;
 };
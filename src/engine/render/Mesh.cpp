@@ -1,8 +1,11 @@
 #include <engine/render/Mesh.h>
 
 #include <cassert>
+#include <cstring>
 
 #include <engine/render/Material.h>
+#include <engine/render/MeshCodec.h>
+#include <engine/render/VertexFormat.h>
 #include <engine/render/graph/Job.h>
 #include <engine/resource/ResourceManager.h>
 
@@ -11,12 +14,58 @@
 const std::string Mesh::resourceClassName = "Mesh";
 const std::string Mesh::defaultResourceData = "";
 
+IndexRegistry<const Mesh::SubMesh> Mesh::subMeshRegistry;
+
+static void readBuffer(ID3D11Buffer *buffer, size_t offset, void *data, size_t size)
+{
+    D3D11_BUFFER_DESC desc;
+    buffer->GetDesc(&desc);
+    assert(offset + size <= desc.ByteWidth);
+
+    desc.ByteWidth = (UINT)size;
+    desc.Usage = D3D11_USAGE_STAGING;
+    desc.BindFlags = 0;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    desc.MiscFlags = 0;
+    desc.StructureByteStride = 0;
+
+    ID3D11Buffer *stagingBuffer;
+    HRESULT res = Device::device->CreateBuffer(&desc, nullptr, &stagingBuffer);
+    CHECK_HRESULT(res);
+
+    D3D11_BOX box = { (UINT)offset, 0, 0, (UINT)(offset + size), 1, 1 };
+    Device::context->CopySubresourceRegion(stagingBuffer, 0, 0, 0, 0, buffer, 0, &box);
+
+    D3D11_MAPPED_SUBRESOURCE mappedResource;
+    res = Device::context->Map(stagingBuffer, 0, D3D11_MAP_READ, 0, &mappedResource);
+    CHECK_HRESULT(res);
+
+    memcpy(data, mappedResource.pData, size);
+
+    Device::context->Unmap(stagingBuffer, 0);
+    stagingBuffer->Release();
+}
+
 void Mesh::load(const unsigned char *buffer, size_t size)
 {
     if (size < sizeof(int))
         return;
 
+    // compressed blobs are normally decoded by Engine::loadData(), along with other meshes
+    std::vector<unsigned char> decodedBuffer;
+    if (MeshCodec::isCompressed(buffer, size))
+    {
+        MeshCodec::decode(buffer, size, decodedBuffer);
+        buffer = decodedBuffer.data();
+        size = decodedBuffer.size();
+    }
+
+    // vertices are either exported as floats and packed at load time, or already packed
+    bool packed = MeshCodec::isPacked(buffer, size);
+
     const unsigned char *readPosition = (const unsigned char *)buffer;
+    if (packed)
+        readPosition += sizeof(uint32_t);
 
     // vertex buffer
 
@@ -25,25 +74,59 @@ void Mesh::load(const unsigned char *buffer, size_t size)
 
     D3D11_BUFFER_DESC vbDesc;
     vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
-    vbDesc.ByteWidth = sizeof(float) * (3 /* pos */ + 3 /* normal */ + 4 /* tangent */ + 2 /* uv */) * this->vertexCount;
+    vbDesc.ByteWidth = sizeof(VertexFormat::Vertex) * this->vertexCount;
     vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
     vbDesc.StructureByteStride = 0;
     vbDesc.MiscFlags = 0;
     vbDesc.CPUAccessFlags = 0;
 
+    std::vector<VertexFormat::Vertex> packedVertices;
+    if (!packed)
+    {
+        packedVertices.resize(this->vertexCount);
+        VertexFormat::encode((const float *)readPosition, this->vertexCount, packedVertices.data());
+    }
+
     D3D11_SUBRESOURCE_DATA vertexData;
-    vertexData.pSysMem = readPosition;
+    vertexData.pSysMem = packed ? readPosition : (const void *)packedVertices.data();
     vertexData.SysMemPitch = 0;
     vertexData.SysMemSlicePitch = 0;
 
     HRESULT res = Device::device->CreateBuffer(&vbDesc, &vertexData, &this->vertexBuffer);
     CHECK_HRESULT(res);
 
-    readPosition += vbDesc.ByteWidth;
+    // compute AABB from vertex positions (first 3 floats of each vertex)
+    const int vertexStride = packed ? (int)(sizeof(VertexFormat::Vertex) / sizeof(float)) : VertexFormat::sourceStride;
+    const float *vertices = (const float *)readPosition;
+    this->minBound = glm::vec3(0.0f);
+    this->maxBound = glm::vec3(0.0f);
+    for (int i = 0; i < this->vertexCount; i++)
+    {
+        glm::vec3 position(vertices[i * vertexStride], vertices[i * vertexStride + 1], vertices[i * vertexStride + 2]);
+        this->minBound = (i == 0) ? position : glm::min(this->minBound, position);
+        this->maxBound = (i == 0) ? position : glm::max(this->maxBound, position);
+    }
+
+    // bounding sphere around the AABB center, for level of detail selection; the cooker computes the same
+    this->boundingCenter = (this->minBound + this->maxBound) * 0.5f;
+    this->boundingRadius = 0.0f;
+    for (int i = 0; i < this->vertexCount; i++)
+    {
+        glm::vec3 position(vertices[i * vertexStride], vertices[i * vertexStride + 1], vertices[i * vertexStride + 2]);
+        this->boundingRadius = glm::max(this->boundingRadius, glm::length(position - this->boundingCenter));
+    }
+
+    readPosition += sizeof(float) * vertexStride * this->vertexCount;
 
     unsigned int materialCount = *(unsigned int *)readPosition;
     readPosition += sizeof(unsigned int);
 
+    // submeshes are ranges of a single index buffer
+    std::vector<uint32_t> indices;
+
+    // submesh of each material, -1 when skipped
+    std::vector<int> materialSubMeshes(materialCount, -1);
+
     for (unsigned int i = 0; i < materialCount; i++)
     {
         SubMesh subMesh;
@@ -59,7 +142,7 @@ void Mesh::load(const unsigned char *buffer, size_t size)
 
         subMesh.material = ResourceManager::getInstance()->requestResource<Material>(materialName);
 
-        // index buffer
+        // index range
 
         subMesh.indexCount = *(unsigned int *)readPosition;
         readPosition += sizeof(unsigned int);
@@ -68,28 +151,150 @@ void Mesh::load(const unsigned char *buffer, size_t size)
         if (subMesh.indexCount == 0)
             continue;
 
-        D3D11_BUFFER_DESC ibDesc;
-        ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
-        ibDesc.ByteWidth = sizeof(uint32_t) * subMesh.indexCount;
-        ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-        ibDesc.StructureByteStride = 0;
-        ibDesc.MiscFlags = 0;
-        ibDesc.CPUAccessFlags = 0;
+        subMesh.firstIndex = (int)indices.size();
+        indices.insert(indices.end(), (const uint32_t *)readPosition, (const uint32_t *)readPosition + subMesh.indexCount);
+        readPosition += sizeof(uint32_t) * subMesh.indexCount;
 
-        D3D11_SUBRESOURCE_DATA indexData;
-        indexData.pSysMem = readPosition;
-        indexData.SysMemPitch = 0;
-        indexData.SysMemSlicePitch = 0;
+        materialSubMeshes[i] = (int)this->subMeshes.size();
+        this->subMeshes.push_back(subMesh);
+    }
 
-        res = Device::device->CreateBuffer(&ibDesc, &indexData, &subMesh.indexBuffer);
-        CHECK_HRESULT(res);
+    size_t fullDetailIndexCount = indices.size();
 
-        readPosition += ibDesc.ByteWidth;
+    // optional levels of detail, one index list per material and level
+    const unsigned char *end = buffer + size;
+    if (readPosition + sizeof(unsigned int) <= end)
+    {
+        unsigned int lodCount = *(unsigned int *)readPosition;
+        readPosition += sizeof(unsigned int);
 
-        this->subMeshes.push_back(subMesh);
+        this->lodErrors.resize(lodCount);
+        this->lodSubMeshes.resize(lodCount * this->subMeshes.size());
+
+        for (unsigned int lod = 0; lod < lodCount; lod++)
+        {
+            this->lodErrors[lod] = *(float *)readPosition;
+            readPosition += sizeof(float);
+
+            for (unsigned int i = 0; i < materialCount; i++)
+            {
+                unsigned int indexCount = *(unsigned int *)readPosition;
+                readPosition += sizeof(unsigned int);
+
+                // materials without triangles at full detail have none in simplified levels
+                if (materialSubMeshes[i] < 0)
+                    continue;
+
+                SubMesh &subMesh = this->lodSubMeshes[lod * this->subMeshes.size() + materialSubMeshes[i]];
+                subMesh = this->subMeshes[materialSubMeshes[i]];
+                subMesh.firstIndex = (int)indices.size();
+                subMesh.indexCount = (int)indexCount;
+
+                indices.insert(indices.end(), (const uint32_t *)readPosition, (const uint32_t *)readPosition + indexCount);
+                readPosition += sizeof(uint32_t) * indexCount;
+            }
+        }
+    }
+
+    // optional clusters of the full detail index lists, one list per material
+    if (readPosition + sizeof(unsigned int) * materialCount <= end)
+    {
+        for (unsigned int i = 0; i < materialCount; i++)
+        {
+            unsigned int clusterCount = *(unsigned int *)readPosition;
+            readPosition += sizeof(unsigned int);
+
+            SubMesh *subMesh = (materialSubMeshes[i] >= 0) ? &this->subMeshes[materialSubMeshes[i]] : nullptr;
+            if (subMesh)
+            {
+                subMesh->firstCluster = (int)this->clusters.size();
+                subMesh->clusterCount = (int)clusterCount;
+            }
+
+            int firstIndex = subMesh ? subMesh->firstIndex : 0;
+            for (unsigned int j = 0; j < clusterCount; j++)
+            {
+                // same layout as the cooker: triangle count, center, radius, cone axis, cone cutoff
+                const float *values = (const float *)(readPosition + sizeof(uint32_t));
+                int indexCount = 3 * (int)*(const uint32_t *)readPosition;
+                readPosition += sizeof(uint32_t) + sizeof(float) * 8;
+
+                if (!subMesh)
+                    continue;
+
+                Cluster cluster;
+                cluster.center = glm::vec3(values[0], values[1], values[2]);
+                cluster.radius = values[3];
+                cluster.coneAxis = glm::vec3(values[4], values[5], values[6]);
+                cluster.coneCutoff = values[7];
+                cluster.firstIndex = firstIndex;
+                cluster.indexCount = indexCount;
+                this->clusters.push_back(cluster);
+
+                firstIndex += indexCount;
+            }
+        }
+    }
+
+    // visible clusters are copied from the CPU side to a dynamic index buffer every frame
+    if (!this->clusters.empty())
+        this->clusterIndices.assign(indices.begin(), indices.begin() + fullDetailIndexCount);
+
+    if (!indices.empty())
+        this->indexBuffer = Mesh::createIndexBuffer(indices.data(), (int)indices.size(), this->vertexCount, this->indexFormat);
+
+    // register once the vector is complete, as addresses are now stable
+    for (auto &subMesh : this->subMeshes)
+    {
+        subMesh.indexBuffer = this->indexBuffer;
+        subMesh.indexFormat = this->indexFormat;
+        subMesh.index = Mesh::subMeshRegistry.add(&subMesh);
+    }
+
+    for (auto &subMesh : this->lodSubMeshes)
+    {
+        subMesh.indexBuffer = this->indexBuffer;
+        subMesh.indexFormat = this->indexFormat;
+        subMesh.index = (subMesh.indexCount > 0) ? Mesh::subMeshRegistry.add(&subMesh) : -1;
     }
 }
 
+ID3D11Buffer *Mesh::createIndexBuffer(const uint32_t *indices, int indexCount, int vertexCount, DXGI_FORMAT &indexFormat)
+{
+    // 16-bit indices whenever all vertices can be addressed
+    std::vector<uint16_t> shortIndices;
+    const void *data = indices;
+    size_t indexSize = sizeof(uint32_t);
+    indexFormat = DXGI_FORMAT_R32_UINT;
+
+    if (vertexCount < 65536)
+    {
+        shortIndices.assign(indices, indices + indexCount);
+        data = shortIndices.data();
+        indexSize = sizeof(uint16_t);
+        indexFormat = DXGI_FORMAT_R16_UINT;
+    }
+
+    D3D11_BUFFER_DESC ibDesc;
+    ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    ibDesc.ByteWidth = (UINT)(indexSize * indexCount);
+    ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    ibDesc.StructureByteStride = 0;
+    ibDesc.MiscFlags = 0;
+    ibDesc.CPUAccessFlags = 0;
+
+    D3D11_SUBRESOURCE_DATA indexData;
+    indexData.pSysMem = data;
+    indexData.SysMemPitch = 0;
+    indexData.SysMemSlicePitch = 0;
+
+    ID3D11Buffer *indexBuffer;
+    HRESULT res = Device::device->CreateBuffer(&ibDesc, &indexData, &indexBuffer);
+    CHECK_HRESULT(res);
+
+    return indexBuffer;
+}
+
 void Mesh::unload()
 {
     if (this->vertexBuffer != nullptr)
@@ -98,13 +303,59 @@ void Mesh::unload()
         this->vertexBuffer = nullptr;
     }
 
+    if (this->indexBuffer != nullptr)
+    {
+        this->indexBuffer->Release();
+        this->indexBuffer = nullptr;
+    }
+
     this->vertexCount = 0;
 
     for (auto &subMesh : this->subMeshes)
     {
-        subMesh.indexBuffer->Release();
+        Mesh::subMeshRegistry.remove(subMesh.index);
         ResourceManager::getInstance()->releaseResource(subMesh.material);
     }
 
     this->subMeshes.clear();
+
+    // materials are only referenced by the full detail submeshes
+    for (auto &subMesh : this->lodSubMeshes)
+    {
+        if (subMesh.index >= 0)
+            Mesh::subMeshRegistry.remove(subMesh.index);
+    }
+
+    this->lodSubMeshes.clear();
+    this->lodErrors.clear();
+
+    this->clusters.clear();
+    this->clusterIndices.clear();
+}
+
+void Mesh::readVertices(std::vector<float> &vertices) const
+{
+    vertices.resize(VertexFormat::sourceStride * this->vertexCount);
+    if (this->vertexCount == 0)
+        return;
+
+    std::vector<VertexFormat::Vertex> packedVertices(this->vertexCount);
+    readBuffer(this->vertexBuffer, 0, packedVertices.data(), packedVertices.size() * sizeof(VertexFormat::Vertex));
+    VertexFormat::decode(packedVertices.data(), this->vertexCount, vertices.data());
+}
+
+void Mesh::readIndices(const SubMesh &subMesh, std::vector<uint32_t> &indices)
+{
+    indices.resize(subMesh.indexCount);
+
+    if (subMesh.indexFormat == DXGI_FORMAT_R16_UINT)
+    {
+        std::vector<uint16_t> shortIndices(subMesh.indexCount);
+        readBuffer(subMesh.indexBuffer, subMesh.firstIndex * sizeof(uint16_t), shortIndices.data(), shortIndices.size() * sizeof(uint16_t));
+        indices.assign(shortIndices.begin(), shortIndices.end());
+    }
+    else
+    {
+        readBuffer(subMesh.indexBuffer, subMesh.firstIndex * sizeof(uint32_t), indices.data(), indices.size() * sizeof(uint32_t));
+    }
 }
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
 #include <engine/render/Device.h>
+#include <engine/resource/IndexRegistry.h>
 #include <engine/resource/Resource.h>
 
 #include <glm/vec3.hpp>
@@ -17,7 +19,7 @@ class Mesh: public Resource
         static const std::string resourceClassName;
         static const std::string defaultResourceData;
 
-        Mesh(): vertexBuffer(nullptr), vertexCount(0) {}
+        Mesh(): vertexBuffer(nullptr), vertexCount(0), indexBuffer(nullptr), indexFormat(DXGI_FORMAT_R32_UINT), minBound(0.0f), maxBound(0.0f), boundingCenter(0.0f), boundingRadius(0.0f) {}
         virtual ~Mesh() {}
 
         virtual void load(const unsigned char *buffer, size_t size) override;
@@ -26,27 +28,102 @@ class Mesh: public Resource
         struct SubMesh
         {
             ID3D11Buffer *vertexBuffer; // same VB as the whole mesh
-            ID3D11Buffer *indexBuffer; // separate IB per submesh
+            ID3D11Buffer *indexBuffer; // same IB as the whole mesh, submeshes are ranges
+            DXGI_FORMAT indexFormat;
+            int firstIndex;
             int indexCount;
             Material *material;
+            int index; // in the global submesh registry
+
+            // see getClusters(), none for simplified levels
+            int firstCluster;
+            int clusterCount;
 
             SubMesh()
                 : vertexBuffer(nullptr)
                 , indexBuffer(nullptr)
+                , indexFormat(DXGI_FORMAT_R32_UINT)
+                , firstIndex(0)
                 , indexCount(0)
                 , material(nullptr)
+                , index(-1)
+                , firstCluster(0)
+                , clusterCount(0)
             {}
         };
 
+        // contiguous index range of a full detail submesh, built at cook time for culling
+        struct Cluster
+        {
+            glm::vec3 center; // local space bounding sphere
+            float radius;
+            glm::vec3 coneAxis; // all triangles face away from viewers in the cone around -coneAxis
+            float coneCutoff; // sine of the normal cone angle, 1 when the cone can't cull
+            int firstIndex; // in the mesh index buffer
+            int indexCount;
+        };
+
         const std::vector<SubMesh> &getSubMeshes() const { return this->subMeshes; }
 
+        // levels of detail generated at cook time; level 0 is getSubMeshes(), simplified levels
+        // share its buffers and keep the submesh order (empty submeshes have no registry index)
+        int getLodCount() const { return 1 + (int)this->lodErrors.size(); }
+        const SubMesh &getLodSubMesh(int lod, int subMeshIndex) const { return (lod == 0) ? this->subMeshes[subMeshIndex] : this->lodSubMeshes[(lod - 1) * this->subMeshes.size() + subMeshIndex]; }
+
+        // simplification error of a level, relative to the bounding sphere radius
+        float getLodError(int lod) const { return (lod == 0) ? 0.0f : this->lodErrors[lod - 1]; }
+
+        // clusters of all submeshes, see SubMesh::firstCluster
+        const std::vector<Cluster> &getClusters() const { return this->clusters; }
+
+        // copy of the full detail indices, only kept for meshes with clusters
+        const std::vector<uint32_t> &getClusterIndices() const { return this->clusterIndices; }
+
+        // lookup of all loaded submeshes by index, as referenced by render jobs
+        static const SubMesh *getSubMesh(int index) { return Mesh::subMeshRegistry.get(index); }
+
+        // copies geometry back from the GPU, decoded to source vertices (see VertexFormat);
+        // slow, uses the immediate context, for load time processing only
+        void readVertices(std::vector<float> &vertices) const;
+        static void readIndices(const SubMesh &subMesh, std::vector<uint32_t> &indices);
+
+        // 16-bit when vertexCount allows it, the chosen format is returned
+        static ID3D11Buffer *createIndexBuffer(const uint32_t *indices, int indexCount, int vertexCount, DXGI_FORMAT &indexFormat);
+
+        // submeshes created outside of mesh resources, so that jobs can reference them
+        static int registerSubMesh(const SubMesh *subMesh) { return Mesh::subMeshRegistry.add(subMesh); }
+        static void unregisterSubMesh(int index) { Mesh::subMeshRegistry.remove(index); }
+
+        // local space bounds, computed at load time
+        const glm::vec3 &getMinBound() const { return this->minBound; }
+        const glm::vec3 &getMaxBound() const { return this->maxBound; }
+
+        // local space, centered on the AABB
+        const glm::vec3 &getBoundingCenter() const { return this->boundingCenter; }
+        float getBoundingRadius() const { return this->boundingRadius; }
+
     private:
         ID3D11Buffer *vertexBuffer;
         int vertexCount;
 
+        ID3D11Buffer *indexBuffer;
+        DXGI_FORMAT indexFormat;
+
         std::vector<SubMesh> subMeshes;
 
+        // level major, subMeshes.size() entries per level
+        std::vector<SubMesh> lodSubMeshes;
+        std::vector<float> lodErrors;
+
+        std::vector<Cluster> clusters;
+        std::vector<uint32_t> clusterIndices;
+
         // AABB
         glm::vec3 minBound;
         glm::vec3 maxBound;
+
+        glm::vec3 boundingCenter;
+        float boundingRadius;
+
+        static IndexRegistry<const SubMesh> subMeshRegistry;
 };
@@ -0,0 +1,268 @@
+#include <engine/render/MeshCodec.h>
+
+#include <cstring>
+
+#include <emmintrin.h>
+
+#include <engine/render/VertexFormat.h>
+
+// stream parameters, see MeshEncoder in the mesh cooker
+static const int CHANNEL_COUNT = 10;
+static const int GROUP_SIZE = 16;
+static const int EDGE_FIFO_SIZE = 16;
+static const int VERTEX_FIFO_SIZE = 16;
+
+// group of 16 values with width bits each, least significant first; the stream is padded for the 8 byte reads
+static inline void unpackGroup(const unsigned char *data, int width, uint32_t *values)
+{
+    if (width == 0)
+    {
+        memset(values, 0, sizeof(uint32_t) * GROUP_SIZE);
+        return;
+    }
+
+    uint64_t mask = (1ull << width) - 1;
+    for (int i = 0; i < GROUP_SIZE; i++)
+    {
+        int bit = i * width;
+
+        uint64_t bits;
+        memcpy(&bits, data + (bit >> 3), sizeof(bits));
+        values[i] = (uint32_t)((bits >> (bit & 7)) & mask);
+    }
+}
+
+// zigzag deltas of 4 vertices to values, continuing from the broadcast previous value
+static inline __m128i accumulate(__m128i deltas, __m128i &previous)
+{
+    __m128i values = _mm_xor_si128(_mm_srli_epi32(deltas, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(deltas, _mm_set1_epi32(1))));
+    values = _mm_add_epi32(values, _mm_slli_si128(values, 4));
+    values = _mm_add_epi32(values, _mm_slli_si128(values, 8));
+    values = _mm_add_epi32(values, previous);
+
+    previous = _mm_shuffle_epi32(values, _MM_SHUFFLE(3, 3, 3, 3));
+    return values;
+}
+
+static void decodeVertices(const unsigned char *data, int vertexCount, float positionStep, VertexFormat::Vertex *destination)
+{
+    alignas(16) uint32_t deltas[CHANNEL_COUNT][GROUP_SIZE];
+    VertexFormat::Vertex lastGroup[GROUP_SIZE];
+
+    __m128i previous[CHANNEL_COUNT];
+    for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+        previous[channel] = _mm_setzero_si128();
+
+    const __m128 step = _mm_set1_ps(positionStep);
+    const __m128i lowMask = _mm_set1_epi32(0xffff);
+
+    for (int group = 0; group < vertexCount; group += GROUP_SIZE)
+    {
+        const unsigned char *widths = data;
+        data += CHANNEL_COUNT;
+
+        for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+        {
+            unpackGroup(data, widths[channel], deltas[channel]);
+            data += 2 * widths[channel];
+        }
+
+        // the last group may be incomplete
+        VertexFormat::Vertex *vertices = (group + GROUP_SIZE <= vertexCount) ? destination + group : lastGroup;
+
+        for (int i = 0; i < GROUP_SIZE; i += 4)
+        {
+            __m128i values[CHANNEL_COUNT];
+            for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+                values[channel] = accumulate(_mm_load_si128((const __m128i *)&deltas[channel][i]), previous[channel]);
+
+            __m128 x = _mm_mul_ps(_mm_cvtepi32_ps(values[0]), step);
+            __m128 y = _mm_mul_ps(_mm_cvtepi32_ps(values[1]), step);
+            __m128 z = _mm_mul_ps(_mm_cvtepi32_ps(values[2]), step);
+            __m128 normal = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(values[3], lowMask), _mm_slli_epi32(values[4], 16)));
+            __m128i tangent = _mm_or_si128(_mm_or_si128(values[5], _mm_slli_epi32(values[6], 10)), _mm_slli_epi32(values[7], 30));
+            __m128i uv = _mm_or_si128(_mm_and_si128(values[8], lowMask), _mm_slli_epi32(values[9], 16));
+
+            // position and normal are the first 16 bytes of a vertex, tangent and uv the last 8
+            _MM_TRANSPOSE4_PS(x, y, z, normal);
+            __m128i tangentUv01 = _mm_unpacklo_epi32(tangent, uv);
+            __m128i tangentUv23 = _mm_unpackhi_epi32(tangent, uv);
+
+            VertexFormat::Vertex *output = vertices + i;
+            _mm_storeu_ps(output[0].position, x);
+            _mm_storeu_ps(output[1].position, y);
+            _mm_storeu_ps(output[2].position, z);
+            _mm_storeu_ps(output[3].position, normal);
+            _mm_storel_epi64((__m128i *)&output[0].tangent, tangentUv01);
+            _mm_storel_epi64((__m128i *)&output[1].tangent, _mm_srli_si128(tangentUv01, 8));
+            _mm_storel_epi64((__m128i *)&output[2].tangent, tangentUv23);
+            _mm_storel_epi64((__m128i *)&output[3].tangent, _mm_srli_si128(tangentUv23, 8));
+        }
+
+        if (vertices == lastGroup)
+            memcpy(destination + group, lastGroup, sizeof(VertexFormat::Vertex) * (vertexCount - group));
+    }
+}
+
+static void decodeIndices(const unsigned char *data, size_t triangleCount, uint32_t *destination)
+{
+    uint32_t edgeFifo[EDGE_FIFO_SIZE][2];
+    uint32_t vertexFifo[VERTEX_FIFO_SIZE];
+    memset(edgeFifo, 0xff, sizeof(edgeFifo));
+    memset(vertexFifo, 0xff, sizeof(vertexFifo));
+    int edgeOffset = 0;
+    int vertexOffset = 0;
+
+    uint32_t next = 0;
+    uint32_t last = 0;
+
+    auto pushEdge = [&](uint32_t a, uint32_t b)
+    {
+        edgeFifo[edgeOffset][0] = a;
+        edgeFifo[edgeOffset][1] = b;
+        edgeOffset = (edgeOffset + 1) & (EDGE_FIFO_SIZE - 1);
+    };
+
+    auto pushVertex = [&](uint32_t vertex)
+    {
+        vertexFifo[vertexOffset] = vertex;
+        vertexOffset = (vertexOffset + 1) & (VERTEX_FIFO_SIZE - 1);
+    };
+
+    auto decodeVertex = [&](int code) -> uint32_t
+    {
+        if (code == 0)
+        {
+            pushVertex(next);
+            return next++;
+        }
+
+        if (code < 15)
+            return vertexFifo[(vertexOffset - code) & (VERTEX_FIFO_SIZE - 1)];
+
+        uint32_t delta = 0;
+        for (int shift = 0; ; shift += 7)
+        {
+            unsigned char byte = *data++;
+            delta |= (uint32_t)(byte & 0x7f) << shift;
+            if (byte < 0x80)
+                break;
+        }
+
+        last += (delta >> 1) ^ (0u - (delta & 1));
+        next = (last >= next) ? last + 1 : next;
+        pushVertex(last);
+        return last;
+    };
+
+    for (size_t i = 0; i < triangleCount; i++)
+    {
+        unsigned char code = *data++;
+        uint32_t *triangle = destination + i * 3;
+
+        if ((code >> 4) < 15)
+        {
+            // rotated to start with a recent edge
+            const uint32_t *edge = edgeFifo[(edgeOffset - 1 - (code >> 4)) & (EDGE_FIFO_SIZE - 1)];
+            triangle[0] = edge[0];
+            triangle[1] = edge[1];
+            triangle[2] = decodeVertex(code & 15);
+
+            pushEdge(triangle[2], triangle[1]);
+            pushEdge(triangle[0], triangle[2]);
+        }
+        else
+        {
+            unsigned char codes = *data++;
+            triangle[0] = decodeVertex(code & 15);
+            triangle[1] = decodeVertex(codes >> 4);
+            triangle[2] = decodeVertex(codes & 15);
+
+            pushEdge(triangle[1], triangle[0]);
+            pushEdge(triangle[2], triangle[1]);
+            pushEdge(triangle[0], triangle[2]);
+        }
+    }
+}
+
+// index lists after the vertices, in the packed layout; only measures the size without destination
+static size_t decodeIndexLists(const unsigned char *readPosition, const unsigned char *end, unsigned char *destination)
+{
+    size_t size = 0;
+    auto copy = [&](size_t count)
+    {
+        if (destination)
+            memcpy(destination + size, readPosition, count);
+
+        readPosition += count;
+        size += count;
+    };
+
+    auto indexList = [&]()
+    {
+        unsigned int indexCount = *(unsigned int *)readPosition;
+        copy(sizeof(unsigned int));
+
+        unsigned int dataSize = *(unsigned int *)readPosition;
+        readPosition += sizeof(unsigned int);
+
+        if (destination)
+            decodeIndices(readPosition, indexCount / 3, (uint32_t *)(destination + size));
+
+        readPosition += dataSize;
+        size += sizeof(uint32_t) * indexCount;
+    };
+
+    unsigned int materialCount = *(unsigned int *)readPosition;
+    copy(sizeof(unsigned int));
+
+    for (unsigned int i = 0; i < materialCount; i++)
+    {
+        unsigned int nameSize = *(unsigned int *)readPosition;
+        copy(sizeof(unsigned int) + nameSize);
+
+        indexList();
+    }
+
+    unsigned int lodCount = *(unsigned int *)readPosition;
+    copy(sizeof(unsigned int));
+
+    for (unsigned int lod = 0; lod < lodCount; lod++)
+    {
+        copy(sizeof(float));
+        for (unsigned int i = 0; i < materialCount; i++)
+            indexList();
+    }
+
+    // the following sections are not compressed
+    copy(end - readPosition);
+
+    return size;
+}
+
+void MeshCodec::decode(const unsigned char *buffer, size_t size, std::vector<unsigned char> &output)
+{
+    const unsigned char *readPosition = buffer + sizeof(uint32_t);
+
+    unsigned int vertexCount = *(unsigned int *)readPosition;
+    readPosition += sizeof(unsigned int);
+
+    float positionStep = *(float *)readPosition;
+    readPosition += sizeof(float);
+
+    unsigned int vertexDataSize = *(unsigned int *)readPosition;
+    readPosition += sizeof(unsigned int);
+
+    const unsigned char *vertexData = readPosition;
+    readPosition += vertexDataSize;
+
+    size_t vertexSize = sizeof(VertexFormat::Vertex) * vertexCount;
+    size_t headerSize = sizeof(uint32_t) + sizeof(unsigned int);
+    output.resize(headerSize + vertexSize + decodeIndexLists(readPosition, buffer + size, nullptr));
+
+    *(uint32_t *)&output[0] = MeshCodec::packedMagic;
+    *(unsigned int *)&output[sizeof(uint32_t)] = vertexCount;
+
+    decodeVertices(vertexData, (int)vertexCount, positionStep, (VertexFormat::Vertex *)&output[headerSize]);
+    decodeIndexLists(readPosition, buffer + size, &output[headerSize + vertexSize]);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Decoder of the compressed mesh blobs written by the mesh cooker (see
+ * MeshEncoder). Decoding produces a packed blob: the exported layout with
+ * vertices already in VertexFormat, uploaded by Mesh::load as is.
+ *
+ * Vertex groups are decoded 4 vertices at a time with SSE2; index lists
+ * take one or two code bytes per triangle.
+ */
+class MeshCodec
+{
+    public:
+        // first words of blobs; raw blobs start with their vertex count, which can't reach these
+        static const uint32_t compressedMagic = 0x31434d4c; // "LMC1"
+        static const uint32_t packedMagic = 0x31504d4c; // "LMP1"
+
+        static bool isCompressed(const unsigned char *buffer, size_t size) { return MeshCodec::hasMagic(buffer, size, MeshCodec::compressedMagic); }
+        static bool isPacked(const unsigned char *buffer, size_t size) { return MeshCodec::hasMagic(buffer, size, MeshCodec::packedMagic); }
+
+        // compressed blob to packed blob
+        static void decode(const unsigned char *buffer, size_t size, std::vector<unsigned char> &output);
+
+    private:
+        static bool hasMagic(const unsigned char *buffer, size_t size, uint32_t magic) { return (size >= sizeof(uint32_t)) && (*(const uint32_t *)buffer == magic); }
+};
@@ -24,8 +24,7 @@ MotionBlurRenderer::MotionBlurRenderer(int backbufferWidth, int backbufferHeight
 		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 40, D3D11_INPUT_PER_VERTEX_DATA, 0 }
 	};
-	HRESULT res = Device::device->CreateInputLayout(layout, 4, motionblurVS, sizeof(motionblurVS), &this->inputLayout);
-	CHECK_HRESULT(res);
+	this->inputLayout = StateObjects::createInputLayout(layout, 4, motionblurVS, sizeof(motionblurVS));
 
 	D3D11_TEXTURE2D_DESC textureDesc;
     ZeroMemory(&textureDesc, sizeof(textureDesc));
@@ -38,7 +37,7 @@ MotionBlurRenderer::MotionBlurRenderer(int backbufferWidth, int backbufferHeight
     textureDesc.SampleDesc.Quality = 0;
     textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
 
-    res = Device::device->CreateTexture2D(&textureDesc, NULL, &this->tileMaxTexture);
+    HRESULT res = Device::device->CreateTexture2D(&textureDesc, NULL, &this->tileMaxTexture);
     CHECK_HRESULT(res);
 
     res = Device::device->CreateShaderResourceView(this->tileMaxTexture, NULL, &this->tileMaxSRV);
@@ -66,13 +65,12 @@ MotionBlurRenderer::MotionBlurRenderer(int backbufferWidth, int backbufferHeight
 	samplerDesc.MinLOD = 0;
 	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
 
-	res = Device::device->CreateSamplerState(&samplerDesc, &this->neighborMaxSampler);
-	CHECK_HRESULT(res);
+	this->neighborMaxSampler = StateObjects::createSampler(samplerDesc);
 }
 
 MotionBlurRenderer::~MotionBlurRenderer()
 {
-	this->inputLayout->Release();
+	StateObjects::release(this->inputLayout);
 
     this->tileMaxTexture->Release();
     this->tileMaxSRV->Release();
@@ -82,7 +80,7 @@ MotionBlurRenderer::~MotionBlurRenderer()
 	this->neighborMaxSRV->Release();
 	this->neighborMaxUAV->Release();
 
-	this->neighborMaxSampler->Release();
+	StateObjects::release(this->neighborMaxSampler);
 }
 
 void MotionBlurRenderer::render(FrameGraph *frameGraph, RenderTarget *radianceTarget, RenderTarget *motionTarget, RenderTarget *outputTarget, int width, int height, const Mesh::SubMesh &quadSubMesh)
@@ -90,7 +88,7 @@ void MotionBlurRenderer::render(FrameGraph *frameGraph, RenderTarget *radianceTa
 	Pass *tileMaxPass = frameGraph->addPass("TileMax");
 
 	Batch *tileMaxBatch = tileMaxPass->addBatch("");
-	tileMaxBatch->setResources({ motionTarget->getSRV() });
+	tileMaxBatch->setResources({ motionTarget });
 	tileMaxBatch->setUnorderedResources({ this->tileMaxUAV });
 	tileMaxBatch->setComputeShader(Shaders::compute.tileMax);
 	tileMaxBatch->addJob()->addDispatch(this->tileCountX, this->tileCountY, 1);
@@ -104,17 +102,17 @@ void MotionBlurRenderer::render(FrameGraph *frameGraph, RenderTarget *radianceTa
 	neighborMaxBatch->addJob()->addDispatch(this->tileCountX, this->tileCountY, 1);
 
 	Pass *blurPass = frameGraph->addPass("MotionBlur");
-	blurPass->setTargets({ outputTarget->getTarget() }, nullptr);
+	blurPass->setRenderTargets({ outputTarget }, nullptr);
 	blurPass->setViewport((float)width, (float)height, glm::mat4(1.0f), glm::mat4(1.0f));
 
 	Batch *blurBatch = blurPass->addBatch("");
-	blurBatch->setResources({ radianceTarget->getSRV(), motionTarget->getSRV(), this->neighborMaxSRV });
+	blurBatch->setResources({ radianceTarget, motionTarget, this->neighborMaxSRV });
 	blurBatch->setSamplers({ radianceTarget->getSamplerState(), motionTarget->getSamplerState(), this->neighborMaxSampler });
 	blurBatch->setVertexShader(Shaders::vertex.motionBlur);
 	blurBatch->setPixelShader(Shaders::pixel.motionBlur);
 	blurBatch->setInputLayout(this->inputLayout);
 
 	Job *blurJob = blurBatch->addJob();
-    blurJob->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexCount);
+    blurJob->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexFormat, quadSubMesh.firstIndex, quadSubMesh.indexCount);
     blurJob->addInstance();
 }
@@ -3,6 +3,7 @@
 #include <d3d11.h>
 
 #include <engine/render/Mesh.h>
+#include <engine/render/StateObjects.h>
 
 class FrameGraph;
 class RenderTarget;
@@ -20,7 +21,7 @@ class MotionBlurRenderer
         int tileCountX;
         int tileCountY;
 
-		ID3D11InputLayout *inputLayout;
+		StateObjects::Id inputLayout;
 
 		ID3D11Texture2D *tileMaxTexture;
         ID3D11ShaderResourceView *tileMaxSRV;
@@ -30,5 +31,5 @@ class MotionBlurRenderer
 		ID3D11ShaderResourceView *neighborMaxSRV;
 		ID3D11UnorderedAccessView *neighborMaxUAV;
 
-		ID3D11SamplerState *neighborMaxSampler;
+		StateObjects::Id neighborMaxSampler;
 };
@@ -8,6 +8,7 @@
 #include <engine/render/RenderSettings.h>
 #include <engine/render/RenderTarget.h>
 #include <engine/render/Shaders.h>
+#include <engine/render/VertexFormat.h>
 #include <engine/render/graph/Batch.h>
 #include <engine/render/graph/FrameGraph.h>
 #include <engine/render/graph/Job.h>
@@ -23,15 +24,7 @@ PostProcessor::PostProcessor(ID3D11RenderTargetView *backbufferTarget, int backb
 	, backbufferHeight(backbufferHeight)
 {
     HRESULT res;
-	D3D11_INPUT_ELEMENT_DESC layout[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 40, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-	};
-	res = Device::device->CreateInputLayout(layout, 4, postprocessVS, sizeof(postprocessVS), &this->inputLayout);
-	CHECK_HRESULT(res);
+	this->inputLayout = VertexFormat::createInputLayout(postprocessVS, sizeof(postprocessVS), false);
 
     D3D11_BUFFER_DESC cbDesc;
     cbDesc.Usage = D3D11_USAGE_DYNAMIC;
@@ -44,8 +37,8 @@ PostProcessor::PostProcessor(ID3D11RenderTargetView *backbufferTarget, int backb
     res = Device::device->CreateBuffer(&cbDesc, nullptr, &this->constantBuffer);
     CHECK_HRESULT(res);
 
-    this->targets[0] = new RenderTarget(this->backbufferWidth, this->backbufferHeight, DXGI_FORMAT_R16G16B16A16_FLOAT);
-    this->targets[1] = new RenderTarget(this->backbufferWidth, this->backbufferHeight, DXGI_FORMAT_R16G16B16A16_FLOAT);
+    this->targets[0] = new RenderTarget(this->backbufferWidth, this->backbufferHeight, DXGI_FORMAT_R16G16B16A16_FLOAT, false, true);
+    this->targets[1] = new RenderTarget(this->backbufferWidth, this->backbufferHeight, DXGI_FORMAT_R16G16B16A16_FLOAT, false, true);
 
     this->fullscreenQuad = ResourceManager::getInstance()->requestResource<Mesh>("__fullscreenQuad");
 
@@ -55,7 +48,7 @@ PostProcessor::PostProcessor(ID3D11RenderTargetView *backbufferTarget, int backb
 
 PostProcessor::~PostProcessor()
 {
-	this->inputLayout->Release();
+	StateObjects::release(this->inputLayout);
 
     this->constantBuffer->Release();
 
@@ -93,19 +86,19 @@ void PostProcessor::render(FrameGraph *frameGraph, const RenderSettings &setting
 
     // tone mapping and gamma correction
     Pass *toneMappingPass = frameGraph->addPass("ToneMapping");
-    toneMappingPass->setTargets({ this->targets[1]->getTarget() }, nullptr);
+    toneMappingPass->setRenderTargets({ this->targets[1] }, nullptr);
 	toneMappingPass->setViewport((float)this->backbufferWidth, (float)this->backbufferHeight, glm::mat4(1.0f), glm::mat4(1.0f));
 
     Batch *toneMappingBatch = toneMappingPass->addBatch("");
     toneMappingBatch->setShaderConstants(this->constantBuffer);
-    toneMappingBatch->setResources({ this->targets[0]->getSRV() });
+    toneMappingBatch->setResources({ this->targets[0] });
 	toneMappingBatch->setSamplers({ this->targets[0]->getSamplerState() });
     toneMappingBatch->setVertexShader(Shaders::vertex.postprocess);
     toneMappingBatch->setPixelShader(Shaders::pixel.postprocess);
 	toneMappingBatch->setInputLayout(this->inputLayout);
 
     Job *toneMappingJob = toneMappingBatch->addJob();
-    toneMappingJob->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexCount);
+    toneMappingJob->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexFormat, quadSubMesh.firstIndex, quadSubMesh.indexCount);
 	toneMappingJob->addInstance();
 
     // fxaa pass and blit to backbuffer
@@ -114,13 +107,13 @@ void PostProcessor::render(FrameGraph *frameGraph, const RenderSettings &setting
 	fxaaPass->setViewport((float)settings.frameWidth, (float)settings.frameHeight, glm::mat4(1.0f), glm::mat4(1.0f));
 
     Batch *fxaaBatch = fxaaPass->addBatch("");
-    fxaaBatch->setResources({ this->targets[1]->getSRV() });
+    fxaaBatch->setResources({ this->targets[1] });
 	fxaaBatch->setSamplers({ this->targets[1]->getSamplerState() });
 	fxaaBatch->setVertexShader(Shaders::vertex.fxaa);
     fxaaBatch->setPixelShader(Shaders::pixel.fxaa);
 	fxaaBatch->setInputLayout(this->inputLayout);
 
     Job *fxaaJob = fxaaBatch->addJob();
-    fxaaJob->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexCount);
+    fxaaJob->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexFormat, quadSubMesh.firstIndex, quadSubMesh.indexCount);
     fxaaJob->addInstance();
 }
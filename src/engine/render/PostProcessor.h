@@ -2,6 +2,8 @@
 
 #include <d3d11.h>
 
+#include <engine/render/StateObjects.h>
+
 class BloomRenderer;
 class FrameGraph;
 class Mesh;
@@ -24,9 +26,9 @@ class PostProcessor
 		int backbufferWidth;
 		int backbufferHeight;
 
-        RenderTarget *targets[2]; // two is enough to ping-pong between the targets
+        RenderTarget *targets[2]; // two is enough to ping-pong between the targets (transient, memory is given by the frame graph)
 
-		ID3D11InputLayout *inputLayout;
+		StateObjects::Id inputLayout;
 
         ID3D11Buffer *constantBuffer;
 
@@ -1,11 +1,25 @@
 #include <engine/render/RenderList.h>
 
 #include <algorithm>
+#include <cstring>
+
+#include <engine/render/Material.h>
 
 void RenderList::clear()
 {
     this->jobs.clear();
     this->lights.clear();
+
+    this->triangleCount = 0;
+    this->savedTriangleCount = 0;
+    this->clusterCulledTriangleCount = 0;
+
+    this->transforms = nullptr;
+    this->derivedTransforms = nullptr;
+    this->changedTransforms = nullptr;
+    this->transformCount = 0;
+
+    this->jobAllocator.reset();
 }
 
 void RenderList::addJob(const Job &job)
@@ -13,6 +27,42 @@ void RenderList::addJob(const Job &job)
     this->jobs.push_back(job);
 }
 
+RenderList::Job *RenderList::allocateJobs(int count)
+{
+    return this->jobAllocator.allocate<Job>(count);
+}
+
+RenderList::ClusterDraw *RenderList::allocateClusterDraw(int indexCount)
+{
+    ClusterDraw *clusterDraw = this->jobAllocator.allocate<ClusterDraw>(1);
+    clusterDraw->indices = (indexCount > 0) ? this->jobAllocator.allocate<uint32_t>(indexCount) : nullptr;
+    clusterDraw->indexCount = indexCount;
+    clusterDraw->indexBuffer = nullptr;
+    clusterDraw->firstIndex = 0;
+    return clusterDraw;
+}
+
+void RenderList::addJobChunks(const std::vector<JobChunk> &chunks)
+{
+    size_t totalCount = 0;
+    for (const auto &chunk : chunks)
+    {
+        totalCount += chunk.count;
+        this->triangleCount += chunk.triangleCount;
+        this->savedTriangleCount += chunk.savedTriangleCount;
+        this->clusterCulledTriangleCount += chunk.clusterCulledTriangleCount;
+    }
+
+    size_t offset = this->jobs.size();
+    this->jobs.resize(offset + totalCount);
+
+    for (const auto &chunk : chunks)
+    {
+        std::copy(chunk.jobs, chunk.jobs + chunk.count, this->jobs.begin() + offset);
+        offset += chunk.count;
+    }
+}
+
 void RenderList::addLight(const Light &light)
 {
     this->lights.push_back(light);
@@ -20,23 +70,62 @@ void RenderList::addLight(const Light &light)
 
 void RenderList::sortFrontToBack(const glm::vec3 &cameraDirection)
 {
-    std::sort(this->jobs.begin(), this->jobs.end(), [&](const Job &lhs, const Job &rhs)
+    for (auto &job : this->jobs)
     {
-        glm::vec3 lhsPosition = glm::vec3(lhs.transform[3]);
-        glm::vec3 rhsPosition = glm::vec3(lhs.transform[3]);
+        float depth = glm::dot(cameraDirection, glm::vec3(this->transforms[job.transformIndex][3]));
 
-        return glm::dot(cameraDirection, lhsPosition) < glm::dot(cameraDirection, rhsPosition);
+        // flip float bits to get an unsigned integer with the same ordering
+        uint32_t depthBits;
+        memcpy(&depthBits, &depth, sizeof(depthBits));
+        depthBits = (depthBits & 0x80000000u) ? ~depthBits : (depthBits | 0x80000000u);
+
+        job.sortKey = ((uint64_t)depthBits << 32) | job.subMeshIndex;
+    }
+
+    std::sort(this->jobs.begin(), this->jobs.end(), [](const Job &lhs, const Job &rhs)
+    {
+        return lhs.sortKey < rhs.sortKey;
     });
 }
 
 void RenderList::sortByMaterial()
 {
+    // if material is the same, sort by mesh data
+    for (auto &job : this->jobs)
+        job.sortKey = ((uint64_t)job.materialIndex << 32) | job.subMeshIndex;
+
     std::sort(this->jobs.begin(), this->jobs.end(), [](const Job &lhs, const Job &rhs)
     {
-        // if material is the same, sort by mesh data
-        if (lhs.material == rhs.material)
-            return (lhs.subMesh < lhs.subMesh);
-
-        return (lhs.material < rhs.material);
+        return lhs.sortKey < rhs.sortKey;
     });
 }
+
+void RenderList::setTransforms(const glm::mat4 *transforms, const DerivedTransform *derivedTransforms, const uint8_t *changedTransforms, int transformCount)
+{
+    this->transforms = transforms;
+    this->derivedTransforms = derivedTransforms;
+    this->changedTransforms = changedTransforms;
+    this->transformCount = transformCount;
+}
+
+void RenderList::captureMaterialConstants()
+{
+    int materialIndexCount = Material::getMaterialIndexCount();
+    this->materialConstantOffsets.resize(materialIndexCount);
+
+    size_t size = 0;
+    for (int i = 0; i < materialIndexCount; i++)
+    {
+        const Material *material = Material::getMaterial(i);
+        this->materialConstantOffsets[i] = size;
+        size += material ? material->getConstantsSize() : 0;
+    }
+
+    this->materialConstants.resize(size);
+    for (int i = 0; i < materialIndexCount; i++)
+    {
+        const Material *material = Material::getMaterial(i);
+        if (material)
+            material->captureConstants(&this->materialConstants[this->materialConstantOffsets[i]]);
+    }
+}
@@ -1,25 +1,54 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 #include <glm/glm.hpp>
-#include <engine/render/Mesh.h>
+#include <engine/memory/FrameAllocator.h>
 
-class Material;
+struct ID3D11Buffer;
 
 class RenderList
 {
     public:
+        // indices of the clusters of a submesh left by culling (see ClusterCuller), drawn
+        // instead of the whole submesh by the camera passes
+        struct ClusterDraw
+        {
+            uint32_t *indices;
+            int indexCount; // 0 when all clusters are culled
+
+            // set by the renderer once uploaded; left null when the upload fails, to draw the whole submesh
+            ID3D11Buffer *indexBuffer;
+            int firstIndex;
+        };
+
+        // kept small to make sorting and pass building cheap; transforms
+        // live in arrays owned by the scene (see setTransforms())
         struct Job
         {
-            Material *material;
-            const Mesh::SubMesh *subMesh;
-            glm::mat4 transform;
-            glm::mat4 previousFrameTransform;
+            uint64_t sortKey;
+            uint32_t subMeshIndex; // see Mesh::getSubMesh()
+            uint32_t materialIndex; // see Material::getMaterial()
+            uint32_t transformIndex;
+
+            // bit 0: visible from the camera, bit 1 + i: casting shadows for shadow slot i (see Light)
+            uint32_t visibility = ~0u;
+
+            // null to draw the whole submesh; shadow passes always do
+            ClusterDraw *clusterDraw = nullptr;
+
+            bool isVisible() const { return (this->visibility & 1u) != 0; }
+            bool isCastingShadow(int shadowSlot) const { return (this->visibility & shadowVisibilityBit(shadowSlot)) != 0; }
         };
 
+        static const int MAX_SHADOW_SLOTS = 31;
+        static unsigned int shadowVisibilityBit(int shadowSlot) { return 2u << shadowSlot; }
+
         struct Light
         {
+            uint32_t id; // stable from frame to frame, used to cache shadow maps
             bool spot;
             glm::vec3 position;
             float radius;
@@ -31,19 +60,86 @@ class RenderList
             float blend;
             glm::mat4 shadowTransform;
             float scattering;
+
+            // index of the shadow map, -1 when the light casts no shadows (see ShadowRenderer::assignShadowSlots())
+            int shadowSlot;
+        };
+
+        // matrices derived from a world transform, only recomputed by the scene when the transform changes
+        struct DerivedTransform
+        {
+            glm::mat4 worldToPreviousFrameWorld; // identity for static objects
+            glm::mat3x4 normalMatrix; // use 3x4 to match cbuffer packing rules
+        };
+
+        // jobs written by worker threads, appended in order once all chunks are filled
+        struct JobChunk
+        {
+            Job *jobs = nullptr;
+            int count = 0;
+
+            // level of detail statistics of the written jobs
+            size_t triangleCount = 0;
+            size_t savedTriangleCount = 0; // compared to full detail
+            size_t clusterCulledTriangleCount = 0;
         };
 
         void clear();
 
         void addJob(const Job &job);
+
+        // thread-safe, storage is valid until the next clear()
+        Job *allocateJobs(int count);
+        void addJobChunks(const std::vector<JobChunk> &chunks);
+
+        // thread-safe, with room for indexCount indices; storage is valid until the next clear()
+        ClusterDraw *allocateClusterDraw(int indexCount);
+
         void addLight(const Light &light);
         void sortFrontToBack(const glm::vec3 &cameraDirection);
         void sortByMaterial();
 
+        // world transforms referenced by jobs; arrays must stay valid until the next clear()
+        // (the scene double-buffers them, so that the next update doesn't overwrite them)
+        void setTransforms(const glm::mat4 *transforms, const DerivedTransform *derivedTransforms, const uint8_t *changedTransforms, int transformCount);
+
+        // copies the constants of all loaded materials, once the scene update has applied material
+        // animation; the renderer uploads these, as the next update runs while the list is rendered
+        void captureMaterialConstants();
+        const void *getMaterialConstants(uint32_t materialIndex) const { return &this->materialConstants[this->materialConstantOffsets[materialIndex]]; }
+
         const std::vector<Job> &getJobs() const { return this->jobs; }
         const std::vector<Light> &getLights() const { return this->lights; }
 
+        size_t getTriangleCount() const { return this->triangleCount; }
+        size_t getSavedTriangleCount() const { return this->savedTriangleCount; }
+        size_t getClusterCulledTriangleCount() const { return this->clusterCulledTriangleCount; }
+
+        int getTransformCount() const { return this->transformCount; }
+        const glm::mat4 &getTransform(int index) const { return this->transforms[index]; }
+        const DerivedTransform &getDerivedTransform(int index) const { return this->derivedTransforms[index]; }
+
+        // true if the transform may have changed since the previous frame
+        bool hasTransformChanged(int index) const { return this->changedTransforms[index] != 0; }
+
+        const glm::mat4 &getTransform(const Job &job) const { return this->transforms[job.transformIndex]; }
+
     private:
         std::vector<Job> jobs;
         std::vector<Light> lights;
+
+        size_t triangleCount = 0;
+        size_t savedTriangleCount = 0;
+        size_t clusterCulledTriangleCount = 0;
+
+        const glm::mat4 *transforms = nullptr;
+        const DerivedTransform *derivedTransforms = nullptr;
+        const uint8_t *changedTransforms = nullptr;
+        int transformCount = 0;
+
+        // kept from frame to frame, indexed by material index
+        std::vector<uint8_t> materialConstants;
+        std::vector<size_t> materialConstantOffsets;
+
+        FrameAllocator jobAllocator;
 };
@@ -2,27 +2,18 @@
 
 #include <engine/render/Device.h>
 
-RenderTarget::RenderTarget(int width, int height, DXGI_FORMAT format, bool msaa)
+RenderTarget::RenderTarget(int width, int height, DXGI_FORMAT format, bool msaa, bool transient)
 {
 	this->width = width;
 	this->height = height;
+    this->format = format;
+    this->sampleCount = msaa ? 4 : 1;
 
-    D3D11_TEXTURE2D_DESC textureDesc;
-    ZeroMemory(&textureDesc, sizeof(textureDesc));
-    textureDesc.Width = width;
-    textureDesc.Height = height;
-    textureDesc.MipLevels = 1;
-    textureDesc.ArraySize = 1;
-    textureDesc.Format = format;
-    textureDesc.SampleDesc.Count = msaa ? 4 : 1;
-    textureDesc.SampleDesc.Quality = 0;
-    textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+    this->transient = transient;
+    this->storage = transient ? nullptr : this;
 
-    HRESULT res = Device::device->CreateTexture2D(&textureDesc, NULL, &this->texture);
-    CHECK_HRESULT(res);
-
-    res = Device::device->CreateRenderTargetView(this->texture, NULL, &this->target);
-    CHECK_HRESULT(res);
+    if (!this->transient)
+        this->createTexture();
 
     D3D11_SAMPLER_DESC samplerDesc;
     ZeroMemory(&samplerDesc, sizeof(samplerDesc));
@@ -34,17 +25,53 @@ RenderTarget::RenderTarget(int width, int height, DXGI_FORMAT format, bool msaa)
     samplerDesc.MinLOD = 0;
     samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
 
-    res = Device::device->CreateSamplerState(&samplerDesc, &this->samplerState);
-    CHECK_HRESULT(res);
-
-    res = Device::device->CreateShaderResourceView(this->texture, NULL, &this->srv);
-    CHECK_HRESULT(res);
+    this->samplerState = StateObjects::createSampler(samplerDesc);
 }
 
 RenderTarget::~RenderTarget()
 {
-    this->texture->Release();
-    this->target->Release();
-    this->samplerState->Release();
-    this->srv->Release();
+    if (!this->transient)
+    {
+        this->texture->Release();
+        this->target->Release();
+        this->srv->Release();
+    }
+
+    StateObjects::release(this->samplerState);
+}
+
+size_t RenderTarget::getMemorySize() const
+{
+    size_t pixelSize = 4;
+    switch (this->format)
+    {
+        case DXGI_FORMAT_R32G32B32A32_FLOAT: pixelSize = 16; break;
+        case DXGI_FORMAT_R16G16B16A16_FLOAT: pixelSize = 8; break;
+        case DXGI_FORMAT_R32G32_FLOAT: pixelSize = 8; break;
+    }
+
+    return (size_t)this->width * (size_t)this->height * (size_t)this->sampleCount * pixelSize;
+}
+
+void RenderTarget::createTexture()
+{
+    D3D11_TEXTURE2D_DESC textureDesc;
+    ZeroMemory(&textureDesc, sizeof(textureDesc));
+    textureDesc.Width = this->width;
+    textureDesc.Height = this->height;
+    textureDesc.MipLevels = 1;
+    textureDesc.ArraySize = 1;
+    textureDesc.Format = this->format;
+    textureDesc.SampleDesc.Count = this->sampleCount;
+    textureDesc.SampleDesc.Quality = 0;
+    textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+
+    HRESULT res = Device::device->CreateTexture2D(&textureDesc, NULL, &this->texture);
+    CHECK_HRESULT(res);
+
+    res = Device::device->CreateRenderTargetView(this->texture, NULL, &this->target);
+    CHECK_HRESULT(res);
+
+    res = Device::device->CreateShaderResourceView(this->texture, NULL, &this->srv);
+    CHECK_HRESULT(res);
 }
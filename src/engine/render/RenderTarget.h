@@ -1,27 +1,50 @@
 #pragma once
 
+#include <cassert>
+
 #include <d3d11.h>
 
+#include <engine/render/StateObjects.h>
+
 class RenderTarget
 {
     public:
-        RenderTarget(int width, int height, DXGI_FORMAT format, bool msaa = false);
+        // transient targets have no memory of their own, the frame graph lends them a texture
+        // for the passes using them (so they must only be bound to passes and batches as targets)
+        RenderTarget(int width, int height, DXGI_FORMAT format, bool msaa = false, bool transient = false);
         ~RenderTarget();
 
 		int getWidth() const { return this->width; }
 		int getHeight() const { return this->height; }
+        DXGI_FORMAT getFormat() const { return this->format; }
+        size_t getMemorySize() const;
+
+        bool isTransient() const { return this->transient; }
+        void setStorage(RenderTarget *storage) { assert(this->transient); this->storage = storage; }
 
-        ID3D11Texture2D *getTexture() const { return this->texture; }
-        ID3D11RenderTargetView *getTarget() const { return this->target; }
-        ID3D11SamplerState *getSamplerState() const { return this->samplerState; }
-        ID3D11ShaderResourceView *getSRV() const { return this->srv; }
+        // index in the resource planner of the frame graph, -1 outside of planning
+        int getPlannedResource() const { return this->plannedResource; }
+        void setPlannedResource(int plannedResource) { this->plannedResource = plannedResource; }
+
+        ID3D11Texture2D *getTexture() const { assert(this->storage); return this->storage->texture; }
+        ID3D11RenderTargetView *getTarget() const { assert(this->storage); return this->storage->target; }
+        StateObjects::Id getSamplerState() const { return this->samplerState; }
+        ID3D11ShaderResourceView *getSRV() const { assert(this->storage); return this->storage->srv; }
 
     private:
+        void createTexture();
+
 		int width;
 		int height;
+        DXGI_FORMAT format;
+        int sampleCount;
+
+        bool transient;
+        RenderTarget *storage; // itself for regular targets
+        int plannedResource = -1;
 
-        ID3D11Texture2D *texture;
-        ID3D11RenderTargetView *target;
-        ID3D11SamplerState *samplerState;
-        ID3D11ShaderResourceView *srv;
+        ID3D11Texture2D *texture = nullptr;
+        ID3D11RenderTargetView *target = nullptr;
+        StateObjects::Id samplerState;
+        ID3D11ShaderResourceView *srv = nullptr;
 };
@@ -1,16 +1,18 @@
 #include <engine/render/Renderer.h>
 
 #include <cstdio>
+#include <cstdlib>
 
 #include <windows.h>
 #include <gl/GL.h>
-#include <d3d11.h>
+#include <d3d11_1.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
 
 #include <RenderDoc/renderdoc_app.h>
 
+#include <engine/render/ClusteredLights.h>
 #include <engine/render/Device.h>
 #include <engine/render/graph/GPUProfiler.h>
 #include <engine/render/Image.h>
@@ -22,12 +24,15 @@
 #include <engine/render/Shaders.h>
 #include <engine/render/ShadowRenderer.h>
 #include <engine/render/Texture.h>
+#include <engine/render/TextureArrays.h>
+#include <engine/render/TextureStreamer.h>
+#include <engine/render/TransformBuffer.h>
+#include <engine/render/VertexFormat.h>
 #include <engine/render/graph/Batch.h>
 #include <engine/render/graph/FrameGraph.h>
 #include <engine/render/graph/Job.h>
 #include <engine/render/graph/Pass.h>
 #include <engine/render/shaders/constants/SceneConstants.h>
-#include <engine/render/shaders/constants/StandardConstants.h>
 #include <engine/resource/ResourceManager.h>
 #include <engine/scene/Scene.h>
 
@@ -38,15 +43,22 @@ static const unsigned char blackDDS[] = { 68, 68, 83, 32, 124, 0, 0, 0, 7, 16, 2
 static const unsigned char whiteDDS[] = { 68, 68, 83, 32, 124, 0, 0, 0, 7, 16, 2, 0, 4, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 85, 86, 69, 82, 0, 0, 0, 0, 78, 86, 84, 84, 0, 1, 2, 0, 32, 0, 0, 0, 4, 0, 0, 0, 68, 88, 49, 48, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 8, 16, 64, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 71, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 255, 255, 255, 255, 170, 170, 170, 170, 255, 255, 255, 255, 170, 170, 170, 170, 255, 255, 255, 255, 170, 170, 170, 170 };
 static const unsigned char normalDDS[] = { 68, 68, 83, 32, 124, 0, 0, 0, 7, 16, 2, 0, 4, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 85, 86, 69, 82, 0, 0, 0, 0, 78, 86, 84, 84, 0, 1, 2, 0, 32, 0, 0, 0, 4, 0, 0, 128, 68, 88, 49, 48, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 8, 16, 64, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 71, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 255, 139, 31, 124, 255, 255, 255, 255, 255, 139, 31, 124, 255, 255, 255, 255, 255, 139, 31, 124, 255, 255, 255, 255 };
 
-#pragma pack(push)
-#pragma pack(16)
-struct InstanceData
+// per draw constants are ranges of shared dynamic constant buffers, mapped with NO_OVERWRITE (see
+// Job::uploadShaderConstants() and StateCache::setConstantBuffer()), which needs a Direct3D 11.1 driver
+static bool supportsConstantBufferRanges(ID3D11Device *device, ID3D11DeviceContext *context)
 {
-    glm::mat4 modelMatrix;
-    glm::mat4 worldToPreviousFrameClipSpaceMatrix;
-    glm::mat3x4 normalMatrix; // use 3x4 to match cbuffer packing rules
-};
-#pragma pack(pop)
+    ID3D11DeviceContext1 *context1 = nullptr;
+    if (FAILED(context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void **)&context1)))
+        return false;
+    context1->Release();
+
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+    ZeroMemory(&options, sizeof(options));
+    if (FAILED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+        return false;
+
+    return options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer;
+}
 
 Renderer::Renderer(HWND hwnd, int backbufferWidth, int backbufferHeight, bool capture, const std::string &profileFilename)
 {
@@ -84,6 +96,14 @@ Renderer::Renderer(HWND hwnd, int backbufferWidth, int backbufferHeight, bool ca
     HRESULT res = D3D11CreateDeviceAndSwapChain(NULL, D3D_DRIVER_TYPE_HARDWARE, NULL, flags, NULL, 0, D3D11_SDK_VERSION, &swapChainDesc, &this->swapChain, &Device::device, NULL, &Device::context);
     CHECK_HRESULT(res);
 
+    if (!supportsConstantBufferRanges(Device::device, Device::context))
+    {
+        const char *message = "The graphics driver doesn't support constant buffer offsets (Direct3D 11.1), which the renderer requires.";
+        printf("Error: %s\n", message);
+        MessageBoxA(hwnd, message, "LeafEngine", MB_OK | MB_ICONERROR);
+        exit(EXIT_FAILURE);
+    }
+
     this->initializeRenderDoc(hwnd, Device::device);
 
     res = this->swapChain->GetBuffer(0, __uuidof(this->backBuffer), (void **)&this->backBuffer);
@@ -130,12 +150,12 @@ Renderer::Renderer(HWND hwnd, int backbufferWidth, int backbufferHeight, bool ca
     depthStateDesc.DepthEnable = TRUE;
     depthStateDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
     depthStateDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-    Device::device->CreateDepthStencilState(&depthStateDesc, &this->lessEqualDepthState);
+    this->lessEqualDepthState = StateObjects::createDepthStencil(depthStateDesc);
 
     depthStateDesc.DepthEnable = TRUE;
     depthStateDesc.DepthFunc = D3D11_COMPARISON_EQUAL;
     depthStateDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
-    Device::device->CreateDepthStencilState(&depthStateDesc, &this->equalDepthState);
+    this->equalDepthState = StateObjects::createDepthStencil(depthStateDesc);
 
     D3D11_RASTERIZER_DESC rasterizerDesc;
     rasterizerDesc.FillMode = D3D11_FILL_SOLID;
@@ -149,9 +169,8 @@ Renderer::Renderer(HWND hwnd, int backbufferWidth, int backbufferHeight, bool ca
     rasterizerDesc.MultisampleEnable = FALSE;
     rasterizerDesc.AntialiasedLineEnable = FALSE;
 
-    ID3D11RasterizerState *rasterizerState;
-    Device::device->CreateRasterizerState(&rasterizerDesc, &rasterizerState);
-    Device::context->RSSetState(rasterizerState);
+    this->rasterizerState = StateObjects::createRasterizer(rasterizerDesc);
+    Device::context->RSSetState(StateObjects::getRasterizer(this->rasterizerState));
 
     // fill the screen in black to get a clean startup (even if some baking is done at loading time)
     glm::vec4 clearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -161,7 +180,9 @@ Renderer::Renderer(HWND hwnd, int backbufferWidth, int backbufferHeight, bool ca
     this->swapChain->Present(0, 0);
 
     this->postProcessor = new PostProcessor(this->renderTarget, backbufferWidth, backbufferHeight);
-    this->shadowRenderer = new ShadowRenderer(1024);
+    this->shadowRenderer = new ShadowRenderer(4096);
+    this->transformBuffer = new TransformBuffer();
+    this->clusteredLights = new ClusteredLights();
 
     this->motionTarget = new RenderTarget(backbufferWidth, backbufferHeight, DXGI_FORMAT_R16G16B16A16_FLOAT);
     
@@ -179,40 +200,8 @@ Renderer::Renderer(HWND hwnd, int backbufferWidth, int backbufferHeight, bool ca
 
     Shaders::loadShaders();
 
-    D3D11_INPUT_ELEMENT_DESC layout[] =
-    {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 40, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "MODELMATRIX", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-		{ "MODELMATRIX", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-		{ "MODELMATRIX", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-		{ "MODELMATRIX", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-		{ "WORLDTOPREVIOUSFRAMECLIPSPACE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-		{ "WORLDTOPREVIOUSFRAMECLIPSPACE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-		{ "WORLDTOPREVIOUSFRAMECLIPSPACE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 96, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-		{ "WORLDTOPREVIOUSFRAMECLIPSPACE", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 112, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-		{ "NORMALMATRIX", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 128, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-		{ "NORMALMATRIX", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 144, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-		{ "NORMALMATRIX", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 160, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
-	};
-    res = Device::device->CreateInputLayout(layout, 15, standardVS, sizeof(standardVS), &this->inputLayout);
-    CHECK_HRESULT(res);
-
-    D3D11_INPUT_ELEMENT_DESC depthOnlyLayout[] =
-    {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 40, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-        { "TRANSFORM", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-        { "TRANSFORM", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-        { "TRANSFORM", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
-    };
-    res = Device::device->CreateInputLayout(depthOnlyLayout, 8, depthonlyVS, sizeof(depthonlyVS), &this->depthOnlyInputLayout);
-    CHECK_HRESULT(res);
+    this->inputLayout = VertexFormat::createInputLayout(standardVS, sizeof(standardVS), true);
+    this->depthOnlyInputLayout = VertexFormat::createInputLayout(depthonlyVS, sizeof(depthonlyVS), true);
 
     // built-in rendering resources
 
@@ -255,6 +244,7 @@ Renderer::Renderer(HWND hwnd, int backbufferWidth, int backbufferHeight, bool ca
     this->fullscreenQuad = ResourceManager::getInstance()->requestResource<Mesh>("__fullscreenQuad");
 
     this->frameGraph = new FrameGraph(profileFilename);
+    this->frameGraph->setRasterizerState(this->rasterizerState);
 }
 
 Renderer::~Renderer()
@@ -271,9 +261,10 @@ Renderer::~Renderer()
     this->depthSRV->Release();
 
     Shaders::unloadShaders();
+    TextureArrays::release();
 
-    this->inputLayout->Release();
-    this->depthOnlyInputLayout->Release();
+    StateObjects::release(this->inputLayout);
+    StateObjects::release(this->depthOnlyInputLayout);
 
     delete this->renderList;
 
@@ -282,11 +273,14 @@ Renderer::~Renderer()
     //for (int i = 0; i < GBUFFER_PLANE_COUNT; i++)
     //    delete this->gBuffer[i];
 
-    this->lessEqualDepthState->Release();
-    this->equalDepthState->Release();
+    StateObjects::release(this->lessEqualDepthState);
+    StateObjects::release(this->equalDepthState);
+    StateObjects::release(this->rasterizerState);
 
     delete this->postProcessor;
     delete this->shadowRenderer;
+    delete this->transformBuffer;
+    delete this->clusteredLights;
 
     delete this->motionTarget;
 
@@ -299,65 +293,67 @@ Renderer::~Renderer()
 
 void Renderer::render(const Scene *scene, const RenderSettings &settings, float deltaTime)
 {
+    // the live link always culls dynamically, as baked visibility may be out of date
+    this->renderList->clear();
+    scene->fillRenderList(this->renderList, settings.camera.viewMatrix, settings.camera.projectionMatrix, !this->capture);
+
+    this->render(this->renderList, settings, deltaTime);
+}
+
+void Renderer::render(RenderList *renderList, const RenderSettings &settings, float deltaTime)
+{
+    // mips requested by the scene, before the textures are used
+    TextureStreamer::update(this->backbufferHeight);
+
+    GPUProfiler::getInstance()->addCounter("StateObjects", StateObjects::getObjectCount());
+
     // rebake environment when needed
     settings.environment.environmentMap->update(this->frameGraph);
 
-    this->renderList->clear();
-    scene->fillRenderList(this->renderList);
+    // material textures loaded or unloaded since the last frame
+    TextureArrays::update();
 
-    // shadow maps
-	ShadowConstants shadowConstants;
-    this->shadowRenderer->render(this->frameGraph, scene, this->renderList, &shadowConstants, this->depthOnlyInputLayout);
+    // transforms are uploaded once and referenced by index from all passes
+    this->transformBuffer->update(renderList);
+    this->frameGraph->setTransformBuffer(this->transformBuffer->getSRV());
 
+    // shadow maps
     SceneConstants sceneConstants;
+    this->shadowRenderer->render(this->frameGraph, renderList, settings.camera.viewMatrix, settings.camera.projectionMatrix, &sceneConstants.shadows, this->depthOnlyInputLayout);
+
     sceneConstants.ambientColor = settings.environment.ambientColor;
     sceneConstants.mist = settings.environment.mist;
     sceneConstants.motionSpeedFactor = settings.camera.shutterSpeed / deltaTime;
     sceneConstants.motionBlurTileSize = 40.0f;
 	sceneConstants.focusDistance = settings.camera.focusDistance;
+    sceneConstants.previousFrameViewProjectionMatrix = this->previousFrameViewProjectionMatrix;
     sceneConstants.environmentMipLevels = (float)settings.environment.environmentMap->getMipLevels() - 1;
 
-    const std::vector<RenderList::Light> &lights = this->renderList->getLights();
-    sceneConstants.pointLightCount = 0;
-    sceneConstants.spotLightCount = 0;
-    for (int i = 0; i < lights.size(); i++)
-    {
-        if (!lights[i].spot && sceneConstants.pointLightCount < MAX_LIGHT)
-        {
-            int index = sceneConstants.pointLightCount++;
-            sceneConstants.pointLights[index].position = lights[i].position;
-            sceneConstants.pointLights[index].radius = lights[i].radius;
-            sceneConstants.pointLights[index].color = lights[i].color;
-        }
-
-        if (lights[i].spot && sceneConstants.spotLightCount < MAX_LIGHT)
-        {
-            // angle falloff precomputations
-            float cosOuterAngle = cosf(lights[i].angle * 0.5f);
-            float cosInnerAngle = glm::mix(cosOuterAngle + 0.001f, 1.0f, lights[i].blend);
-            float cosAngleScale = 1.0f / (cosInnerAngle - cosOuterAngle);
-            float cosAngleOffset = -cosOuterAngle * cosAngleScale;
-
-            int index = sceneConstants.spotLightCount++;
-            sceneConstants.spotLights[index].position = lights[i].position;
-            sceneConstants.spotLights[index].radius = lights[i].radius;
-            sceneConstants.spotLights[index].color = lights[i].color;
-            sceneConstants.spotLights[index].cosAngleScale = cosAngleScale;
-            sceneConstants.spotLights[index].direction = lights[i].direction;
-            sceneConstants.spotLights[index].cosAngleOffset = cosAngleOffset;
-            sceneConstants.spotLights[index].scattering = lights[i].scattering;
-        }
-    }
+    // lights are assigned to the froxels of the camera
+    this->clusteredLights->update(renderList, this->shadowRenderer->getShadowIndices(), settings.camera.viewMatrix, settings.camera.projectionMatrix, &sceneConstants);
+    this->frameGraph->setLightBuffers(this->clusteredLights->getLightSRV(), this->clusteredLights->getClusterSRV(), this->clusteredLights->getLightIndexSRV());
 
     this->frameGraph->addClearTarget(this->renderTarget, glm::vec4(1.0f, 1.0f, 0.0f, 1.0f));
     this->frameGraph->addClearTarget(this->motionTarget->getTarget(), glm::vec4(0.0f, 0.0f, 0.0f, 0.0f));
     this->frameGraph->addClearTarget(this->depthTarget, 1.0, 0);
 
-    const std::vector<RenderList::Job> &jobs = this->renderList->getJobs();
+    const std::vector<RenderList::Job> &jobs = renderList->getJobs();
+
+    // indices of partially culled submeshes, shared by the depth and radiance passes
+    for (const auto &job : jobs)
+    {
+        if (job.isVisible() && job.clusterDraw && (job.clusterDraw->indexCount > 0))
+        {
+            const Mesh::SubMesh *subMesh = Mesh::getSubMesh(job.subMeshIndex);
+            Job::IndexRange range = Job::uploadIndices(job.clusterDraw->indices, job.clusterDraw->indexCount, subMesh->indexFormat);
+            job.clusterDraw->indexBuffer = range.buffer;
+            job.clusterDraw->firstIndex = range.firstIndex;
+        }
+    }
 
     // depth pre-pass
     glm::vec3 cameraDirection = glm::vec3(settings.camera.viewMatrix * glm::vec4(0.0f, 0.0f, -1.0f, 1.0f));
-    this->renderList->sortFrontToBack(cameraDirection);
+    renderList->sortFrontToBack(cameraDirection);
 
     Pass *depthPrePass = this->frameGraph->addPass("DepthPrePass");
     depthPrePass->setTargets({}, this->depthTarget);
@@ -369,67 +365,112 @@ void Renderer::render(const Scene *scene, const RenderSettings &settings, float
     depthBatch->setPixelShader(Shaders::pixel.depthOnly);
     depthBatch->setInputLayout(this->depthOnlyInputLayout);
 
-    const Mesh::SubMesh *currentSubMesh = nullptr;
+    uint32_t currentSubMeshIndex = ~0u;
     Job *currentJob = nullptr;
     for (const auto &job : jobs)
     {
-        if (currentSubMesh != job.subMesh)
+        if (!job.isVisible() || (job.clusterDraw && (job.clusterDraw->indexCount == 0)))
+            continue;
+
+        // visible clusters are drawn on their own
+        if (job.clusterDraw && job.clusterDraw->indexBuffer)
         {
-            currentSubMesh = job.subMesh;
+            currentSubMeshIndex = ~0u;
 
-            currentJob = depthBatch->addJob();
-            currentJob->setBuffers(currentSubMesh->vertexBuffer, currentSubMesh->indexBuffer, currentSubMesh->indexCount);
+            const Mesh::SubMesh *subMesh = Mesh::getSubMesh(job.subMeshIndex);
+            Job *clusterJob = depthBatch->addJob();
+            clusterJob->setBuffers(subMesh->vertexBuffer, job.clusterDraw->indexBuffer, subMesh->indexFormat, job.clusterDraw->firstIndex, job.clusterDraw->indexCount);
+            clusterJob->addInstance(job.transformIndex);
+            continue;
         }
 
-        DepthOnlyInstanceData instanceData;
-        instanceData.transformMatrix = job.transform;
+        if (currentSubMeshIndex != job.subMeshIndex)
+        {
+            currentSubMeshIndex = job.subMeshIndex;
+
+            const Mesh::SubMesh *subMesh = Mesh::getSubMesh(job.subMeshIndex);
+            currentJob = depthBatch->addJob();
+            currentJob->setBuffers(subMesh->vertexBuffer, subMesh->indexBuffer, subMesh->indexFormat, subMesh->firstIndex, subMesh->indexCount);
+        }
 
-        currentJob->addInstance(instanceData);
+        currentJob->addInstance(job.transformIndex);
     }
 
     // main radiance pass
-    this->renderList->sortByMaterial();
+    renderList->sortByMaterial();
 
     RenderTarget *radianceTarget = this->postProcessor->getRadianceTarget();
 
     Pass *radiancePass = this->frameGraph->addPass("Radiance");
-    radiancePass->setTargets({ radianceTarget->getTarget(), this->motionTarget->getTarget() }, this->depthTarget);
+    radiancePass->setRenderTargets({ radianceTarget, this->motionTarget }, this->depthTarget);
 	radiancePass->setViewport((float)this->backbufferWidth, (float)this->backbufferHeight, settings.camera.viewMatrix, settings.camera.projectionMatrix);
 
     {
         //GPUProfiler::ScopedProfile profile("Geometry");
-        Material *currentMaterial = nullptr;
-        const Mesh::SubMesh *currentSubMesh = nullptr;
+        uint32_t currentMaterialIndex = ~0u;
+        uint32_t currentSubMeshIndex = ~0u;
+        const Material *batchMaterial = nullptr;
+        Job::ShaderConstants materialConstants;
         Batch *currentBatch = nullptr;
         Job *currentJob = nullptr;
+        int batchCount = 0;
         for (const auto &job : jobs)
         {
-            if (currentMaterial != job.material)
+            if (!job.isVisible() || (job.clusterDraw && (job.clusterDraw->indexCount == 0)))
+                continue;
+
+            if (currentMaterialIndex != job.materialIndex)
             {
-                currentMaterial = job.material;
+                currentMaterialIndex = job.materialIndex;
+                currentSubMeshIndex = ~0u;
 
-                currentBatch = radiancePass->addBatch(std::string("Material"));
-                currentBatch->setDepthStencil(this->equalDepthState);
-                currentBatch->setInputLayout(this->inputLayout);
+                // constants of all materials go to the same ring buffer, so materials
+                // only differing by their constants are drawn in a single batch
+                const Material *material = Material::getMaterial(job.materialIndex);
+                materialConstants = material->uploadConstants(renderList->getMaterialConstants(job.materialIndex));
 
-                currentMaterial->setupBatch(currentBatch, settings, this->shadowRenderer->getSRV(), this->shadowRenderer->getSampler(), &shadowConstants);
+                if (!batchMaterial || !material->canShareBatch(batchMaterial))
+                {
+                    batchMaterial = material;
+                    batchCount++;
+
+                    currentBatch = radiancePass->addBatch("Material");
+                    currentBatch->setDepthStencil(this->equalDepthState);
+                    currentBatch->setInputLayout(this->inputLayout);
+
+                    material->setupBatch(currentBatch, settings, this->shadowRenderer->getSRV(), this->shadowRenderer->getSampler());
+                }
+            }
+
+            if (job.clusterDraw && job.clusterDraw->indexBuffer)
+            {
+                currentSubMeshIndex = ~0u;
+
+                const Mesh::SubMesh *subMesh = Mesh::getSubMesh(job.subMeshIndex);
+                Job *clusterJob = currentBatch->addJob();
+                clusterJob->setBuffers(subMesh->vertexBuffer, job.clusterDraw->indexBuffer, subMesh->indexFormat, job.clusterDraw->firstIndex, job.clusterDraw->indexCount);
+                clusterJob->setShaderConstants(materialConstants);
+                clusterJob->addInstance(job.transformIndex);
+                continue;
             }
 
-            if (currentSubMesh != job.subMesh)
+            if (currentSubMeshIndex != job.subMeshIndex)
             {
-                currentSubMesh = job.subMesh;
+                currentSubMeshIndex = job.subMeshIndex;
 
+                const Mesh::SubMesh *subMesh = Mesh::getSubMesh(job.subMeshIndex);
                 currentJob = currentBatch->addJob();
-                currentJob->setBuffers(currentSubMesh->vertexBuffer, currentSubMesh->indexBuffer, currentSubMesh->indexCount);
+                currentJob->setBuffers(subMesh->vertexBuffer, subMesh->indexBuffer, subMesh->indexFormat, subMesh->firstIndex, subMesh->indexCount);
+                currentJob->setShaderConstants(materialConstants);
             }
 
-			InstanceData instanceData;
-			instanceData.modelMatrix = job.transform;
-			instanceData.worldToPreviousFrameClipSpaceMatrix = this->previousFrameViewProjectionMatrix * job.previousFrameTransform * glm::inverse(job.transform);
-			instanceData.normalMatrix = glm::mat3x4(glm::inverseTranspose(glm::mat3(job.transform)));
-		
-			currentJob->addInstance(instanceData);
+			currentJob->addInstance(job.transformIndex);
         }
+
+        GPUProfiler::getInstance()->addCounter("MaterialBatches", batchCount);
+        GPUProfiler::getInstance()->addCounter("Triangles", renderList->getTriangleCount());
+        GPUProfiler::getInstance()->addCounter("LodTrianglesSaved", renderList->getSavedTriangleCount());
+        GPUProfiler::getInstance()->addCounter("ClusterTrianglesCulled", renderList->getClusterCulledTriangleCount());
     }
 
     // background
@@ -444,7 +485,7 @@ void Renderer::render(const Scene *scene, const RenderSettings &settings, float
     const Mesh::SubMesh &quadSubMesh = this->fullscreenQuad->getSubMeshes()[0];
 
     Job *backgroundJob = backgroundBatch->addJob();
-    backgroundJob->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexCount);
+    backgroundJob->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexFormat, quadSubMesh.firstIndex, quadSubMesh.indexCount);
 	backgroundJob->addInstance();
 
     this->postProcessor->render(this->frameGraph, settings, this->motionTarget);
@@ -7,6 +7,9 @@
 
 #include <glm/glm.hpp>
 
+#include <engine/render/StateObjects.h>
+
+class ClusteredLights;
 class FrameGraph;
 class Mesh;
 class PostProcessor;
@@ -15,6 +18,7 @@ struct RenderSettings;
 class RenderTarget;
 class Scene;
 class ShadowRenderer;
+class TransformBuffer;
 
 class Renderer
 {
@@ -23,6 +27,9 @@ class Renderer
         ~Renderer();
 
         void render(const Scene *scene, const RenderSettings &settings, float deltaTime);
+
+        // the list is sorted in place
+        void render(RenderList *renderList, const RenderSettings &settings, float deltaTime);
         void renderBlenderViewport(const Scene *scene, const RenderSettings &settings);
         void renderBlenderFrame(const Scene *scene, const RenderSettings &settings, float *outputBuffer, float deltaTime);
 
@@ -43,8 +50,8 @@ class Renderer
         ID3D11DepthStencilView *depthTarget;
         ID3D11ShaderResourceView *depthSRV;
 
-        ID3D11InputLayout *inputLayout;
-        ID3D11InputLayout *depthOnlyInputLayout;
+        StateObjects::Id inputLayout;
+        StateObjects::Id depthOnlyInputLayout;
 
         RenderList *renderList;
 
@@ -56,11 +63,14 @@ class Renderer
         static const int GBUFFER_PLANE_COUNT = 2;
         RenderTarget *gBuffer[GBUFFER_PLANE_COUNT];
 
-        ID3D11DepthStencilState *lessEqualDepthState;
-        ID3D11DepthStencilState *equalDepthState;
+        StateObjects::Id lessEqualDepthState;
+        StateObjects::Id equalDepthState;
+        StateObjects::Id rasterizerState;
 
         PostProcessor *postProcessor;
         ShadowRenderer *shadowRenderer;
+        TransformBuffer *transformBuffer;
+        ClusteredLights *clusteredLights;
         RenderTarget *motionTarget;
 
         glm::mat4 previousFrameViewProjectionMatrix;
@@ -0,0 +1,116 @@
+#include <engine/render/ShadowAtlas.h>
+
+#include <cassert>
+
+ShadowAtlas::ShadowAtlas(int size, int minTileSize)
+{
+    assert(minTileSize > 0 && minTileSize <= size);
+
+    this->size = size;
+    this->levelCount = 1;
+    while ((size >> this->levelCount) >= minTileSize)
+        this->levelCount++;
+
+    int nodeCount = 0;
+    for (int level = 0; level < this->levelCount; level++)
+        nodeCount += 1 << (2 * level);
+
+    this->nodes.resize(nodeCount, FREE);
+}
+
+bool ShadowAtlas::allocate(int size, Tile *tile)
+{
+    int level = 0;
+    while (level < this->levelCount - 1 && (this->size >> (level + 1)) >= size)
+        level++;
+
+    if ((this->size >> level) < size)
+        return false;
+
+    return this->allocateNode(0, 0, 0, 0, level, tile);
+}
+
+void ShadowAtlas::release(const Tile &tile)
+{
+    // walk down to the node of the tile
+    int node = 0;
+    int nodeSize = this->size;
+    int x = 0;
+    int y = 0;
+    while (nodeSize > tile.size)
+    {
+        nodeSize /= 2;
+
+        int child = 0;
+        if (tile.x >= x + nodeSize)
+        {
+            child += 1;
+            x += nodeSize;
+        }
+        if (tile.y >= y + nodeSize)
+        {
+            child += 2;
+            y += nodeSize;
+        }
+
+        node = node * 4 + 1 + child;
+    }
+
+    assert(this->nodes[node] == USED);
+    this->nodes[node] = FREE;
+
+    // merge free siblings
+    while (node > 0)
+    {
+        int parent = (node - 1) / 4;
+        int firstChild = parent * 4 + 1;
+        for (int i = 0; i < 4; i++)
+        {
+            if (this->nodes[firstChild + i] != FREE)
+                return;
+        }
+
+        this->nodes[parent] = FREE;
+        node = parent;
+    }
+}
+
+bool ShadowAtlas::allocateNode(int node, int level, int x, int y, int targetLevel, Tile *tile)
+{
+    NodeState state = this->nodes[node];
+    if (level == targetLevel)
+    {
+        if (state != FREE)
+            return false;
+
+        this->nodes[node] = USED;
+        tile->x = x;
+        tile->y = y;
+        tile->size = this->size >> level;
+        return true;
+    }
+
+    if (state == USED)
+        return false;
+
+    // children of a free node are free too
+    this->nodes[node] = SPLIT;
+
+    int childSize = this->size >> (level + 1);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            int child = node * 4 + 1 + i;
+            if ((this->nodes[child] == SPLIT) != (pass == 0))
+                continue;
+
+            if (this->allocateNode(child, level + 1, x + (i & 1) * childSize, y + (i >> 1) * childSize, targetLevel, tile))
+                return true;
+        }
+    }
+
+    // nothing found below, restore the node
+    this->nodes[node] = state;
+    return false;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Quadtree allocator for the square tiles of the shadow map atlas.
+ * Tile sizes are powers of two between the minimum tile size and the atlas size;
+ * allocations go to nodes that are already split first, to keep large areas free.
+ */
+class ShadowAtlas
+{
+    public:
+        struct Tile
+        {
+            int x;
+            int y;
+            int size;
+        };
+
+        ShadowAtlas(int size, int minTileSize);
+
+        // size is rounded up to a valid tile size; returns false when the atlas is full
+        bool allocate(int size, Tile *tile);
+        void release(const Tile &tile);
+
+        int getSize() const { return this->size; }
+        int getMinTileSize() const { return this->size >> (this->levelCount - 1); }
+
+    private:
+        enum NodeState : uint8_t
+        {
+            FREE,
+            SPLIT,
+            USED
+        };
+
+        bool allocateNode(int node, int level, int x, int y, int targetLevel, Tile *tile);
+
+        // complete quadtree, children of node i are 4i+1 to 4i+4
+        std::vector<NodeState> nodes;
+        int levelCount;
+        int size;
+};
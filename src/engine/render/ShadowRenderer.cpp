@@ -1,6 +1,9 @@
 #include <engine/render/ShadowRenderer.h>
 
+#include <algorithm>
+
 #include <engine/render/Device.h>
+#include <engine/render/Mesh.h>
 #include <engine/render/RenderList.h>
 #include <engine/render/Shaders.h>
 #include <engine/render/graph/Batch.h>
@@ -8,20 +11,42 @@
 #include <engine/render/graph/GPUProfiler.h>
 #include <engine/render/graph/Job.h>
 #include <engine/render/graph/Pass.h>
-#include <engine/scene/Scene.h>
+#include <engine/resource/ResourceManager.h>
+
+#include <engine/render/shaders/constants/ShadowConstants.h>
 
-#include <engine/render/shaders/constants/StandardConstants.h>
+static_assert(ShadowRenderer::MAX_SHADOW_COUNT <= RenderList::MAX_SHADOW_SLOTS, "shadow slots are bits of the job visibility");
 
-ShadowRenderer::ShadowRenderer(int resolution)
+// tile sizes, the largest one is given to lights covering the whole screen
+static const int MIN_TILE_SIZE = 64;
+static const int MAX_TILE_SIZE = 1024;
+
+static int computeTileSize(const RenderList::Light &light, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix)
 {
-    HRESULT res;
+    // fraction of the screen height covered by the light bounding sphere
+    float distance = -(viewMatrix * glm::vec4(light.position, 1.0f)).z;
+    float coverage = 1.0f;
+    if (distance < -light.radius)
+        coverage = 0.0f;
+    else if (distance > light.radius)
+        coverage = light.radius * projectionMatrix[1][1] / distance;
+
+    int tileSize = MIN_TILE_SIZE;
+    while (tileSize < MAX_TILE_SIZE && tileSize < coverage * MAX_TILE_SIZE)
+        tileSize *= 2;
+
+    return tileSize;
+}
 
-    this->resolution = resolution;
+ShadowRenderer::ShadowRenderer(int atlasSize)
+    : atlas(atlasSize, MIN_TILE_SIZE)
+{
+    HRESULT res;
 
     D3D11_TEXTURE2D_DESC shadowMapDesc;
     ZeroMemory(&shadowMapDesc, sizeof(shadowMapDesc));
-    shadowMapDesc.Width = resolution * 2;
-    shadowMapDesc.Height = resolution * 2;
+    shadowMapDesc.Width = atlasSize;
+    shadowMapDesc.Height = atlasSize;
     shadowMapDesc.MipLevels = 1;
     shadowMapDesc.ArraySize = 1;
     shadowMapDesc.Format = DXGI_FORMAT_R24G8_TYPELESS;
@@ -60,8 +85,7 @@ ShadowRenderer::ShadowRenderer(int resolution)
     samplerDesc.MinLOD = 0;
     samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
 
-    res = Device::device->CreateSamplerState(&samplerDesc, &this->sampler);
-    CHECK_HRESULT(res);
+    this->sampler = StateObjects::createSampler(samplerDesc);
     D3D11_DEPTH_STENCIL_DESC depthStateDesc;
 
     ZeroMemory(&depthStateDesc, sizeof(depthStateDesc));
@@ -69,8 +93,13 @@ ShadowRenderer::ShadowRenderer(int resolution)
     depthStateDesc.DepthEnable = TRUE;
     depthStateDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
     depthStateDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-    res = Device::device->CreateDepthStencilState(&depthStateDesc, &this->depthState);
-    CHECK_HRESULT(res);
+    this->depthState = StateObjects::createDepthStencil(depthStateDesc);
+
+    // tiles are cleared one by one with a quad at the far plane
+    depthStateDesc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+    this->clearDepthState = StateObjects::createDepthStencil(depthStateDesc);
+
+    this->fullscreenQuad = ResourceManager::getInstance()->requestResource<Mesh>("__fullscreenQuad");
 }
 
 ShadowRenderer::~ShadowRenderer()
@@ -78,52 +107,180 @@ ShadowRenderer::~ShadowRenderer()
     this->shadowMap->Release();
     this->target->Release();
     this->srv->Release();
-    this->sampler->Release();
-    this->depthState->Release();
+    StateObjects::release(this->sampler);
+    StateObjects::release(this->depthState);
+    StateObjects::release(this->clearDepthState);
+
+    ResourceManager::getInstance()->releaseResource(this->fullscreenQuad);
 }
 
-void ShadowRenderer::render(FrameGraph *frameGraph, const Scene *scene, const RenderList *renderList, ShadowConstants *shadowConstants, ID3D11InputLayout *inputLayout)
+void ShadowRenderer::assignShadowSlots(std::vector<RenderList::Light> &lights, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix)
+{
+    // only spotlights cast shadows, the ones covering the most of the screen first
+    std::vector<std::pair<int, int>> candidates; // tile size, light index
+    for (int i = 0; i < (int)lights.size(); i++)
+    {
+        lights[i].shadowSlot = -1;
+        if (lights[i].spot)
+            candidates.push_back(std::make_pair(computeTileSize(lights[i], viewMatrix, projectionMatrix), i));
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(), [](const std::pair<int, int> &lhs, const std::pair<int, int> &rhs)
+    {
+        return lhs.first > rhs.first;
+    });
+
+    int slotCount = std::min((int)candidates.size(), MAX_SHADOW_COUNT);
+    for (int slot = 0; slot < slotCount; slot++)
+        lights[candidates[slot].second].shadowSlot = slot;
+}
+
+void ShadowRenderer::render(FrameGraph *frameGraph, const RenderList *renderList, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix, ShadowConstants *shadowConstants, StateObjects::Id inputLayout)
 {
     const std::vector<RenderList::Job> &jobs = renderList->getJobs();
     const std::vector<RenderList::Light> &lights = renderList->getLights();
 
-	frameGraph->addClearTarget(this->target, 1.0f, 0);
+    // slots were given in order of screen coverage, so tiles are allocated from the largest one
+    std::vector<std::pair<int, int>> candidates(MAX_SHADOW_COUNT, std::make_pair(0, -1)); // tile size, light index
+    for (int i = 0; i < (int)lights.size(); i++)
+    {
+        if (lights[i].shadowSlot >= 0)
+            candidates[lights[i].shadowSlot] = std::make_pair(computeTileSize(lights[i], viewMatrix, projectionMatrix), i);
+    }
+
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [](const std::pair<int, int> &candidate)
+    {
+        return candidate.second < 0;
+    }), candidates.end());
+
+    // keep the tiles of lights still casting shadows, unless the size they were allocated for is
+    // too far off; comparing to the allocated size would drop fallback tiles every frame
+    for (auto &cachedShadow : this->cachedShadows)
+        cachedShadow.used = false;
+
+    for (const auto &candidate : candidates)
+    {
+        for (auto &cachedShadow : this->cachedShadows)
+        {
+            if (cachedShadow.lightId == lights[candidate.second].id)
+            {
+                cachedShadow.used = (cachedShadow.requestedSize >= candidate.first && cachedShadow.requestedSize <= candidate.first * 2);
+                break;
+            }
+        }
+    }
 
+    for (const auto &cachedShadow : this->cachedShadows)
+    {
+        if (!cachedShadow.used)
+            this->atlas.release(cachedShadow.tile);
+    }
+
+    this->cachedShadows.erase(std::remove_if(this->cachedShadows.begin(), this->cachedShadows.end(), [](const CachedShadow &cachedShadow)
+    {
+        return !cachedShadow.used;
+    }), this->cachedShadows.end());
+
+    GPUProfiler::ScopedProfile profile("Shadow");
+
+    this->shadowIndices.assign(lights.size(), -1);
     int shadowCount = 0;
-	for (int i = 0; i < lights.size(); i++)
-	{
-		// only spotlights cast shadows
-		if (!lights[i].spot || shadowCount >= 4)
-			continue;
-
-		int index = shadowCount++;
-
-		// apply NDC [-1, 1] to texture space [0, 1] to atlas rect
-		/*glm::vec3 scale = glm::vec3(0.5f, 0.5f, 1.0f);
-		glm::vec3 offset = glm::vec3(0.5f, 0.5f, 0.0f);
-		//glm::vec3 scale = glm::vec3(0.125f, 0.125f, 1.0f);
-		//glm::vec3 offset = glm::vec3(0.125f + 0.25f * (float)(index % 4), 0.125f + 0.25f * (float)(index / 4), 0.0f);
-		glm::mat4 biasMatrix(
-			scale.x, 0.0f, 0.0f, offset.x,
-			0.0f, scale.y, 0.0f, offset.y,
-			0.0f, 0.0f, scale.z, offset.z,
-			0.0f, 0.0f, 0.0f, 1.0f
-		);*/
-		shadowConstants->lightMatrix[index] = lights[i].shadowTransform;
-
-		GPUProfiler::ScopedProfile profile("Shadow");
+    int renderedCount = 0;
+    for (const auto &candidate : candidates)
+    {
+        int lightIndex = candidate.second;
+        const RenderList::Light &light = lights[lightIndex];
+
+        CachedShadow *cachedShadow = nullptr;
+        for (auto &existingShadow : this->cachedShadows)
+        {
+            if (existingShadow.lightId == light.id)
+            {
+                cachedShadow = &existingShadow;
+                break;
+            }
+        }
+
+        if (!cachedShadow)
+        {
+            // fall back to smaller tiles when the atlas is getting full
+            ShadowAtlas::Tile tile;
+            int tileSize = candidate.first;
+            while (!this->atlas.allocate(tileSize, &tile))
+            {
+                tileSize /= 2;
+                if (tileSize < this->atlas.getMinTileSize())
+                    break;
+            }
+
+            if (tileSize < this->atlas.getMinTileSize())
+                continue;
+
+            CachedShadow newShadow;
+            newShadow.lightId = light.id;
+            newShadow.tile = tile;
+            newShadow.requestedSize = candidate.first;
+            newShadow.casterHash = 0;
+            newShadow.rendered = false;
+            newShadow.used = true;
+            this->cachedShadows.push_back(newShadow);
+            cachedShadow = &this->cachedShadows.back();
+        }
+
+        int index = light.shadowSlot;
+        this->shadowIndices[lightIndex] = index;
+        shadowCount++;
+
+        // NDC [-1, 1] to texture space [0, 1] is applied in the shader, then scale and offset to the atlas tile
+        const ShadowAtlas::Tile &tile = cachedShadow->tile;
+        float atlasSize = (float)this->atlas.getSize();
+        shadowConstants->lightMatrix[index] = light.shadowTransform;
+        shadowConstants->atlasRects[index] = glm::vec4((float)tile.size / atlasSize, (float)tile.size / atlasSize, (float)tile.x / atlasSize, (float)tile.y / atlasSize);
+
+        // the tile is up to date if the light, its casters and their transforms didn't change
+        uint64_t casterHash = 14695981039346656037ull;
+        bool castersChanged = false;
+        for (const auto &job : jobs)
+        {
+            if (!job.isCastingShadow(index))
+                continue;
+
+            casterHash = (casterHash ^ (((uint64_t)job.subMeshIndex << 32) | job.transformIndex)) * 1099511628211ull;
+            castersChanged = castersChanged || renderList->hasTransformChanged(job.transformIndex);
+        }
+
+        if (cachedShadow->rendered && !castersChanged && cachedShadow->casterHash == casterHash && cachedShadow->shadowTransform == light.shadowTransform)
+            continue;
+
+        cachedShadow->shadowTransform = light.shadowTransform;
+        cachedShadow->casterHash = casterHash;
+        cachedShadow->rendered = true;
+        renderedCount++;
 
 		Pass *shadowPass = frameGraph->addPass("ShadowMap");
 		shadowPass->setTargets({}, this->target);
 
 		D3D11_VIEWPORT viewport;
-        viewport.Width = (float)this->resolution;
-        viewport.Height = (float)this->resolution;
+        viewport.Width = (float)tile.size;
+        viewport.Height = (float)tile.size;
         viewport.MinDepth = 0.0f;
         viewport.MaxDepth = 1.0f;
-        viewport.TopLeftX = (float)((index % 2) * this->resolution);
-        viewport.TopLeftY = (float)((index / 2) * this->resolution);
-        shadowPass->setViewport(viewport, glm::mat4(1.0f), glm::mat4(1.0f));
+        viewport.TopLeftX = (float)tile.x;
+        viewport.TopLeftY = (float)tile.y;
+        shadowPass->setViewport(viewport, glm::mat4(1.0f), light.shadowTransform);
+
+        // clear the tile only, the rest of the atlas is still in use
+        Batch *clearBatch = shadowPass->addBatch("Clear");
+        clearBatch->setDepthStencil(this->clearDepthState);
+        clearBatch->setVertexShader(Shaders::vertex.background);
+        clearBatch->setPixelShader(nullptr);
+        clearBatch->setInputLayout(inputLayout);
+
+        const Mesh::SubMesh &quadSubMesh = this->fullscreenQuad->getSubMeshes()[0];
+
+        Job *clearJob = clearBatch->addJob();
+        clearJob->setBuffers(quadSubMesh.vertexBuffer, quadSubMesh.indexBuffer, quadSubMesh.indexFormat, quadSubMesh.firstIndex, quadSubMesh.indexCount);
+        clearJob->addInstance();
 
 		Batch *batch = shadowPass->addBatch("Light");
 		batch->setDepthStencil(this->depthState);
@@ -131,22 +288,26 @@ void ShadowRenderer::render(FrameGraph *frameGraph, const Scene *scene, const Re
 		batch->setPixelShader(Shaders::pixel.depthOnly);
 		batch->setInputLayout(inputLayout);
 
-        const Mesh::SubMesh *currentSubMesh = nullptr;
+        uint32_t currentSubMeshIndex = ~0u;
 		Job *currentJob = nullptr;
         for (const auto &job : jobs)
         {
-            if (currentSubMesh != job.subMesh)
+            if (!job.isCastingShadow(index))
+                continue;
+
+            if (currentSubMeshIndex != job.subMeshIndex)
             {
-                currentSubMesh = job.subMesh;
+                currentSubMeshIndex = job.subMeshIndex;
 
+                const Mesh::SubMesh *subMesh = Mesh::getSubMesh(job.subMeshIndex);
 				currentJob = batch->addJob();
-                currentJob->setBuffers(currentSubMesh->vertexBuffer, currentSubMesh->indexBuffer, currentSubMesh->indexCount);
+                currentJob->setBuffers(subMesh->vertexBuffer, subMesh->indexBuffer, subMesh->indexFormat, subMesh->firstIndex, subMesh->indexCount);
             }
 
-			DepthOnlyInstanceData instanceData;
-			instanceData.transformMatrix = lights[i].shadowTransform * job.transform;
-	
-			currentJob->addInstance(instanceData);
+			currentJob->addInstance(job.transformIndex);
 		}
     }
+
+    GPUProfiler::getInstance()->addCounter("ShadowTilesRendered", renderedCount);
+    GPUProfiler::getInstance()->addCounter("ShadowTilesCached", shadowCount - renderedCount);
 }
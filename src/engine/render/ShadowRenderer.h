@@ -1,36 +1,67 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include <d3d11.h>
 #include <glm/glm.hpp>
 
+#include <engine/render/RenderList.h>
+#include <engine/render/ShadowAtlas.h>
+#include <engine/render/StateObjects.h>
+
 class FrameGraph;
-class RenderList;
-class Scene;
+class Mesh;
 struct ShadowConstants;
 
-struct DepthOnlyInstanceData
-{
-    glm::mat4 transformMatrix;
-};
-
+/**
+ * Renders spot light shadow maps into tiles of a shared atlas. Tiles are sized by the
+ * screen coverage of the light, and kept from frame to frame: a tile is only rendered
+ * again when the light, its casters or their transforms changed.
+ */
 class ShadowRenderer
 {
     public:
-        ShadowRenderer(int resolution);
+        // spot lights covering the most of the screen cast shadows, up to this count (see ShadowConstants)
+        static const int MAX_SHADOW_COUNT = 16;
+
+        ShadowRenderer(int atlasSize);
         ~ShadowRenderer();
 
-        void render(FrameGraph *frameGraph, const Scene *scene, const RenderList *renderList, ShadowConstants *shadowConstants, ID3D11InputLayout *inputLayout);
+        // gives a shadow slot to the lights casting shadows; called when filling the render list,
+        // as jobs reference the slots of the lights they cast shadows for
+        static void assignShadowSlots(std::vector<RenderList::Light> &lights, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix);
+
+        void render(FrameGraph *frameGraph, const RenderList *renderList, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix, ShadowConstants *shadowConstants, StateObjects::Id inputLayout);
+
+        // per light of the render list, -1 when the light has no shadow map; otherwise its shadow slot
+        const std::vector<int> &getShadowIndices() const { return this->shadowIndices; }
 
 		ID3D11ShaderResourceView *getSRV() const { return this->srv; }
-		ID3D11SamplerState *getSampler() const { return this->sampler; }
+		StateObjects::Id getSampler() const { return this->sampler; }
 
     private:
-        int resolution;
+        struct CachedShadow
+        {
+            uint32_t lightId;
+            ShadowAtlas::Tile tile;
+            int requestedSize; // tile size wanted for the light, larger than the tile when the atlas was full
+            glm::mat4 shadowTransform;
+            uint64_t casterHash;
+            bool rendered;
+            bool used; // by the current frame
+        };
+
+        ShadowAtlas atlas;
+        std::vector<CachedShadow> cachedShadows;
+        std::vector<int> shadowIndices;
+
         ID3D11Texture2D *shadowMap;
         ID3D11DepthStencilView *target;
         ID3D11ShaderResourceView *srv;
-        ID3D11SamplerState *sampler;
-        ID3D11DepthStencilState *depthState;
+        StateObjects::Id sampler;
+        StateObjects::Id depthState;
+        StateObjects::Id clearDepthState;
 
-        ID3D11Buffer *cbShadows;
+        Mesh *fullscreenQuad;
 };
@@ -1,9 +1,10 @@
 #include <engine/render/StandardBsdf.h>
 
+#include <cstring>
+
 #include <engine/animation/AnimationData.h>
 #include <engine/animation/AnimationPlayer.h>
 #include <engine/animation/PropertyMapping.h>
-#include <engine/render/Device.h>
 #include <engine/render/RenderSettings.h>
 #include <engine/render/Shaders.h>
 #include <engine/render/Texture.h>
@@ -31,17 +32,6 @@ StandardBsdf::StandardBsdf(cJSON *json)
     this->normalMap = ResourceManager::getInstance()->requestResource<Texture>(cJSON_GetObjectItem(json, "normalMap")->valuestring);
     this->metallicMap = ResourceManager::getInstance()->requestResource<Texture>(cJSON_GetObjectItem(json, "metallicMap")->valuestring);
     this->roughnessMap = ResourceManager::getInstance()->requestResource<Texture>(cJSON_GetObjectItem(json, "roughnessMap")->valuestring);
-
-    D3D11_BUFFER_DESC cbDesc;
-    cbDesc.Usage = D3D11_USAGE_DYNAMIC;
-    cbDesc.ByteWidth = sizeof(StandardConstants);
-    cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-    cbDesc.StructureByteStride = 0;
-    cbDesc.MiscFlags = 0;
-    cbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-
-    HRESULT res = Device::device->CreateBuffer(&cbDesc, nullptr, &this->constantBuffer);
-    CHECK_HRESULT(res);
 }
 
 StandardBsdf::~StandardBsdf()
@@ -50,8 +40,6 @@ StandardBsdf::~StandardBsdf()
     ResourceManager::getInstance()->releaseResource(this->normalMap);
     ResourceManager::getInstance()->releaseResource(this->metallicMap);
     ResourceManager::getInstance()->releaseResource(this->roughnessMap);
-
-    this->constantBuffer->Release();
 }
 
 void StandardBsdf::registerAnimatedProperties(PropertyMapping &properties)
@@ -64,26 +52,16 @@ void StandardBsdf::registerAnimatedProperties(PropertyMapping &properties)
     properties.add("leaf.uv_offset", (float *)&this->constants.uvOffset);
 }
 
-void StandardBsdf::setupBatch(Batch *batch, const RenderSettings &settings, ID3D11ShaderResourceView *shadowSRV, ID3D11SamplerState *shadowSampler, ShadowConstants *shadowConstants)
+void StandardBsdf::setupBatch(Batch *batch, const RenderSettings &settings, ID3D11ShaderResourceView *shadowSRV, StateObjects::Id shadowSampler)
 {
-	this->constants.shadows = *shadowConstants;
-
-    D3D11_MAPPED_SUBRESOURCE mappedResource;
-    HRESULT res = Device::context->Map(this->constantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-    CHECK_HRESULT(res);
-    memcpy(mappedResource.pData, &constants, sizeof(constants));
-    Device::context->Unmap(this->constantBuffer, 0);
-
     batch->setVertexShader(Shaders::vertex.standard);
     batch->setPixelShader(Shaders::pixel.standard);
 
-    batch->setShaderConstants(this->constantBuffer);
-
     batch->setResources({
-        this->baseColorMap->getSRV(),
-        this->normalMap->getSRV(),
-        this->metallicMap->getSRV(),
-        this->roughnessMap->getSRV(),
+        this->baseColorMap->getSlot().srv,
+        this->normalMap->getSlot().srv,
+        this->metallicMap->getSlot().srv,
+        this->roughnessMap->getSlot().srv,
 		shadowSRV,
         settings.environment.environmentMap->getSRV()
 	});
@@ -97,3 +75,56 @@ void StandardBsdf::setupBatch(Batch *batch, const RenderSettings &settings, ID3D
         this->baseColorMap->getSamplerState() // use base color sampler for envmap
 	});
 }
+
+void StandardBsdf::captureConstants(void *constants) const
+{
+    memcpy(constants, &this->constants, sizeof(this->constants));
+}
+
+Job::ShaderConstants StandardBsdf::uploadConstants(const void *capturedConstants) const
+{
+    const TextureArrays::Slot &baseColorSlot = this->baseColorMap->getSlot();
+    const TextureArrays::Slot &normalSlot = this->normalMap->getSlot();
+    const TextureArrays::Slot &metallicSlot = this->metallicMap->getSlot();
+    const TextureArrays::Slot &roughnessSlot = this->roughnessMap->getSlot();
+
+    // texture slots only change on the render thread
+    StandardConstants constants;
+    memcpy(&constants, capturedConstants, sizeof(constants));
+    constants.baseColorRect = baseColorSlot.rect;
+    constants.normalRect = normalSlot.rect;
+    constants.metallicRect = metallicSlot.rect;
+    constants.roughnessRect = roughnessSlot.rect;
+    constants.mapSlices = glm::vec4(baseColorSlot.slice, normalSlot.slice, metallicSlot.slice, roughnessSlot.slice);
+    constants.mapInsets = glm::vec4(baseColorSlot.inset, normalSlot.inset, metallicSlot.inset, roughnessSlot.inset);
+
+    return Job::uploadShaderConstants(&constants, sizeof(constants));
+}
+
+bool StandardBsdf::canShareBatch(const Bsdf *other) const
+{
+    const StandardBsdf *standard = dynamic_cast<const StandardBsdf *>(other);
+    if (standard == nullptr)
+        return false;
+
+    // maps in the same texture arrays, slices and cells are per draw constants
+    auto sameArray = [](const Texture *a, const Texture *b)
+    {
+        return (a == b) || ((a->getSlot().srv != nullptr) && (a->getSlot().srv == b->getSlot().srv) && (a->getSamplerState() == b->getSamplerState()));
+    };
+
+    return sameArray(standard->baseColorMap, this->baseColorMap)
+        && sameArray(standard->normalMap, this->normalMap)
+        && sameArray(standard->metallicMap, this->metallicMap)
+        && sameArray(standard->roughnessMap, this->roughnessMap);
+}
+
+void StandardBsdf::requestScreenSize(float screenSize) const
+{
+    // uvs are assumed to cover the object once before scaling
+    float textureSize = screenSize * glm::max(fabsf(this->constants.uvScale.x), fabsf(this->constants.uvScale.y));
+    this->baseColorMap->requestScreenSize(textureSize);
+    this->normalMap->requestScreenSize(textureSize);
+    this->metallicMap->requestScreenSize(textureSize);
+    this->roughnessMap->requestScreenSize(textureSize);
+}
@@ -14,11 +14,15 @@ class StandardBsdf: public Bsdf
         virtual ~StandardBsdf();
 
         virtual void registerAnimatedProperties(PropertyMapping &properties) override;
-        virtual void setupBatch(Batch *batch, const RenderSettings &settings, ID3D11ShaderResourceView *shadowSRV, ID3D11SamplerState *shadowSampler, ShadowConstants *shadowConstants) override;
+        virtual void setupBatch(Batch *batch, const RenderSettings &settings, ID3D11ShaderResourceView *shadowSRV, StateObjects::Id shadowSampler) override;
+        virtual size_t getConstantsSize() const override { return sizeof(this->constants); }
+        virtual void captureConstants(void *constants) const override;
+        virtual Job::ShaderConstants uploadConstants(const void *constants) const override;
+        virtual bool canShareBatch(const Bsdf *other) const override;
+        virtual void requestScreenSize(float screenSize) const override;
 
     private:
         StandardConstants constants;
-        ID3D11Buffer *constantBuffer;
 
         Texture *baseColorMap;
         Texture *normalMap;
@@ -0,0 +1,397 @@
+#include <engine/render/StateCache.h>
+
+#include <cassert>
+
+#include <engine/render/Device.h>
+#include <engine/render/graph/GPUProfiler.h>
+
+namespace
+{
+    // the view keeps a reference, so the pointer stays valid as long as the view is bound
+    ID3D11Resource *getResource(ID3D11View *view)
+    {
+        if (view == nullptr)
+            return nullptr;
+
+        ID3D11Resource *resource = nullptr;
+        view->GetResource(&resource);
+        resource->Release();
+        return resource;
+    }
+
+    void bindShaderResources(ID3D11DeviceContext *context, StateCache::Stage stage, int firstSlot, int count, ID3D11ShaderResourceView *const *resources)
+    {
+        switch (stage)
+        {
+            case StateCache::VERTEX_STAGE: context->VSSetShaderResources(firstSlot, count, resources); break;
+            case StateCache::PIXEL_STAGE: context->PSSetShaderResources(firstSlot, count, resources); break;
+            case StateCache::COMPUTE_STAGE: context->CSSetShaderResources(firstSlot, count, resources); break;
+        }
+    }
+}
+
+StateCache::StateCache(ID3D11DeviceContext *context)
+    : context(context)
+{
+    // support is checked at device creation; the interface lives as long as the context, no need to keep a reference
+    HRESULT res = context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void **)&this->context1);
+    CHECK_HRESULT(res);
+    this->context1->Release();
+}
+
+bool StateCache::filter(bool redundant)
+{
+    if (redundant)
+        this->filteredCallCount++;
+    else
+        this->issuedCallCount++;
+
+    return redundant;
+}
+
+void StateCache::setVertexShader(ID3D11VertexShader *shader)
+{
+    if (this->filter(this->vertexShader == shader))
+        return;
+
+    this->vertexShader = shader;
+    this->context->VSSetShader(shader, nullptr, 0);
+}
+
+void StateCache::setPixelShader(ID3D11PixelShader *shader)
+{
+    if (this->filter(this->pixelShader == shader))
+        return;
+
+    this->pixelShader = shader;
+    this->context->PSSetShader(shader, nullptr, 0);
+}
+
+void StateCache::setComputeShader(ID3D11ComputeShader *shader)
+{
+    if (this->filter(this->computeShader == shader))
+        return;
+
+    this->computeShader = shader;
+    this->context->CSSetShader(shader, nullptr, 0);
+}
+
+void StateCache::setConstantBuffer(Stage stage, int slot, ID3D11Buffer *buffer, UINT firstConstant, UINT constantCount)
+{
+    assert(slot < MAX_CONSTANT_BUFFERS);
+
+    bool redundant = (this->constantBuffers[stage][slot] == buffer)
+        && (this->constantBufferFirstConstants[stage][slot] == firstConstant)
+        && (this->constantBufferConstantCounts[stage][slot] == constantCount);
+    if (this->filter(redundant))
+        return;
+
+    this->constantBuffers[stage][slot] = buffer;
+    this->constantBufferFirstConstants[stage][slot] = firstConstant;
+    this->constantBufferConstantCounts[stage][slot] = constantCount;
+
+    if (constantCount == 0)
+    {
+        switch (stage)
+        {
+            case VERTEX_STAGE: this->context->VSSetConstantBuffers(slot, 1, &buffer); break;
+            case PIXEL_STAGE: this->context->PSSetConstantBuffers(slot, 1, &buffer); break;
+            case COMPUTE_STAGE: this->context->CSSetConstantBuffers(slot, 1, &buffer); break;
+        }
+    }
+    else
+    {
+        switch (stage)
+        {
+            case VERTEX_STAGE: this->context1->VSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &constantCount); break;
+            case PIXEL_STAGE: this->context1->PSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &constantCount); break;
+            case COMPUTE_STAGE: this->context1->CSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &constantCount); break;
+        }
+    }
+}
+
+void StateCache::setShaderResources(Stage stage, int firstSlot, int count, ID3D11ShaderResourceView *const *resources)
+{
+    assert(firstSlot + count <= MAX_SHADER_RESOURCES);
+
+    bool redundant = true;
+    for (int i = 0; i < count; i++)
+    {
+        int slot = firstSlot + i;
+        if (this->shaderResources[stage][slot] == resources[i])
+            continue;
+
+        redundant = false;
+
+        // a resource can't be read while it is bound for writing
+        ID3D11Resource *resource = getResource(resources[i]);
+        if (resource != nullptr)
+        {
+            if (this->isBoundAsTarget(resource))
+                this->setRenderTargets(0, nullptr, nullptr);
+
+            this->unbindUnorderedResources(resource);
+        }
+
+        this->shaderResources[stage][slot] = resources[i];
+        this->shaderResourceTargets[stage][slot] = resource;
+    }
+
+    if (this->filter(redundant))
+        return;
+
+    bindShaderResources(this->context, stage, firstSlot, count, resources);
+}
+
+void StateCache::setSamplers(Stage stage, int count, ID3D11SamplerState *const *samplers)
+{
+    assert(count <= MAX_SAMPLERS);
+
+    bool redundant = true;
+    for (int i = 0; i < count; i++)
+    {
+        if (this->samplers[stage][i] != samplers[i])
+        {
+            this->samplers[stage][i] = samplers[i];
+            redundant = false;
+        }
+    }
+
+    if (this->filter(redundant))
+        return;
+
+    switch (stage)
+    {
+        case VERTEX_STAGE: this->context->VSSetSamplers(0, count, samplers); break;
+        case PIXEL_STAGE: this->context->PSSetSamplers(0, count, samplers); break;
+        case COMPUTE_STAGE: this->context->CSSetSamplers(0, count, samplers); break;
+    }
+}
+
+void StateCache::setUnorderedResources(int count, ID3D11UnorderedAccessView *const *resources)
+{
+    assert(count <= MAX_UNORDERED_RESOURCES);
+
+    bool redundant = true;
+    for (int i = 0; i < count; i++)
+    {
+        if (this->unorderedResources[i] == resources[i])
+            continue;
+
+        redundant = false;
+
+        // a resource can't be written while it is bound for reading (or as a target)
+        ID3D11Resource *resource = getResource(resources[i]);
+        if (resource != nullptr)
+        {
+            if (this->isBoundAsTarget(resource))
+                this->setRenderTargets(0, nullptr, nullptr);
+
+            this->unbindShaderResources(resource);
+        }
+
+        this->unorderedResources[i] = resources[i];
+        this->unorderedResourceTargets[i] = resource;
+    }
+
+    if (this->filter(redundant))
+        return;
+
+    this->context->CSSetUnorderedAccessViews(0, count, resources, nullptr);
+}
+
+void StateCache::setInputLayout(ID3D11InputLayout *inputLayout)
+{
+    if (this->filter(this->inputLayout == inputLayout))
+        return;
+
+    this->inputLayout = inputLayout;
+    this->context->IASetInputLayout(inputLayout);
+}
+
+void StateCache::setVertexBuffer(int slot, ID3D11Buffer *buffer, UINT stride, UINT offset)
+{
+    assert(slot < MAX_VERTEX_BUFFERS);
+
+    bool redundant = (this->vertexBuffers[slot] == buffer) && (this->vertexBufferStrides[slot] == stride) && (this->vertexBufferOffsets[slot] == offset);
+    if (this->filter(redundant))
+        return;
+
+    this->vertexBuffers[slot] = buffer;
+    this->vertexBufferStrides[slot] = stride;
+    this->vertexBufferOffsets[slot] = offset;
+    this->context->IASetVertexBuffers(slot, 1, &buffer, &stride, &offset);
+}
+
+void StateCache::setIndexBuffer(ID3D11Buffer *buffer, DXGI_FORMAT format)
+{
+    if (this->filter((this->indexBuffer == buffer) && (this->indexFormat == format)))
+        return;
+
+    this->indexBuffer = buffer;
+    this->indexFormat = format;
+    this->context->IASetIndexBuffer(buffer, format, 0);
+}
+
+void StateCache::setPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+    if (this->filter(this->topology == topology))
+        return;
+
+    this->topology = topology;
+    this->context->IASetPrimitiveTopology(topology);
+}
+
+void StateCache::setDepthStencilState(ID3D11DepthStencilState *depthStencil)
+{
+    if (this->filter(this->depthStencil == depthStencil))
+        return;
+
+    this->depthStencil = depthStencil;
+    this->context->OMSetDepthStencilState(depthStencil, 0);
+}
+
+void StateCache::setRasterizerState(ID3D11RasterizerState *rasterizer)
+{
+    if (this->filter(this->rasterizer == rasterizer))
+        return;
+
+    this->rasterizer = rasterizer;
+    this->context->RSSetState(rasterizer);
+}
+
+void StateCache::setRenderTargets(int count, ID3D11RenderTargetView *const *targets, ID3D11DepthStencilView *depthStencil)
+{
+    assert(count <= MAX_RENDER_TARGETS);
+
+    bool redundant = (this->renderTargetCount == count) && (this->depthStencilTarget == depthStencil);
+    for (int i = 0; (i < count) && redundant; i++)
+        redundant = (this->renderTargets[i] == targets[i]);
+
+    if (this->filter(redundant))
+        return;
+
+    // targets can't be read from anymore
+    for (int i = 0; i < count; i++)
+    {
+        this->renderTargets[i] = targets[i];
+        this->renderTargetResources[i] = getResource(targets[i]);
+        this->unbindShaderResources(this->renderTargetResources[i]);
+        this->unbindUnorderedResources(this->renderTargetResources[i]);
+    }
+    this->renderTargetCount = count;
+
+    this->depthStencilTarget = depthStencil;
+    this->depthStencilResource = getResource(depthStencil);
+    this->unbindShaderResources(this->depthStencilResource);
+
+    this->context->OMSetRenderTargets(count, targets, depthStencil);
+}
+
+void StateCache::setViewport(const D3D11_VIEWPORT &viewport)
+{
+    bool redundant = (this->viewport.TopLeftX == viewport.TopLeftX) && (this->viewport.TopLeftY == viewport.TopLeftY)
+        && (this->viewport.Width == viewport.Width) && (this->viewport.Height == viewport.Height)
+        && (this->viewport.MinDepth == viewport.MinDepth) && (this->viewport.MaxDepth == viewport.MaxDepth);
+    if (this->filter(redundant))
+        return;
+
+    this->viewport = viewport;
+    this->context->RSSetViewports(1, &viewport);
+}
+
+void StateCache::unbindResources()
+{
+    ID3D11ShaderResourceView *nullResources[MAX_SHADER_RESOURCES] = {};
+    for (int stage = 0; stage < STAGE_COUNT; stage++)
+        this->setShaderResources((Stage)stage, 0, MAX_SHADER_RESOURCES, nullResources);
+
+    ID3D11UnorderedAccessView *nullUnorderedResources[MAX_UNORDERED_RESOURCES] = {};
+    this->setUnorderedResources(MAX_UNORDERED_RESOURCES, nullUnorderedResources);
+
+    ID3D11Buffer *nullBuffer = nullptr;
+    for (int slot = 0; slot < MAX_VERTEX_BUFFERS; slot++)
+        this->setVertexBuffer(slot, nullptr, 0, 0);
+    this->setIndexBuffer(nullptr, DXGI_FORMAT_UNKNOWN);
+
+    for (int stage = 0; stage < STAGE_COUNT; stage++)
+    {
+        for (int slot = 0; slot < MAX_CONSTANT_BUFFERS; slot++)
+            this->setConstantBuffer((Stage)stage, slot, nullBuffer);
+    }
+
+    this->setRenderTargets(0, nullptr, nullptr);
+}
+
+void StateCache::reset()
+{
+    int issuedCallCount = this->issuedCallCount;
+    int filteredCallCount = this->filteredCallCount;
+
+    *this = StateCache(this->context);
+
+    this->issuedCallCount = issuedCallCount;
+    this->filteredCallCount = filteredCallCount;
+}
+
+void StateCache::reportCounters()
+{
+    GPUProfiler::getInstance()->addCounter("StateCallsIssued", this->issuedCallCount);
+    GPUProfiler::getInstance()->addCounter("StateCallsFiltered", this->filteredCallCount);
+
+    this->issuedCallCount = 0;
+    this->filteredCallCount = 0;
+}
+
+bool StateCache::isBoundAsTarget(ID3D11Resource *resource) const
+{
+    if (resource == this->depthStencilResource)
+        return true;
+
+    for (int i = 0; i < this->renderTargetCount; i++)
+    {
+        if (resource == this->renderTargetResources[i])
+            return true;
+    }
+
+    return false;
+}
+
+void StateCache::unbindShaderResources(ID3D11Resource *resource)
+{
+    if (resource == nullptr)
+        return;
+
+    for (int stage = 0; stage < STAGE_COUNT; stage++)
+    {
+        for (int slot = 0; slot < MAX_SHADER_RESOURCES; slot++)
+        {
+            if (this->shaderResourceTargets[stage][slot] != resource)
+                continue;
+
+            ID3D11ShaderResourceView *nullResource = nullptr;
+            this->shaderResources[stage][slot] = nullptr;
+            this->shaderResourceTargets[stage][slot] = nullptr;
+            bindShaderResources(this->context, (Stage)stage, slot, 1, &nullResource);
+            this->issuedCallCount++;
+        }
+    }
+}
+
+void StateCache::unbindUnorderedResources(ID3D11Resource *resource)
+{
+    if (resource == nullptr)
+        return;
+
+    for (int slot = 0; slot < MAX_UNORDERED_RESOURCES; slot++)
+    {
+        if (this->unorderedResourceTargets[slot] != resource)
+            continue;
+
+        ID3D11UnorderedAccessView *nullResource = nullptr;
+        this->unorderedResources[slot] = nullptr;
+        this->unorderedResourceTargets[slot] = nullptr;
+        this->context->CSSetUnorderedAccessViews(slot, 1, &nullResource, nullptr);
+        this->issuedCallCount++;
+    }
+}
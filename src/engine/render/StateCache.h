@@ -0,0 +1,107 @@
+#pragma once
+
+#include <d3d11_1.h>
+
+/**
+ * Shadow copy of the context state; redundant calls are filtered out, and
+ * resources are only unbound when they are about to be used for writing
+ * (an SRV becoming a render target or UAV, and the other way around).
+ */
+class StateCache
+{
+    public:
+        enum Stage
+        {
+            VERTEX_STAGE,
+            PIXEL_STAGE,
+            COMPUTE_STAGE,
+            STAGE_COUNT
+        };
+
+        StateCache(ID3D11DeviceContext *context);
+
+        ID3D11DeviceContext *getContext() const { return this->context; }
+
+        void setVertexShader(ID3D11VertexShader *shader);
+        void setPixelShader(ID3D11PixelShader *shader);
+        void setComputeShader(ID3D11ComputeShader *shader);
+
+        // a constant count of 0 binds the whole buffer, otherwise a range of it (multiples of 16 constants)
+        void setConstantBuffer(Stage stage, int slot, ID3D11Buffer *buffer, UINT firstConstant = 0, UINT constantCount = 0);
+        void setShaderResources(Stage stage, int firstSlot, int count, ID3D11ShaderResourceView *const *resources);
+        void setSamplers(Stage stage, int count, ID3D11SamplerState *const *samplers);
+        void setUnorderedResources(int count, ID3D11UnorderedAccessView *const *resources); // compute stage only
+
+        void setInputLayout(ID3D11InputLayout *inputLayout);
+        void setVertexBuffer(int slot, ID3D11Buffer *buffer, UINT stride, UINT offset);
+        void setIndexBuffer(ID3D11Buffer *buffer, DXGI_FORMAT format);
+        void setPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+
+        void setDepthStencilState(ID3D11DepthStencilState *depthStencil);
+        void setRasterizerState(ID3D11RasterizerState *rasterizer);
+        void setRenderTargets(int count, ID3D11RenderTargetView *const *targets, ID3D11DepthStencilView *depthStencil);
+        void setViewport(const D3D11_VIEWPORT &viewport);
+
+        // leaves the context without any bound resource, for code outside of the frame graph
+        void unbindResources();
+
+        // forgets the shadow state, when the context state has been cleared outside of the cache
+        // (deferred contexts start each command list from the default state)
+        void reset();
+
+        // sends the number of issued and filtered calls since the last report to the profiler
+        void reportCounters();
+
+    private:
+        bool isBoundAsTarget(ID3D11Resource *resource) const;
+        void unbindShaderResources(ID3D11Resource *resource);
+        void unbindUnorderedResources(ID3D11Resource *resource);
+
+        // keeps track of the context calls for the counters
+        bool filter(bool redundant);
+
+        ID3D11DeviceContext *context;
+        ID3D11DeviceContext1 *context1; // for constant buffer ranges
+
+        static const int MAX_CONSTANT_BUFFERS = 4;
+        static const int MAX_SHADER_RESOURCES = 32;
+        static const int MAX_SAMPLERS = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+        static const int MAX_UNORDERED_RESOURCES = 8;
+        static const int MAX_RENDER_TARGETS = D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT;
+        static const int MAX_VERTEX_BUFFERS = 2;
+
+        ID3D11VertexShader *vertexShader = nullptr;
+        ID3D11PixelShader *pixelShader = nullptr;
+        ID3D11ComputeShader *computeShader = nullptr;
+
+        ID3D11Buffer *constantBuffers[STAGE_COUNT][MAX_CONSTANT_BUFFERS] = {};
+        UINT constantBufferFirstConstants[STAGE_COUNT][MAX_CONSTANT_BUFFERS] = {};
+        UINT constantBufferConstantCounts[STAGE_COUNT][MAX_CONSTANT_BUFFERS] = {};
+
+        // resources of the bound views are kept to detect hazards
+        ID3D11ShaderResourceView *shaderResources[STAGE_COUNT][MAX_SHADER_RESOURCES] = {};
+        ID3D11Resource *shaderResourceTargets[STAGE_COUNT][MAX_SHADER_RESOURCES] = {};
+        ID3D11SamplerState *samplers[STAGE_COUNT][MAX_SAMPLERS] = {};
+        ID3D11UnorderedAccessView *unorderedResources[MAX_UNORDERED_RESOURCES] = {};
+        ID3D11Resource *unorderedResourceTargets[MAX_UNORDERED_RESOURCES] = {};
+
+        ID3D11InputLayout *inputLayout = nullptr;
+        ID3D11Buffer *vertexBuffers[MAX_VERTEX_BUFFERS] = {};
+        UINT vertexBufferStrides[MAX_VERTEX_BUFFERS] = {};
+        UINT vertexBufferOffsets[MAX_VERTEX_BUFFERS] = {};
+        ID3D11Buffer *indexBuffer = nullptr;
+        DXGI_FORMAT indexFormat = DXGI_FORMAT_UNKNOWN;
+        D3D11_PRIMITIVE_TOPOLOGY topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+
+        ID3D11DepthStencilState *depthStencil = nullptr;
+        ID3D11RasterizerState *rasterizer = nullptr;
+        ID3D11RenderTargetView *renderTargets[MAX_RENDER_TARGETS] = {};
+        ID3D11Resource *renderTargetResources[MAX_RENDER_TARGETS] = {};
+        int renderTargetCount = 0;
+        ID3D11DepthStencilView *depthStencilTarget = nullptr;
+        ID3D11Resource *depthStencilResource = nullptr;
+        D3D11_VIEWPORT viewport = {};
+
+        int issuedCallCount = 0;
+        int filteredCallCount = 0;
+};
@@ -0,0 +1,230 @@
+#include <engine/render/StateObjects.h>
+
+#include <cassert>
+#include <cstring>
+
+#include <engine/render/Device.h>
+
+StateObjects::Entry StateObjects::entries[StateObjects::MAX_OBJECTS] = {};
+std::unordered_multimap<uint64_t, StateObjects::Id> StateObjects::lookup;
+std::vector<StateObjects::Id> StateObjects::freeIds;
+int StateObjects::nextId = 1;
+int StateObjects::objectCount = 0;
+std::mutex StateObjects::mutex;
+
+// FNV-1a
+static uint64_t hashKey(const std::vector<unsigned char> &key)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char byte : key)
+        hash = (hash ^ byte) * 0x100000001b3ull;
+
+    return hash;
+}
+
+static void appendKey(std::vector<unsigned char> &key, const void *data, size_t size)
+{
+    key.insert(key.end(), (const unsigned char *)data, (const unsigned char *)data + size);
+}
+
+StateObjects::Id StateObjects::createSampler(const D3D11_SAMPLER_DESC &desc)
+{
+    std::vector<unsigned char> key(1, KIND_SAMPLER);
+    appendKey(key, &desc, sizeof(desc));
+    uint64_t hash = hashKey(key);
+
+    std::lock_guard<std::mutex> lock(StateObjects::mutex);
+    Id id = StateObjects::find(hash, key);
+    if (id != 0)
+        return id;
+
+    ID3D11SamplerState *sampler = nullptr;
+    HRESULT res = Device::device->CreateSamplerState(&desc, &sampler);
+    CHECK_HRESULT(res);
+
+    return StateObjects::add(hash, key, sampler);
+}
+
+StateObjects::Id StateObjects::createDepthStencil(const D3D11_DEPTH_STENCIL_DESC &desc)
+{
+    // copied field by field, so that padding is always zero
+    D3D11_DEPTH_STENCIL_DESC normalized;
+    memset(&normalized, 0, sizeof(normalized));
+    normalized.DepthEnable = desc.DepthEnable;
+    normalized.DepthWriteMask = desc.DepthWriteMask;
+    normalized.DepthFunc = desc.DepthFunc;
+    normalized.StencilEnable = desc.StencilEnable;
+    normalized.StencilReadMask = desc.StencilReadMask;
+    normalized.StencilWriteMask = desc.StencilWriteMask;
+    normalized.FrontFace = desc.FrontFace;
+    normalized.BackFace = desc.BackFace;
+
+    std::vector<unsigned char> key(1, KIND_DEPTH_STENCIL);
+    appendKey(key, &normalized, sizeof(normalized));
+    uint64_t hash = hashKey(key);
+
+    std::lock_guard<std::mutex> lock(StateObjects::mutex);
+    Id id = StateObjects::find(hash, key);
+    if (id != 0)
+        return id;
+
+    ID3D11DepthStencilState *depthStencil = nullptr;
+    HRESULT res = Device::device->CreateDepthStencilState(&desc, &depthStencil);
+    CHECK_HRESULT(res);
+
+    return StateObjects::add(hash, key, depthStencil);
+}
+
+StateObjects::Id StateObjects::createRasterizer(const D3D11_RASTERIZER_DESC &desc)
+{
+    std::vector<unsigned char> key(1, KIND_RASTERIZER);
+    appendKey(key, &desc, sizeof(desc));
+    uint64_t hash = hashKey(key);
+
+    std::lock_guard<std::mutex> lock(StateObjects::mutex);
+    Id id = StateObjects::find(hash, key);
+    if (id != 0)
+        return id;
+
+    ID3D11RasterizerState *rasterizer = nullptr;
+    HRESULT res = Device::device->CreateRasterizerState(&desc, &rasterizer);
+    CHECK_HRESULT(res);
+
+    return StateObjects::add(hash, key, rasterizer);
+}
+
+StateObjects::Id StateObjects::createBlend(const D3D11_BLEND_DESC &desc)
+{
+    D3D11_BLEND_DESC normalized;
+    memset(&normalized, 0, sizeof(normalized));
+    normalized.AlphaToCoverageEnable = desc.AlphaToCoverageEnable;
+    normalized.IndependentBlendEnable = desc.IndependentBlendEnable;
+    for (int i = 0; i < 8; i++)
+    {
+        D3D11_RENDER_TARGET_BLEND_DESC &target = normalized.RenderTarget[i];
+        target.BlendEnable = desc.RenderTarget[i].BlendEnable;
+        target.SrcBlend = desc.RenderTarget[i].SrcBlend;
+        target.DestBlend = desc.RenderTarget[i].DestBlend;
+        target.BlendOp = desc.RenderTarget[i].BlendOp;
+        target.SrcBlendAlpha = desc.RenderTarget[i].SrcBlendAlpha;
+        target.DestBlendAlpha = desc.RenderTarget[i].DestBlendAlpha;
+        target.BlendOpAlpha = desc.RenderTarget[i].BlendOpAlpha;
+        target.RenderTargetWriteMask = desc.RenderTarget[i].RenderTargetWriteMask;
+    }
+
+    std::vector<unsigned char> key(1, KIND_BLEND);
+    appendKey(key, &normalized, sizeof(normalized));
+    uint64_t hash = hashKey(key);
+
+    std::lock_guard<std::mutex> lock(StateObjects::mutex);
+    Id id = StateObjects::find(hash, key);
+    if (id != 0)
+        return id;
+
+    ID3D11BlendState *blend = nullptr;
+    HRESULT res = Device::device->CreateBlendState(&desc, &blend);
+    CHECK_HRESULT(res);
+
+    return StateObjects::add(hash, key, blend);
+}
+
+StateObjects::Id StateObjects::createInputLayout(const D3D11_INPUT_ELEMENT_DESC *elements, int elementCount, const void *shaderBytecode, size_t bytecodeLength)
+{
+    // semantic names by content, the pointers differ between callers
+    std::vector<unsigned char> key(1, KIND_INPUT_LAYOUT);
+    for (int i = 0; i < elementCount; i++)
+    {
+        const D3D11_INPUT_ELEMENT_DESC &element = elements[i];
+        appendKey(key, element.SemanticName, strlen(element.SemanticName) + 1);
+
+        UINT fields[] = { element.SemanticIndex, (UINT)element.Format, element.InputSlot, element.AlignedByteOffset, (UINT)element.InputSlotClass, element.InstanceDataStepRate };
+        appendKey(key, fields, sizeof(fields));
+    }
+    uint64_t hash = hashKey(key);
+
+    std::lock_guard<std::mutex> lock(StateObjects::mutex);
+    Id id = StateObjects::find(hash, key);
+    if (id != 0)
+        return id;
+
+    ID3D11InputLayout *inputLayout = nullptr;
+    HRESULT res = Device::device->CreateInputLayout(elements, elementCount, shaderBytecode, bytecodeLength, &inputLayout);
+    CHECK_HRESULT(res);
+
+    return StateObjects::add(hash, key, inputLayout);
+}
+
+void StateObjects::release(Id id)
+{
+    if (id == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(StateObjects::mutex);
+
+    Entry &entry = StateObjects::entries[id];
+    assert(entry.references > 0);
+    if (--entry.references > 0)
+        return;
+
+    auto range = StateObjects::lookup.equal_range(entry.hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == id)
+        {
+            StateObjects::lookup.erase(it);
+            break;
+        }
+    }
+
+    if (entry.object != nullptr)
+        entry.object->Release();
+
+    entry.object = nullptr;
+    entry.key.clear();
+
+    StateObjects::freeIds.push_back(id);
+    StateObjects::objectCount--;
+}
+
+StateObjects::Id StateObjects::find(uint64_t hash, const std::vector<unsigned char> &key)
+{
+    auto range = StateObjects::lookup.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        Entry &entry = StateObjects::entries[it->second];
+        if (entry.key == key)
+        {
+            entry.references++;
+            return it->second;
+        }
+    }
+
+    return 0;
+}
+
+StateObjects::Id StateObjects::add(uint64_t hash, std::vector<unsigned char> &key, ID3D11DeviceChild *object)
+{
+    Id id;
+    if (!StateObjects::freeIds.empty())
+    {
+        id = StateObjects::freeIds.back();
+        StateObjects::freeIds.pop_back();
+    }
+    else
+    {
+        assert(StateObjects::nextId < MAX_OBJECTS);
+        id = (Id)StateObjects::nextId++;
+    }
+
+    // failed creations keep an entry too, resolved to the default state
+    Entry &entry = StateObjects::entries[id];
+    entry.object = object;
+    entry.references = 1;
+    entry.hash = hash;
+    entry.key.swap(key);
+
+    StateObjects::lookup.insert(std::make_pair(hash, id));
+    StateObjects::objectCount++;
+
+    return id;
+}
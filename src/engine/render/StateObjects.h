@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <d3d11.h>
+
+/**
+ * Device state objects shared by content: samplers, depth-stencil,
+ * rasterizer and blend states, input layouts. Objects are hashed by their
+ * descriptor and reference counted, so that identical descriptors give the
+ * same object, under a small integer id.
+ *
+ * Batches keep ids instead of pointers; comparing their states is an
+ * integer compare. Ids are only resolved when the batch is executed.
+ */
+class StateObjects
+{
+    public:
+        // 0 is no object, the default state of the context
+        typedef uint16_t Id;
+
+        // each call takes a reference, to give back with release()
+        static Id createSampler(const D3D11_SAMPLER_DESC &desc);
+        static Id createDepthStencil(const D3D11_DEPTH_STENCIL_DESC &desc);
+        static Id createRasterizer(const D3D11_RASTERIZER_DESC &desc);
+        static Id createBlend(const D3D11_BLEND_DESC &desc);
+
+        // keyed by the elements only; the layout is validated against the first shader it is created with
+        static Id createInputLayout(const D3D11_INPUT_ELEMENT_DESC *elements, int elementCount, const void *shaderBytecode, size_t bytecodeLength);
+
+        static void release(Id id);
+
+        // safe while other threads create objects, entries never move
+        static ID3D11SamplerState *getSampler(Id id) { return (ID3D11SamplerState *)StateObjects::entries[id].object; }
+        static ID3D11DepthStencilState *getDepthStencil(Id id) { return (ID3D11DepthStencilState *)StateObjects::entries[id].object; }
+        static ID3D11RasterizerState *getRasterizer(Id id) { return (ID3D11RasterizerState *)StateObjects::entries[id].object; }
+        static ID3D11BlendState *getBlend(Id id) { return (ID3D11BlendState *)StateObjects::entries[id].object; }
+        static ID3D11InputLayout *getInputLayout(Id id) { return (ID3D11InputLayout *)StateObjects::entries[id].object; }
+
+        // number of live objects, for profiling
+        static int getObjectCount() { return StateObjects::objectCount; }
+
+    private:
+        enum Kind
+        {
+            KIND_SAMPLER,
+            KIND_DEPTH_STENCIL,
+            KIND_RASTERIZER,
+            KIND_BLEND,
+            KIND_INPUT_LAYOUT
+        };
+
+        struct Entry
+        {
+            ID3D11DeviceChild *object;
+            int references;
+            uint64_t hash;
+            std::vector<unsigned char> key; // kind, then the descriptor content
+        };
+
+        static const int MAX_OBJECTS = 4096;
+
+        // returns the id of an existing object with a reference added, 0 if there is none
+        static Id find(uint64_t hash, const std::vector<unsigned char> &key);
+        static Id add(uint64_t hash, std::vector<unsigned char> &key, ID3D11DeviceChild *object);
+
+        static Entry entries[MAX_OBJECTS];
+        static std::unordered_multimap<uint64_t, Id> lookup;
+        static std::vector<Id> freeIds;
+        static int nextId;
+        static int objectCount;
+        static std::mutex mutex;
+};
@@ -34,7 +34,7 @@ void Texture::load(const unsigned char *buffer, size_t size)
     samplerDesc.MinLOD = 0;
     samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
 
-    Device::device->CreateSamplerState(&samplerDesc, &this->samplerState);
+    this->samplerState = StateObjects::createSampler(samplerDesc);
 
     switch (this->type)
     {
@@ -42,6 +42,7 @@ void Texture::load(const unsigned char *buffer, size_t size)
         {
             std::string imageName = cJSON_GetObjectItem(json, "image")->valuestring;
             this->image = ResourceManager::getInstance()->requestResource<Image>(imageName);
+            TextureArrays::addImage(this->image);
             break;
         }
 
@@ -49,6 +50,7 @@ void Texture::load(const unsigned char *buffer, size_t size)
         {
             std::string imageName = cJSON_GetObjectItem(json, "image")->valuestring;
             this->environmentMap = ResourceManager::getInstance()->requestResource<Image>(imageName, this);
+            this->environmentMap->pin();
 
             this->environmentMapDirty = true;
 
@@ -61,13 +63,14 @@ void Texture::load(const unsigned char *buffer, size_t size)
 
 void Texture::unload()
 {
-    this->samplerState->Release();
-    this->samplerState = nullptr;
+    StateObjects::release(this->samplerState);
+    this->samplerState = 0;
 
     switch (this->type)
     {
         case TextureType_Image:
         {
+            TextureArrays::removeImage(this->image);
             ResourceManager::getInstance()->releaseResource(this->image);
             this->image = nullptr;
             break;
@@ -75,6 +78,7 @@ void Texture::unload()
 
         case TextureType_EnvironmentMap:
         {
+            this->environmentMap->unpin();
             ResourceManager::getInstance()->releaseResource(this->environmentMap, this);
             this->environmentMap = nullptr;
 
@@ -103,9 +107,14 @@ void Texture::onResourceUpdated(Resource *resource)
 
 void Texture::update(FrameGraph *frameGraph)
 {
+    // streamed images become fully resident after pinning
+    if ((this->type == TextureType_EnvironmentMap) && (this->environmentMap->getMipLevels() != this->environmentMapMipLevels))
+        this->environmentMapDirty = true;
+
     if (this->environmentMapDirty)
     {
         this->environmentMapDirty = false;
+        this->environmentMapMipLevels = this->environmentMap->getMipLevels();
 
         if (this->environmentTexture != nullptr)
         {
@@ -210,3 +219,14 @@ int Texture::getMipLevels() const
     assert(0);
     return 0;
 }
+
+const TextureArrays::Slot &Texture::getSlot() const
+{
+    return TextureArrays::getSlot((this->type == TextureType_Image) ? this->image : nullptr);
+}
+
+void Texture::requestScreenSize(float screenSize) const
+{
+    if (this->type == TextureType_Image)
+        this->image->requestScreenSize(screenSize);
+}
@@ -4,6 +4,8 @@
 #include <vector>
 
 #include <engine/render/Device.h>
+#include <engine/render/StateObjects.h>
+#include <engine/render/TextureArrays.h>
 #include <engine/resource/Resource.h>
 #include <engine/resource/ResourceWatcher.h>
 
@@ -28,10 +30,17 @@ class Texture: public Resource, public ResourceWatcher
         // frame update for dynamic textures
         void update(FrameGraph *frameGraph);
 
-        ID3D11SamplerState *getSamplerState() const { return this->samplerState; }
+        StateObjects::Id getSamplerState() const { return this->samplerState; }
+        // null for images copied to texture arrays, their slot is sampled instead
         ID3D11ShaderResourceView *getSRV() const;
         int getMipLevels() const;
 
+        // placement in the texture arrays of the materials, empty for environment maps
+        const TextureArrays::Slot &getSlot() const;
+
+        // projected size of the texture in NDC units, for mip streaming (see TextureStreamer)
+        void requestScreenSize(float screenSize) const;
+
     private:
         enum TextureType
         {
@@ -40,7 +49,7 @@ class Texture: public Resource, public ResourceWatcher
         };
         TextureType type;
 
-        ID3D11SamplerState *samplerState;
+        StateObjects::Id samplerState = 0;
 
         // type-specific data
 
@@ -55,4 +64,7 @@ class Texture: public Resource, public ResourceWatcher
 
         // flag if the envmap prefiltering needs to be rebaked
         bool environmentMapDirty = false;
+
+        // resident levels of the image at the last bake
+        int environmentMapMipLevels = 0;
 };
@@ -0,0 +1,312 @@
+#include <engine/render/TextureArrays.h>
+
+#include <algorithm>
+#include <cstdio>
+
+#include <engine/render/Device.h>
+#include <engine/render/Image.h>
+#include <engine/render/TexturePacker.h>
+
+std::map<Image *, int> TextureArrays::images;
+std::unordered_map<const Image *, TextureArrays::Slot> TextureArrays::slots;
+std::unordered_map<const Image *, TextureArrays::Copy> TextureArrays::copies;
+std::unordered_map<const Image *, ID3D11ShaderResourceView *> TextureArrays::inPlaceSRVs;
+std::vector<ID3D11Texture2D *> TextureArrays::textures;
+std::vector<ID3D11ShaderResourceView *> TextureArrays::srvs;
+bool TextureArrays::dirty = false;
+
+static const TextureArrays::Slot emptySlot = { nullptr, 0.0f, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), 0.0f };
+
+// single slice array view of the texture of an image
+static ID3D11ShaderResourceView *createInPlaceView(ID3D11Texture2D *texture)
+{
+    D3D11_TEXTURE2D_DESC desc;
+    texture->GetDesc(&desc);
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+    ZeroMemory(&srvDesc, sizeof(srvDesc));
+    srvDesc.Format = desc.Format;
+    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+    srvDesc.Texture2DArray.MostDetailedMip = 0;
+    srvDesc.Texture2DArray.MipLevels = desc.MipLevels;
+    srvDesc.Texture2DArray.FirstArraySlice = 0;
+    srvDesc.Texture2DArray.ArraySize = 1;
+
+    ID3D11ShaderResourceView *srv = nullptr;
+    HRESULT res = Device::device->CreateShaderResourceView(texture, &srvDesc, &srv);
+    CHECK_HRESULT(res);
+
+    return srv;
+}
+
+void TextureArrays::addImage(Image *image)
+{
+    if (TextureArrays::images[image]++ == 0)
+        TextureArrays::dirty = true;
+}
+
+void TextureArrays::removeImage(Image *image)
+{
+    auto it = TextureArrays::images.find(image);
+    if ((it != TextureArrays::images.end()) && (--it->second == 0))
+    {
+        TextureArrays::images.erase(it);
+        TextureArrays::dirty = true;
+    }
+}
+
+void TextureArrays::invalidate(const Image *image)
+{
+    // the image is copied again from its new texture, if any
+    TextureArrays::copies.erase(image);
+    TextureArrays::dirty = true;
+}
+
+void TextureArrays::updateStreamedImage(const Image *image)
+{
+    auto it = TextureArrays::inPlaceSRVs.find(image);
+    if ((it == TextureArrays::inPlaceSRVs.end()) || (image->getTexture() == nullptr))
+        return;
+
+    ID3D11Texture2D *texture = nullptr;
+    if (FAILED(image->getTexture()->QueryInterface(__uuidof(ID3D11Texture2D), (void **)&texture)))
+        return;
+
+    it->second->Release();
+    it->second = createInPlaceView(texture);
+    TextureArrays::slots[image].srv = it->second;
+
+    texture->Release();
+}
+
+void TextureArrays::copyCell(const Copy &source, const Copy &destination)
+{
+    // cells of atlas pages are squares of the largest side, aligned on their size and at least a compression block
+    // wide at their last mip; slices of plain arrays are copied whole
+    int cellSize = std::max(std::max(source.desc.width, source.desc.height), 4);
+    for (int mip = 0; mip < std::min(source.mipLevels, destination.mipLevels); mip++)
+    {
+        D3D11_BOX box;
+        box.left = source.x >> mip;
+        box.top = source.y >> mip;
+        box.front = 0;
+        box.right = box.left + std::max(cellSize >> mip, 1);
+        box.bottom = box.top + std::max(cellSize >> mip, 1);
+        box.back = 1;
+
+        UINT sourceSubresource = D3D11CalcSubresource(mip, source.slice, source.mipLevels);
+        UINT destinationSubresource = D3D11CalcSubresource(mip, destination.slice, destination.mipLevels);
+        Device::context->CopySubresourceRegion(destination.array, destinationSubresource, destination.x >> mip, destination.y >> mip, 0, source.array, sourceSubresource, source.atlas ? &box : nullptr);
+    }
+}
+
+const TextureArrays::Slot &TextureArrays::getSlot(const Image *image)
+{
+    auto it = TextureArrays::slots.find(image);
+    return (it != TextureArrays::slots.end()) ? it->second : emptySlot;
+}
+
+void TextureArrays::update()
+{
+    if (!TextureArrays::dirty)
+        return;
+
+    // copied images don't have their own texture anymore, the previous arrays are the sources of their new copies
+    std::vector<ID3D11Texture2D *> previousTextures;
+    std::vector<ID3D11ShaderResourceView *> previousSRVs;
+    std::unordered_map<const Image *, Copy> previousCopies;
+    previousTextures.swap(TextureArrays::textures);
+    previousSRVs.swap(TextureArrays::srvs);
+    previousCopies.swap(TextureArrays::copies);
+
+    TextureArrays::release();
+    TextureArrays::dirty = false;
+
+    // single 2D textures only; others keep an empty slot
+    std::vector<Image *> packedImages;
+    std::vector<ID3D11Texture2D *> sources; // null for images copied from the previous arrays
+    std::vector<TexturePacker::Texture> descs;
+
+    for (const auto &it : TextureArrays::images)
+    {
+        if (it.first->getTexture() == nullptr)
+        {
+            auto previousCopy = previousCopies.find(it.first);
+            if (previousCopy != previousCopies.end())
+            {
+                packedImages.push_back(it.first);
+                sources.push_back(nullptr);
+                descs.push_back(previousCopy->second.desc);
+            }
+            continue;
+        }
+
+        ID3D11Texture2D *source = nullptr;
+        if (FAILED(it.first->getTexture()->QueryInterface(__uuidof(ID3D11Texture2D), (void **)&source)))
+            continue;
+
+        D3D11_TEXTURE2D_DESC desc;
+        source->GetDesc(&desc);
+
+        if ((desc.ArraySize != 1) || (desc.SampleDesc.Count != 1) || (desc.MiscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE))
+        {
+            source->Release();
+            continue;
+        }
+
+        // streamed images are viewed in place, their texture is recreated when their resident levels change; so
+        // are the images pinned by environment maps, which sample their own texture
+        if (it.first->isStreamed() || it.first->isPinned())
+        {
+            ID3D11ShaderResourceView *srv = createInPlaceView(source);
+            TextureArrays::inPlaceSRVs[it.first] = srv;
+            TextureArrays::slots[it.first] = { srv, 0.0f, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), 0.0f };
+
+            source->Release();
+            continue;
+        }
+
+        packedImages.push_back(it.first);
+        sources.push_back(source);
+        descs.push_back({ desc.Format, (int)desc.Width, (int)desc.Height, (int)desc.MipLevels });
+    }
+
+    std::vector<TexturePacker::Array> arrays;
+    std::vector<TexturePacker::Placement> placements;
+    TexturePacker::pack(descs, arrays, placements);
+
+    // textures alone in a plain array are used in place, if they still have their own
+    std::vector<int> singleMembers(arrays.size(), -1);
+    for (int i = 0; i < (int)placements.size(); i++)
+    {
+        int arrayIndex = placements[i].arrayIndex;
+        if ((arrayIndex >= 0) && !arrays[arrayIndex].atlas && (arrays[arrayIndex].sliceCount == 1) && (sources[i] != nullptr))
+            singleMembers[arrayIndex] = i;
+    }
+
+    std::vector<ID3D11Texture2D *> arrayTextures(arrays.size(), nullptr);
+    std::vector<ID3D11ShaderResourceView *> arraySRVs(arrays.size(), nullptr);
+    int copiedCount = 0;
+    int atlasCount = 0;
+
+    for (int i = 0; i < (int)arrays.size(); i++)
+    {
+        const TexturePacker::Array &array = arrays[i];
+        ID3D11Texture2D *texture = (singleMembers[i] >= 0) ? sources[singleMembers[i]] : nullptr;
+
+        if (texture == nullptr)
+        {
+            D3D11_TEXTURE2D_DESC desc;
+            ZeroMemory(&desc, sizeof(desc));
+            desc.Width = array.width;
+            desc.Height = array.height;
+            desc.MipLevels = array.mipLevels;
+            desc.ArraySize = array.sliceCount;
+            desc.Format = array.format;
+            desc.SampleDesc.Count = 1;
+            desc.Usage = D3D11_USAGE_DEFAULT;
+            desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+            HRESULT res = Device::device->CreateTexture2D(&desc, nullptr, &arrayTextures[i]);
+            CHECK_HRESULT(res);
+
+            texture = arrayTextures[i];
+            TextureArrays::textures.push_back(texture);
+        }
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+        ZeroMemory(&srvDesc, sizeof(srvDesc));
+        srvDesc.Format = array.format;
+        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+        srvDesc.Texture2DArray.MostDetailedMip = 0;
+        srvDesc.Texture2DArray.MipLevels = array.mipLevels;
+        srvDesc.Texture2DArray.FirstArraySlice = 0;
+        srvDesc.Texture2DArray.ArraySize = array.sliceCount;
+
+        HRESULT res = Device::device->CreateShaderResourceView(texture, &srvDesc, &arraySRVs[i]);
+        CHECK_HRESULT(res);
+
+        TextureArrays::srvs.push_back(arraySRVs[i]);
+        atlasCount += array.atlas ? array.sliceCount : 0;
+    }
+
+    for (int i = 0; i < (int)placements.size(); i++)
+    {
+        const TexturePacker::Placement &placement = placements[i];
+        if (placement.arrayIndex < 0)
+            continue;
+
+        const TexturePacker::Array &array = arrays[placement.arrayIndex];
+        const TexturePacker::Texture &desc = descs[i];
+
+        if (arrayTextures[placement.arrayIndex] != nullptr)
+        {
+            Copy copy = { desc, arrayTextures[placement.arrayIndex], array.mipLevels, placement.slice, placement.x, placement.y, array.atlas };
+
+            if (sources[i] != nullptr)
+            {
+                // atlas cells are aligned on their size, so mips of compressed textures stay on block boundaries
+                for (int mip = 0; mip < array.mipLevels; mip++)
+                {
+                    UINT destination = D3D11CalcSubresource(mip, placement.slice, array.mipLevels);
+                    UINT source = D3D11CalcSubresource(mip, 0, desc.mipLevels);
+                    Device::context->CopySubresourceRegion(copy.array, destination, placement.x >> mip, placement.y >> mip, 0, sources[i], source, nullptr);
+                }
+
+                // the array is the only storage of the image from now on
+                sources[i]->Release();
+                sources[i] = nullptr;
+                packedImages[i]->releaseTexture();
+            }
+            else
+            {
+                TextureArrays::copyCell(previousCopies[packedImages[i]], copy);
+            }
+
+            TextureArrays::copies[packedImages[i]] = copy;
+            copiedCount++;
+        }
+
+        Slot slot;
+        slot.srv = arraySRVs[placement.arrayIndex];
+        slot.slice = (float)placement.slice;
+        slot.rect = glm::vec4((float)placement.x / array.width, (float)placement.y / array.height, (float)desc.width / array.width, (float)desc.height / array.height);
+        slot.inset = array.atlas ? 0.5f / array.width : 0.0f;
+        TextureArrays::slots[packedImages[i]] = slot;
+    }
+
+    for (ID3D11Texture2D *source : sources)
+    {
+        if (source != nullptr)
+            source->Release();
+    }
+
+    for (ID3D11ShaderResourceView *srv : previousSRVs)
+        srv->Release();
+
+    for (ID3D11Texture2D *texture : previousTextures)
+        texture->Release();
+
+    printf("Packed %d textures in %d texture arrays, %d copied, %d atlas pages, %d viewed in place\n", (int)packedImages.size(), (int)arrays.size(), copiedCount, atlasCount, (int)TextureArrays::inPlaceSRVs.size());
+}
+
+void TextureArrays::release()
+{
+    for (ID3D11ShaderResourceView *srv : TextureArrays::srvs)
+        srv->Release();
+
+    for (ID3D11Texture2D *texture : TextureArrays::textures)
+        texture->Release();
+
+    for (const auto &it : TextureArrays::inPlaceSRVs)
+        it.second->Release();
+
+    TextureArrays::srvs.clear();
+    TextureArrays::textures.clear();
+    TextureArrays::slots.clear();
+    TextureArrays::copies.clear();
+    TextureArrays::inPlaceSRVs.clear();
+
+    // registered images are packed again by the next update
+    TextureArrays::dirty = true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <d3d11.h>
+
+#include <glm/glm.hpp>
+
+#include <engine/render/TexturePacker.h>
+
+class Image;
+
+/**
+ * Texture arrays sampled by the standard materials, built from the images of
+ * their textures (see TexturePacker); materials whose maps share arrays share
+ * batches, their slices and atlas cells are given by the shader constants.
+ *
+ * Images alone in their array are viewed in place. The others are copied,
+ * and their own texture is released: unlit materials sample the arrays too,
+ * and the arrays are packed again from the previous ones. Streamed images
+ * are never copied, as their resident levels change, nor the images pinned
+ * by environment maps: each one is viewed in place as a single slice array.
+ */
+class TextureArrays
+{
+    public:
+        struct Slot
+        {
+            ID3D11ShaderResourceView *srv; // Texture2DArray
+            float slice;
+            glm::vec4 rect; // xy: offset, zw: scale, in uv units of the slice
+            float inset; // half a texel of the top mip of atlas pages, scaled to the sampled mip by the shader to keep taps inside the cells
+        };
+
+        // reference counted, as textures can share images
+        static void addImage(Image *image);
+        static void removeImage(Image *image);
+
+        // to call when the texture of an image changes
+        static void invalidate(const Image *image);
+
+        // to call when the texture of a streamed image is recreated, instead of invalidate(); only its view changes
+        static void updateStreamedImage(const Image *image);
+
+        // packs the registered images again after changes; uses the immediate context
+        static void update();
+
+        // releases the arrays, and with them the only storage of copied images
+        static void release();
+
+        // slot with a null view for images packed after the last update()
+        static const Slot &getSlot(const Image *image);
+
+    private:
+        // placement of a copied image, the source of its next copy
+        struct Copy
+        {
+            TexturePacker::Texture desc;
+            ID3D11Texture2D *array;
+            int mipLevels; // of the array
+            int slice;
+            int x; // texels of the top mip
+            int y;
+            bool atlas;
+        };
+
+        static void copyCell(const Copy &source, const Copy &destination);
+
+        static std::map<Image *, int> images;
+        static std::unordered_map<const Image *, Slot> slots;
+        static std::unordered_map<const Image *, Copy> copies;
+        static std::unordered_map<const Image *, ID3D11ShaderResourceView *> inPlaceSRVs;
+        static std::vector<ID3D11Texture2D *> textures;
+        static std::vector<ID3D11ShaderResourceView *> srvs;
+        static bool dirty;
+};
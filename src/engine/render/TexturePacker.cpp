@@ -0,0 +1,134 @@
+#include <engine/render/TexturePacker.h>
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+// textures up to this size go to atlas pages
+static const int ATLAS_MAX_TEXTURE_SIZE = 64;
+static const int ATLAS_PAGE_SIZE = 1024;
+
+// cells keep this many texels at their last mip, the size of compression blocks
+static const int ATLAS_MIN_MIP_SIZE = 4;
+
+// D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION
+static const int MAX_SLICE_COUNT = 2048;
+
+static bool isPowerOfTwo(int value)
+{
+    return (value > 0) && ((value & (value - 1)) == 0);
+}
+
+// mip levels kept in an atlas: down to ATLAS_MIN_MIP_SIZE texels, the cells of smaller textures are padded
+static int computeAtlasMipLevels(const TexturePacker::Texture &texture)
+{
+    int mipLevels = 1;
+    for (int size = std::max(texture.width, texture.height); (size > ATLAS_MIN_MIP_SIZE) && (mipLevels < texture.mipLevels); size /= 2)
+        mipLevels++;
+
+    return mipLevels;
+}
+
+void TexturePacker::pack(const std::vector<Texture> &textures, std::vector<Array> &arrays, std::vector<Placement> &placements)
+{
+    arrays.clear();
+    placements.assign(textures.size(), { -1, 0, 0, 0 });
+
+    // format, width, height, mip levels of the arrays; format and mip levels of the atlases
+    std::map<std::tuple<int, int, int, int>, std::vector<int>> arrayGroups;
+    std::map<std::tuple<int, int>, std::vector<int>> atlasGroups;
+
+    for (int i = 0; i < (int)textures.size(); i++)
+    {
+        const Texture &texture = textures[i];
+        if ((texture.width <= 0) || (texture.height <= 0) || (texture.mipLevels <= 0))
+            continue;
+
+        bool small = (texture.width <= ATLAS_MAX_TEXTURE_SIZE) && (texture.height <= ATLAS_MAX_TEXTURE_SIZE);
+        if (small && isPowerOfTwo(texture.width) && isPowerOfTwo(texture.height))
+            atlasGroups[std::make_tuple((int)texture.format, computeAtlasMipLevels(texture))].push_back(i);
+        else
+            arrayGroups[std::make_tuple((int)texture.format, texture.width, texture.height, texture.mipLevels)].push_back(i);
+    }
+
+    for (const auto &group : arrayGroups)
+    {
+        const std::vector<int> &members = group.second;
+        for (int i = 0; i < (int)members.size(); i++)
+        {
+            const Texture &texture = textures[members[i]];
+            if (i % MAX_SLICE_COUNT == 0)
+                arrays.push_back({ texture.format, texture.width, texture.height, texture.mipLevels, 0, false });
+
+            placements[members[i]] = { (int)arrays.size() - 1, arrays.back().sliceCount++, 0, 0 };
+        }
+    }
+
+    struct Cell
+    {
+        int slice;
+        int x;
+        int y;
+        int size;
+    };
+
+    for (const auto &group : atlasGroups)
+    {
+        // largest first, so that splitting cells never leaves holes that larger textures would need
+        std::vector<int> members = group.second;
+        auto cellSize = [&](int index) { return std::max(std::max(textures[index].width, textures[index].height), ATLAS_MIN_MIP_SIZE); };
+        std::stable_sort(members.begin(), members.end(), [&](int a, int b) { return cellSize(a) > cellSize(b); });
+
+        // pages shrink to the area of small groups; squares of decreasing powers of two fill them without gaps
+        size_t area = 0;
+        for (int member : members)
+            area += (size_t)cellSize(member) * cellSize(member);
+
+        int pageSize = cellSize(members[0]);
+        while ((pageSize < ATLAS_PAGE_SIZE) && ((size_t)pageSize * pageSize < area))
+            pageSize *= 2;
+
+        int arrayIndex = -1;
+        std::vector<Cell> freeCells;
+
+        for (int member : members)
+        {
+            int size = cellSize(member);
+
+            // smallest free cell that fits, split down to the texture size
+            int best = -1;
+            for (int i = 0; i < (int)freeCells.size(); i++)
+            {
+                if ((freeCells[i].size >= size) && ((best < 0) || (freeCells[i].size < freeCells[best].size)))
+                    best = i;
+            }
+
+            if ((best < 0) && ((arrayIndex < 0) || (arrays[arrayIndex].sliceCount == MAX_SLICE_COUNT)))
+            {
+                const Texture &texture = textures[member];
+                arrays.push_back({ texture.format, pageSize, pageSize, std::get<1>(group.first), 0, true });
+                arrayIndex = (int)arrays.size() - 1;
+                freeCells.clear();
+            }
+
+            if (best < 0)
+            {
+                freeCells.push_back({ arrays[arrayIndex].sliceCount++, 0, 0, pageSize });
+                best = (int)freeCells.size() - 1;
+            }
+
+            Cell cell = freeCells[best];
+            freeCells.erase(freeCells.begin() + best);
+
+            while (cell.size > size)
+            {
+                cell.size /= 2;
+                freeCells.push_back({ cell.slice, cell.x + cell.size, cell.y, cell.size });
+                freeCells.push_back({ cell.slice, cell.x, cell.y + cell.size, cell.size });
+                freeCells.push_back({ cell.slice, cell.x + cell.size, cell.y + cell.size, cell.size });
+            }
+
+            placements[member] = { arrayIndex, cell.slice, cell.x, cell.y };
+        }
+    }
+}
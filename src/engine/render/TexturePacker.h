@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include <d3d11.h>
+
+/**
+ * Groups material textures in texture arrays, so that materials using
+ * different textures can be drawn in one batch (see TextureArrays).
+ *
+ * Textures of the same format, size and mip count become slices of one
+ * array. Small power of two textures are packed in atlas pages instead,
+ * each in a square cell of a quadtree; the mip count of a page is limited
+ * so that its smallest cell keeps whole compression blocks.
+ */
+class TexturePacker
+{
+    public:
+        struct Texture
+        {
+            DXGI_FORMAT format;
+            int width;
+            int height;
+            int mipLevels;
+        };
+
+        struct Array
+        {
+            DXGI_FORMAT format;
+            int width;
+            int height;
+            int mipLevels;
+            int sliceCount;
+            bool atlas;
+        };
+
+        // texels of the top mip in the array slice, the first mipLevels levels of the array are copied
+        struct Placement
+        {
+            int arrayIndex; // -1 if the texture can't be packed
+            int slice;
+            int x;
+            int y;
+        };
+
+        static void pack(const std::vector<Texture> &textures, std::vector<Array> &arrays, std::vector<Placement> &placements);
+};
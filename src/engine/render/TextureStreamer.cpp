@@ -0,0 +1,117 @@
+#include <engine/render/TextureStreamer.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+#include <engine/render/Image.h>
+#include <engine/render/graph/GPUProfiler.h>
+
+// streamed levels of all images, mip tails are always resident
+static const size_t TEXTURE_MEMORY_BUDGET = 512 * 1024 * 1024;
+
+// images are still updated one at a time over this
+static const size_t UPLOAD_BUDGET = 32 * 1024 * 1024;
+
+// requests are kept for this many frames, so that mips don't come and go with the view
+static const int REQUEST_FRAME_COUNT = 60;
+
+std::unordered_map<Image *, TextureStreamer::Request> TextureStreamer::images;
+
+void TextureStreamer::addImage(Image *image)
+{
+    TextureStreamer::images[image] = { 0.0f, 0 };
+}
+
+void TextureStreamer::removeImage(Image *image)
+{
+    TextureStreamer::images.erase(image);
+}
+
+void TextureStreamer::update(int viewportHeight)
+{
+    struct Level
+    {
+        Image *image;
+        int mip;
+        size_t size;
+        float priority; // requested texels over the texels of the next coarser level
+    };
+
+    std::vector<Level> levels;
+    std::unordered_map<Image *, int> targetMips;
+    size_t totalSize = 0;
+
+    for (auto &it : TextureStreamer::images)
+    {
+        Image *image = it.first;
+        Request &request = it.second;
+
+        float screenSize = image->consumeRequestedScreenSize();
+        if ((screenSize >= request.screenSize) || (++request.age > REQUEST_FRAME_COUNT))
+        {
+            request.screenSize = screenSize;
+            request.age = 0;
+        }
+
+        targetMips[image] = image->getTailMip();
+        for (int mip = image->getTailMip(); mip < image->getFullMipLevels(); mip++)
+            totalSize += image->computeMipSize(mip);
+
+        // a level is needed when the coarser one has fewer texels than requested; NDC spans 2 units
+        float texels = request.screenSize * 0.5f * (float)viewportHeight;
+        int size = std::max(image->getWidth(), image->getHeight());
+        for (int mip = image->getTailMip() - 1; mip >= 0; mip--)
+        {
+            float priority = image->isPinned() ? FLT_MAX : texels / (float)std::max(size >> (mip + 1), 1);
+            if (priority <= 1.0f)
+                break;
+
+            levels.push_back({ image, mip, image->computeMipSize(mip), priority });
+        }
+    }
+
+    // levels of an image come coarse to fine, the finer ones are needed less
+    std::stable_sort(levels.begin(), levels.end(), [](const Level &a, const Level &b) { return a.priority > b.priority; });
+
+    for (const Level &level : levels)
+    {
+        int &targetMip = targetMips[level.image];
+        if ((level.mip == targetMip - 1) && (totalSize + level.size <= TEXTURE_MEMORY_BUDGET))
+        {
+            targetMip = level.mip;
+            totalSize += level.size;
+        }
+    }
+
+    // dropping levels is done right away
+    for (auto &it : targetMips)
+    {
+        if (it.second > it.first->getResidentMip())
+            it.first->setResidentMip(it.second);
+    }
+
+    // the whole chain is uploaded again, most needed images first
+    size_t uploadedSize = 0;
+    for (const Level &level : levels)
+    {
+        Image *image = level.image;
+        int targetMip = targetMips[image];
+        if ((targetMip >= image->getResidentMip()) || (uploadedSize >= UPLOAD_BUDGET))
+            continue;
+
+        image->setResidentMip(targetMip);
+        for (int mip = targetMip; mip < image->getFullMipLevels(); mip++)
+            uploadedSize += image->computeMipSize(mip);
+    }
+
+    size_t residentSize = 0;
+    for (auto &it : TextureStreamer::images)
+    {
+        for (int mip = it.first->getResidentMip(); mip < it.first->getFullMipLevels(); mip++)
+            residentSize += it.first->computeMipSize(mip);
+    }
+
+    GPUProfiler::getInstance()->addCounter("StreamedTextureBytes", residentSize);
+    GPUProfiler::getInstance()->addCounter("TextureUploadBytes", uploadedSize);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <unordered_map>
+
+class Image;
+
+/**
+ * Chooses the resident mips of streamed images (see Image). Each frame, the
+ * scene requests the projected size of the visible materials; the levels
+ * needed for those sizes are ranked by how much they are needed, and kept
+ * within a global texture memory budget.
+ *
+ * Changed images are recreated from their DDS blob with the new levels,
+ * finer levels are uploaded within a per frame budget.
+ */
+class TextureStreamer
+{
+    public:
+        // called by streamed images
+        static void addImage(Image *image);
+        static void removeImage(Image *image);
+
+        // consumes the requests of the frame; viewportHeight converts requested sizes to texels
+        static void update(int viewportHeight);
+
+    private:
+        struct Request
+        {
+            float screenSize; // largest request of the last frames, in NDC units
+            int age; // frames since screenSize was requested
+        };
+
+        static std::unordered_map<Image *, Request> images;
+};
@@ -0,0 +1,86 @@
+#include <engine/render/TransformBuffer.h>
+
+#include <engine/render/Device.h>
+#include <engine/render/RenderList.h>
+#include <engine/render/graph/GPUProfiler.h>
+
+#include <engine/render/shaders/constants/TransformData.h>
+
+static const int MIN_TRANSFORM_CAPACITY = 1024;
+
+TransformBuffer::TransformBuffer()
+{
+    this->resize(MIN_TRANSFORM_CAPACITY);
+}
+
+TransformBuffer::~TransformBuffer()
+{
+    this->buffer->Release();
+    this->srv->Release();
+}
+
+void TransformBuffer::update(const RenderList *renderList)
+{
+    int count = renderList->getTransformCount();
+    if (count == 0)
+        return;
+
+    if (count > this->capacity)
+    {
+        int capacity = this->capacity;
+        while (capacity < count)
+            capacity *= 2;
+
+        this->resize(capacity);
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mappedResource;
+    HRESULT res = Device::context->Map(this->buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+    CHECK_HRESULT(res);
+
+    TransformData *transforms = (TransformData *)mappedResource.pData;
+    for (int i = 0; i < count; i++)
+    {
+        const RenderList::DerivedTransform &derivedTransform = renderList->getDerivedTransform(i);
+
+        transforms[i].modelMatrix = renderList->getTransform(i);
+        transforms[i].worldToPreviousFrameWorldMatrix = derivedTransform.worldToPreviousFrameWorld;
+        transforms[i].normalMatrix = derivedTransform.normalMatrix;
+    }
+
+    Device::context->Unmap(this->buffer, 0);
+
+    GPUProfiler::getInstance()->addCounter("TransformUploadBytes", count * sizeof(TransformData));
+}
+
+void TransformBuffer::resize(int capacity)
+{
+    if (this->buffer)
+    {
+        this->buffer->Release();
+        this->srv->Release();
+    }
+
+    this->capacity = capacity;
+
+    D3D11_BUFFER_DESC bufferDesc;
+    bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+    bufferDesc.ByteWidth = capacity * sizeof(TransformData);
+    bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    bufferDesc.StructureByteStride = sizeof(TransformData);
+    bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+    HRESULT res = Device::device->CreateBuffer(&bufferDesc, NULL, &this->buffer);
+    CHECK_HRESULT(res);
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+    ZeroMemory(&srvDesc, sizeof(srvDesc));
+    srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+    srvDesc.Buffer.FirstElement = 0;
+    srvDesc.Buffer.NumElements = capacity;
+
+    res = Device::device->CreateShaderResourceView(this->buffer, &srvDesc, &this->srv);
+    CHECK_HRESULT(res);
+}
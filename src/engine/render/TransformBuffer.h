@@ -0,0 +1,28 @@
+#pragma once
+
+#include <d3d11.h>
+
+class RenderList;
+
+/**
+ * Structured buffer holding the transforms of all objects for the current frame.
+ * It is uploaded once and shared by every pass, so instance streams only need
+ * to carry the index of the transform (see shaders/transforms.h).
+ */
+class TransformBuffer
+{
+    public:
+        TransformBuffer();
+        ~TransformBuffer();
+
+        void update(const RenderList *renderList);
+
+        ID3D11ShaderResourceView *getSRV() const { return this->srv; }
+
+    private:
+        void resize(int capacity);
+
+        ID3D11Buffer *buffer = nullptr;
+        ID3D11ShaderResourceView *srv = nullptr;
+        int capacity = 0;
+};
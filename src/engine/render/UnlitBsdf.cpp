@@ -1,9 +1,10 @@
 #include <engine/render/UnlitBsdf.h>
 
+#include <cstring>
+
 #include <engine/animation/AnimationData.h>
 #include <engine/animation/AnimationPlayer.h>
 #include <engine/animation/PropertyMapping.h>
-#include <engine/render/Device.h>
 #include <engine/render/RenderSettings.h>
 #include <engine/render/Shaders.h>
 #include <engine/render/Texture.h>
@@ -24,24 +25,11 @@ UnlitBsdf::UnlitBsdf(cJSON *json)
     this->constants.uvOffset = glm::vec2(cJSON_GetArrayItem(uvOffset, 0)->valuedouble, cJSON_GetArrayItem(uvOffset, 1)->valuedouble);
 
     this->emissiveMap = ResourceManager::getInstance()->requestResource<Texture>(cJSON_GetObjectItem(json, "emissiveMap")->valuestring);
-
-    D3D11_BUFFER_DESC cbDesc;
-    cbDesc.Usage = D3D11_USAGE_DYNAMIC;
-    cbDesc.ByteWidth = sizeof(UnlitConstants);
-    cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-    cbDesc.StructureByteStride = 0;
-    cbDesc.MiscFlags = 0;
-    cbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-
-    HRESULT res = Device::device->CreateBuffer(&cbDesc, nullptr, &this->constantBuffer);
-    CHECK_HRESULT(res);
 }
 
 UnlitBsdf::~UnlitBsdf()
 {
     ResourceManager::getInstance()->releaseResource(this->emissiveMap);
-
-    this->constantBuffer->Release();
 }
 
 void UnlitBsdf::registerAnimatedProperties(PropertyMapping &properties)
@@ -51,24 +39,54 @@ void UnlitBsdf::registerAnimatedProperties(PropertyMapping &properties)
     properties.add("leaf.uv_offset", (float *)&this->constants.uvOffset);
 }
 
-void UnlitBsdf::setupBatch(Batch *batch, const RenderSettings &settings, ID3D11ShaderResourceView *shadowSRV, ID3D11SamplerState *shadowSampler, ShadowConstants *shadowConstants)
+void UnlitBsdf::setupBatch(Batch *batch, const RenderSettings &settings, ID3D11ShaderResourceView *shadowSRV, StateObjects::Id shadowSampler)
 {
-    D3D11_MAPPED_SUBRESOURCE mappedResource;
-    HRESULT res = Device::context->Map(this->constantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-    CHECK_HRESULT(res);
-    memcpy(mappedResource.pData, &constants, sizeof(constants));
-    Device::context->Unmap(this->constantBuffer, 0);
-
     batch->setVertexShader(Shaders::vertex.unlit);
     batch->setPixelShader(Shaders::pixel.unlit);
 
-    batch->setShaderConstants(this->constantBuffer);
-
     batch->setResources({
-        this->emissiveMap->getSRV(),
+        this->emissiveMap->getSlot().srv,
 	});
 
 	batch->setSamplers({
 		this->emissiveMap->getSamplerState(),
 	});
 }
+
+void UnlitBsdf::captureConstants(void *constants) const
+{
+    memcpy(constants, &this->constants, sizeof(this->constants));
+}
+
+Job::ShaderConstants UnlitBsdf::uploadConstants(const void *capturedConstants) const
+{
+    const TextureArrays::Slot &emissiveSlot = this->emissiveMap->getSlot();
+
+    // texture slots only change on the render thread
+    UnlitConstants constants;
+    memcpy(&constants, capturedConstants, sizeof(constants));
+    constants.emissiveRect = emissiveSlot.rect;
+    constants.emissiveSlice = emissiveSlot.slice;
+    constants.emissiveInset = emissiveSlot.inset;
+
+    return Job::uploadShaderConstants(&constants, sizeof(constants));
+}
+
+bool UnlitBsdf::canShareBatch(const Bsdf *other) const
+{
+    const UnlitBsdf *unlit = dynamic_cast<const UnlitBsdf *>(other);
+    if (unlit == nullptr)
+        return false;
+
+    // maps in the same texture array, slices and cells are per draw constants
+    const TextureArrays::Slot &slot = this->emissiveMap->getSlot();
+    return (unlit->emissiveMap == this->emissiveMap)
+        || ((slot.srv != nullptr) && (unlit->emissiveMap->getSlot().srv == slot.srv) && (unlit->emissiveMap->getSamplerState() == this->emissiveMap->getSamplerState()));
+}
+
+void UnlitBsdf::requestScreenSize(float screenSize) const
+{
+    // uvs are assumed to cover the object once before scaling
+    float textureSize = screenSize * glm::max(fabsf(this->constants.uvScale.x), fabsf(this->constants.uvScale.y));
+    this->emissiveMap->requestScreenSize(textureSize);
+}
@@ -6,7 +6,6 @@
 #include <engine/render/shaders/constants/UnlitConstants.h>
 
 struct cJSON;
-struct ShadowConstants;
 
 class UnlitBsdf: public Bsdf
 {
@@ -15,11 +14,15 @@ class UnlitBsdf: public Bsdf
         virtual ~UnlitBsdf();
 
         virtual void registerAnimatedProperties(PropertyMapping &properties) override;
-        virtual void setupBatch(Batch *batch, const RenderSettings &settings, ID3D11ShaderResourceView *shadowSRV, ID3D11SamplerState *shadowSampler, ShadowConstants *shadowConstants) override;
+        virtual void setupBatch(Batch *batch, const RenderSettings &settings, ID3D11ShaderResourceView *shadowSRV, StateObjects::Id shadowSampler) override;
+        virtual size_t getConstantsSize() const override { return sizeof(this->constants); }
+        virtual void captureConstants(void *constants) const override;
+        virtual Job::ShaderConstants uploadConstants(const void *constants) const override;
+        virtual bool canShareBatch(const Bsdf *other) const override;
+        virtual void requestScreenSize(float screenSize) const override;
 
     private:
         UnlitConstants constants;
-        ID3D11Buffer *constantBuffer;
 
         Texture *emissiveMap;
 };
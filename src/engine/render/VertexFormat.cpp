@@ -0,0 +1,210 @@
+#include <engine/render/VertexFormat.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#include <emmintrin.h>
+
+StateObjects::Id VertexFormat::createInputLayout(const void *shaderBytecode, size_t bytecodeLength, bool transformIndex)
+{
+    D3D11_INPUT_ELEMENT_DESC layout[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(Vertex, position), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(Vertex, normal), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TANGENT", 0, DXGI_FORMAT_R10G10B10A2_UNORM, 0, offsetof(Vertex, tangent), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, offsetof(Vertex, uv), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TRANSFORMINDEX", 0, DXGI_FORMAT_R32_UINT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
+    };
+
+    return StateObjects::createInputLayout(layout, transformIndex ? 5 : 4, shaderBytecode, bytecodeLength);
+}
+
+static inline __m128 absolute(__m128 v)
+{
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+// +1 or -1, zero being positive
+static inline __m128 signNotZero(__m128 v)
+{
+    return _mm_or_ps(_mm_and_ps(_mm_set1_ps(-0.0f), v), _mm_set1_ps(1.0f));
+}
+
+static inline __m128 select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// projection on the octahedron, unfolded in [-1, 1]^2; the lower half is folded over the diagonals
+static inline void encodeOctahedral(__m128 x, __m128 y, __m128 z, __m128 &u, __m128 &v)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    __m128 length = _mm_add_ps(_mm_add_ps(absolute(x), absolute(y)), absolute(z));
+    __m128 scale = _mm_div_ps(one, _mm_max_ps(length, _mm_set1_ps(1e-20f)));
+    x = _mm_mul_ps(x, scale);
+    y = _mm_mul_ps(y, scale);
+
+    __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+    u = select(lower, _mm_mul_ps(_mm_sub_ps(one, absolute(y)), signNotZero(x)), x);
+    v = select(lower, _mm_mul_ps(_mm_sub_ps(one, absolute(x)), signNotZero(y)), y);
+}
+
+static inline __m128 clamp(__m128 v, float minimum, float maximum)
+{
+    return _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(minimum)), _mm_set1_ps(maximum));
+}
+
+// round to nearest even, with denormals, infinities and NaNs
+static inline __m128i floatToHalf(__m128 f)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128i maxRegular = _mm_set1_epi32((127 + 16) << 23); // rounds to infinity from here
+    const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+    const __m128i subnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    const __m128i normalBias = _mm_set1_epi32(0xfff - ((127 - 15) << 23)); // exponent rebias and rounding
+
+    __m128 sign = _mm_and_ps(signMask, f);
+    __m128 absf = _mm_xor_ps(f, sign);
+    __m128i absi = _mm_castps_si128(absf);
+
+    __m128i isNan = _mm_castps_si128(_mm_cmpunord_ps(absf, absf));
+    __m128i isRegular = _mm_cmpgt_epi32(maxRegular, absi);
+    __m128i special = _mm_or_si128(_mm_and_si128(isNan, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7c00));
+
+    // subnormal results, rounded by the float addition
+    __m128i isSubnormal = _mm_cmpgt_epi32(minNormal, absi);
+    __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absf, _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+
+    // normal results; bias towards rounding up when the result mantissa is odd
+    __m128i oddMantissa = _mm_srai_epi32(_mm_slli_epi32(absi, 31 - 13), 31);
+    __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absi, normalBias), oddMantissa), 13);
+
+    __m128i regular = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+    __m128i result = _mm_or_si128(_mm_and_si128(isRegular, regular), _mm_andnot_si128(isRegular, special));
+
+    return _mm_or_si128(result, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+}
+
+// two 16-bit values per 32-bit lane, low first
+static inline __m128i packPairs(__m128i low, __m128i high)
+{
+    return _mm_or_si128(_mm_and_si128(low, _mm_set1_epi32(0xffff)), _mm_slli_epi32(high, 16));
+}
+
+static void encodeBlock(const float *source, VertexFormat::Vertex *destination, int count)
+{
+    const int stride = VertexFormat::sourceStride;
+
+    // vertices as rows of 4 floats, transposed to one register per attribute component
+    __m128 a0 = _mm_loadu_ps(source + 0 * stride), b0 = _mm_loadu_ps(source + 0 * stride + 4), c0 = _mm_loadu_ps(source + 0 * stride + 8);
+    __m128 a1 = _mm_loadu_ps(source + 1 * stride), b1 = _mm_loadu_ps(source + 1 * stride + 4), c1 = _mm_loadu_ps(source + 1 * stride + 8);
+    __m128 a2 = _mm_loadu_ps(source + 2 * stride), b2 = _mm_loadu_ps(source + 2 * stride + 4), c2 = _mm_loadu_ps(source + 2 * stride + 8);
+    __m128 a3 = _mm_loadu_ps(source + 3 * stride), b3 = _mm_loadu_ps(source + 3 * stride + 4), c3 = _mm_loadu_ps(source + 3 * stride + 8);
+
+    _MM_TRANSPOSE4_PS(a0, a1, a2, a3); // px, py, pz, nx
+    _MM_TRANSPOSE4_PS(b0, b1, b2, b3); // ny, nz, tx, ty
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3); // tz, tw, u, v
+
+    __m128 normalU, normalV;
+    encodeOctahedral(a3, b0, b1, normalU, normalV);
+    __m128i normalX = _mm_cvtps_epi32(_mm_mul_ps(clamp(normalU, -1.0f, 1.0f), _mm_set1_ps(32767.0f)));
+    __m128i normalY = _mm_cvtps_epi32(_mm_mul_ps(clamp(normalV, -1.0f, 1.0f), _mm_set1_ps(32767.0f)));
+
+    __m128 tangentU, tangentV;
+    encodeOctahedral(b2, b3, c0, tangentU, tangentV);
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128i tangentX = _mm_cvtps_epi32(_mm_mul_ps(clamp(_mm_add_ps(_mm_mul_ps(tangentU, half), half), 0.0f, 1.0f), _mm_set1_ps(1023.0f)));
+    __m128i tangentY = _mm_cvtps_epi32(_mm_mul_ps(clamp(_mm_add_ps(_mm_mul_ps(tangentV, half), half), 0.0f, 1.0f), _mm_set1_ps(1023.0f)));
+    __m128i tangentSign = _mm_and_si128(_mm_castps_si128(_mm_cmpge_ps(c1, _mm_setzero_ps())), _mm_set1_epi32((int)(3u << 30)));
+
+    alignas(16) uint32_t normals[4];
+    alignas(16) uint32_t tangents[4];
+    alignas(16) uint32_t uvs[4];
+    _mm_store_si128((__m128i *)normals, packPairs(normalX, normalY));
+    _mm_store_si128((__m128i *)tangents, _mm_or_si128(_mm_or_si128(tangentX, _mm_slli_epi32(tangentY, 10)), tangentSign));
+    _mm_store_si128((__m128i *)uvs, packPairs(floatToHalf(c2), floatToHalf(c3)));
+
+    for (int i = 0; i < count; i++)
+    {
+        VertexFormat::Vertex &vertex = destination[i];
+        memcpy(vertex.position, source + i * stride, sizeof(vertex.position));
+        memcpy(vertex.normal, &normals[i], sizeof(vertex.normal));
+        vertex.tangent = tangents[i];
+        memcpy(vertex.uv, &uvs[i], sizeof(vertex.uv));
+    }
+}
+
+void VertexFormat::encode(const float *source, int count, Vertex *destination)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        encodeBlock(source + i * VertexFormat::sourceStride, destination + i, 4);
+
+    if (i < count)
+    {
+        // padded copy of the last vertices
+        float block[4 * VertexFormat::sourceStride] = {};
+        memcpy(block, source + i * VertexFormat::sourceStride, (count - i) * VertexFormat::sourceStride * sizeof(float));
+        encodeBlock(block, destination + i, count - i);
+    }
+}
+
+static float halfToFloat(uint16_t value)
+{
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+
+    if (exponent == 0)
+    {
+        float subnormal = ldexpf((float)mantissa, -24);
+        return sign ? -subnormal : subnormal;
+    }
+
+    uint32_t bits = sign | (mantissa << 13) | ((exponent == 31) ? 0x7f800000 : ((exponent + 127 - 15) << 23));
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static void decodeOctahedral(float u, float v, float *direction)
+{
+    float x = u;
+    float y = v;
+    float z = 1.0f - fabsf(u) - fabsf(v);
+    if (z < 0.0f)
+    {
+        x = (1.0f - fabsf(v)) * ((u >= 0.0f) ? 1.0f : -1.0f);
+        y = (1.0f - fabsf(u)) * ((v >= 0.0f) ? 1.0f : -1.0f);
+    }
+
+    float length = sqrtf(x * x + y * y + z * z);
+    direction[0] = x / length;
+    direction[1] = y / length;
+    direction[2] = z / length;
+}
+
+void VertexFormat::decode(const Vertex *source, int count, float *destination)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const Vertex &vertex = source[i];
+        float *output = destination + i * VertexFormat::sourceStride;
+
+        memcpy(output, vertex.position, sizeof(vertex.position));
+
+        decodeOctahedral(std::max(vertex.normal[0] / 32767.0f, -1.0f), std::max(vertex.normal[1] / 32767.0f, -1.0f), output + 3);
+
+        float tangentU = (float)(vertex.tangent & 0x3ff) / 1023.0f * 2.0f - 1.0f;
+        float tangentV = (float)((vertex.tangent >> 10) & 0x3ff) / 1023.0f * 2.0f - 1.0f;
+        decodeOctahedral(tangentU, tangentV, output + 6);
+        output[9] = (vertex.tangent >> 30) ? 1.0f : -1.0f;
+
+        output[10] = halfToFloat(vertex.uv[0]);
+        output[11] = halfToFloat(vertex.uv[1]);
+    }
+}
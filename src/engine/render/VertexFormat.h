@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+#include <engine/render/Device.h>
+#include <engine/render/StateObjects.h>
+
+/**
+ * Packed mesh vertex, shared by all mesh input layouts. Source vertices, as
+ * exported, are float3 position, float3 normal, float4 tangent, float2 uv
+ * (48 bytes); they are encoded at load time to 24 bytes:
+ * - normal: octahedral, 2x snorm16
+ * - tangent: octahedral, 2x unorm10, bitangent sign in the 2-bit alpha
+ * - uv: 2x half
+ */
+class VertexFormat
+{
+    public:
+        struct Vertex
+        {
+            float position[3];
+            int16_t normal[2];
+            uint32_t tangent;
+            uint16_t uv[2];
+        };
+
+        // floats per source vertex
+        static const int sourceStride = 3 + 3 + 4 + 2;
+
+        // mesh elements on slot 0, followed by the per-instance transform index on slot 1 if requested;
+        // shared through StateObjects, to release with StateObjects::release()
+        static StateObjects::Id createInputLayout(const void *shaderBytecode, size_t bytecodeLength, bool transformIndex);
+
+        // SSE, 4 vertices at a time
+        static void encode(const float *source, int count, Vertex *destination);
+
+        // back to source vertices, for load time processing only
+        static void decode(const Vertex *source, int count, float *destination);
+};
+
+static_assert(sizeof(VertexFormat::Vertex) == 24, "packed vertex must stay half the size of the source vertex");
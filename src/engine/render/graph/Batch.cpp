@@ -2,6 +2,9 @@
 
 #include <cassert>
 
+#include <engine/memory/FrameAllocator.h>
+#include <engine/render/RenderTarget.h>
+#include <engine/render/StateCache.h>
 #include <engine/render/graph/GPUProfiler.h>
 #include <engine/render/graph/Job.h>
 
@@ -10,97 +13,114 @@ namespace
     // base implementation left intentionally undefined; will break the build if an unknown
     // shader type is encountered
     template <class StageType>
-    void bindStage(ID3D11DeviceContext *context, StageType *shader, const std::vector<ID3D11ShaderResourceView *> &resources, const std::vector<ID3D11UnorderedAccessView *> &uavs, const std::vector<ID3D11SamplerState *> &samplers, ID3D11Buffer *shaderConstantBuffer);
+    void bindStage(StateCache *stateCache, StageType *shader, ID3D11ShaderResourceView **resources, int resourceCount, ID3D11UnorderedAccessView **uavs, int uavCount, ID3D11SamplerState **samplers, int samplerCount, ID3D11Buffer *shaderConstantBuffer);
 
     template <>
-    void bindStage<ID3D11VertexShader>(ID3D11DeviceContext *context, ID3D11VertexShader *shader, const std::vector<ID3D11ShaderResourceView *> &resources, const std::vector<ID3D11UnorderedAccessView *> &uavs, const std::vector<ID3D11SamplerState *> &samplers, ID3D11Buffer *shaderConstantBuffer)
+    void bindStage<ID3D11VertexShader>(StateCache *stateCache, ID3D11VertexShader *shader, ID3D11ShaderResourceView **resources, int resourceCount, ID3D11UnorderedAccessView **uavs, int uavCount, ID3D11SamplerState **samplers, int samplerCount, ID3D11Buffer *shaderConstantBuffer)
     {
-        context->VSSetShader(shader, nullptr, 0);
-        context->VSSetConstantBuffers(2, 1, &shaderConstantBuffer);
-        context->VSSetShaderResources(0, (UINT)resources.size(), resources.data());
-        context->VSSetSamplers(0, (UINT)samplers.size(), samplers.data());
+        stateCache->setVertexShader(shader);
+        stateCache->setConstantBuffer(StateCache::VERTEX_STAGE, 2, shaderConstantBuffer);
+        stateCache->setShaderResources(StateCache::VERTEX_STAGE, 0, resourceCount, resources);
+        stateCache->setSamplers(StateCache::VERTEX_STAGE, samplerCount, samplers);
     }
 
     template <>
-    void bindStage<ID3D11PixelShader>(ID3D11DeviceContext *context, ID3D11PixelShader *shader, const std::vector<ID3D11ShaderResourceView *> &resources, const std::vector<ID3D11UnorderedAccessView *> &uavs, const std::vector<ID3D11SamplerState *> &samplers, ID3D11Buffer *shaderConstantBuffer)
+    void bindStage<ID3D11PixelShader>(StateCache *stateCache, ID3D11PixelShader *shader, ID3D11ShaderResourceView **resources, int resourceCount, ID3D11UnorderedAccessView **uavs, int uavCount, ID3D11SamplerState **samplers, int samplerCount, ID3D11Buffer *shaderConstantBuffer)
     {
-        context->PSSetShader(shader, nullptr, 0);
-        context->PSSetConstantBuffers(2, 1, &shaderConstantBuffer);
-        context->PSSetShaderResources(0, (UINT)resources.size(), resources.data());
-        context->PSSetSamplers(0, (UINT)samplers.size(), samplers.data());
+        stateCache->setPixelShader(shader);
+        stateCache->setConstantBuffer(StateCache::PIXEL_STAGE, 2, shaderConstantBuffer);
+        stateCache->setShaderResources(StateCache::PIXEL_STAGE, 0, resourceCount, resources);
+        stateCache->setSamplers(StateCache::PIXEL_STAGE, samplerCount, samplers);
 	}
 
     template <>
-    void bindStage<ID3D11ComputeShader>(ID3D11DeviceContext *context, ID3D11ComputeShader *shader, const std::vector<ID3D11ShaderResourceView *> &resources, const std::vector<ID3D11UnorderedAccessView *> &uavs, const std::vector<ID3D11SamplerState *> &samplers, ID3D11Buffer *shaderConstantBuffer)
+    void bindStage<ID3D11ComputeShader>(StateCache *stateCache, ID3D11ComputeShader *shader, ID3D11ShaderResourceView **resources, int resourceCount, ID3D11UnorderedAccessView **uavs, int uavCount, ID3D11SamplerState **samplers, int samplerCount, ID3D11Buffer *shaderConstantBuffer)
     {
-        context->CSSetShader(shader, nullptr, 0);
-        context->CSSetConstantBuffers(2, 1, &shaderConstantBuffer);
-        context->CSSetShaderResources(0, (UINT)resources.size(), resources.data());
-		context->CSSetUnorderedAccessViews(0, (UINT)uavs.size(), uavs.data(), nullptr);
-		context->CSSetSamplers(0, (UINT)samplers.size(), samplers.data());
+        stateCache->setComputeShader(shader);
+        stateCache->setConstantBuffer(StateCache::COMPUTE_STAGE, 2, shaderConstantBuffer);
+        stateCache->setShaderResources(StateCache::COMPUTE_STAGE, 0, resourceCount, resources);
+		stateCache->setUnorderedResources(uavCount, uavs);
+		stateCache->setSamplers(StateCache::COMPUTE_STAGE, samplerCount, samplers);
 	}
 }
 
-Batch::Batch(const std::string &name)
-    : name(name)
+Batch::Batch(const char *name, FrameAllocator *allocator)
+    : allocator(allocator), name(name)
 {
 }
 
-Job *Batch::addJob()
+void Batch::setResources(std::initializer_list<ID3D11ShaderResourceView *> resources)
 {
-    Job *job = new Job();
-    this->jobs.push_back(job);
-    return job;
+    this->resources = this->allocator->allocate<ShaderResource>(resources.size());
+    this->resourceCount = (int)resources.size();
+
+    int i = 0;
+    for (ID3D11ShaderResourceView *resource : resources)
+        this->resources[i++] = ShaderResource(resource);
 }
 
-void Batch::execute(ID3D11DeviceContext *context)
+void Batch::setResources(std::initializer_list<ShaderResource> resources)
 {
-    GPUProfiler::ScopedProfile profile(this->name);
-
-    if (this->depthStencil != nullptr)
-        context->OMSetDepthStencilState(this->depthStencil, 0);
-
-    if (this->vertexShader != nullptr)
-        bindStage(context, this->vertexShader, this->resources, this->unorderedResources, this->samplers, this->shaderConstantBuffer);
-
-    if (this->pixelShader != nullptr)
-        bindStage(context, this->pixelShader, this->resources, this->unorderedResources, this->samplers, this->shaderConstantBuffer);
-    
-    if (this->computeShader != nullptr)
-        bindStage(context, this->computeShader, this->resources, this->unorderedResources, this->samplers, this->shaderConstantBuffer);
+    this->resources = this->allocator->copy(resources);
+    this->resourceCount = (int)resources.size();
+}
 
-    if (this->inputLayout != nullptr)
-        context->IASetInputLayout(this->inputLayout);
+void Batch::setUnorderedResources(std::initializer_list<ID3D11UnorderedAccessView *> resources)
+{
+    this->unorderedResources = this->allocator->copy(resources);
+    this->unorderedResourceCount = (int)resources.size();
+}
 
-    // render jobs
-    for (auto *job : this->jobs)
-    {
-        job->execute(context);
-        delete job;
-    }
+void Batch::setSamplers(std::initializer_list<StateObjects::Id> samplers)
+{
+    this->samplers = this->allocator->copy(samplers);
+    this->samplerCount = (int)samplers.size();
+}
 
-    // nullify all resources to unbind them
-    if (this->resources.size() > 0)
-        memset(&this->resources[0], 0, sizeof(this->resources[0]) * this->resources.size());
+Job *Batch::addJob()
+{
+    Job *job = this->allocator->create<Job>(this->allocator);
 
-	if (this->unorderedResources.size() > 0)
-		memset(&this->unorderedResources[0], 0, sizeof(this->unorderedResources[0]) * this->unorderedResources.size());
+    if (this->lastJob)
+        this->lastJob->next = job;
+    else
+        this->firstJob = job;
+    this->lastJob = job;
 
-	if (this->samplers.size() > 0)
-		memset(&this->samplers[0], 0, sizeof(this->samplers[0]) * this->samplers.size());
+    return job;
+}
 
-	if (this->depthStencil != nullptr)
-        context->OMSetDepthStencilState(nullptr, 0);
+void Batch::execute(StateCache *stateCache)
+{
+    GPUProfiler::ScopedProfile profile(this->name, stateCache->getContext());
 
-    if (this->vertexShader != nullptr)
-        bindStage<ID3D11VertexShader>(context, nullptr, this->resources, this->unorderedResources, this->samplers, nullptr);
+    // storage of render targets is final at this point
+    assert(this->resourceCount <= MAX_RESOURCES);
+    ID3D11ShaderResourceView *resources[MAX_RESOURCES];
+    for (int i = 0; i < this->resourceCount; i++)
+        resources[i] = this->resources[i].target ? this->resources[i].target->getSRV() : this->resources[i].view;
 
-    if (this->pixelShader != nullptr)
-        bindStage<ID3D11PixelShader>(context, nullptr, this->resources, this->unorderedResources, this->samplers, nullptr);
+    assert(this->samplerCount <= MAX_SAMPLERS);
+    ID3D11SamplerState *samplers[MAX_SAMPLERS];
+    for (int i = 0; i < this->samplerCount; i++)
+        samplers[i] = StateObjects::getSampler(this->samplers[i]);
 
+    // state is not restored after the batch; it is overwritten by the next batches when needed
+    // (draw batches always set both graphics stages, so no shader leaks from a previous batch)
     if (this->computeShader != nullptr)
-        bindStage<ID3D11ComputeShader>(context, nullptr, this->resources, this->unorderedResources, this->samplers, nullptr);
+    {
+        bindStage(stateCache, this->computeShader, resources, this->resourceCount, this->unorderedResources, this->unorderedResourceCount, samplers, this->samplerCount, this->shaderConstantBuffer);
+    }
+    else
+    {
+        stateCache->setDepthStencilState(StateObjects::getDepthStencil(this->depthStencil));
+        stateCache->setInputLayout(StateObjects::getInputLayout(this->inputLayout));
+
+        bindStage(stateCache, this->vertexShader, resources, this->resourceCount, this->unorderedResources, this->unorderedResourceCount, samplers, this->samplerCount, this->shaderConstantBuffer);
+        bindStage(stateCache, this->pixelShader, resources, this->resourceCount, this->unorderedResources, this->unorderedResourceCount, samplers, this->samplerCount, this->shaderConstantBuffer);
+    }
 
-    if (this->inputLayout != nullptr)
-        context->IASetInputLayout(nullptr);
+    // render jobs; their memory is released along with the frame
+    for (Job *job = this->firstJob; job != nullptr; job = job->next)
+        job->execute(stateCache);
 }
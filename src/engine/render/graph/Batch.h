@@ -1,48 +1,80 @@
 #pragma once
 
-#include <string>
-#include <vector>
+#include <initializer_list>
 
 #include <d3d11.h>
 
+#include <engine/render/StateObjects.h>
+
+class FrameAllocator;
 class Job;
+class RenderTarget;
+class StateCache;
 
 class Batch
 {
     public:
-        Batch(const std::string &name);
+        // either a view, or a render target whose view is only known when the frame graph is executed
+        // (transient targets are given memory once all the passes of the frame are known)
+        struct ShaderResource
+        {
+            ShaderResource(ID3D11ShaderResourceView *view) : view(view), target(nullptr) {}
+            ShaderResource(RenderTarget *target) : view(nullptr), target(target) {}
+
+            ID3D11ShaderResourceView *view;
+            RenderTarget *target;
+        };
 
-        void setDepthStencil(ID3D11DepthStencilState *depthStencil) { this->depthStencil = depthStencil; }
+        Batch(const char *name, FrameAllocator *allocator);
 
-        void setResources(const std::vector<ID3D11ShaderResourceView *> &resources) { this->resources = resources; }
-		void setUnorderedResources(const std::vector<ID3D11UnorderedAccessView *> &resources) { this->unorderedResources = resources; }
-		void setSamplers(const std::vector<ID3D11SamplerState *> &samplers) { this->samplers = samplers; }
+        void setDepthStencil(StateObjects::Id depthStencil) { this->depthStencil = depthStencil; }
+
+        void setResources(std::initializer_list<ID3D11ShaderResourceView *> resources);
+        void setResources(std::initializer_list<ShaderResource> resources);
+		void setUnorderedResources(std::initializer_list<ID3D11UnorderedAccessView *> resources);
+		void setSamplers(std::initializer_list<StateObjects::Id> samplers);
 		void setShaderConstants(ID3D11Buffer *shaderConstantBuffer) { this->shaderConstantBuffer = shaderConstantBuffer; }
 
         void setVertexShader(ID3D11VertexShader *vertexShader) { this->vertexShader = vertexShader; }
         void setPixelShader(ID3D11PixelShader *pixelShader) { this->pixelShader = pixelShader; }
         void setComputeShader(ID3D11ComputeShader *computeShader) { this->computeShader = computeShader; }
 
-        void setInputLayout(ID3D11InputLayout *inputLayout) { this->inputLayout = inputLayout; }
+        void setInputLayout(StateObjects::Id inputLayout) { this->inputLayout = inputLayout; }
 
         Job *addJob();
 
-        void execute(ID3D11DeviceContext *context);
+        void execute(StateCache *stateCache);
 
     private:
-        std::string name;
+        friend class FrameGraph;
+        friend class Pass;
+
+        static const int MAX_RESOURCES = 32;
+        static const int MAX_SAMPLERS = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
 
-        ID3D11DepthStencilState *depthStencil = nullptr;
-        std::vector<ID3D11ShaderResourceView *> resources;
-		std::vector<ID3D11UnorderedAccessView *> unorderedResources;
-		std::vector<ID3D11SamplerState *> samplers;
+        // all the data below is allocated from the frame memory
+        FrameAllocator *allocator;
+
+        const char *name;
+
+        // states are ids of StateObjects, resolved at execution
+        StateObjects::Id depthStencil = 0;
+        ShaderResource *resources = nullptr;
+        int resourceCount = 0;
+		ID3D11UnorderedAccessView **unorderedResources = nullptr;
+		int unorderedResourceCount = 0;
+		StateObjects::Id *samplers = nullptr;
+		int samplerCount = 0;
 		ID3D11Buffer *shaderConstantBuffer = nullptr;
 
         ID3D11VertexShader *vertexShader = nullptr;
         ID3D11PixelShader *pixelShader = nullptr;
         ID3D11ComputeShader *computeShader = nullptr;
 
-        ID3D11InputLayout *inputLayout = nullptr;
+        StateObjects::Id inputLayout = 0;
+
+        Job *firstJob = nullptr;
+        Job *lastJob = nullptr;
 
-        std::vector<Job *> jobs;
+        Batch *next = nullptr; // in the owning pass
 };
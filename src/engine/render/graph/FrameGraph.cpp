@@ -1,11 +1,25 @@
 #include <engine/render/graph/FrameGraph.h>
 
+#include <algorithm>
+#include <type_traits>
+
 #include <engine/render/Device.h>
+#include <engine/render/RenderTarget.h>
+#include <engine/render/StateCache.h>
 #include <engine/render/graph/GPUProfiler.h>
 #include <engine/render/graph/Job.h>
+#include <engine/render/graph/Batch.h>
 #include <engine/render/graph/Pass.h>
+#include <engine/render/shaders/constants/LightData.h>
 #include <engine/render/shaders/constants/SceneConstants.h>
 #include <engine/render/shaders/constants/PassConstants.h>
+#include <engine/render/shaders/constants/TransformData.h>
+#include <engine/thread/TaskScheduler.h>
+
+// frame graph nodes are never destroyed, only their memory is recycled
+static_assert(std::is_trivially_destructible<Pass>::value, "Pass must not own any memory");
+static_assert(std::is_trivially_destructible<Batch>::value, "Batch must not own any memory");
+static_assert(std::is_trivially_destructible<Job>::value, "Job must not own any memory");
 
 FrameGraph::FrameGraph(const std::string &profileFilename)
 {
@@ -31,7 +45,7 @@ FrameGraph::FrameGraph(const std::string &profileFilename)
 	res = this->context->QueryInterface(__uuidof(this->annotation), (void **)&this->annotation);
 	CHECK_HRESULT(res);
 
-	Job::createInstanceBuffer(10 * 1024 * 1024);
+	Job::createUploadBuffers(1024 * 1024, 256 * 1024, 4 * 1024 * 1024);
 
     this->profileFilename = profileFilename;
 
@@ -44,7 +58,17 @@ FrameGraph::~FrameGraph()
     GPUProfiler::getInstance()->endJsonCapture(this->profileFilename);
     GPUProfiler::destroy();
 
-	Job::destroyInstanceBuffer();
+	Job::destroyUploadBuffers();
+
+    for (auto &pooledTarget : this->targetPool)
+        delete pooledTarget.target;
+
+    for (auto &recorder : this->passRecorders)
+    {
+        delete recorder.stateCache;
+        recorder.annotation->Release();
+        recorder.context->Release();
+    }
 
 	this->context->Release();
 	this->annotation->Release();
@@ -70,9 +94,11 @@ void FrameGraph::addClearTarget(ID3D11DepthStencilView *target, float depth, uns
     this->clearDepthTargets.push_back(depthTarget);
 }
 
-Pass *FrameGraph::addPass(const std::string &name)
+Pass *FrameGraph::addPass(const char *name)
 {
-    Pass *pass = new Pass(name);
+    FrameAllocator *allocator = &this->frameAllocator;
+
+    Pass *pass = allocator->create<Pass>(name, this->internWideName(name), allocator);
     this->passes.push_back(pass);
     return pass;
 }
@@ -81,7 +107,7 @@ void FrameGraph::execute(const SceneConstants &sceneConstants)
 {
     GPUProfiler::getInstance()->beginFrame();
 
-	Job::applyInstanceBuffer();
+	Job::applyUploadBuffers();
 
     // upload scene constants to GPU
     D3D11_MAPPED_SUBRESOURCE mappedResource;
@@ -90,33 +116,143 @@ void FrameGraph::execute(const SceneConstants &sceneConstants)
     memcpy(mappedResource.pData, &sceneConstants, sizeof(SceneConstants));
     this->context->Unmap(this->sceneConstantBuffer, 0);
 
-    // bind common buffers
-    ID3D11Buffer *commonConstantBuffers[] = { this->sceneConstantBuffer, this->passConstantBuffer };
-    Device::context->VSSetConstantBuffers(0, 2, commonConstantBuffers);
-    Device::context->PSSetConstantBuffers(0, 2, commonConstantBuffers);
-	Device::context->CSSetConstantBuffers(0, 2, commonConstantBuffers);
-
+    this->planTransientTargets();
     this->clearAllTargets();
     this->executeAllPasses();
 
-    // unbind common buffers
-    ID3D11Buffer *nullConstantBuffers[] = { nullptr, nullptr };
-    Device::context->VSSetConstantBuffers(0, 2, nullConstantBuffers);
-    Device::context->PSSetConstantBuffers(0, 2, nullConstantBuffers);
-	Device::context->CSSetConstantBuffers(0, 2, nullConstantBuffers);
-
-	Job::resetInstanceBufferPosition();
+	Job::resetUploadBuffers();
 
 	GPUProfiler::getInstance()->endFrame();
+
+    // command lists are submitted, nothing references the nodes anymore
+    this->frameAllocator.reset();
+}
+
+void FrameGraph::planTransientTargets()
+{
+    this->resourcePlanner.clear();
+    this->transientTargets.clear();
+
+    auto getResource = [&](RenderTarget *target) -> int
+    {
+        if (!target->isTransient())
+            return -1;
+
+        if (target->getPlannedResource() >= 0)
+            return target->getPlannedResource();
+
+        ResourcePlanner::ResourceDesc desc;
+        desc.width = target->getWidth();
+        desc.height = target->getHeight();
+        desc.format = (int)target->getFormat();
+        desc.size = target->getMemorySize();
+
+        int resource = this->resourcePlanner.addResource(desc);
+        target->setPlannedResource(resource);
+        this->transientTargets.push_back(target);
+        return resource;
+    };
+
+    for (auto *pass : this->passes)
+    {
+        // anything else than transient targets is visible outside of the frame
+        bool sideEffects = (pass->colorTargetCount == 0) || (pass->colorRenderTargets == nullptr) || (pass->depthStencilTarget != nullptr);
+        for (int i = 0; !sideEffects && (i < pass->colorTargetCount); i++)
+            sideEffects = !pass->colorRenderTargets[i]->isTransient();
+        for (Batch *batch = pass->firstBatch; !sideEffects && (batch != nullptr); batch = batch->next)
+            sideEffects = (batch->unorderedResourceCount > 0);
+
+        int plannedPass = this->resourcePlanner.addPass(sideEffects);
+
+        for (int i = 0; (pass->colorRenderTargets != nullptr) && (i < pass->colorTargetCount); i++)
+        {
+            int resource = getResource(pass->colorRenderTargets[i]);
+            if (resource >= 0)
+                this->resourcePlanner.addWrite(plannedPass, resource);
+        }
+
+        for (Batch *batch = pass->firstBatch; batch != nullptr; batch = batch->next)
+        {
+            for (int i = 0; i < batch->resourceCount; i++)
+            {
+                int resource = batch->resources[i].target ? getResource(batch->resources[i].target) : -1;
+                if (resource >= 0)
+                    this->resourcePlanner.addRead(plannedPass, resource);
+            }
+        }
+    }
+
+    this->resourcePlanner.compile();
+
+    // back the planned storage with pooled targets
+    for (auto &pooledTarget : this->targetPool)
+        pooledTarget.used = false;
+
+    this->storageTargets.resize(this->resourcePlanner.getStorageCount());
+    for (int storage = 0; storage < this->resourcePlanner.getStorageCount(); storage++)
+    {
+        const ResourcePlanner::ResourceDesc &desc = this->resourcePlanner.getStorageDesc(storage);
+
+        auto it = std::find_if(this->targetPool.begin(), this->targetPool.end(), [&](const PooledTarget &pooledTarget)
+        {
+            return !pooledTarget.used && (pooledTarget.target->getWidth() == desc.width) && (pooledTarget.target->getHeight() == desc.height) && ((int)pooledTarget.target->getFormat() == desc.format);
+        });
+
+        if (it == this->targetPool.end())
+        {
+            PooledTarget pooledTarget;
+            pooledTarget.target = new RenderTarget(desc.width, desc.height, (DXGI_FORMAT)desc.format);
+            this->targetPool.push_back(pooledTarget);
+            it = this->targetPool.end() - 1;
+        }
+
+        it->used = true;
+        it->unusedFrameCount = 0;
+        this->storageTargets[storage] = it->target;
+    }
+
+    for (int i = 0; i < (int)this->transientTargets.size(); i++)
+    {
+        int storage = this->resourcePlanner.getResourceStorage(i);
+        this->transientTargets[i]->setStorage((storage >= 0) ? this->storageTargets[storage] : nullptr);
+
+        // targets may not live until the next frame
+        this->transientTargets[i]->setPlannedResource(-1);
+    }
+
+    // release the storage that is not needed anymore (the runtime keeps it alive while the GPU uses it)
+    for (auto it = this->targetPool.begin(); it != this->targetPool.end();)
+    {
+        if (!it->used && (++it->unusedFrameCount > TARGET_POOL_LATENCY))
+        {
+            delete it->target;
+            it = this->targetPool.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    // culled passes are not recorded; the planner indices are not used past this point
+    int remainingPassCount = 0;
+    for (int i = 0; i < (int)this->passes.size(); i++)
+    {
+        if (!this->resourcePlanner.isPassCulled(i))
+            this->passes[remainingPassCount++] = this->passes[i];
+    }
+
+    GPUProfiler::getInstance()->addCounter("CulledPasses", this->passes.size() - remainingPassCount);
+    this->passes.resize(remainingPassCount);
+    GPUProfiler::getInstance()->addCounter("TransientTargetBytes", this->resourcePlanner.getAllocatedSize());
+    GPUProfiler::getInstance()->addCounter("TransientTargetBytesSaved", this->resourcePlanner.getRequestedSize() - this->resourcePlanner.getAllocatedSize());
 }
 
 void FrameGraph::clearAllTargets()
 {
     GPUProfiler::ScopedProfile profile("Clear");
 
-	std::string clearName("Clear");
-	std::wstring clearNameWide(clearName.begin(), clearName.end());
-	this->annotation->BeginEvent(clearNameWide.c_str());
+	this->annotation->BeginEvent(L"Clear");
 
 	for (auto &colorTarget : this->clearColorTargets)
         this->context->ClearRenderTargetView(colorTarget.target, (float *)&colorTarget.color);
@@ -132,11 +268,86 @@ void FrameGraph::clearAllTargets()
 
 void FrameGraph::executeAllPasses()
 {
-    for (auto *pass : this->passes)
+    while (this->passRecorders.size() < this->passes.size())
+    {
+        PassRecorder recorder;
+
+        HRESULT res = Device::device->CreateDeferredContext(0, &recorder.context);
+        CHECK_HRESULT(res);
+
+        res = recorder.context->QueryInterface(__uuidof(recorder.annotation), (void **)&recorder.annotation);
+        CHECK_HRESULT(res);
+
+        recorder.stateCache = new StateCache(recorder.context);
+        recorder.commandList = nullptr;
+
+        this->passRecorders.push_back(recorder);
+    }
+
+    TaskScheduler::getInstance()->parallelFor((int)this->passes.size(), 1, [this](int begin, int end, int chunkIndex)
     {
-        pass->execute(this->context, this->passConstantBuffer, this->annotation);
-        delete pass;
+        for (int i = begin; i < end; i++)
+            this->recordPass(this->passes[i], this->passRecorders[i]);
+    });
+
+    // submit in graph order; the immediate context state is cleared after each command list,
+    // so that no binding leaks from one pass to the next (and none remains after the frame)
+    for (size_t i = 0; i < this->passes.size(); i++)
+    {
+        PassRecorder &recorder = this->passRecorders[i];
+
+        this->context->ExecuteCommandList(recorder.commandList, FALSE);
+        recorder.commandList->Release();
+        recorder.commandList = nullptr;
+
+        recorder.stateCache->reportCounters();
     }
 
+    // nodes are not deleted, their memory is released along with the frame
     this->passes.clear();
 }
+
+void FrameGraph::setLightBuffers(ID3D11ShaderResourceView *lights, ID3D11ShaderResourceView *clusters, ID3D11ShaderResourceView *indices)
+{
+    static_assert(LIGHT_CLUSTER_BUFFER_SLOT == LIGHT_BUFFER_SLOT + 1 && LIGHT_INDEX_BUFFER_SLOT == LIGHT_BUFFER_SLOT + 2, "light buffers are bound together");
+
+    this->lightBuffers[0] = lights;
+    this->lightBuffers[1] = clusters;
+    this->lightBuffers[2] = indices;
+}
+
+void FrameGraph::recordPass(Pass *pass, PassRecorder &recorder)
+{
+    // the deferred context starts from the default state
+    StateCache *stateCache = recorder.stateCache;
+    stateCache->reset();
+
+    // bind common buffers
+    for (int stage = 0; stage < StateCache::STAGE_COUNT; stage++)
+    {
+        stateCache->setConstantBuffer((StateCache::Stage)stage, 0, this->sceneConstantBuffer);
+        stateCache->setConstantBuffer((StateCache::Stage)stage, 1, this->passConstantBuffer);
+    }
+    stateCache->setShaderResources(StateCache::VERTEX_STAGE, TRANSFORM_BUFFER_SLOT, 1, &this->transformBuffer);
+    stateCache->setShaderResources(StateCache::PIXEL_STAGE, LIGHT_BUFFER_SLOT, 3, this->lightBuffers);
+    stateCache->setRasterizerState(StateObjects::getRasterizer(this->rasterizerState));
+
+    // the pass constant buffer is renamed by each deferred context, passes don't overwrite each other
+    pass->execute(stateCache, this->passConstantBuffer, recorder.annotation);
+
+    HRESULT res = recorder.context->FinishCommandList(FALSE, &recorder.commandList);
+    CHECK_HRESULT(res);
+}
+
+const wchar_t *FrameGraph::internWideName(const char *name)
+{
+    // names are literals, so the pointer identifies them
+    auto it = this->wideNames.find(name);
+    if (it == this->wideNames.end())
+    {
+        std::string narrowName(name);
+        it = this->wideNames.insert(std::make_pair(name, std::wstring(narrowName.begin(), narrowName.end()))).first;
+    }
+
+    return it->second.c_str();
+}
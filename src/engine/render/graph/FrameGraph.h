@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <windows.h>
@@ -8,12 +9,22 @@
 
 #include <glm/vec4.hpp>
 
+#include <engine/memory/FrameAllocator.h>
+#include <engine/render/StateObjects.h>
+#include <engine/render/graph/ResourcePlanner.h>
+
 class Pass;
+class RenderTarget;
+class StateCache;
 struct SceneConstants;
 
 /**
  * The FrameGraph manages all the state changes and submits
  * all draw calls for a given frame.
+ * Passes are recorded in parallel into command lists (one deferred
+ * context per pass), which are then submitted in graph order.
+ * Transient render targets read and written by passes are given memory
+ * from a pool at execution, and passes that nobody consumes are culled.
  */
 class FrameGraph
 {
@@ -24,13 +35,34 @@ class FrameGraph
         void addClearTarget(ID3D11RenderTargetView *target, glm::vec4 color);
         void addClearTarget(ID3D11DepthStencilView *target, float depth, unsigned char stencil);
 
-        Pass *addPass(const std::string &name);
+        // name is not copied, it must outlive the frame (use literals)
+        Pass *addPass(const char *name);
+
+        // bound to all vertex shaders for the whole frame
+        void setTransformBuffer(ID3D11ShaderResourceView *transformBuffer) { this->transformBuffer = transformBuffer; }
+
+        // bound to all pixel shaders for the whole frame (see ClusteredLights)
+        void setLightBuffers(ID3D11ShaderResourceView *lights, ID3D11ShaderResourceView *clusters, ID3D11ShaderResourceView *indices);
+
+        // set on all the passes, deferred contexts don't inherit it from the immediate context
+        void setRasterizerState(StateObjects::Id rasterizerState) { this->rasterizerState = rasterizerState; }
 
         void execute(const SceneConstants &sceneConstants);
 
     private:
+        struct PassRecorder
+        {
+            ID3D11DeviceContext *context;
+            ID3DUserDefinedAnnotation *annotation;
+            StateCache *stateCache;
+            ID3D11CommandList *commandList;
+        };
+
+        void planTransientTargets();
         void clearAllTargets();
         void executeAllPasses();
+        void recordPass(Pass *pass, PassRecorder &recorder);
+        const wchar_t *internWideName(const char *name);
 
         ID3D11DeviceContext *context;
 		ID3DUserDefinedAnnotation *annotation;
@@ -54,6 +86,35 @@ class FrameGraph
 
         ID3D11Buffer *sceneConstantBuffer;
         ID3D11Buffer *passConstantBuffer;
+        ID3D11ShaderResourceView *transformBuffer = nullptr;
+        ID3D11ShaderResourceView *lightBuffers[3] = {};
+        StateObjects::Id rasterizerState = 0;
 
         std::vector<Pass *> passes;
+
+        // storage of the transient targets, reused from frame to frame
+        struct PooledTarget
+        {
+            RenderTarget *target;
+            int unusedFrameCount;
+            bool used;
+        };
+        std::vector<PooledTarget> targetPool;
+
+        // targets are released when they have not been used for this number of frames
+        static const int TARGET_POOL_LATENCY = 60;
+
+        ResourcePlanner resourcePlanner;
+        std::vector<RenderTarget *> transientTargets; // indexed as in the planner
+        std::vector<RenderTarget *> storageTargets; // pooled targets, indexed as the planner storage
+
+        // deferred contexts are created on demand and reused, pass i is always recorded by recorder i
+        std::vector<PassRecorder> passRecorders;
+
+        // passes, batches and jobs are allocated from the frame memory; the graph is recorded
+        // and submitted within execute(), so the memory is reused as soon as it returns
+        FrameAllocator frameAllocator;
+
+        // wide names for annotations, converted once per name
+        std::unordered_map<const char *, std::wstring> wideNames;
 };
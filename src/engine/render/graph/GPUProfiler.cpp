@@ -1,5 +1,6 @@
 #include <engine/render/graph/GPUProfiler.h>
 
+#include <cstring>
 #include <fstream>
 
 #include <engine/render/Device.h>
@@ -60,6 +61,8 @@ void GPUProfiler::endFrame()
     // collect measurements if this frame is not disjoint
     if (queryDataDisjoint.Disjoint == FALSE)
     {
+        UINT64 frameStartUs = 0;
+
         for (auto &point: this->currentFrame->points)
         {
             UINT64 start;
@@ -73,10 +76,21 @@ void GPUProfiler::endFrame()
             UINT64 endUs = end * 1000000 / queryDataDisjoint.Frequency;
             UINT64 durationUs = endUs - startUs;
 
+            // the first point is the automatic frame block
+            if (&point == &this->currentFrame->points[0])
+                frameStartUs = startUs;
+
             if (this->capturingJson)
                 this->jsonData << "{\"pid\":\"Leaf\",\"tid\":\"GPU\",\"ts\":" << startUs << ",\"ph\":\"X\",\"cat\":\"gpu\",\"name\":\"" << point.name << "\",\"dur\":" << durationUs << "}," << std::endl;
         }
+
+        if (this->capturingJson)
+        {
+            for (auto &counter : this->currentFrame->counters)
+                this->jsonData << "{\"pid\":\"Leaf\",\"tid\":\"GPU\",\"ts\":" << frameStartUs << ",\"ph\":\"C\",\"name\":\"" << counter.name << "\",\"args\":{\"value\":" << counter.value << "}}," << std::endl;
+        }
     }
+    this->currentFrame->counters.clear();
 
     // return all queries to the pool
     for (auto &point: this->currentFrame->points)
@@ -87,32 +101,70 @@ void GPUProfiler::endFrame()
     this->currentFrame->points.clear();
 }
 
-int GPUProfiler::beginBlock(const std::string &name)
+int GPUProfiler::beginBlock(const char *name, ID3D11DeviceContext *context)
 {
     if (!this->enabled)
         return 0;
 
+    if (context == nullptr)
+        context = this->context;
+
     ProfilePoint point;
     point.name = name;
-    point.startQuery = this->requestPooledQuery();
-    point.endQuery = this->requestPooledQuery();
+
+    int handle;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        point.startQuery = this->requestPooledQuery();
+        point.endQuery = this->requestPooledQuery();
+
+        this->currentFrame->points.push_back(point);
+        handle = (int)this->currentFrame->points.size() - 1;
+    }
 
     // record the start timestamp
-    this->context->End(point.startQuery);
+    context->End(point.startQuery);
 
-    this->currentFrame->points.push_back(point);
-    return (int)this->currentFrame->points.size() - 1;
+    return handle;
 }
 
-void GPUProfiler::endBlock(int handle)
+void GPUProfiler::endBlock(int handle, ID3D11DeviceContext *context)
 {
     if (!this->enabled)
         return;
 
-    ProfilePoint &point = this->currentFrame->points[handle];
+    if (context == nullptr)
+        context = this->context;
+
+    ID3D11Query *endQuery;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        endQuery = this->currentFrame->points[handle].endQuery;
+    }
 
     // record the end timestamp
-    this->context->End(point.endQuery);
+    context->End(endQuery);
+}
+
+void GPUProfiler::addCounter(const char *name, size_t value)
+{
+    if (!this->enabled)
+        return;
+
+    for (auto &counter : this->currentFrame->counters)
+    {
+        if (strcmp(counter.name, name) == 0)
+        {
+            counter.value += value;
+            return;
+        }
+    }
+
+    ProfileCounter counter;
+    counter.name = name;
+    counter.value = value;
+    this->currentFrame->counters.push_back(counter);
 }
 
 void GPUProfiler::beginJsonCapture()
@@ -145,14 +197,15 @@ void GPUProfiler::endJsonCapture(const std::string filename)
     this->jsonData.clear();
 }
 
-GPUProfiler::ScopedProfile::ScopedProfile(const std::string &name)
+GPUProfiler::ScopedProfile::ScopedProfile(const char *name, ID3D11DeviceContext *context)
+    : context(context)
 {
-    this->blockHandle = GPUProfiler::getInstance()->beginBlock(name);
+    this->blockHandle = GPUProfiler::getInstance()->beginBlock(name, context);
 }
 
 GPUProfiler::ScopedProfile::~ScopedProfile()
 {
-    GPUProfiler::getInstance()->endBlock(this->blockHandle);
+    GPUProfiler::getInstance()->endBlock(this->blockHandle, this->context);
 }
 
 GPUProfiler::GPUProfiler(bool enabled, ID3D11DeviceContext *context)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cassert>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <sstream>
@@ -14,8 +15,13 @@ class GPUProfiler
         void endFrame();
 
         // returns an opaque handle on an internal structure
-        int beginBlock(const std::string &name);
-        void endBlock(int handle);
+        // names are not copied, they must outlive the profiled frames (use literals)
+        // blocks can be recorded in deferred contexts from any thread (default is the immediate context)
+        int beginBlock(const char *name, ID3D11DeviceContext *context = nullptr);
+        void endBlock(int handle, ID3D11DeviceContext *context = nullptr);
+
+        // accumulated over the current frame, and written along with its timings
+        void addCounter(const char *name, size_t value);
         
         // capture in the same JSON format as chrome://tracing
         // (allows analysis in the chrome tool directly)
@@ -25,11 +31,12 @@ class GPUProfiler
         class ScopedProfile
         {
             public:
-                ScopedProfile(const std::string &name);
+                ScopedProfile(const char *name, ID3D11DeviceContext *context = nullptr);
                 ~ScopedProfile();
 
             private:
                 int blockHandle;
+                ID3D11DeviceContext *context;
         };
         
     private:
@@ -51,15 +58,22 @@ class GPUProfiler
 
         struct ProfilePoint
         {
-            std::string name;
+            const char *name;
             ID3D11Query *startQuery;
             ID3D11Query *endQuery;
         };
 
+        struct ProfileCounter
+        {
+            const char *name;
+            size_t value;
+        };
+
         struct ProfileFrame
         {
             ID3D11Query *disjointQuery;
             std::vector<ProfilePoint> points;
+            std::vector<ProfileCounter> counters;
 
             ProfileFrame()
                 : disjointQuery(nullptr)
@@ -75,6 +89,9 @@ class GPUProfiler
 
         int frameBlock;
 
+        // protects the query pool and the current frame during command recording
+        std::mutex mutex;
+
         bool capturingJson;
         std::stringstream jsonData;
 
@@ -1,73 +1,173 @@
 #include <engine/render/graph/Job.h>
 
+#include <algorithm>
+
+#include <engine/memory/FrameAllocator.h>
 #include <engine/render/Device.h>
+#include <engine/render/StateCache.h>
+#include <engine/render/VertexFormat.h>
+#include <engine/render/graph/RingBuffer.h>
+
+RingBuffer *Job::instanceBuffer = nullptr;
+RingBuffer *Job::constantBuffer = nullptr;
+RingBuffer *Job::indexUploadBuffer = nullptr;
+int Job::instanceBufferFrame = 0;
+
+namespace
+{
+    // constant buffer ranges are given in blocks of 16 constants (256 bytes)
+    const int CONSTANT_ALIGNMENT = 256;
+
+    // each thread fills its own region of the instance buffer, so that the lock is rarely taken
+    const int THREAD_REGION_SIZE = 16 * 1024;
 
-std::vector<unsigned char> Job::instanceBufferData;
-ID3D11Buffer *Job::instanceBuffer = nullptr;
-unsigned char *Job::instanceBufferPosition = nullptr;
+    struct ThreadRegion
+    {
+        RingBuffer::Region region;
+        int used = 0;
+        int frame = -1;
+    };
+
+    thread_local ThreadRegion threadRegion;
+}
+
+Job::Job(FrameAllocator *allocator)
+	: allocator(allocator)
+{
+}
 
-Job::Job()
+void *Job::allocateInstance(int size)
 {
-	this->instanceBufferOffset = (int)(Job::instanceBufferPosition - &Job::instanceBufferData[0]);
+	ThreadRegion &thread = threadRegion;
+	if (thread.frame != Job::instanceBufferFrame || thread.used + size > thread.region.size)
+	{
+		thread.region = Job::instanceBuffer->allocate(std::max(size, std::min(THREAD_REGION_SIZE, Job::instanceBuffer->getChunkSize())));
+		thread.used = 0;
+		thread.frame = Job::instanceBufferFrame;
+	}
+
+	ID3D11Buffer *buffer = thread.region.buffer;
+	int offset = thread.region.offset + thread.used;
+	void *data = thread.region.data + thread.used;
+	thread.used += size;
+
+	InstanceRange *range = this->lastRange;
+	bool contiguous = (range->buffer == buffer) && (range->offset + range->count * this->instanceDataSize == offset);
+	if (range->count > 0 && !contiguous)
+	{
+		range = this->allocator->create<InstanceRange>();
+		range->count = 0;
+		range->next = nullptr;
+		this->lastRange->next = range;
+		this->lastRange = range;
+	}
+
+	if (range->count == 0)
+	{
+		range->buffer = buffer;
+		range->offset = offset;
+	}
+	range->count++;
+
+	return data;
 }
 
-void Job::execute(ID3D11DeviceContext *context)
+void Job::execute(StateCache *stateCache)
 {
 	if (this->dispatchSizeX > 0)
 	{
-		context->Dispatch(this->dispatchSizeX, this->dispatchSizeY, this->dispatchSizeZ);
+		stateCache->getContext()->Dispatch(this->dispatchSizeX, this->dispatchSizeY, this->dispatchSizeZ);
 		return;
 	}
 
-	ID3D11Buffer *buffers[] = { this->vertexBuffer, Job::instanceBuffer };
-	UINT strides[] = { sizeof(float) * (3 /* pos */ + 3 /* normal */ + 4 /* tangent */ + 2 /* uv */), (UINT)this->instanceDataSize };
-	UINT offsets[] = { 0, (UINT)this->instanceBufferOffset };
-    context->IASetVertexBuffers(0, 2, buffers, strides, offsets);
-    context->IASetIndexBuffer(this->indexBuffer, DXGI_FORMAT_R32_UINT, 0);
-    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	stateCache->setVertexBuffer(0, this->vertexBuffer, sizeof(VertexFormat::Vertex), 0);
+	stateCache->setIndexBuffer(this->indexBuffer, this->indexFormat);
+	stateCache->setPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-    context->DrawIndexedInstanced(this->indexCount, this->instanceCount, 0, 0, 0);
+	if (this->shaderConstants.buffer != nullptr)
+	{
+		stateCache->setConstantBuffer(StateCache::VERTEX_STAGE, 2, this->shaderConstants.buffer, this->shaderConstants.firstConstant, this->shaderConstants.constantCount);
+		stateCache->setConstantBuffer(StateCache::PIXEL_STAGE, 2, this->shaderConstants.buffer, this->shaderConstants.firstConstant, this->shaderConstants.constantCount);
+	}
 
-	buffers[0] = nullptr;
-	buffers[1] = nullptr;
-	context->IASetVertexBuffers(0, 2, buffers, strides, offsets);
-	context->IASetIndexBuffer(nullptr, DXGI_FORMAT_R32_UINT, 0);
+	for (InstanceRange *range = &this->firstRange; range != nullptr; range = range->next)
+	{
+		stateCache->setVertexBuffer(1, range->buffer, (UINT)this->instanceDataSize, (UINT)range->offset);
+		stateCache->getContext()->DrawIndexedInstanced(this->indexCount, range->count, this->firstIndex, 0, 0);
+	}
 }
 
-void Job::createInstanceBuffer(int size)
+Job::ShaderConstants Job::uploadShaderConstants(const void *data, int size)
 {
-	Job::instanceBufferData.resize(size);
+	RingBuffer::Region region = Job::constantBuffer->allocate(size);
+	memcpy(region.data, data, size);
+
+	ShaderConstants shaderConstants;
+	shaderConstants.buffer = region.buffer;
+	shaderConstants.firstConstant = (UINT)(region.offset / 16);
+	shaderConstants.constantCount = (UINT)((size + CONSTANT_ALIGNMENT - 1) / CONSTANT_ALIGNMENT * (CONSTANT_ALIGNMENT / 16));
+	return shaderConstants;
+}
 
-	D3D11_BUFFER_DESC bufferDesc;
-	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	bufferDesc.ByteWidth = size;
-	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	bufferDesc.StructureByteStride = 0;
-	bufferDesc.MiscFlags = 0;
-	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+Job::IndexRange Job::uploadIndices(const uint32_t *indices, int indexCount, DXGI_FORMAT indexFormat)
+{
+	int indexSize = (indexFormat == DXGI_FORMAT_R16_UINT) ? (int)sizeof(uint16_t) : (int)sizeof(uint32_t);
 
-	HRESULT res = Device::device->CreateBuffer(&bufferDesc, NULL, &Job::instanceBuffer);
-	CHECK_HRESULT(res);
+	IndexRange range = {nullptr, 0};
+	if (indexCount * indexSize > Job::indexUploadBuffer->getChunkSize())
+		return range;
 
-	Job::instanceBufferPosition = &Job::instanceBufferData[0];
+	RingBuffer::Region region = Job::indexUploadBuffer->allocate(indexCount * indexSize);
+	if (indexSize == sizeof(uint16_t))
+	{
+		uint16_t *shortIndices = (uint16_t *)region.data;
+		for (int i = 0; i < indexCount; i++)
+			shortIndices[i] = (uint16_t)indices[i];
+	}
+	else
+	{
+		memcpy(region.data, indices, indexCount * indexSize);
+	}
+
+	range.buffer = region.buffer;
+	range.firstIndex = region.offset / indexSize;
+	return range;
 }
 
-void Job::destroyInstanceBuffer()
+void Job::createUploadBuffers(int instanceChunkSize, int constantChunkSize, int indexChunkSize)
 {
-	Job::instanceBufferData.clear();
-	Job::instanceBuffer->Release();
+	Job::instanceBuffer = new RingBuffer(instanceChunkSize, D3D11_BIND_VERTEX_BUFFER, 1, "InstanceUploadBytes", "InstanceBufferMaps");
+	Job::constantBuffer = new RingBuffer(constantChunkSize, D3D11_BIND_CONSTANT_BUFFER, CONSTANT_ALIGNMENT, "ConstantUploadBytes", "ConstantBufferMaps");
+
+	// 32-bit aligned, so that ranges start on whole indices of both formats
+	Job::indexUploadBuffer = new RingBuffer(indexChunkSize, D3D11_BIND_INDEX_BUFFER, sizeof(uint32_t), "ClusterIndexUploadBytes", "ClusterIndexBufferMaps");
 }
 
-void Job::resetInstanceBufferPosition()
+void Job::destroyUploadBuffers()
 {
-	Job::instanceBufferPosition = &Job::instanceBufferData[0];
+	delete Job::instanceBuffer;
+	Job::instanceBuffer = nullptr;
+
+	delete Job::constantBuffer;
+	Job::constantBuffer = nullptr;
+
+	delete Job::indexUploadBuffer;
+	Job::indexUploadBuffer = nullptr;
+}
+
+void Job::resetUploadBuffers()
+{
+	Job::instanceBuffer->nextFrame();
+	Job::constantBuffer->nextFrame();
+	Job::indexUploadBuffer->nextFrame();
+
+	// invalidates the regions of all threads
+	Job::instanceBufferFrame++;
 }
 
-void Job::applyInstanceBuffer()
+void Job::applyUploadBuffers()
 {
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	HRESULT res = Device::context->Map(Job::instanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	CHECK_HRESULT(res);
-	memcpy(mappedResource.pData, &Job::instanceBufferData[0], Job::instanceBufferData.size());
-	Device::context->Unmap(Job::instanceBuffer, 0);
+	Job::instanceBuffer->unmap();
+	Job::constantBuffer->unmap();
+	Job::indexUploadBuffer->unmap();
 }
@@ -1,26 +1,47 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
 #include <vector>
 
 #include <d3d11.h>
 
+class StateCache;
+
+class FrameAllocator;
+class RingBuffer;
+class StateCache;
+
 class Job
 {
     public:
-		Job::Job();
+		// range of the shader constant ring buffer, bound to the slot 2 of the graphics stages
+		struct ShaderConstants
+		{
+			ID3D11Buffer *buffer;
+			UINT firstConstant;
+			UINT constantCount;
+		};
 
-        void setBuffers(ID3D11Buffer *vertexBuffer, ID3D11Buffer *indexBuffer, int indexCount)
+		Job(FrameAllocator *allocator);
+
+        // draws indexCount indices from firstIndex
+        void setBuffers(ID3D11Buffer *vertexBuffer, ID3D11Buffer *indexBuffer, DXGI_FORMAT indexFormat, int firstIndex, int indexCount)
         {
             this->vertexBuffer = vertexBuffer;
             this->indexBuffer = indexBuffer;
+            this->indexFormat = indexFormat;
+            this->firstIndex = firstIndex;
             this->indexCount = indexCount;
         }
 
 		template <typename InstanceData>
 		void addInstance(const InstanceData &instanceData);
 
-		void addInstance() { assert(this->instanceDataSize == 0);  this->instanceCount++; }
+		void addInstance() { assert(this->instanceDataSize == 0);  this->firstRange.count++; }
+
+		// overrides the constants of the batch, so that jobs with different constants can share a batch
+		void setShaderConstants(const ShaderConstants &shaderConstants) { this->shaderConstants = shaderConstants; }
 
 		void addDispatch(int x, int y, int z)
 		{
@@ -29,47 +50,73 @@ class Job
 			this->dispatchSizeZ = z;
 		}
 
-        void execute(ID3D11DeviceContext *context);
+        void execute(StateCache *stateCache);
 		
-		static void createInstanceBuffer(int size);
-		static void destroyInstanceBuffer();
+		// thread-safe; the data is copied to the shader constant ring buffer
+		static ShaderConstants uploadShaderConstants(const void *data, int size);
+
+		// range of the index ring buffer, to pass to setBuffers()
+		struct IndexRange
+		{
+			ID3D11Buffer *buffer; // null if the indices don't fit in a chunk
+			int firstIndex;
+		};
+
+		// thread-safe; indices are copied to the index ring buffer, in the given format
+		static IndexRange uploadIndices(const uint32_t *indices, int indexCount, DXGI_FORMAT indexFormat);
+
+		// size of the chunks of the instance, shader constant and index ring buffers
+		static void createUploadBuffers(int instanceChunkSize, int constantChunkSize, int indexChunkSize);
+		static void destroyUploadBuffers();
 
-		static void resetInstanceBufferPosition();
-		static void applyInstanceBuffer();
+		static void resetUploadBuffers();
+		static void applyUploadBuffers();
 
     private:
-		static std::vector<unsigned char> instanceBufferData;
-		static ID3D11Buffer *instanceBuffer;
-		static unsigned char *instanceBufferPosition;
+		friend class Batch;
+
+		// returns mapped memory for one instance, written directly by the caller
+		void *allocateInstance(int size);
+
+		static RingBuffer *instanceBuffer;
+		static RingBuffer *constantBuffer;
+		static RingBuffer *indexUploadBuffer;
+		static int instanceBufferFrame;
+
+		// contiguous instances in one chunk of the instance buffer, each range is one draw
+		struct InstanceRange
+		{
+			ID3D11Buffer *buffer;
+			int offset;
+			int count;
+			InstanceRange *next;
+		};
+
+		FrameAllocator *allocator;
 
 		ID3D11Buffer *vertexBuffer = nullptr;
         ID3D11Buffer *indexBuffer = nullptr;
+        DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT;
+        int firstIndex = 0;
         int indexCount = 0;
-		int instanceCount = 0;
-		int instanceBufferOffset = 0;
-		int instanceBufferSlice = 0;
 		int instanceDataSize = 0;
+		ShaderConstants shaderConstants = {nullptr, 0, 0};
+
+		InstanceRange firstRange = {nullptr, 0, 0, nullptr};
+		InstanceRange *lastRange = &this->firstRange;
 
 		int dispatchSizeX = 0;
 		int dispatchSizeY = 0;
 		int dispatchSizeZ = 0;
+
+		Job *next = nullptr; // in the owning batch
 };
 
 template <typename InstanceData>
 void Job::addInstance(const InstanceData &instanceData)
 {
-	assert((this->instanceCount == 0) || (this->instanceDataSize == sizeof(InstanceData)));
-
-	if (Job::instanceBufferPosition + sizeof(InstanceData) > &Job::instanceBufferData[0] + Job::instanceBufferData.size())
-	{
-		printf("Too many instances for this frame\n");
-		return;
-	}
-
-	memcpy(Job::instanceBufferPosition, &instanceData, sizeof(InstanceData));
-	this->instanceCount++;
+	assert((this->firstRange.count == 0) || (this->instanceDataSize == sizeof(InstanceData)));
 
 	this->instanceDataSize = sizeof(InstanceData);
-	this->instanceBufferSlice += this->instanceDataSize;
-	Job::instanceBufferPosition += this->instanceDataSize;
+	memcpy(this->allocateInstance(sizeof(InstanceData)), &instanceData, sizeof(InstanceData));
 }
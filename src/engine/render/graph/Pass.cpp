@@ -1,11 +1,14 @@
 #include <engine/render/graph/Pass.h>
 
+#include <engine/memory/FrameAllocator.h>
 #include <engine/render/Device.h>
+#include <engine/render/RenderTarget.h>
+#include <engine/render/StateCache.h>
 #include <engine/render/graph/Batch.h>
 #include <engine/render/graph/GPUProfiler.h>
 
-Pass::Pass(const std::string &name)
-    : name(name)
+Pass::Pass(const char *name, const wchar_t *wideName, FrameAllocator *allocator)
+    : allocator(allocator), name(name), wideName(wideName)
 {
     D3D11_VIEWPORT defaultViewport;
     defaultViewport.Width = 16.0f;
@@ -18,6 +21,20 @@ Pass::Pass(const std::string &name)
     this->setViewport(defaultViewport, glm::mat4(1.0f), glm::mat4(1.0f));
 }
 
+void Pass::setTargets(std::initializer_list<ID3D11RenderTargetView *> colorTargets, ID3D11DepthStencilView *depthStencilTarget)
+{
+    this->colorTargets = this->allocator->copy(colorTargets);
+    this->colorTargetCount = (int)colorTargets.size();
+    this->depthStencilTarget = depthStencilTarget;
+}
+
+void Pass::setRenderTargets(std::initializer_list<RenderTarget *> colorTargets, ID3D11DepthStencilView *depthStencilTarget)
+{
+    this->colorRenderTargets = this->allocator->copy(colorTargets);
+    this->colorTargetCount = (int)colorTargets.size();
+    this->depthStencilTarget = depthStencilTarget;
+}
+
 void Pass::setViewport(D3D11_VIEWPORT viewport, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix)
 {
 	assert(viewport.Width > 0.0f);
@@ -50,19 +67,26 @@ void Pass::setViewport(float width, float height, const glm::mat4 &viewMatrix, c
 	this->setViewport(viewport, viewMatrix, projectionMatrix);
 }
 
-Batch *Pass::addBatch(const std::string &name)
+Batch *Pass::addBatch(const char *name)
 {
-    Batch *batch = new Batch(name);
-    this->batches.push_back(batch);
+    Batch *batch = this->allocator->create<Batch>(name, this->allocator);
+
+    if (this->lastBatch)
+        this->lastBatch->next = batch;
+    else
+        this->firstBatch = batch;
+    this->lastBatch = batch;
+
     return batch;
 }
 
-void Pass::execute(ID3D11DeviceContext *context, ID3D11Buffer *passConstantBuffer, ID3DUserDefinedAnnotation *annotation)
+void Pass::execute(StateCache *stateCache, ID3D11Buffer *passConstantBuffer, ID3DUserDefinedAnnotation *annotation)
 {
-    GPUProfiler::ScopedProfile profile(this->name);
+    ID3D11DeviceContext *context = stateCache->getContext();
+
+    GPUProfiler::ScopedProfile profile(this->name, context);
 
-	std::wstring nameWide(name.begin(), name.end());
-	annotation->BeginEvent(nameWide.c_str());
+	annotation->BeginEvent(this->wideName);
 
     // upload pass constants to GPU
     D3D11_MAPPED_SUBRESOURCE mappedResource;
@@ -71,20 +95,21 @@ void Pass::execute(ID3D11DeviceContext *context, ID3D11Buffer *passConstantBuffe
     memcpy(mappedResource.pData, &this->passConstants, sizeof(PassConstants));
     context->Unmap(passConstantBuffer, 0);
 
-    context->RSSetViewports(1, &this->viewport);
+    stateCache->setViewport(this->viewport);
 
-    if ((this->colorTargets.size() > 0) || (this->depthStencilTarget != nullptr))
-        context->OMSetRenderTargets((UINT)this->colorTargets.size(), this->colorTargets.data(), this->depthStencilTarget);
-
-    // render batches
-    for (auto *batch : this->batches)
+    // targets stay bound until the end of the command list of the pass
+    if ((this->colorTargetCount > 0) || (this->depthStencilTarget != nullptr))
     {
-        batch->execute(context);
-        delete batch;
+        ID3D11RenderTargetView *colorTargets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+        for (int i = 0; i < this->colorTargetCount; i++)
+            colorTargets[i] = this->colorRenderTargets ? this->colorRenderTargets[i]->getTarget() : this->colorTargets[i];
+
+        stateCache->setRenderTargets(this->colorTargetCount, colorTargets, this->depthStencilTarget);
     }
 
-    if ((this->colorTargets.size() > 0) || (this->depthStencilTarget != nullptr))
-        context->OMSetRenderTargets(0, nullptr, nullptr);
+    // render batches; their memory is released along with the frame
+    for (Batch *batch = this->firstBatch; batch != nullptr; batch = batch->next)
+        batch->execute(stateCache);
 
 	annotation->EndEvent();
 }
@@ -1,7 +1,6 @@
 #pragma once
 
-#include <string>
-#include <vector>
+#include <initializer_list>
 
 #include <windows.h>
 #include <d3d11_1.h>
@@ -9,6 +8,9 @@
 #include <engine/render/shaders/constants/PassConstants.h>
 
 class Batch;
+class FrameAllocator;
+class RenderTarget;
+class StateCache;
 
 /**
  * A pass contains all the batches for a given render target and viewport.
@@ -16,30 +18,39 @@ class Batch;
 class Pass
 {
     public:
-        Pass(const std::string &name);
+        Pass(const char *name, const wchar_t *wideName, FrameAllocator *allocator);
 
-        void setTargets(const std::vector<ID3D11RenderTargetView *> &colorTargets, ID3D11DepthStencilView *depthStencilTarget)
-        {
-            this->colorTargets = colorTargets;
-            this->depthStencilTarget = depthStencilTarget;
-        }
+        void setTargets(std::initializer_list<ID3D11RenderTargetView *> colorTargets, ID3D11DepthStencilView *depthStencilTarget);
+
+        // views are resolved at execution, so the targets can be transient
+        void setRenderTargets(std::initializer_list<RenderTarget *> colorTargets, ID3D11DepthStencilView *depthStencilTarget);
 
         void setViewport(D3D11_VIEWPORT viewport, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix);
 		void setViewport(float width, float height, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix);
 
-        Batch *addBatch(const std::string &name);
+        // name is not copied, it must outlive the frame (use literals)
+        Batch *addBatch(const char *name);
 
-        void execute(ID3D11DeviceContext *context, ID3D11Buffer *passConstantBuffer, ID3DUserDefinedAnnotation *annotation);
+        void execute(StateCache *stateCache, ID3D11Buffer *passConstantBuffer, ID3DUserDefinedAnnotation *annotation);
 
     private:
-        std::string name;
+        friend class FrameGraph;
+
+        // all the data below is allocated from the frame memory
+        FrameAllocator *allocator;
+
+        const char *name;
+        const wchar_t *wideName;
 
-        std::vector<ID3D11RenderTargetView *> colorTargets;
+        ID3D11RenderTargetView **colorTargets = nullptr;
+        RenderTarget **colorRenderTargets = nullptr; // used instead of the views when set
+        int colorTargetCount = 0;
         ID3D11DepthStencilView *depthStencilTarget = nullptr;
 
         D3D11_VIEWPORT viewport;
 
         PassConstants passConstants;
 
-        std::vector<Batch *> batches;
+        Batch *firstBatch = nullptr;
+        Batch *lastBatch = nullptr;
 };
@@ -0,0 +1,140 @@
+#include <engine/render/graph/ResourcePlanner.h>
+
+#include <cassert>
+
+void ResourcePlanner::clear()
+{
+    this->resources.clear();
+    this->passes.clear();
+    this->uses.clear();
+    this->storages.clear();
+
+    this->requestedSize = 0;
+    this->allocatedSize = 0;
+}
+
+int ResourcePlanner::addResource(const ResourceDesc &desc)
+{
+    Resource resource;
+    resource.desc = desc;
+    resource.firstPass = -1;
+    resource.lastPass = -1;
+    resource.storage = -1;
+
+    this->resources.push_back(resource);
+    return (int)this->resources.size() - 1;
+}
+
+int ResourcePlanner::addPass(bool sideEffects)
+{
+    Pass pass;
+    pass.sideEffects = sideEffects;
+    pass.culled = false;
+    pass.firstUse = (int)this->uses.size();
+    pass.useCount = 0;
+
+    this->passes.push_back(pass);
+    return (int)this->passes.size() - 1;
+}
+
+void ResourcePlanner::addRead(int pass, int resource)
+{
+    this->addUse(pass, resource, false);
+}
+
+void ResourcePlanner::addWrite(int pass, int resource)
+{
+    this->addUse(pass, resource, true);
+}
+
+void ResourcePlanner::addUse(int pass, int resource, bool write)
+{
+    // the uses of a pass are contiguous
+    assert(pass == (int)this->passes.size() - 1);
+    assert(resource < (int)this->resources.size());
+
+    Use use;
+    use.resource = resource;
+    use.write = write;
+    this->uses.push_back(use);
+
+    this->passes[pass].useCount++;
+}
+
+void ResourcePlanner::compile()
+{
+    // cull from the end of the frame: a pass is needed when it has side effects, or
+    // when it writes a resource read by a needed pass executed later
+    this->neededResources.assign(this->resources.size(), false);
+    for (int i = (int)this->passes.size() - 1; i >= 0; i--)
+    {
+        Pass &pass = this->passes[i];
+
+        bool needed = pass.sideEffects;
+        for (int j = pass.firstUse; j < pass.firstUse + pass.useCount; j++)
+            needed = needed || (this->uses[j].write && this->neededResources[this->uses[j].resource]);
+
+        pass.culled = !needed;
+        if (pass.culled)
+            continue;
+
+        // writes are not assumed to cover the whole resource, so earlier writers stay needed
+        for (int j = pass.firstUse; j < pass.firstUse + pass.useCount; j++)
+        {
+            if (!this->uses[j].write)
+                this->neededResources[this->uses[j].resource] = true;
+        }
+    }
+
+    // lifetimes, from the first to the last remaining pass using the resource
+    for (int i = 0; i < (int)this->passes.size(); i++)
+    {
+        const Pass &pass = this->passes[i];
+        if (pass.culled)
+            continue;
+
+        for (int j = pass.firstUse; j < pass.firstUse + pass.useCount; j++)
+        {
+            Resource &resource = this->resources[this->uses[j].resource];
+            if (resource.firstPass < 0)
+                resource.firstPass = i;
+            resource.lastPass = i;
+        }
+    }
+
+    // assign storage in execution order; it is released after the last use of its resource,
+    // and can be reused from the next pass by any resource with the same description
+    this->freeStorages.clear();
+    for (int i = 0; i < (int)this->passes.size(); i++)
+    {
+        for (auto &resource : this->resources)
+        {
+            if (resource.firstPass != i)
+                continue;
+
+            auto it = this->freeStorages.begin();
+            while ((it != this->freeStorages.end()) && !(this->storages[*it] == resource.desc))
+                ++it;
+
+            if (it != this->freeStorages.end())
+            {
+                resource.storage = *it;
+                this->freeStorages.erase(it);
+            }
+            else
+            {
+                resource.storage = (int)this->storages.size();
+                this->storages.push_back(resource.desc);
+                this->allocatedSize += resource.desc.size;
+            }
+
+            this->requestedSize += resource.desc.size;
+        }
+
+        for (auto &resource : this->resources)
+        {
+            if (resource.lastPass == i)
+                this->freeStorages.push_back(resource.storage);
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Plans the memory of the transient resources of a frame; only CPU logic, it knows nothing about the device.
+ * Passes are given in execution order with the resources they read and write. Passes that nobody
+ * consumes are culled, and resources whose lifetimes don't overlap share the same storage.
+ * All the arrays are kept from frame to frame, planning doesn't allocate once they are large enough.
+ */
+class ResourcePlanner
+{
+    public:
+        // resources can only share storage when their descriptions are equal
+        struct ResourceDesc
+        {
+            int width;
+            int height;
+            int format;
+            size_t size; // in bytes
+
+            bool operator==(const ResourceDesc &other) const { return (this->width == other.width) && (this->height == other.height) && (this->format == other.format); }
+        };
+
+        void clear();
+
+        int addResource(const ResourceDesc &desc);
+
+        // passes with side effects (writing to a non-transient resource) are never culled;
+        // reads and writes are given for the last added pass
+        int addPass(bool sideEffects);
+        void addRead(int pass, int resource);
+        void addWrite(int pass, int resource);
+
+        void compile();
+
+        bool isPassCulled(int pass) const { return this->passes[pass].culled; }
+
+        // -1 when the resource is not used by any remaining pass
+        int getResourceStorage(int resource) const { return this->resources[resource].storage; }
+
+        int getStorageCount() const { return (int)this->storages.size(); }
+        const ResourceDesc &getStorageDesc(int storage) const { return this->storages[storage]; }
+
+        // memory of all the used resources, versus the memory actually needed after aliasing
+        size_t getRequestedSize() const { return this->requestedSize; }
+        size_t getAllocatedSize() const { return this->allocatedSize; }
+
+    private:
+        struct Resource
+        {
+            ResourceDesc desc;
+            int firstPass;
+            int lastPass;
+            int storage;
+        };
+
+        struct Use
+        {
+            int resource;
+            bool write;
+        };
+
+        struct Pass
+        {
+            bool sideEffects;
+            bool culled;
+            int firstUse; // range of the uses array
+            int useCount;
+        };
+
+        void addUse(int pass, int resource, bool write);
+
+        std::vector<Resource> resources;
+        std::vector<Pass> passes;
+        std::vector<Use> uses;
+        std::vector<ResourceDesc> storages;
+
+        // compile() scratch
+        std::vector<bool> neededResources;
+        std::vector<int> freeStorages;
+
+        size_t requestedSize = 0;
+        size_t allocatedSize = 0;
+};
@@ -0,0 +1,114 @@
+#include <engine/render/graph/RingBuffer.h>
+
+#include <cassert>
+
+#include <engine/render/Device.h>
+#include <engine/render/graph/GPUProfiler.h>
+
+RingBuffer::RingBuffer(int chunkSize, UINT bindFlags, int alignment, const char *uploadCounterName, const char *mapCounterName)
+    : chunkSize(chunkSize), bindFlags(bindFlags), alignment(alignment), uploadCounterName(uploadCounterName), mapCounterName(mapCounterName)
+{
+    this->createChunk(0);
+}
+
+RingBuffer::~RingBuffer()
+{
+    this->unmap();
+
+    for (auto &chunk : this->chunks)
+        chunk.buffer->Release();
+}
+
+RingBuffer::Region RingBuffer::allocate(int size)
+{
+    assert(size <= this->chunkSize);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->currentOffset = (this->currentOffset + this->alignment - 1) / this->alignment * this->alignment;
+    if (this->currentOffset + size > this->chunkSize)
+    {
+        this->currentChunk = (this->currentChunk + 1) % (int)this->chunks.size();
+        this->currentOffset = 0;
+
+        // the ring is full with this frame's data, grow it right after the last used chunk
+        if (this->currentChunk == this->frameFirstChunk)
+        {
+            this->createChunk(this->currentChunk);
+            this->frameFirstChunk++;
+        }
+    }
+
+    if (this->frameFirstChunk < 0)
+        this->frameFirstChunk = this->currentChunk;
+
+    Chunk &chunk = this->chunks[this->currentChunk];
+    if (chunk.mappedData == nullptr)
+    {
+        // the beginning of the chunk may still be in use by the GPU when resuming in the middle of it
+        D3D11_MAP mapType = (this->currentOffset == 0) ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+
+        D3D11_MAPPED_SUBRESOURCE mappedResource;
+        HRESULT res = Device::context->Map(chunk.buffer, 0, mapType, 0, &mappedResource);
+        CHECK_HRESULT(res);
+
+        chunk.mappedData = (unsigned char *)mappedResource.pData;
+        this->frameMapCount++;
+    }
+
+    Region region;
+    region.buffer = chunk.buffer;
+    region.data = chunk.mappedData + this->currentOffset;
+    region.offset = this->currentOffset;
+    region.size = size;
+
+    this->currentOffset += size;
+    this->frameAllocatedSize += size;
+
+    return region;
+}
+
+void RingBuffer::unmap()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    for (auto &chunk : this->chunks)
+    {
+        if (chunk.mappedData != nullptr)
+        {
+            Device::context->Unmap(chunk.buffer, 0);
+            chunk.mappedData = nullptr;
+        }
+    }
+}
+
+void RingBuffer::nextFrame()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    GPUProfiler::getInstance()->addCounter(this->uploadCounterName, this->frameAllocatedSize);
+    GPUProfiler::getInstance()->addCounter(this->mapCounterName, this->frameMapCount);
+
+    this->frameFirstChunk = -1;
+    this->frameAllocatedSize = 0;
+    this->frameMapCount = 0;
+}
+
+void RingBuffer::createChunk(int index)
+{
+	D3D11_BUFFER_DESC bufferDesc;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = this->chunkSize;
+	bufferDesc.BindFlags = this->bindFlags;
+	bufferDesc.StructureByteStride = 0;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+    Chunk chunk;
+    chunk.mappedData = nullptr;
+
+	HRESULT res = Device::device->CreateBuffer(&bufferDesc, NULL, &chunk.buffer);
+	CHECK_HRESULT(res);
+
+    this->chunks.insert(this->chunks.begin() + index, chunk);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include <d3d11.h>
+
+/**
+ * Ring of dynamic buffer chunks receiving the per-frame data (instances, shader constants).
+ * Data is written directly into mapped memory: chunks are mapped with NO_OVERWRITE
+ * when a frame resumes where the previous one stopped, and with DISCARD when the
+ * ring wraps. A new chunk is inserted when a frame would overwrite its own data.
+ */
+class RingBuffer
+{
+    public:
+        // allocations start on multiples of the alignment; counter names are reported to the profiler
+        RingBuffer(int chunkSize, UINT bindFlags, int alignment, const char *uploadCounterName, const char *mapCounterName);
+        ~RingBuffer();
+
+        struct Region
+        {
+            ID3D11Buffer *buffer = nullptr;
+            unsigned char *data = nullptr; // mapped memory
+            int offset = 0; // in the buffer
+            int size = 0;
+        };
+
+        // thread-safe; but the context must not be used by other threads in the meantime
+        Region allocate(int size);
+
+        // regions are invalid after this call, and can be used for drawing
+        void unmap();
+
+        void nextFrame();
+
+        int getChunkSize() const { return this->chunkSize; }
+
+    private:
+        void createChunk(int index);
+
+        struct Chunk
+        {
+            ID3D11Buffer *buffer;
+            unsigned char *mappedData;
+        };
+
+        int chunkSize;
+        UINT bindFlags;
+        int alignment;
+        std::vector<Chunk> chunks;
+
+        int currentChunk = 0;
+        int currentOffset = 0;
+        int frameFirstChunk = -1; // where the current frame started, -1 if nothing was allocated yet
+        int frameAllocatedSize = 0;
+        int frameMapCount = 0;
+
+        const char *uploadCounterName;
+        const char *mapCounterName;
+
+        std::mutex mutex;
+};
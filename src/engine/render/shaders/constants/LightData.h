@@ -0,0 +1,36 @@
+#ifdef __cplusplus
+#pragma once
+#endif
+
+#include "ShaderTypes.h"
+
+// pixel shader slots of the light buffers (see lights.h)
+#define LIGHT_BUFFER_SLOT 17
+#define LIGHT_CLUSTER_BUFFER_SLOT 18
+#define LIGHT_INDEX_BUFFER_SLOT 19
+
+// froxel grid of the camera: screen tiles, and exponential slices in view depth
+#define LIGHT_CLUSTER_COUNT_X 16
+#define LIGHT_CLUSTER_COUNT_Y 9
+#define LIGHT_CLUSTER_COUNT_Z 24
+
+// point lights use a constant angle falloff (cosAngleScale = 0, cosAngleOffset = 1)
+struct LightData
+{
+	float3 position;
+	float radius;
+	float3 color;
+	float cosAngleScale;
+	float3 direction;
+	float cosAngleOffset;
+	float scattering;
+	int shadowIndex; // -1 when the light has no shadow map
+	float _padding0;
+	float _padding1;
+};
+
+struct LightClusterData
+{
+	uint lightOffset; // in the light index buffer
+	uint lightCount;
+};
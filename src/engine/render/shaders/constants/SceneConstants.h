@@ -3,30 +3,7 @@
 #endif
 
 #include "ShaderTypes.h"
-
-#define MAX_LIGHT 8
-
-struct PointLightData
-{
-	float3 position;
-	float radius;
-	float3 color;
-	float _padding;
-};
-
-struct SpotLightData
-{
-	float3 position;
-	float radius;
-	float3 color;
-	float cosAngleScale;
-	float3 direction;
-	float cosAngleOffset;
-	float scattering;
-	float _padding0;
-	float _padding1;
-	float _padding2;
-};
+#include "ShadowConstants.h"
 
 struct SceneConstants
 {
@@ -34,12 +11,14 @@ struct SceneConstants
 	float motionSpeedFactor; // shutter speed / delta time
 	float motionBlurTileSize; // in pixels
     float mist;
-    int pointLightCount;
-	int spotLightCount;
-	PointLightData pointLights[MAX_LIGHT];
-	SpotLightData spotLights[MAX_LIGHT];
+    int lightCount;
+	int scatteringLightCount; // scattering lights are first in the light buffer
 	float focusDistance;
 	float environmentMipLevels;
-	float _padding1;
-	float _padding2;
+	float lightClusterDepthScale; // slice = log(depth) * scale + bias
+	float lightClusterDepthBias;
+	float4x4 previousFrameViewProjectionMatrix;
+
+	// shared by all materials, see ShadowRenderer
+	ShadowConstants shadows;
 };
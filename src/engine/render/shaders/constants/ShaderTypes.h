@@ -5,9 +5,11 @@
 #include <glm/glm.hpp>
 
 // remap HLSL types to glm types
+using uint = unsigned int;
 using float2 = glm::vec2;
 using float3 = glm::vec3;
 using float4 = glm::vec4;
 using float4x4 = glm::mat4;
+using float4x3 = glm::mat3x4; // HLSL is rows x columns, glm is columns x rows
 
 #endif // __cplusplus
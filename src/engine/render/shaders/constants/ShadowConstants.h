@@ -0,0 +1,11 @@
+#ifdef __cplusplus
+#pragma once
+#endif
+
+#include "ShaderTypes.h"
+
+struct ShadowConstants
+{
+	float4x4 lightMatrix[16];
+	float4 atlasRects[16]; // scale (xy) and offset (zw) of the tiles in the shadow map atlas
+};
@@ -4,11 +4,6 @@
 
 #include "ShaderTypes.h"
 
-struct ShadowConstants
-{
-	float4x4 lightMatrix[16];
-};
-
 struct StandardConstants
 {
     float3 baseColorMultiplier;
@@ -19,5 +14,13 @@ struct StandardConstants
     float2 uvScale;
     float2 uvOffset;
 
-	ShadowConstants shadows;
+    // placement of the maps in their texture arrays (see TextureArrays), xy: offset, zw: scale
+    float4 baseColorRect;
+    float4 normalRect;
+    float4 metallicRect;
+    float4 roughnessRect;
+
+    // base color, normal, metallic and roughness
+    float4 mapSlices;
+    float4 mapInsets;
 };
@@ -0,0 +1,15 @@
+#ifdef __cplusplus
+#pragma once
+#endif
+
+#include "ShaderTypes.h"
+
+// vertex shader slot of the per-frame transform buffer (see transforms.h)
+#define TRANSFORM_BUFFER_SLOT 16
+
+struct TransformData
+{
+	float4x4 modelMatrix;
+	float4x4 worldToPreviousFrameWorldMatrix;
+	float4x3 normalMatrix; // only the upper 3x3 part is used
+};
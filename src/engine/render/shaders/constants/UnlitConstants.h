@@ -11,4 +11,11 @@ struct UnlitConstants
 
     float2 uvScale;
     float2 uvOffset;
+
+    // placement of the map in its texture array (see TextureArrays), xy: offset, zw: scale
+    float4 emissiveRect;
+    float emissiveSlice;
+    float emissiveInset;
+    float _padding0;
+    float _padding1;
 };
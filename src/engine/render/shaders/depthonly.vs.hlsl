@@ -1,20 +1,21 @@
 #include "depthonly.h"
 #include "pass.h"
+#include "transforms.h"
 
 struct VS_INPUT
 {
     float3 pos: POSITION;
-    float3 normal: NORMAL;
+    float2 normal: NORMAL;
     float4 tangent: TANGENT;
     float2 uv: TEXCOORD;
-	float4x4 transformMatrix: TRANSFORM;
+	uint transformIndex: TRANSFORMINDEX;
 };
 
 DEPTHONLY_PS_INPUT main(VS_INPUT input)
 {
     DEPTHONLY_PS_INPUT output;
 
-    float4 worldPosition = mul(input.transformMatrix, float4(input.pos, 1.0));
+    float4 worldPosition = mul(transforms[input.transformIndex].modelMatrix, float4(input.pos, 1.0));
     float4 viewPosition = mul(passConstants.viewMatrix, worldPosition);
     output.position = mul(passConstants.projectionMatrix, viewPosition);
 
@@ -0,0 +1,7 @@
+#include "constants/LightData.h"
+
+// lights of the frame, and their assignment to the froxels of the camera;
+// registers must match the LIGHT_*_SLOT values
+StructuredBuffer<LightData> lights : register(t17);
+StructuredBuffer<LightClusterData> lightClusters : register(t18);
+StructuredBuffer<uint> lightIndices : register(t19);
@@ -0,0 +1,16 @@
+// maps are slices of texture arrays, or cells of atlas slices repeating within their rectangle;
+// gradients come from the continuous coordinates, so that mips are not disturbed at the cell borders
+float4 sampleMaterialMap(Texture2DArray<float4> map, SamplerState mapSampler, float4 rect, float slice, float inset, float2 uv)
+{
+    float2 gradientX = ddx(uv) * rect.zw;
+    float2 gradientY = ddy(uv) * rect.zw;
+
+    // the inset is half a texel of the top mip, and texels double with each mip: scale it to the
+    // coarser mip blended by trilinear filtering, without going past the cell center
+    float texelSize = 2.0 * inset;
+    float lod = log2(max(max(length(gradientX), length(gradientY)) / max(texelSize, 1e-8), 1.0));
+    float2 mipInset = min(inset * exp2(ceil(lod)), 0.5 * rect.zw);
+
+    float2 cellUv = clamp(rect.xy + frac(uv) * rect.zw, rect.xy + mipInset, rect.xy + rect.zw - mipInset);
+    return map.SampleGrad(mapSampler, float3(cellUv, slice), gradientX, gradientY);
+}
@@ -3,7 +3,7 @@
 struct VS_INPUT
 {
 	float3 pos: POSITION;
-    float3 normal: NORMAL;
+    float2 normal: NORMAL;
     float4 tangent: TANGENT;
     float2 uv: TEXCOORD;
 };
@@ -5,16 +5,16 @@ cbuffer StandardConstants : register(b2)
     StandardConstants standardConstants;
 };
 
-Texture2D<float4> baseColorMap: register(t0);
+Texture2DArray<float4> baseColorMap: register(t0);
 SamplerState baseColorSampler: register(s0);
 
-Texture2D<float4> normalMap: register(t1);
+Texture2DArray<float4> normalMap: register(t1);
 SamplerState normalSampler: register(s1);
 
-Texture2D<float4> metallicMap: register(t2);
+Texture2DArray<float4> metallicMap: register(t2);
 SamplerState metallicSampler: register(s2);
 
-Texture2D<float4> roughnessMap: register(t3);
+Texture2DArray<float4> roughnessMap: register(t3);
 SamplerState roughnessSampler : register(s3);
 
 Texture2D shadowMap: register(t4);
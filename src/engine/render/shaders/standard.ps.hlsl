@@ -1,4 +1,6 @@
 #include "equirectangular.h"
+#include "lights.h"
+#include "materialmaps.h"
 #include "pass.h"
 #include "scene.h"
 #include "shadows.h"
@@ -67,12 +69,12 @@ float computeLightFalloff(float distance, float radius)
 
 float sampleShadowMap(int index, float3 worldPosition)
 {
-    float4 shadowCoords = mul(standardConstants.shadows.lightMatrix[index], float4(worldPosition, 1.0));
+    float4 shadowCoords = mul(sceneConstants.shadows.lightMatrix[index], float4(worldPosition, 1.0));
     shadowCoords.z = (shadowCoords.z + shadowCoords.w) * 0.5; // hack; GL to DX clip space
     shadowCoords /= shadowCoords.w;
 	shadowCoords.xy = shadowCoords.xy * 0.5 + 0.5;
 	shadowCoords.y = 1.0 - shadowCoords.y;
-	shadowCoords.xy = shadowCoords.xy * 0.5 + 0.5 * float2(index % 2.0, floor(float(index) / 2.0));
+	shadowCoords.xy = shadowCoords.xy * sceneConstants.shadows.atlasRects[index].xy + sceneConstants.shadows.atlasRects[index].zw;
 
     float bias = 0.00005;
     float shadowFactor = (shadowMap.SampleLevel(shadowMapSampler, shadowCoords.xy, 0).r >= shadowCoords.z - bias);
@@ -114,12 +116,12 @@ STANDARD_PS_OUTPUT main(STANDARD_PS_INPUT input)
     float3x3 TBN = float3x3(tangent, bitangent, normal);
 
     // compute normal after normal map perturbation, in world space
-    float3 tangentNormal = normalize(normalMap.Sample(normalSampler, input.uv).rgb * 2.0 - 1.0);
+    float3 tangentNormal = normalize(sampleMaterialMap(normalMap, normalSampler, standardConstants.normalRect, standardConstants.mapSlices.y, standardConstants.mapInsets.y, input.uv).rgb * 2.0 - 1.0);
     float3 perturbedNormal = mul(tangentNormal, TBN);
 
-    float3 baseColor = standardConstants.baseColorMultiplier * baseColorMap.Sample(baseColorSampler, input.uv).rgb;
-    float metallic = saturate(standardConstants.metallicOffset + metallicMap.Sample(metallicSampler, input.uv).r);
-    float roughness = saturate(standardConstants.roughnessOffset + roughnessMap.Sample(roughnessSampler, input.uv).r);
+    float3 baseColor = standardConstants.baseColorMultiplier * sampleMaterialMap(baseColorMap, baseColorSampler, standardConstants.baseColorRect, standardConstants.mapSlices.x, standardConstants.mapInsets.x, input.uv).rgb;
+    float metallic = saturate(standardConstants.metallicOffset + sampleMaterialMap(metallicMap, metallicSampler, standardConstants.metallicRect, standardConstants.mapSlices.z, standardConstants.mapInsets.z, input.uv).r);
+    float roughness = saturate(standardConstants.roughnessOffset + sampleMaterialMap(roughnessMap, roughnessSampler, standardConstants.roughnessRect, standardConstants.mapSlices.w, standardConstants.mapInsets.w, input.uv).r);
 
     // blend between dielectric and metal
     float3 albedo = baseColor * (1.0 - metallic);
@@ -136,59 +138,59 @@ STANDARD_PS_OUTPUT main(STANDARD_PS_INPUT input)
     radiance += computeEnvironmentIrradiance(surface) * surface.albedo;
     radiance += computeEnvironmentRadiance(surface, eye) * surface.specularColor;
 
-    // point lights
-    for (int i = 0; i < sceneConstants.pointLightCount; i++)
+    // lights of the froxel containing the pixel
+    float viewDepth = -input.viewPosition.z;
+    uint3 clusterCoords;
+    clusterCoords.xy = min(uint2(input.position.xy * passConstants.viewportSize.zw * float2(LIGHT_CLUSTER_COUNT_X, LIGHT_CLUSTER_COUNT_Y)), uint2(LIGHT_CLUSTER_COUNT_X - 1, LIGHT_CLUSTER_COUNT_Y - 1));
+    clusterCoords.z = (uint)clamp(log(max(viewDepth, 0.0001)) * sceneConstants.lightClusterDepthScale + sceneConstants.lightClusterDepthBias, 0.0, LIGHT_CLUSTER_COUNT_Z - 1.0);
+    LightClusterData cluster = lightClusters[(clusterCoords.z * LIGHT_CLUSTER_COUNT_Y + clusterCoords.y) * LIGHT_CLUSTER_COUNT_X + clusterCoords.x];
+
+    for (uint i = 0; i < cluster.lightCount; i++)
     {
-        float3 lightVector = sceneConstants.pointLights[i].position - input.worldPosition;
+        LightData lightData = lights[lightIndices[cluster.lightOffset + i]];
+
+        float3 lightVector = lightData.position - input.worldPosition;
         float lightDistance = length(lightVector);
 
+        float shadowFactor = (lightData.shadowIndex >= 0) ? sampleShadowMap(lightData.shadowIndex, input.worldPosition) : 1.0;
+
         LightProperties light;
         light.direction = lightVector / lightDistance;
-        light.incomingRadiance = sceneConstants.pointLights[i].color * computeLightFalloff(lightDistance, sceneConstants.pointLights[i].radius);
+        light.incomingRadiance = lightData.color * computeLightFalloff(lightDistance, lightData.radius) * shadowFactor;
+
+        // angle falloff (scale and offset are precomputed on CPU according to the inner and outer angles)
+        float angleFalloff = saturate(dot(-light.direction, lightData.direction) * lightData.cosAngleScale + lightData.cosAngleOffset);
+        angleFalloff *= angleFalloff; // more natural square attenuation
+        light.incomingRadiance *= angleFalloff;
 
         radiance += computeShading(surface, light, eye);
     }
 
 	float jitter = rand(input.uv);
 
-	// spot lights
+	// in-scattering of the spot lights along the view ray, which goes through many froxels
     float3 inScattering = float3(0.0, 0.0, 0.0);
     float stepLength = length(input.marchingStep);
-    for (int j = 0; j < sceneConstants.spotLightCount; j++)
+    for (int j = 0; j < sceneConstants.scatteringLightCount; j++)
     {
-        float3 lightVector = sceneConstants.spotLights[j].position - input.worldPosition;
-        float lightDistance = length(lightVector);
-
-        float shadowFactor = sampleShadowMap(j, input.worldPosition);
-
-        LightProperties light;
-        light.direction = lightVector / lightDistance;
-        light.incomingRadiance = sceneConstants.spotLights[j].color * computeLightFalloff(lightDistance, sceneConstants.spotLights[j].radius) * shadowFactor;
-
-        // angle falloff (scale and offset are precomputed on CPU according to the inner and outer angles)
-        float angleFalloff = saturate(dot(-light.direction, sceneConstants.spotLights[j].direction) * sceneConstants.spotLights[j].cosAngleScale + sceneConstants.spotLights[j].cosAngleOffset);
-        angleFalloff *= angleFalloff; // more natural square attenuation
-        light.incomingRadiance *= angleFalloff;
-
-        radiance += computeShading(surface, light, eye);
+        LightData lightData = lights[j];
 
-        if (sceneConstants.spotLights[j].scattering == 0.0)
-            continue;
+        float lightDistance = length(lightData.position - input.worldPosition);
 
 		float3 samplePosition = passConstants.cameraPosition + input.marchingStep * jitter;
         float3 sampledScattering = float3(0.0, 0.0, 0.0);
         for (int k = 0; k < MARCHING_ITERATIONS; k++)
         {
-            float3 lightVector2 = sceneConstants.spotLights[j].position - samplePosition;
+            float3 lightVector2 = lightData.position - samplePosition;
             float lightDistance2 = length(lightVector2);
             float opticalDepth = distance(passConstants.cameraPosition, samplePosition) + lightDistance2;
-            float angleFalloff2 = saturate(dot(-lightVector2 / lightDistance2, sceneConstants.spotLights[j].direction) * sceneConstants.spotLights[j].cosAngleScale + sceneConstants.spotLights[j].cosAngleOffset);
+            float angleFalloff2 = saturate(dot(-lightVector2 / lightDistance2, lightData.direction) * lightData.cosAngleScale + lightData.cosAngleOffset);
             angleFalloff2 *= angleFalloff2; // more natural square attenuation
 
 			if (angleFalloff2 > 0.01)
 			{
-				float shadowFactor2 = sampleShadowMap(j, samplePosition);
-				float3 radiance2 = sceneConstants.spotLights[j].color * computeLightFalloff(lightDistance, sceneConstants.spotLights[j].radius) * angleFalloff2 * shadowFactor2;
+				float shadowFactor2 = (lightData.shadowIndex >= 0) ? sampleShadowMap(lightData.shadowIndex, samplePosition) : 1.0;
+				float3 radiance2 = lightData.color * computeLightFalloff(lightDistance, lightData.radius) * angleFalloff2 * shadowFactor2;
 
 				//float density = exp(-samplePosition.z * 10.0);
 				sampledScattering += stepLength * radiance2 * exp(-opticalDepth * 0.01);
@@ -197,7 +199,7 @@ STANDARD_PS_OUTPUT main(STANDARD_PS_INPUT input)
             samplePosition += input.marchingStep;
         }
 
-        inScattering += sampledScattering * sceneConstants.spotLights[j].scattering;
+        inScattering += sampledScattering * lightData.scattering;
     }
 
     float transmittance = exp(input.viewPosition.z * sceneConstants.mist);
@@ -1,16 +1,16 @@
 #include "pass.h"
 #include "scene.h"
+#include "transforms.h"
 #include "standard.h"
+#include "vertex.h"
 
 struct VS_INPUT
 {
     float3 pos: POSITION;
-    float3 normal: NORMAL;
+    float2 normal: NORMAL;
     float4 tangent: TANGENT;
     float2 uv: TEXCOORD;
-	float4x4 modelMatrix: MODELMATRIX;
-	float4x4 worldToPreviousFrameClipSpaceMatrix: WORLDTOPREVIOUSFRAMECLIPSPACE;
-	float3x3 normalMatrix: NORMALMATRIX;
+	uint transformIndex: TRANSFORMINDEX;
 };
 
 STANDARD_PS_INPUT main(VS_INPUT input)
@@ -19,7 +19,9 @@ STANDARD_PS_INPUT main(VS_INPUT input)
 
     float2 uv = input.uv * standardConstants.uvScale + standardConstants.uvOffset;
 
-    float4 worldPosition = mul(input.modelMatrix, float4(input.pos, 1.0));
+    TransformData transform = transforms[input.transformIndex];
+
+    float4 worldPosition = mul(transform.modelMatrix, float4(input.pos, 1.0));
     float4 viewPosition = mul(passConstants.viewMatrix, worldPosition);
     output.position = mul(passConstants.projectionMatrix, viewPosition);
    
@@ -29,12 +31,14 @@ STANDARD_PS_INPUT main(VS_INPUT input)
     output.worldPosition = worldPosition.xyz;
     output.viewPosition = viewPosition.xyz;
     output.marchingStep = (output.worldPosition - passConstants.cameraPosition) / MARCHING_ITERATIONS;
-    output.normal = mul(input.normalMatrix, input.normal);
-    output.tangent = float4(mul(input.normalMatrix, input.tangent.xyz), input.tangent.w);
+    float3x3 normalMatrix = (float3x3)transform.normalMatrix;
+    float4 tangent = decodeVertexTangent(input.tangent);
+    output.normal = mul(normalMatrix, decodeVertexNormal(input.normal));
+    output.tangent = float4(mul(normalMatrix, tangent.xyz), tangent.w);
     output.uv = float2(uv.x, 1.0 - uv.y);
     output.clipPosition = output.position;
 
-	output.worldToPreviousFrameClipSpaceMatrix = input.worldToPreviousFrameClipSpaceMatrix;
+	output.worldToPreviousFrameClipSpaceMatrix = mul(sceneConstants.previousFrameViewProjectionMatrix, transform.worldToPreviousFrameWorldMatrix);
 
     return output;
 }
@@ -0,0 +1,5 @@
+#include "constants/TransformData.h"
+
+// object transforms of the current frame, shared by all passes and indexed
+// by the instance stream; register must match TRANSFORM_BUFFER_SLOT
+StructuredBuffer<TransformData> transforms : register(t16);
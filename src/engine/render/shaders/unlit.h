@@ -5,7 +5,7 @@ cbuffer UnlitConstants : register(b2)
     UnlitConstants unlitConstants;
 };
 
-Texture2D<float4> emissiveMap: register(t0);
+Texture2DArray<float4> emissiveMap: register(t0);
 SamplerState emissiveSampler: register(s0);
 
 struct UNLIT_PS_INPUT
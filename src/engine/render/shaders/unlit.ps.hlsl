@@ -1,4 +1,5 @@
 #include "equirectangular.h"
+#include "materialmaps.h"
 #include "pass.h"
 #include "scene.h"
 #include "unlit.h"
@@ -7,7 +8,7 @@ UNLIT_PS_OUTPUT main(UNLIT_PS_INPUT input)
 {
     UNLIT_PS_OUTPUT output;
 
-    float3 radiance = unlitConstants.emissive * emissiveMap.Sample(emissiveSampler, input.uv).rgb;
+    float3 radiance = unlitConstants.emissive * sampleMaterialMap(emissiveMap, emissiveSampler, unlitConstants.emissiveRect, unlitConstants.emissiveSlice, unlitConstants.emissiveInset, input.uv).rgb;
     output.radiance = float4(radiance, input.viewPosition.z);
 
     // estimate pixel movement from last frame
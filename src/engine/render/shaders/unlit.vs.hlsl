@@ -1,16 +1,15 @@
 #include "pass.h"
 #include "scene.h"
+#include "transforms.h"
 #include "unlit.h"
 
 struct VS_INPUT
 {
     float3 pos: POSITION;
-    float3 normal: NORMAL;
+    float2 normal: NORMAL;
     float4 tangent: TANGENT;
     float2 uv: TEXCOORD;
-	float4x4 modelMatrix: MODELMATRIX;
-	float4x4 worldToPreviousFrameClipSpaceMatrix: WORLDTOPREVIOUSFRAMECLIPSPACE;
-	float3x3 normalMatrix: NORMALMATRIX;
+	uint transformIndex: TRANSFORMINDEX;
 };
 
 UNLIT_PS_INPUT main(VS_INPUT input)
@@ -19,7 +18,9 @@ UNLIT_PS_INPUT main(VS_INPUT input)
 
     float2 uv = input.uv * unlitConstants.uvScale + unlitConstants.uvOffset;
 
-    float4 worldPosition = mul(input.modelMatrix, float4(input.pos, 1.0));
+    TransformData transform = transforms[input.transformIndex];
+
+    float4 worldPosition = mul(transform.modelMatrix, float4(input.pos, 1.0));
     float4 viewPosition = mul(passConstants.viewMatrix, worldPosition);
     output.position = mul(passConstants.projectionMatrix, viewPosition);
    
@@ -31,7 +32,7 @@ UNLIT_PS_INPUT main(VS_INPUT input)
     output.uv = float2(uv.x, 1.0 - uv.y);
     output.clipPosition = output.position;
 
-	output.worldToPreviousFrameClipSpaceMatrix = input.worldToPreviousFrameClipSpaceMatrix;
+	output.worldToPreviousFrameClipSpaceMatrix = mul(sceneConstants.previousFrameViewProjectionMatrix, transform.worldToPreviousFrameWorldMatrix);
 
     return output;
 }
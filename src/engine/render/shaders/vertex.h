@@ -0,0 +1,21 @@
+// packed mesh vertices, see VertexFormat.h
+
+float3 decodeOctahedral(float2 e)
+{
+    float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += (n.xy >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+// snorm octahedral normal
+float3 decodeVertexNormal(float2 normal)
+{
+    return decodeOctahedral(normal);
+}
+
+// unorm octahedral tangent, bitangent sign in alpha
+float4 decodeVertexTangent(float4 tangent)
+{
+    return float4(decodeOctahedral(tangent.xy * 2.0 - 1.0), tangent.w * 2.0 - 1.0);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+
+// stable integer handles for loaded objects, so that per-frame data can reference
+// them with 32-bit indices instead of pointers; freed slots are recycled
+template <typename ObjectType>
+class IndexRegistry
+{
+    public:
+        // add/remove are called at load time; lookups can be done from any thread in between
+        int add(ObjectType *object)
+        {
+            if (!this->freeIndices.empty())
+            {
+                int index = this->freeIndices.back();
+                this->freeIndices.pop_back();
+                this->objects[index] = object;
+                return index;
+            }
+
+            this->objects.push_back(object);
+            return (int)this->objects.size() - 1;
+        }
+
+        void remove(int index)
+        {
+            assert(this->objects[index] != nullptr);
+            this->objects[index] = nullptr;
+            this->freeIndices.push_back(index);
+        }
+
+        ObjectType *get(int index) const { return this->objects[index]; }
+
+        // indices are in [0, count), free ones return null
+        int getIndexCount() const { return (int)this->objects.size(); }
+
+    private:
+        std::vector<ObjectType *> objects;
+        std::vector<int> freeIndices;
+};
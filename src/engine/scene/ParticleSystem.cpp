@@ -1,10 +1,13 @@
 #include <engine/scene/ParticleSystem.h>
 
+#include <algorithm>
+
 #include <cJSON/cJSON.h>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/random.hpp>
 
+#include <engine/render/Material.h>
 #include <engine/render/Mesh.h>
 #include <engine/render/RenderList.h>
 #include <engine/scene/ParticleSettings.h>
@@ -37,25 +40,56 @@ void ParticleSystem::update(float time, const glm::mat4 &emitterTransform)
     this->stepSimulation(time - this->simulationTime, emitterTransform);
 }
 
-void ParticleSystem::fillRenderList(RenderList *renderList) const
+void ParticleSystem::writeTransforms(glm::mat4 *transforms) const
+{
+    for (const auto &particle : this->particles)
+        *transforms++ = glm::translate(glm::mat4(1.0f), particle.position) * glm::scale(glm::mat4(1.0f), glm::vec3(particle.size));
+}
+
+int ParticleSystem::getMaxJobCount() const
+{
+    return (int)this->settings->duplicate->getSubMeshes().size() * (int)this->particles.size();
+}
+
+void ParticleSystem::fillJobs(RenderList::JobChunk &chunk, int transformOffset, const LodSelector &lodSelector) const
 {
     Mesh *mesh = this->settings->duplicate;
 
-    for (auto &subMesh : mesh->getSubMeshes())
+    // textures are streamed for the largest particle
+    float screenSize = 0.0f;
+    for (int i = 0; i < (int)this->particles.size(); i++)
     {
-        RenderList::Job job;
-        job.subMesh = &subMesh;
-        job.material = subMesh.material;
+        if (this->particles[i].visible)
+        {
+            lodSelector.select(mesh, transformOffset + i, this->particleLods[i]);
+            screenSize = std::max(screenSize, 2.0f * lodSelector.computeScreenRadius(mesh, transformOffset + i));
+        }
+    }
+
+    for (int j = 0; j < (int)mesh->getSubMeshes().size(); j++)
+    {
+        const Mesh::SubMesh &fullSubMesh = mesh->getSubMeshes()[j];
+        if (screenSize > 0.0f)
+            fullSubMesh.material->requestScreenSize(screenSize);
 
-        for (const auto &particle : this->particles)
+        for (int i = 0; i < (int)this->particles.size(); i++)
         {
-            if (!particle.visible)
+            if (!this->particles[i].visible)
                 continue;
 
-            glm::mat4 transform = glm::translate(glm::mat4(1.0f), particle.position) * glm::scale(glm::mat4(1.0f), glm::vec3(particle.size));
-            job.transform = transform;
-            job.previousFrameTransform = transform;
-            renderList->addJob(job);
+            const Mesh::SubMesh &subMesh = mesh->getLodSubMesh(this->particleLods[i], j);
+            chunk.savedTriangleCount += (fullSubMesh.indexCount - subMesh.indexCount) / 3;
+            if (subMesh.index < 0)
+                continue;
+
+            RenderList::Job job;
+            job.sortKey = 0;
+            job.subMeshIndex = subMesh.index;
+            job.materialIndex = subMesh.material->getIndex();
+            job.transformIndex = transformOffset + i;
+            chunk.jobs[chunk.count++] = job;
+
+            chunk.triangleCount += subMesh.indexCount / 3;
         }
     }
 }
@@ -65,6 +99,7 @@ void ParticleSystem::createSimulation()
     this->simulationTime = 0.0f;
 
     this->particles.resize(this->settings->count);
+    this->particleLods.assign(this->settings->count, 0);
     for (int i = 0; i < this->settings->count; i++)
     {
         Particle &particle = this->particles[i];
@@ -89,6 +124,7 @@ void ParticleSystem::createSimulation()
 void ParticleSystem::destroySimulation()
 {
     this->particles.clear();
+    this->particleLods.clear();
 }
 
 void ParticleSystem::stepSimulation(float deltaTime, const glm::mat4 &emitterTransform)
@@ -1,15 +1,17 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include <glm/glm.hpp>
 
+#include <engine/render/RenderList.h>
+#include <engine/render/LodSelector.h>
 #include <engine/resource/ResourceWatcher.h>
 
 struct cJSON;
 class Mesh;
 struct ParticleSettings;
-class RenderList;
 
 class ParticleSystem: public ResourceWatcher
 {
@@ -23,8 +25,16 @@ class ParticleSystem: public ResourceWatcher
         // step simulation
         void update(float time, const glm::mat4 &emitterTransform);
 
-        // send active particles as render jobs
-        void fillRenderList(RenderList *renderList) const;
+        // one transform per particle, visible or not
+        int getParticleCount() const { return (int)this->particles.size(); }
+        void writeTransforms(glm::mat4 *transforms) const;
+
+        // upper bound of the job count written by fillJobs()
+        int getMaxJobCount() const;
+
+        // append active particles as render jobs to the chunk, each at its own level of detail; transforms
+        // are expected at transformOffset in the array filled with writeTransforms()
+        void fillJobs(RenderList::JobChunk &chunk, int transformOffset, const LodSelector &lodSelector) const;
 
     private:
         void createSimulation();
@@ -55,4 +65,8 @@ class ParticleSystem: public ResourceWatcher
             float size;
         };
         std::vector<Particle> particles;
+
+        // levels of detail selected by the last fillJobs(), by particle index; transform
+        // indices shift when other particle systems of the scene change
+        mutable std::vector<uint8_t> particleLods;
 };
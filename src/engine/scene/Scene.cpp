@@ -1,13 +1,24 @@
 #include <engine/scene/Scene.h>
 
 #include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 
 #include <engine/animation/AnimationData.h>
+#include <engine/render/ClusterCuller.h>
+#include <engine/render/Frustum.h>
+#include <engine/render/LodSelector.h>
+#include <engine/render/Material.h>
 #include <engine/render/Texture.h>
 #include <engine/render/RenderList.h>
+#include <engine/render/ShadowRenderer.h>
 #include <engine/resource/ResourceManager.h>
+#include <engine/scene/ParticleSystem.h>
+#include <engine/thread/TaskScheduler.h>
 
 #include <cJSON/cJSON.h>
+#include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 const std::string Scene::resourceClassName = "Scene";
@@ -15,6 +26,87 @@ const std::string Scene::defaultResourceData = "{\"activeCamera\": 0, \"nodes\":
 
 std::vector<Scene *> Scene::allScenes;
 
+// visibility baking parameters (in frames)
+static const float VISIBILITY_INTERVAL_LENGTH = 8.0f;
+static const int VISIBILITY_INTERVAL_SAMPLES = 32;
+
+// relative enlargement of the bounds when baking, to stay conservative between samples
+static const float VISIBILITY_BOUNDS_MARGIN = 0.1f;
+
+// FNV-1a, for the inputs of the baked visibility
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ ((const unsigned char *)data)[i]) * 1099511628211ull;
+
+    return hash;
+}
+
+static uint64_t hashJson(uint64_t hash, const cJSON *json)
+{
+    char *text = cJSON_PrintUnformatted(json);
+    hash = hashBytes(hash, text, strlen(text));
+    free(text);
+
+    return hash;
+}
+
+static glm::mat4 computeShadowTransform(const SceneNode *node, const Light *light)
+{
+    glm::mat4 viewMatrix = glm::inverse(node->computeViewTransform());
+    glm::mat4 projectionMatrix = glm::perspective(light->getSpotAngle(), 1.0f, 0.1f, light->getRadius());
+    return projectionMatrix * viewMatrix;
+}
+
+// node ranges processed by each worker task
+static const int MESH_NODE_GRAIN_SIZE = 64;
+static const int LIGHT_NODE_GRAIN_SIZE = 8;
+static const int STATIC_BATCH_GRAIN_SIZE = 64;
+
+static RenderList::DerivedTransform computeDerivedTransform(const glm::mat4 &transform, const glm::mat4 &previousFrameTransform)
+{
+    RenderList::DerivedTransform derivedTransform;
+    derivedTransform.worldToPreviousFrameWorld = previousFrameTransform * glm::affineInverse(transform);
+    derivedTransform.normalMatrix = glm::mat3x4(glm::inverseTranspose(glm::mat3(transform)));
+    return derivedTransform;
+}
+
+static void writeMeshJobs(RenderList::JobChunk &chunk, const SceneNode *node, int transformIndex, unsigned int visibility, int lod, RenderList *renderList, const ClusterCuller &clusterCuller, const LodSelector &lodSelector)
+{
+    Mesh *mesh = node->getData<Mesh>();
+
+    // textures are only sampled by the camera passes
+    float screenSize = ((visibility & 1u) != 0) ? 2.0f * lodSelector.computeScreenRadius(mesh, transformIndex) : 0.0f;
+
+    for (int i = 0; i < (int)mesh->getSubMeshes().size(); i++)
+    {
+        const Mesh::SubMesh &subMesh = mesh->getLodSubMesh(lod, i);
+        chunk.savedTriangleCount += (mesh->getSubMeshes()[i].indexCount - subMesh.indexCount) / 3;
+
+        // simplification may remove all triangles of a material
+        if (subMesh.index < 0)
+            continue;
+
+        RenderList::Job &job = chunk.jobs[chunk.count++];
+        job.sortKey = 0;
+        job.subMeshIndex = subMesh.index;
+        job.materialIndex = subMesh.material->getIndex();
+        job.transformIndex = transformIndex;
+        job.visibility = visibility;
+        job.clusterDraw = nullptr;
+
+        subMesh.material->requestScreenSize(screenSize);
+
+        // clusters only exist at full detail, and only matter to the camera passes
+        int culledTriangleCount = 0;
+        if ((lod == 0) && (subMesh.clusterCount > 0) && ((visibility & 1u) != 0))
+            job.clusterDraw = clusterCuller.cull(renderList, mesh, subMesh, transformIndex, culledTriangleCount);
+
+        chunk.triangleCount += subMesh.indexCount / 3 - culledTriangleCount;
+        chunk.clusterCulledTriangleCount += culledTriangleCount;
+    }
+}
+
 void Scene::load(const unsigned char *buffer, size_t size)
 {
     this->animation = nullptr;
@@ -24,6 +116,13 @@ void Scene::load(const unsigned char *buffer, size_t size)
     this->activeCamera = cJSON_GetObjectItem(json, "activeCamera")->valueint;
 
     cJSON *nodesJson = cJSON_GetObjectItem(json, "nodes");
+
+    // rest transforms, animations, hierarchy and data of the nodes, camera markers and range
+    this->layoutHash = hashJson(14695981039346656037ull, nodesJson);
+    this->layoutHash = hashJson(this->layoutHash, cJSON_GetObjectItem(json, "markers"));
+    this->layoutHash = hashJson(this->layoutHash, cJSON_GetObjectItem(json, "frame_start"));
+    this->layoutHash = hashJson(this->layoutHash, cJSON_GetObjectItem(json, "frame_end"));
+
     cJSON *nodeJson = nodesJson->child;
     while (nodeJson)
     {
@@ -87,6 +186,22 @@ void Scene::load(const unsigned char *buffer, size_t size)
     this->renderSettings.postProcess.scanlineFrequency = (float)cJSON_GetObjectItem(pixellateJson, "scanline_frequency")->valuedouble;
     this->renderSettings.postProcess.scanlineOffset = (float)cJSON_GetObjectItem(pixellateJson, "scanline_offset")->valuedouble;
 
+    cJSON *visibilityJson = cJSON_GetObjectItem(json, "visibility");
+    if (visibilityJson)
+        this->visibility.load(visibilityJson);
+    else
+        this->visibility.clear();
+
+    cJSON *staticBatchingJson = cJSON_GetObjectItem(json, "staticBatching");
+    if (staticBatchingJson)
+    {
+        // rest transforms; static nodes only depend on static parents, so this is their final transform
+        for (SceneNode *node : this->nodes)
+            node->updateTransforms();
+
+        this->staticGeometry.build(this->meshNodes, (float)cJSON_GetObjectItem(staticBatchingJson, "cellSize")->valuedouble);
+    }
+
     cJSON *animation = cJSON_GetObjectItem(json, "animation");
     if (animation)
     {
@@ -122,6 +237,8 @@ void Scene::unload()
 
     Scene::allScenes.erase(std::remove(Scene::allScenes.begin(), Scene::allScenes.end(), this), Scene::allScenes.end());
 
+    this->staticGeometry.clear();
+
     for (SceneNode *node : this->nodes)
     {
         node->unregisterAnimation(&this->animationPlayer);
@@ -133,12 +250,25 @@ void Scene::unload()
     this->cameraNodes.clear();
     this->meshNodes.clear();
     this->lightNodes.clear();
+    this->particleSystemNodes.clear();
+
+    this->visibility.clear();
+
+    for (TransformArrays &arrays : this->transformArrays)
+    {
+        arrays.transforms.clear();
+        arrays.derivedTransforms.clear();
+        arrays.changedTransforms.clear();
+    }
+    this->particleTransformOffsets.clear();
 
     ResourceManager::getInstance()->releaseResource(this->renderSettings.environment.environmentMap);
 }
 
 void Scene::update(float time)
 {
+    this->currentTime = time;
+
     this->animationPlayer.update(time);
     AnimationPlayer::globalPlayer.update(time);
 
@@ -151,11 +281,83 @@ void Scene::update(float time)
         node->updateTransforms();
     }
 
+    // meshes or lights may have been reloaded since the bake (live editing only)
+    this->bakedVisibilityValid = this->visibility.matches((int)this->meshNodes.size(), (int)this->lightNodes.size(), this->computeVisibilityHash());
+
     // step particle simulations
     for (SceneNode *node : this->particleSystemNodes)
     {
         node->updateParticles(time);
     }
+
+    this->updateTransformArrays();
+}
+
+void Scene::updateTransformArrays()
+{
+    // the other set is left to the render list of the previous update
+    const TransformArrays &previous = this->transformArrays[this->currentTransformArrays];
+    this->currentTransformArrays = 1 - this->currentTransformArrays;
+    TransformArrays &arrays = this->transformArrays[this->currentTransformArrays];
+
+    int staticTransformIndex = (int)this->meshNodes.size();
+    int transformCount = staticTransformIndex + 1;
+
+    this->particleTransformOffsets.resize(this->particleSystemNodes.size());
+    for (int i = 0; i < (int)this->particleSystemNodes.size(); i++)
+    {
+        this->particleTransformOffsets[i] = transformCount;
+        for (const ParticleSystem *particleSystem : this->particleSystemNodes[i]->getParticleSystems())
+            transformCount += particleSystem->getParticleCount();
+    }
+
+    // mesh nodes are at the beginning of the arrays, so their cached entries survive resizing;
+    // this set was last written two updates ago, so entries changed by the previous update
+    // are stale too
+    bool refreshAll = (arrays.derivedTransforms.size() <= this->meshNodes.size()) || (previous.changedTransforms.size() <= this->meshNodes.size());
+
+    arrays.transforms.resize(transformCount);
+    arrays.derivedTransforms.resize(transformCount);
+    arrays.changedTransforms.resize(transformCount);
+    this->transformLods.resize(transformCount);
+
+    // static geometry is already in world space
+    arrays.changedTransforms[staticTransformIndex] = refreshAll;
+    arrays.transforms[staticTransformIndex] = glm::mat4(1.0f);
+    arrays.derivedTransforms[staticTransformIndex] = computeDerivedTransform(glm::mat4(1.0f), glm::mat4(1.0f));
+
+    TaskScheduler::getInstance()->parallelFor((int)this->meshNodes.size(), MESH_NODE_GRAIN_SIZE, [&](int begin, int end, int chunkIndex)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            const SceneNode *node = this->meshNodes[i];
+            arrays.changedTransforms[i] = (refreshAll || node->hasTransformChanged());
+            if (!arrays.changedTransforms[i] && !previous.changedTransforms[i])
+                continue;
+
+            arrays.transforms[i] = node->getCurrentTransform();
+            arrays.derivedTransforms[i] = computeDerivedTransform(node->getCurrentTransform(), node->getPreviousFrameTransform());
+        }
+    });
+
+    TaskScheduler::getInstance()->parallelFor((int)this->particleSystemNodes.size(), 1, [&](int begin, int end, int chunkIndex)
+    {
+        int offset = this->particleTransformOffsets[begin];
+        for (const ParticleSystem *particleSystem : this->particleSystemNodes[begin]->getParticleSystems())
+        {
+            particleSystem->writeTransforms(&arrays.transforms[offset]);
+
+            // particles have no motion vectors
+            for (int i = offset; i < offset + particleSystem->getParticleCount(); i++)
+            {
+                arrays.changedTransforms[i] = 1;
+                arrays.derivedTransforms[i].worldToPreviousFrameWorld = glm::mat4(1.0f);
+                arrays.derivedTransforms[i].normalMatrix = glm::mat3x4(glm::inverseTranspose(glm::mat3(arrays.transforms[i])));
+            }
+
+            offset += particleSystem->getParticleCount();
+        }
+    });
 }
 
 const RenderSettings &Scene::updateRenderSettings(int width, int height, bool overrideCamera, const glm::mat4 &viewMatrixOverride, const glm::mat4 &projectionMatrixOverride)
@@ -169,44 +371,31 @@ const RenderSettings &Scene::updateRenderSettings(int width, int height, bool ov
 	return this->renderSettings;
 }
 
-void Scene::fillRenderList(RenderList *renderList) const
+void Scene::fillRenderList(RenderList *renderList, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix, bool useBakedVisibility) const
 {
-    for (const SceneNode *node : this->meshNodes)
-    {
-        if (!node->isHidden())
-        {
-            Mesh *mesh = node->getData<Mesh>();
+    glm::mat4 viewProjectionMatrix = projectionMatrix * viewMatrix;
 
-            for (auto &subMesh : mesh->getSubMeshes())
-            {
-                RenderList::Job job;
-                job.subMesh = &subMesh;
-                job.transform = node->getCurrentTransform();
-                job.previousFrameTransform = node->getPreviousFrameTransform();
-                job.material = subMesh.material;
+    TaskScheduler *scheduler = TaskScheduler::getInstance();
 
-                renderList->addJob(job);
-            }
-        }
-    }
+    const TransformArrays &arrays = this->transformArrays[this->currentTransformArrays];
+    assert(arrays.transforms.size() > this->meshNodes.size());
+    renderList->setTransforms(arrays.transforms.data(), arrays.derivedTransforms.data(), arrays.changedTransforms.data(), (int)arrays.transforms.size());
 
-    for (const SceneNode *node : this->particleSystemNodes)
+    // lights first, as job visibility references their shadow slots
+    std::vector<RenderList::Light> nodeLights(this->lightNodes.size());
+    scheduler->parallelFor((int)this->lightNodes.size(), LIGHT_NODE_GRAIN_SIZE, [&](int begin, int end, int chunkIndex)
     {
-        if (!node->isHidden())
+        for (int i = begin; i < end; i++)
         {
-            // append particles attached to this node
-            node->fillParticleRenderList(renderList);
-        }
-    }
+            const SceneNode *node = this->lightNodes[i];
+            if (node->isHidden())
+                continue;
 
-    for (const SceneNode *node: this->lightNodes)
-    {
-        if (!node->isHidden())
-        {
             Light *light = node->getData<Light>();
             glm::mat4 transform = node->getCurrentTransform();
 
-            RenderList::Light renderLight;
+            RenderList::Light &renderLight = nodeLights[i];
+            renderLight.id = (uint32_t)i;
             renderLight.position = glm::vec3(transform[3]);
             renderLight.radius = light->getRadius();
             renderLight.color = light->getColor();
@@ -219,15 +408,280 @@ void Scene::fillRenderList(RenderList *renderList) const
                 renderLight.angle = light->getSpotAngle();
                 renderLight.blend = light->getSpotBlend();
                 renderLight.scattering = light->getScattering();
+                renderLight.shadowTransform = computeShadowTransform(node, light);
+            }
+        }
+    });
 
-                glm::mat4 viewMatrix = glm::inverse(node->computeViewTransform());
-                glm::mat4 projectionMatrix = glm::perspective(light->getSpotAngle(), 1.0f, 0.1f, light->getRadius());
-                renderLight.shadowTransform = projectionMatrix * viewMatrix;
+    std::vector<RenderList::Light> renderLights;
+    std::vector<int> renderLightIndices(this->lightNodes.size(), -1);
+    for (int i = 0; i < (int)this->lightNodes.size(); i++)
+    {
+        if (!this->lightNodes[i]->isHidden())
+        {
+            renderLightIndices[i] = (int)renderLights.size();
+            renderLights.push_back(nodeLights[i]);
+        }
+    }
+
+    ShadowRenderer::assignShadowSlots(renderLights, viewMatrix, projectionMatrix);
+    for (const auto &light : renderLights)
+        renderList->addLight(light);
+
+    // baked casters are indexed by light node
+    std::vector<int> lightNodeShadowSlots(this->lightNodes.size(), -1);
+    for (int i = 0; i < (int)this->lightNodes.size(); i++)
+    {
+        if (renderLightIndices[i] >= 0)
+            lightNodeShadowSlots[i] = renderLights[renderLightIndices[i]].shadowSlot;
+    }
+
+    const VisibilitySet::Interval *interval = nullptr;
+    if (useBakedVisibility && this->bakedVisibilityValid)
+        interval = this->visibility.findInterval(this->currentTime);
+
+    // without baked data, objects are culled against the camera and the spot light frustums
+    Frustum cameraFrustum(viewProjectionMatrix);
+
+    // levels of detail only depend on the camera, shadow maps reuse them
+    LodSelector lodSelector(viewProjectionMatrix, arrays.transforms.data(), this->transformLods.data());
+    ClusterCuller clusterCuller(viewProjectionMatrix, arrays.transforms.data());
+
+    const std::vector<RenderList::Light> &lights = renderList->getLights();
+    std::vector<Frustum> lightFrustums;
+    for (const auto &light : lights)
+        lightFrustums.push_back(Frustum(light.spot ? light.shadowTransform : glm::mat4(1.0f)));
+
+    // each task writes its node range in its own chunk; chunks are then concatenated
+    // in order, so that the job list is the same as when filled serially
+    std::vector<RenderList::JobChunk> meshChunks(TaskScheduler::computeChunkCount((int)this->meshNodes.size(), MESH_NODE_GRAIN_SIZE));
+    scheduler->parallelFor((int)this->meshNodes.size(), MESH_NODE_GRAIN_SIZE, [&](int begin, int end, int chunkIndex)
+    {
+        int maxJobCount = 0;
+        for (int i = begin; i < end; i++)
+        {
+            if (!this->staticGeometry.isMerged(i))
+                maxJobCount += (int)this->meshNodes[i]->getData<Mesh>()->getSubMeshes().size();
+        }
+
+        RenderList::JobChunk &chunk = meshChunks[chunkIndex];
+        chunk.jobs = renderList->allocateJobs(maxJobCount);
+
+        for (int i = begin; i < end; i++)
+        {
+            const SceneNode *node = this->meshNodes[i];
+            if (node->isHidden() || this->staticGeometry.isMerged(i))
+                continue;
+
+            unsigned int visibility = 0;
+            if (interval)
+            {
+                // precomputed sets, no culling work
+                visibility = VisibilitySet::test(interval->objects, i) ? 1u : 0u;
+                for (int j = 0; j < (int)this->lightNodes.size(); j++)
+                {
+                    if ((lightNodeShadowSlots[j] >= 0) && VisibilitySet::test(interval->casters[j], i))
+                        visibility |= RenderList::shadowVisibilityBit(lightNodeShadowSlots[j]);
+                }
+            }
+            else
+            {
+                Mesh *mesh = node->getData<Mesh>();
+                const glm::mat4 &transform = arrays.transforms[i];
+
+                visibility = cameraFrustum.intersects(mesh->getMinBound(), mesh->getMaxBound(), transform) ? 1u : 0u;
+                for (int j = 0; j < (int)lights.size(); j++)
+                {
+                    if ((lights[j].shadowSlot >= 0) && lightFrustums[j].intersects(mesh->getMinBound(), mesh->getMaxBound(), transform))
+                        visibility |= RenderList::shadowVisibilityBit(lights[j].shadowSlot);
+                }
             }
 
-            renderList->addLight(renderLight);
+            if (visibility != 0)
+                writeMeshJobs(chunk, node, i, visibility, lodSelector.select(node->getData<Mesh>(), i), renderList, clusterCuller, lodSelector);
         }
+    });
+
+    // static batches are culled like nodes; baked visibility of a batch is the union of its merged nodes
+    const std::vector<StaticGeometry::Batch> &batches = this->staticGeometry.getBatches();
+    int staticTransformIndex = (int)this->meshNodes.size();
+    std::vector<RenderList::JobChunk> batchChunks(TaskScheduler::computeChunkCount((int)batches.size(), STATIC_BATCH_GRAIN_SIZE));
+    scheduler->parallelFor((int)batches.size(), STATIC_BATCH_GRAIN_SIZE, [&](int begin, int end, int chunkIndex)
+    {
+        RenderList::JobChunk &chunk = batchChunks[chunkIndex];
+        chunk.jobs = renderList->allocateJobs(end - begin);
+
+        for (int i = begin; i < end; i++)
+        {
+            const StaticGeometry::Batch &batch = batches[i];
+
+            unsigned int visibility = 0;
+            if (interval)
+            {
+                for (int nodeIndex : batch.nodes)
+                {
+                    if (VisibilitySet::test(interval->objects, nodeIndex))
+                        visibility |= 1u;
+
+                    for (int j = 0; j < (int)this->lightNodes.size(); j++)
+                    {
+                        if ((lightNodeShadowSlots[j] >= 0) && VisibilitySet::test(interval->casters[j], nodeIndex))
+                            visibility |= RenderList::shadowVisibilityBit(lightNodeShadowSlots[j]);
+                    }
+                }
+            }
+            else
+            {
+                const glm::mat4 identity(1.0f);
+
+                visibility = cameraFrustum.intersects(batch.minBound, batch.maxBound, identity) ? 1u : 0u;
+                for (int j = 0; j < (int)lights.size(); j++)
+                {
+                    if ((lights[j].shadowSlot >= 0) && lightFrustums[j].intersects(batch.minBound, batch.maxBound, identity))
+                        visibility |= RenderList::shadowVisibilityBit(lights[j].shadowSlot);
+                }
+            }
+
+            if (visibility == 0)
+                continue;
+
+            // bounding sphere of the world space bounds
+            if ((visibility & 1u) != 0)
+                batch.subMesh.material->requestScreenSize(2.0f * lodSelector.computeScreenRadius(0.5f * (batch.minBound + batch.maxBound), 0.5f * glm::length(batch.maxBound - batch.minBound)));
+
+            RenderList::Job &job = chunk.jobs[chunk.count++];
+            job.sortKey = 0;
+            job.subMeshIndex = batch.subMesh.index;
+            job.materialIndex = batch.subMesh.material->getIndex();
+            job.transformIndex = staticTransformIndex;
+            job.visibility = visibility;
+            job.clusterDraw = nullptr;
+
+            chunk.triangleCount += batch.subMesh.indexCount / 3;
+        }
+    });
+
+    // one task per particle emitter node
+    std::vector<RenderList::JobChunk> particleChunks(this->particleSystemNodes.size());
+    scheduler->parallelFor((int)this->particleSystemNodes.size(), 1, [&](int begin, int end, int chunkIndex)
+    {
+        const SceneNode *node = this->particleSystemNodes[begin];
+        if (node->isHidden())
+            return;
+
+        int maxJobCount = 0;
+        for (const ParticleSystem *particleSystem : node->getParticleSystems())
+            maxJobCount += particleSystem->getMaxJobCount();
+
+        RenderList::JobChunk &chunk = particleChunks[chunkIndex];
+        chunk.jobs = renderList->allocateJobs(maxJobCount);
+
+        int transformOffset = this->particleTransformOffsets[begin];
+        for (const ParticleSystem *particleSystem : node->getParticleSystems())
+        {
+            particleSystem->fillJobs(chunk, transformOffset, lodSelector);
+            transformOffset += particleSystem->getParticleCount();
+        }
+    });
+
+    renderList->addJobChunks(meshChunks);
+    renderList->addJobChunks(batchChunks);
+    renderList->addJobChunks(particleChunks);
+
+    // material animation was applied by update(), and the next update may run while the list is rendered
+    renderList->captureMaterialConstants();
+}
+
+uint64_t Scene::computeVisibilityHash() const
+{
+    uint64_t hash = this->layoutHash;
+    for (const SceneNode *node : this->meshNodes)
+    {
+        const Mesh *mesh = node->getData<Mesh>();
+        hash = hashBytes(hash, &mesh->getMinBound(), sizeof(glm::vec3));
+        hash = hashBytes(hash, &mesh->getMaxBound(), sizeof(glm::vec3));
+    }
+
+    for (const SceneNode *node : this->lightNodes)
+    {
+        const Light *light = node->getData<Light>();
+        float shape[] = { (float)light->getType(), light->getRadius(), light->getSpotAngle() };
+        hash = hashBytes(hash, shape, sizeof(shape));
+    }
+
+    return hash;
+}
+
+std::string Scene::bakeVisibility(int width, int height)
+{
+    float previousTime = this->currentTime;
+
+    int intervalCount = std::max((int)ceilf((this->frameEnd - this->frameStart) / VISIBILITY_INTERVAL_LENGTH), 1);
+    this->visibility.reset(this->frameStart, VISIBILITY_INTERVAL_LENGTH, intervalCount, (int)this->meshNodes.size(), (int)this->lightNodes.size(), this->computeVisibilityHash());
+
+    // enlarged local bounds for each mesh node
+    std::vector<glm::vec3> minBounds;
+    std::vector<glm::vec3> maxBounds;
+    for (const SceneNode *node : this->meshNodes)
+    {
+        Mesh *mesh = node->getData<Mesh>();
+        glm::vec3 margin = (mesh->getMaxBound() - mesh->getMinBound()) * VISIBILITY_BOUNDS_MARGIN;
+        minBounds.push_back(mesh->getMinBound() - margin);
+        maxBounds.push_back(mesh->getMaxBound() + margin);
     }
+
+    for (int i = 0; i < intervalCount; i++)
+    {
+        VisibilitySet::Interval &interval = this->visibility.getInterval(i);
+
+        // sample both interval bounds, the union stays conservative for the whole interval
+        for (int sample = 0; sample <= VISIBILITY_INTERVAL_SAMPLES; sample++)
+        {
+            float time = this->frameStart + ((float)i + (float)sample / (float)VISIBILITY_INTERVAL_SAMPLES) * VISIBILITY_INTERVAL_LENGTH;
+            this->update(time);
+
+            const CameraSettings &camera = this->updateRenderSettings(width, height).camera;
+            Frustum cameraFrustum(camera.projectionMatrix * camera.viewMatrix);
+
+            // hidden state is ignored, as it is still checked at runtime
+            for (int j = 0; j < (int)this->meshNodes.size(); j++)
+            {
+                if (cameraFrustum.intersects(minBounds[j], maxBounds[j], this->meshNodes[j]->getCurrentTransform()))
+                    VisibilitySet::set(interval.objects, j);
+            }
+
+            for (int j = 0; j < (int)this->lightNodes.size(); j++)
+            {
+                const SceneNode *node = this->lightNodes[j];
+                Light *light = node->getData<Light>();
+
+                // only spotlights cast shadows; skip lights not affecting the camera view at all
+                if (light->getType() != Light::Spot)
+                    continue;
+
+                if (!cameraFrustum.intersects(glm::vec3(node->getCurrentTransform()[3]), light->getRadius()))
+                    continue;
+
+                Frustum lightFrustum(computeShadowTransform(node, light));
+                for (int k = 0; k < (int)this->meshNodes.size(); k++)
+                {
+                    if (lightFrustum.intersects(minBounds[k], maxBounds[k], this->meshNodes[k]->getCurrentTransform()))
+                        VisibilitySet::set(interval.casters[j], k);
+                }
+            }
+        }
+    }
+
+    // back to the state before the sweep
+    this->update(previousTime);
+
+    cJSON *json = this->visibility.save();
+    char *text = cJSON_PrintUnformatted(json);
+    std::string result(text);
+    free(text);
+    cJSON_Delete(json);
+
+    return result;
 }
 
 void Scene::updateCameraSettings(bool overrideCamera, const glm::mat4 &viewMatrixOverride, const glm::mat4 &projectionMatrixOverride, float aspect)
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -9,12 +10,14 @@
 #include <engine/render/Camera.h>
 #include <engine/render/Light.h>
 #include <engine/render/Mesh.h>
+#include <engine/render/RenderList.h>
 #include <engine/render/RenderSettings.h>
 #include <engine/resource/Resource.h>
 #include <engine/scene/SceneNode.h>
+#include <engine/scene/StaticGeometry.h>
+#include <engine/scene/VisibilitySet.h>
 
 class AnimationData;
-class RenderList;
 
 class Scene : public Resource
 {
@@ -29,13 +32,25 @@ class Scene : public Resource
 
         void update(float time);
 
-        void fillRenderList(RenderList *renderList) const;
+        // merged meshes may have been reloaded (live editing only); see StaticGeometry::refresh()
+        void refreshStaticGeometry() { this->staticGeometry.refresh(); }
+
+        // baked visibility is used when available for the current time,
+        // otherwise objects are culled against the camera and light frustums
+        void fillRenderList(RenderList *renderList, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix, bool useBakedVisibility) const;
+
+        // sweep the whole timeline and compute the visibility sets; returns the json to store in scene data
+        std::string bakeVisibility(int width, int height);
 
 	    const RenderSettings &updateRenderSettings(int width, int height, bool overrideCamera = false, const glm::mat4 &viewMatrixOverride = glm::mat4(1.0f), const glm::mat4 &projectionMatrixOverride = glm::mat4(1.0f));
 
         static Scene *findCurrentScene(float time);
 
     private:
+        void updateTransformArrays();
+
+        // layout hash, combined with the data of the resources the bake depends on
+        uint64_t computeVisibilityHash() const;
 		void updateCameraSettings(bool overrideCamera, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix, float aspect);
 		int findCurrentCamera(float time);
 
@@ -65,5 +80,31 @@ class Scene : public Resource
 
 		RenderSettings renderSettings;
 
+        float currentTime = 0.0f;
+        VisibilitySet visibility;
+        uint64_t layoutHash = 0; // of the scene data baked visibility depends on
+        bool bakedVisibilityValid = false; // visibility matches the scene, checked in update()
+
+        // opt-in, merges static mesh nodes by material
+        StaticGeometry staticGeometry;
+
+        // world transforms of mesh nodes, then an identity entry for static geometry,
+        // followed by particles, gathered in update();
+        // render jobs reference them by index instead of holding copies
+        struct TransformArrays
+        {
+            std::vector<glm::mat4> transforms;
+            std::vector<RenderList::DerivedTransform> derivedTransforms; // kept across frames for static mesh nodes
+            std::vector<uint8_t> changedTransforms; // since the previous update, particles always change
+        };
+
+        // double-buffered, as the render list of the previous update may still be rendered
+        // while the next update writes; each update switches to the other set
+        TransformArrays transformArrays[2];
+        int currentTransformArrays = 0;
+
+        mutable std::vector<uint8_t> transformLods; // levels of detail selected by the last fillRenderList()
+        std::vector<int> particleTransformOffsets; // one per particle system node
+
         static std::vector<Scene *> allScenes;
 };
@@ -22,15 +22,15 @@ SceneNode::SceneNode(const cJSON *json, const SceneNode *parent)
 {
     this->animation = nullptr;
 
-    std::string dataName = cJSON_GetObjectItem(json, "data")->valuestring;
+    this->dataName = cJSON_GetObjectItem(json, "data")->valuestring;
     int dataType = cJSON_GetObjectItem(json, "type")->valueint;
 
     this->data = nullptr;
     switch (dataType)
     {
-        case 0: this->data = ResourceManager::getInstance()->requestResource<Camera>(dataName); break;
-        case 1: this->data = ResourceManager::getInstance()->requestResource<Mesh>(dataName); break;
-        case 2: this->data = ResourceManager::getInstance()->requestResource<Light>(dataName); break;
+        case 0: this->data = ResourceManager::getInstance()->requestResource<Camera>(this->dataName); break;
+        case 1: this->data = ResourceManager::getInstance()->requestResource<Mesh>(this->dataName); break;
+        case 2: this->data = ResourceManager::getInstance()->requestResource<Light>(this->dataName); break;
     }
     
     cJSON *position = cJSON_GetObjectItem(json, "position");
@@ -101,9 +101,18 @@ void SceneNode::unregisterAnimation(AnimationPlayer *player) const
         player->unregisterAnimation(this->animation);
 }
 
+bool SceneNode::isStatic() const
+{
+    if ((this->animation != nullptr) || this->hasParticleSystems())
+        return false;
+
+    return (this->parent == nullptr) || this->parent->isStatic();
+}
+
 void SceneNode::updateTransforms()
 {
     // backup current transform
+    bool wasMoving = (this->previousFrameTransform != this->currentTransform);
     this->previousFrameTransform = this->currentTransform;
 
     // node's own transform
@@ -117,6 +126,7 @@ void SceneNode::updateTransforms()
         transform = parentTransform * transform;
     }
 
+    this->transformChanged = wasMoving || (transform != this->currentTransform);
     this->currentTransform = transform;
 }
 
@@ -145,9 +155,3 @@ void SceneNode::updateParticles(float time)
     for (auto *particleSystem : this->particleSystems)
         particleSystem->update(time, this->currentTransform);
 }
-
-void SceneNode::fillParticleRenderList(RenderList *renderList) const
-{
-    for (auto *particleSystem : this->particleSystems)
-        particleSystem->fillRenderList(renderList);
-}
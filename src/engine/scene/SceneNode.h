@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -8,7 +9,6 @@ struct cJSON;
 class AnimationData;
 class AnimationPlayer;
 class Resource;
-class RenderList;
 class ParticleSystem;
 
 class SceneNode
@@ -22,6 +22,10 @@ class SceneNode
 
         bool isHidden() const { return this->hide == 1.0f; }
 
+        // no animation in the parent chain and no particles: the transform and
+        // the hidden state never change after load
+        bool isStatic() const;
+
         // update current and last frame transforms, applying the parent transform
         // (parent must have been updated before to ensure correctness)
         void updateTransforms();
@@ -29,16 +33,22 @@ class SceneNode
         const glm::mat4 &getCurrentTransform() const { return this->currentTransform; }
         const glm::mat4 &getPreviousFrameTransform() const { return this->previousFrameTransform; }
 
+        // true if current or previous frame transform changed during the last update
+        bool hasTransformChanged() const { return this->transformChanged; }
+
         // view transform is a special case because cameras need to ignore scaling
         glm::mat4 computeViewTransform() const;
 
         template <typename DataType>
         DataType *getData() const;
 
+        // resource name of the above data
+        const std::string &getDataName() const { return this->dataName; }
+
         bool hasParticleSystems() const { return this->particleSystems.size() > 0; }
+        const std::vector<ParticleSystem *> &getParticleSystems() const { return this->particleSystems; }
 
         void updateParticles(float time);
-        void fillParticleRenderList(RenderList *renderList) const;
 
     private:
         // transform
@@ -49,6 +59,7 @@ class SceneNode
         // baked transform of the above fields, with parent transform applied
         glm::mat4 currentTransform;
         glm::mat4 previousFrameTransform;
+        bool transformChanged = true;
 
         const SceneNode *parent;
         glm::mat4 parentMatrix;
@@ -60,6 +71,7 @@ class SceneNode
 
         // custom data attached to this node
         Resource *data;
+        std::string dataName;
 
         std::vector<ParticleSystem *> particleSystems;
 };
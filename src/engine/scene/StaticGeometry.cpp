@@ -0,0 +1,202 @@
+#include <engine/scene/StaticGeometry.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <tuple>
+
+#include <engine/render/Material.h>
+#include <engine/render/VertexFormat.h>
+#include <engine/resource/ResourceManager.h>
+#include <engine/scene/SceneNode.h>
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+static ID3D11Buffer *createVertexBuffer(const void *data, size_t size)
+{
+    D3D11_BUFFER_DESC desc;
+    desc.Usage = D3D11_USAGE_IMMUTABLE;
+    desc.ByteWidth = (UINT)size;
+    desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    desc.StructureByteStride = 0;
+    desc.MiscFlags = 0;
+    desc.CPUAccessFlags = 0;
+
+    D3D11_SUBRESOURCE_DATA initialData;
+    initialData.pSysMem = data;
+    initialData.SysMemPitch = 0;
+    initialData.SysMemSlicePitch = 0;
+
+    ID3D11Buffer *buffer;
+    HRESULT res = Device::device->CreateBuffer(&desc, &initialData, &buffer);
+    CHECK_HRESULT(res);
+
+    return buffer;
+}
+
+void StaticGeometry::build(const std::vector<SceneNode *> &meshNodes, float cellSize)
+{
+    this->clear();
+
+    this->meshNodes = meshNodes;
+    this->cellSize = cellSize;
+    this->merged.assign(meshNodes.size(), 0);
+
+    // submeshes grouped by material index and cell coordinates
+    typedef std::tuple<int, int, int, int> GroupKey;
+    struct Entry
+    {
+        int nodeIndex;
+        const Mesh::SubMesh *subMesh;
+    };
+    std::map<GroupKey, std::vector<Entry>> groups;
+
+    for (int i = 0; i < (int)meshNodes.size(); i++)
+    {
+        const SceneNode *node = meshNodes[i];
+        if (!node->isStatic() || node->isHidden())
+            continue;
+
+        Mesh *mesh = node->getData<Mesh>();
+        this->merged[i] = 1;
+
+        // watch each merged mesh once, as reloading it requires a rebuild; meshes not
+        // loaded yet have no submeshes and are merged when they get loaded
+        if (std::find(this->watchedMeshes.begin(), this->watchedMeshes.end(), mesh) == this->watchedMeshes.end())
+            this->watchedMeshes.push_back(ResourceManager::getInstance()->requestResource<Mesh>(node->getDataName(), this));
+
+        // cell of the world space bounds center; a node is never split across batches
+        const glm::mat4 &transform = node->getCurrentTransform();
+        glm::vec3 center = glm::vec3(transform * glm::vec4((mesh->getMinBound() + mesh->getMaxBound()) * 0.5f, 1.0f));
+        glm::ivec3 cell = glm::ivec3(glm::floor(center / cellSize));
+
+        for (const auto &subMesh : mesh->getSubMeshes())
+            groups[GroupKey(subMesh.material->getIndex(), cell.x, cell.y, cell.z)].push_back({ i, &subMesh });
+    }
+
+    // vertices are read back once per mesh, as mesh data is not kept on the CPU
+    std::map<const Mesh *, std::vector<float>> meshVertices;
+
+    std::vector<float> vertices;
+    std::vector<VertexFormat::Vertex> packedVertices;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> subMeshIndices;
+    std::vector<int> remap;
+
+    this->batches.resize(groups.size());
+    int batchIndex = 0;
+    for (const auto &group : groups)
+    {
+        Batch &batch = this->batches[batchIndex++];
+
+        vertices.clear();
+        indices.clear();
+
+        for (const Entry &entry : group.second)
+        {
+            const SceneNode *node = meshNodes[entry.nodeIndex];
+            const Mesh *mesh = node->getData<Mesh>();
+
+            std::vector<float> &sourceVertices = meshVertices[mesh];
+            if (sourceVertices.empty())
+                mesh->readVertices(sourceVertices);
+
+            Mesh::readIndices(*entry.subMesh, subMeshIndices);
+
+            // same transforms as the vertex shader applies to individual nodes; normals
+            // and tangents are normalized by the encoding
+            const glm::mat4 &transform = node->getCurrentTransform();
+            glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(transform));
+
+            // only copy the vertices referenced by this submesh
+            remap.assign(sourceVertices.size() / VertexFormat::sourceStride, -1);
+            for (uint32_t index : subMeshIndices)
+            {
+                if (remap[index] < 0)
+                {
+                    remap[index] = (int)(vertices.size() / VertexFormat::sourceStride);
+
+                    const float *source = &sourceVertices[index * VertexFormat::sourceStride];
+                    glm::vec3 position = glm::vec3(transform * glm::vec4(source[0], source[1], source[2], 1.0f));
+                    glm::vec3 normal = normalMatrix * glm::vec3(source[3], source[4], source[5]);
+                    glm::vec3 tangent = normalMatrix * glm::vec3(source[6], source[7], source[8]);
+
+                    vertices.insert(vertices.end(), { position.x, position.y, position.z, normal.x, normal.y, normal.z, tangent.x, tangent.y, tangent.z, source[9], source[10], source[11] });
+
+                    bool first = (vertices.size() == VertexFormat::sourceStride);
+                    batch.minBound = first ? position : glm::min(batch.minBound, position);
+                    batch.maxBound = first ? position : glm::max(batch.maxBound, position);
+                }
+
+                indices.push_back((uint32_t)remap[index]);
+            }
+
+            if (batch.nodes.empty() || (batch.nodes.back() != entry.nodeIndex))
+                batch.nodes.push_back(entry.nodeIndex);
+        }
+
+        int vertexCount = (int)(vertices.size() / VertexFormat::sourceStride);
+        packedVertices.resize(vertexCount);
+        VertexFormat::encode(vertices.data(), vertexCount, packedVertices.data());
+
+        batch.subMesh.vertexBuffer = createVertexBuffer(packedVertices.data(), packedVertices.size() * sizeof(VertexFormat::Vertex));
+        batch.subMesh.indexBuffer = Mesh::createIndexBuffer(indices.data(), (int)indices.size(), vertexCount, batch.subMesh.indexFormat);
+        batch.subMesh.indexCount = (int)indices.size();
+        batch.subMesh.material = group.second.front().subMesh->material;
+    }
+
+    // register once the vector is complete, as addresses are now stable
+    for (auto &batch : this->batches)
+        batch.subMesh.index = Mesh::registerSubMesh(&batch.subMesh);
+
+    this->dirty = false;
+
+    int mergedCount = (int)std::count(this->merged.begin(), this->merged.end(), 1);
+    printf("static geometry: %d mesh nodes merged in %d batches\n", mergedCount, (int)this->batches.size());
+}
+
+void StaticGeometry::clear()
+{
+    StaticGeometry::releaseBatches(this->batches);
+    StaticGeometry::releaseBatches(this->retiredBatches);
+
+    this->merged.clear();
+    this->meshNodes.clear();
+
+    for (Mesh *mesh : this->watchedMeshes)
+        ResourceManager::getInstance()->releaseResource(mesh, this);
+
+    this->watchedMeshes.clear();
+    this->dirty = false;
+}
+
+void StaticGeometry::refresh()
+{
+    StaticGeometry::releaseBatches(this->retiredBatches);
+
+    if (!this->dirty)
+        return;
+
+    // build() clears the stored nodes and batches
+    std::vector<Batch> batches;
+    batches.swap(this->batches);
+
+    std::vector<SceneNode *> meshNodes = this->meshNodes;
+    this->build(meshNodes, this->cellSize);
+
+    this->retiredBatches.swap(batches);
+}
+
+void StaticGeometry::releaseBatches(std::vector<Batch> &batches)
+{
+    for (auto &batch : batches)
+    {
+        Mesh::unregisterSubMesh(batch.subMesh.index);
+        batch.subMesh.vertexBuffer->Release();
+        batch.subMesh.indexBuffer->Release();
+    }
+
+    batches.clear();
+}
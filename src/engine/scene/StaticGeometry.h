@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <engine/render/Mesh.h>
+#include <engine/resource/ResourceWatcher.h>
+
+class SceneNode;
+
+/**
+ * Merged geometry of static mesh nodes, built at scene load when enabled.
+ * Submeshes sharing a material are pre-transformed to world space and
+ * concatenated, one batch per material and spatial cell, so that batches
+ * can still be culled.
+ */
+class StaticGeometry: public ResourceWatcher
+{
+    public:
+        struct Batch
+        {
+            Mesh::SubMesh subMesh; // merged VB and IB, registered like mesh submeshes
+            glm::vec3 minBound; // world space
+            glm::vec3 maxBound;
+            std::vector<int> nodes; // merged mesh node indices, for baked visibility
+        };
+
+        StaticGeometry() : cellSize(0.0f), dirty(false) {}
+
+        // node transforms must be up to date
+        void build(const std::vector<SceneNode *> &meshNodes, float cellSize);
+        void clear();
+
+        // rebuild if a merged mesh was reloaded since the last build; called from the render thread
+        // while no update runs, as meshes are read back from the device. Replaced batches are
+        // released by the next call, once the frame still referencing them is rendered
+        void refresh();
+
+        const std::vector<Batch> &getBatches() const { return this->batches; }
+
+        // merged nodes must not be rendered individually
+        bool isMerged(int meshNodeIndex) const { return !this->merged.empty() && (this->merged[meshNodeIndex] != 0); }
+
+        virtual void onResourceUpdated(Resource *resource) override { this->dirty = true; }
+
+    private:
+        static void releaseBatches(std::vector<Batch> &batches);
+
+        std::vector<Batch> batches;
+        std::vector<Batch> retiredBatches;
+        std::vector<uint8_t> merged; // one per mesh node
+
+        // kept for rebuilds
+        std::vector<SceneNode *> meshNodes;
+        float cellSize;
+
+        std::vector<Mesh *> watchedMeshes;
+        bool dirty;
+};
@@ -0,0 +1,155 @@
+#include <engine/scene/VisibilitySet.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+
+#include <cJSON/cJSON.h>
+
+void VisibilitySet::load(const cJSON *json)
+{
+    this->clear();
+
+    this->intervalStart = (float)cJSON_GetObjectItem(json, "interval_start")->valuedouble;
+    this->intervalLength = (float)cJSON_GetObjectItem(json, "interval_length")->valuedouble;
+    this->objectCount = cJSON_GetObjectItem(json, "object_count")->valueint;
+    this->lightCount = cJSON_GetObjectItem(json, "light_count")->valueint;
+
+    // json numbers can't hold 64 bits; bakes without a hash never match
+    cJSON *sceneHashJson = cJSON_GetObjectItem(json, "scene_hash");
+    this->sceneHash = 0;
+    if (sceneHashJson && sceneHashJson->valuestring)
+        sscanf(sceneHashJson->valuestring, "%" SCNx64, &this->sceneHash);
+
+    cJSON *intervalsJson = cJSON_GetObjectItem(json, "intervals");
+    this->intervals.resize(cJSON_GetArraySize(intervalsJson));
+
+    int index = 0;
+    cJSON *intervalJson = intervalsJson->child;
+    while (intervalJson)
+    {
+        Interval &interval = this->intervals[index++];
+
+        VisibilitySet::decode(cJSON_GetObjectItem(intervalJson, "objects"), interval.objects, this->objectCount);
+
+        cJSON *castersJson = cJSON_GetObjectItem(intervalJson, "casters");
+        interval.casters.resize(this->lightCount);
+        for (int i = 0; i < this->lightCount; i++)
+            VisibilitySet::decode(cJSON_GetArrayItem(castersJson, i), interval.casters[i], this->objectCount);
+
+        intervalJson = intervalJson->next;
+    }
+}
+
+cJSON *VisibilitySet::save() const
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "interval_start", this->intervalStart);
+    cJSON_AddNumberToObject(json, "interval_length", this->intervalLength);
+    cJSON_AddNumberToObject(json, "object_count", this->objectCount);
+    cJSON_AddNumberToObject(json, "light_count", this->lightCount);
+
+    char sceneHash[17];
+    snprintf(sceneHash, sizeof(sceneHash), "%016" PRIx64, this->sceneHash);
+    cJSON_AddStringToObject(json, "scene_hash", sceneHash);
+
+    cJSON *intervalsJson = cJSON_CreateArray();
+    for (const Interval &interval : this->intervals)
+    {
+        cJSON *intervalJson = cJSON_CreateObject();
+        cJSON_AddItemToObject(intervalJson, "objects", VisibilitySet::encode(interval.objects, this->objectCount));
+
+        cJSON *castersJson = cJSON_CreateArray();
+        for (const Bitset &casters : interval.casters)
+            cJSON_AddItemToArray(castersJson, VisibilitySet::encode(casters, this->objectCount));
+        cJSON_AddItemToObject(intervalJson, "casters", castersJson);
+
+        cJSON_AddItemToArray(intervalsJson, intervalJson);
+    }
+    cJSON_AddItemToObject(json, "intervals", intervalsJson);
+
+    return json;
+}
+
+void VisibilitySet::reset(float start, float length, int intervalCount, int objectCount, int lightCount, uint64_t sceneHash)
+{
+    this->intervalStart = start;
+    this->intervalLength = length;
+    this->objectCount = objectCount;
+    this->lightCount = lightCount;
+    this->sceneHash = sceneHash;
+
+    Bitset empty((objectCount + 31) / 32, 0);
+
+    this->intervals.clear();
+    this->intervals.resize(intervalCount);
+    for (Interval &interval : this->intervals)
+    {
+        interval.objects = empty;
+        interval.casters.assign(lightCount, empty);
+    }
+}
+
+void VisibilitySet::clear()
+{
+    this->intervals.clear();
+    this->objectCount = 0;
+    this->lightCount = 0;
+    this->sceneHash = 0;
+}
+
+const VisibilitySet::Interval *VisibilitySet::findInterval(float time) const
+{
+    if (this->intervals.empty())
+        return nullptr;
+
+    int index = (int)floorf((time - this->intervalStart) / this->intervalLength);
+    if ((index < 0) || (index >= (int)this->intervals.size()))
+        return nullptr;
+
+    return &this->intervals[index];
+}
+
+cJSON *VisibilitySet::encode(const Bitset &bitset, int size)
+{
+    std::vector<int> runs;
+
+    bool current = false;
+    int runLength = 0;
+    for (int i = 0; i < size; i++)
+    {
+        if (VisibilitySet::test(bitset, i) != current)
+        {
+            runs.push_back(runLength);
+            current = !current;
+            runLength = 0;
+        }
+        runLength++;
+    }
+    runs.push_back(runLength);
+
+    return cJSON_CreateIntArray(runs.data(), (int)runs.size());
+}
+
+void VisibilitySet::decode(const cJSON *json, Bitset &bitset, int size)
+{
+    bitset.assign((size + 31) / 32, 0);
+
+    bool current = false;
+    int index = 0;
+    const cJSON *runJson = json ? json->child : nullptr;
+    while (runJson && (index < size))
+    {
+        int end = std::min(index + runJson->valueint, size);
+        if (current)
+        {
+            for (int i = index; i < end; i++)
+                VisibilitySet::set(bitset, i);
+        }
+
+        index = end;
+        current = !current;
+        runJson = runJson->next;
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct cJSON;
+
+// precomputed visibility along the demo timeline; the timeline is split in
+// fixed-size intervals, each storing a bitset of potentially visible mesh nodes,
+// and for each light, the bitset of mesh nodes potentially casting shadows
+class VisibilitySet
+{
+    public:
+        typedef std::vector<uint32_t> Bitset;
+
+        struct Interval
+        {
+            Bitset objects;
+            std::vector<Bitset> casters; // one per light node
+        };
+
+        VisibilitySet() : intervalStart(0.0f), intervalLength(1.0f), objectCount(0), lightCount(0), sceneHash(0) {}
+
+        // bitsets are stored as run-length encoded arrays in the scene json
+        void load(const cJSON *json);
+        cJSON *save() const;
+
+        // sceneHash identifies what the bake depends on: node transforms and animations, mesh bounds, lights
+        void reset(float start, float length, int intervalCount, int objectCount, int lightCount, uint64_t sceneHash);
+        void clear();
+
+        // null when there is no baked data for this time
+        const Interval *findInterval(float time) const;
+
+        Interval &getInterval(int index) { return this->intervals[index]; }
+        int getIntervalCount() const { return (int)this->intervals.size(); }
+
+        // data baked for a different scene layout, or before nodes or meshes changed, cannot be used
+        bool matches(int objectCount, int lightCount, uint64_t sceneHash) const { return !this->intervals.empty() && (this->objectCount == objectCount) && (this->lightCount == lightCount) && (this->sceneHash == sceneHash); }
+
+        static bool test(const Bitset &bitset, int index) { return (bitset[index >> 5] & (1u << (index & 31))) != 0; }
+        static void set(Bitset &bitset, int index) { bitset[index >> 5] |= (1u << (index & 31)); }
+
+    private:
+        // runs alternate between cleared and set bits, starting with cleared
+        static cJSON *encode(const Bitset &bitset, int size);
+        static void decode(const cJSON *json, Bitset &bitset, int size);
+
+        float intervalStart;
+        float intervalLength;
+        int objectCount;
+        int lightCount;
+        uint64_t sceneHash;
+
+        std::vector<Interval> intervals;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+// bounded queue between exactly one producer thread and one consumer thread; items are
+// exchanged lock-free, and a thread waiting on a full or empty queue sleeps until the
+// other one progresses; the capacity must be a power of two
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    public:
+        SpscQueue() : head(0), tail(0) {}
+
+        // producer only; waits while the queue is full
+        void push(const T &value)
+        {
+            if (!this->tryPush(value))
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->notFull.wait(lock, [&]() { return this->tryPush(value); });
+            }
+
+            // taking the lock orders the push with the check of a consumer about to wait
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+            }
+            this->notEmpty.notify_one();
+        }
+
+        // consumer only; waits while the queue is empty
+        T pop()
+        {
+            T value;
+            if (!this->tryPop(value))
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->notEmpty.wait(lock, [&]() { return this->tryPop(value); });
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+            }
+            this->notFull.notify_one();
+
+            return value;
+        }
+
+    private:
+        bool tryPush(const T &value)
+        {
+            size_t tail = this->tail.load(std::memory_order_relaxed);
+            if (tail - this->head.load(std::memory_order_acquire) == Capacity)
+                return false;
+
+            this->items[tail & (Capacity - 1)] = value;
+            this->tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool tryPop(T &value)
+        {
+            size_t head = this->head.load(std::memory_order_relaxed);
+            if (head == this->tail.load(std::memory_order_acquire))
+                return false;
+
+            value = this->items[head & (Capacity - 1)];
+            this->head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        T items[Capacity];
+
+        // on separate cache lines, as each one is written by a different thread
+        alignas(64) std::atomic<size_t> head; // next item to pop
+        alignas(64) std::atomic<size_t> tail; // next slot to push
+
+        // one condition per direction, only used when a thread has to wait
+        std::mutex mutex;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+};
@@ -0,0 +1,126 @@
+#include <engine/thread/TaskScheduler.h>
+
+#include <algorithm>
+#include <cstdio>
+
+TaskScheduler *TaskScheduler::instance = nullptr;
+
+TaskScheduler::TaskScheduler()
+    : tasks(nullptr)
+    , stopping(false)
+{
+    // keep one core for the render (main) thread and one for the update thread (see FramePipeline),
+    // both of them run parallel loops along with the workers
+    int workerCount = std::max((int)std::thread::hardware_concurrency() - 2, 0);
+    for (int i = 0; i < workerCount; i++)
+        this->workers.push_back(std::thread(&TaskScheduler::workerMain, this));
+
+    printf("Task scheduler started with %d worker threads\n", workerCount);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wakeCondition.notify_all();
+
+    for (auto &worker : this->workers)
+        worker.join();
+}
+
+void TaskScheduler::parallelFor(int count, int grainSize, const RangeFunction &function)
+{
+    assert(grainSize > 0);
+
+    int chunkCount = TaskScheduler::computeChunkCount(count, grainSize);
+    if (chunkCount == 0)
+        return;
+
+    // not worth waking up workers
+    if ((chunkCount == 1) || this->workers.empty())
+    {
+        for (int i = 0; i < chunkCount; i++)
+            function(i * grainSize, std::min((i + 1) * grainSize, count), i);
+        return;
+    }
+
+    Task task;
+    task.function = &function;
+    task.count = count;
+    task.grainSize = grainSize;
+    task.chunkCount = chunkCount;
+    task.nextChunk = 0;
+    task.activeWorkers = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        task.next = this->tasks;
+        this->tasks = &task;
+    }
+    this->wakeCondition.notify_all();
+
+    TaskScheduler::runChunks(task);
+
+    // the task lives on this stack frame; unlink it so that no worker picks it
+    // anymore, then wait for the ones still running its chunks
+    std::unique_lock<std::mutex> lock(this->mutex);
+    Task **link = &this->tasks;
+    while (*link != &task)
+        link = &(*link)->next;
+    *link = task.next;
+
+    this->doneCondition.wait(lock, [&]() { return task.activeWorkers == 0; });
+}
+
+void TaskScheduler::workerMain()
+{
+    while (true)
+    {
+        Task *task = nullptr;
+
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->wakeCondition.wait(lock, [&]() { return this->stopping || ((task = this->findPendingTask()) != nullptr); });
+
+            if (this->stopping)
+                return;
+
+            task->activeWorkers++;
+        }
+
+        TaskScheduler::runChunks(*task);
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            task->activeWorkers--;
+        }
+
+        // several callers may be waiting, each for its own task
+        this->doneCondition.notify_all();
+    }
+}
+
+TaskScheduler::Task *TaskScheduler::findPendingTask() const
+{
+    // tasks whose chunks are all taken are skipped, so that workers don't spin on them
+    for (Task *task = this->tasks; task != nullptr; task = task->next)
+    {
+        if (task->nextChunk.load() < task->chunkCount)
+            return task;
+    }
+
+    return nullptr;
+}
+
+void TaskScheduler::runChunks(Task &task)
+{
+    int chunkIndex;
+    while ((chunkIndex = task.nextChunk.fetch_add(1)) < task.chunkCount)
+    {
+        int begin = chunkIndex * task.grainSize;
+        int end = std::min(begin + task.grainSize, task.count);
+        (*task.function)(begin, end, chunkIndex);
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// worker thread pool running data-parallel loops; the calling thread
+// takes part in the work, and waits until all chunks are processed
+class TaskScheduler
+{
+    public:
+        // called once per chunk, with the [begin, end) range and the chunk index
+        typedef std::function<void(int begin, int end, int chunkIndex)> RangeFunction;
+
+        // calls from different threads (update and render) run concurrently and share the workers
+        void parallelFor(int count, int grainSize, const RangeFunction &function);
+
+        // chunk indices passed to the range function are in [0, chunkCount)
+        static int computeChunkCount(int count, int grainSize) { return (count + grainSize - 1) / grainSize; }
+
+        int getThreadCount() const { return (int)this->workers.size() + 1; }
+
+    private:
+        static TaskScheduler *instance;
+
+        struct Task
+        {
+            const RangeFunction *function;
+            int count;
+            int grainSize;
+            int chunkCount;
+            std::atomic<int> nextChunk;
+
+            // protected by the scheduler mutex
+            int activeWorkers; // running chunks of this task, the caller waits for them to leave
+            Task *next;
+        };
+
+        TaskScheduler();
+        ~TaskScheduler();
+
+        void workerMain();
+        Task *findPendingTask() const;
+        static void runChunks(Task &task);
+
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable wakeCondition;
+        std::condition_variable doneCondition;
+
+        // protected by the mutex
+        Task *tasks; // of the callers currently in parallelFor(), most recent first
+        bool stopping;
+
+    public:
+        // singleton implementation
+        static void create() { assert(!TaskScheduler::instance); TaskScheduler::instance = new TaskScheduler; }
+        static void destroy() { assert(TaskScheduler::instance); delete TaskScheduler::instance; }
+        static TaskScheduler *getInstance() { assert(TaskScheduler::instance); return TaskScheduler::instance; }
+};
@@ -0,0 +1,70 @@
+#include <mesh-cooker/MeshCooker.h>
+
+#include <cassert>
+
+bool MeshCooker::cook(const MeshCookingInput &input, bool generateLods, std::vector<unsigned char> &output, MeshOptimizer::Stats *stats)
+{
+    if ((input.loopCount <= 0) || (input.vertexCount <= 0))
+        return false;
+
+    std::vector<float> vertices(input.loopCount * MeshOptimizer::vertexStride);
+    for (int i = 0; i < input.loopCount; i++)
+    {
+        int vertexIndex = input.loopVertexIndices[i];
+        if ((vertexIndex < 0) || (vertexIndex >= input.vertexCount))
+            return false;
+
+        float *vertex = &vertices[i * MeshOptimizer::vertexStride];
+        const float *position = &input.positions[vertexIndex * 3];
+        const float *normal = &input.loopNormals[i * 3];
+        const float *tangent = &input.loopTangents[i * 3];
+
+        vertex[0] = position[0];
+        vertex[1] = position[1];
+        vertex[2] = position[2];
+        vertex[3] = normal[0];
+        vertex[4] = normal[1];
+        vertex[5] = normal[2];
+        vertex[6] = tangent[0];
+        vertex[7] = tangent[1];
+        vertex[8] = tangent[2];
+        vertex[9] = input.loopBitangentSigns[i];
+        vertex[10] = input.loopUVs ? input.loopUVs[i * 2] : 0.0f;
+        vertex[11] = input.loopUVs ? input.loopUVs[i * 2 + 1] : 0.0f;
+    }
+
+    // fan triangulation, per material
+    std::vector<std::vector<uint32_t>> materialIndices(input.materialCount);
+    for (int i = 0; i < input.polygonCount; i++)
+    {
+        int materialIndex = input.polygonMaterialIndices[i];
+        if ((materialIndex < 0) || (materialIndex >= input.materialCount))
+            continue;
+
+        uint32_t loopStart = (uint32_t)input.polygonLoopStarts[i];
+        int loopTotal = input.polygonLoopTotals[i];
+        if ((input.polygonLoopStarts[i] < 0) || (loopTotal < 0) || (input.polygonLoopStarts[i] + loopTotal > input.loopCount))
+            return false;
+
+        std::vector<uint32_t> &indices = materialIndices[materialIndex];
+        for (int j = 0; j < loopTotal - 2; j++)
+        {
+            indices.push_back(loopStart);
+            indices.push_back(loopStart + j + 1);
+            indices.push_back(loopStart + j + 2);
+        }
+    }
+
+    MeshOptimizer optimizer;
+    optimizer.setVertices(vertices);
+    for (int i = 0; i < input.materialCount; i++)
+        optimizer.addSubMesh(input.materialNames[i], materialIndices[i]);
+
+    optimizer.optimize(generateLods, stats);
+    optimizer.write(output);
+
+    stats->rawSize = (int)optimizer.computeRawSize();
+    stats->compressedSize = (int)output.size();
+
+    return true;
+}
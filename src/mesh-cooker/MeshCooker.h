@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+
+#include <mesh-cooker/api.h>
+#include <mesh-cooker/MeshOptimizer.h>
+
+/**
+ * Builds mesh blobs from flat Blender arrays: one vertex per loop, polygons
+ * triangulated as fans, one index list per material; the result then goes
+ * through MeshOptimizer.
+ */
+class MeshCooker
+{
+    public:
+        // returns false if the input references out of range vertices or loops
+        static bool cook(const MeshCookingInput &input, bool generateLods, std::vector<unsigned char> &output, MeshOptimizer::Stats *stats);
+};
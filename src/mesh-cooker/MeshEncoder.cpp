@@ -0,0 +1,261 @@
+#include <mesh-cooker/MeshEncoder.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// position xyz, normal uv, tangent uv and sign, texture uv
+static const int CHANNEL_COUNT = 10;
+static const int GROUP_SIZE = 16;
+
+// lets the decoder read 8 bytes at any bit offset of a vertex stream
+static const int STREAM_PADDING = 8;
+
+// entries addressable by the index codes; code 15 is reserved in both cases
+static const int EDGE_FIFO_SIZE = 16;
+static const int VERTEX_FIFO_SIZE = 16;
+
+// same math as VertexFormat::encode(), one vertex at a time
+static void encodeOctahedral(float x, float y, float z, float &u, float &v)
+{
+    float scale = 1.0f / std::max(fabsf(x) + fabsf(y) + fabsf(z), 1e-20f);
+    x *= scale;
+    y *= scale;
+
+    u = (z < 0.0f) ? (1.0f - fabsf(y)) * copysignf(1.0f, x) : x;
+    v = (z < 0.0f) ? (1.0f - fabsf(x)) * copysignf(1.0f, y) : y;
+}
+
+static int32_t quantize(float value, float minimum, float maximum, float scale)
+{
+    return (int32_t)lrintf(std::min(std::max(value, minimum), maximum) * scale);
+}
+
+// round to nearest even, with denormals, infinities and NaNs
+static uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t absolute = bits & 0x7fffffff;
+
+    if (absolute > 0x7f800000)
+        return (uint16_t)(sign | 0x7e00);
+
+    if (absolute >= 0x47800000)
+        return (uint16_t)(sign | 0x7c00);
+
+    if (absolute < 0x38800000)
+    {
+        float magnitude;
+        memcpy(&magnitude, &absolute, sizeof(magnitude));
+        return (uint16_t)(sign | (uint32_t)lrintf(magnitude * 16777216.0f));
+    }
+
+    uint32_t oddMantissa = (absolute >> 13) & 1;
+    return (uint16_t)(sign | ((absolute + 0xc8000fff + oddMantissa) >> 13));
+}
+
+static void quantizeVertex(const float *vertex, float inverseStep, int32_t *channels)
+{
+    for (int i = 0; i < 3; i++)
+        channels[i] = (int32_t)lrintf(vertex[i] * inverseStep);
+
+    float u, v;
+    encodeOctahedral(vertex[3], vertex[4], vertex[5], u, v);
+    channels[3] = quantize(u, -1.0f, 1.0f, 32767.0f);
+    channels[4] = quantize(v, -1.0f, 1.0f, 32767.0f);
+
+    encodeOctahedral(vertex[6], vertex[7], vertex[8], u, v);
+    channels[5] = quantize(u * 0.5f + 0.5f, 0.0f, 1.0f, 1023.0f);
+    channels[6] = quantize(v * 0.5f + 0.5f, 0.0f, 1.0f, 1023.0f);
+    channels[7] = (vertex[9] >= 0.0f) ? 3 : 0;
+
+    channels[8] = floatToHalf(vertex[10]);
+    channels[9] = floatToHalf(vertex[11]);
+}
+
+static void writeVarint(std::vector<unsigned char> &output, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        output.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+
+    output.push_back((unsigned char)value);
+}
+
+static uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+float MeshEncoder::computePositionStep(const float *vertices, int vertexCount, int vertexStride)
+{
+    float maxCoordinate = 0.0f;
+    for (int i = 0; i < vertexCount; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            float coordinate = fabsf(vertices[i * vertexStride + j]);
+            if (std::isfinite(coordinate))
+                maxCoordinate = std::max(maxCoordinate, coordinate);
+        }
+    }
+
+    if (maxCoordinate == 0.0f)
+        return 1.0f;
+
+    // the grid is aligned on the origin, so that meshes of similar size snap shared borders alike
+    int exponent;
+    frexpf(maxCoordinate, &exponent);
+    return ldexpf(1.0f, std::max(exponent - MeshEncoder::positionBits, -126));
+}
+
+void MeshEncoder::encodeVertices(const float *vertices, int vertexCount, int vertexStride, float positionStep, std::vector<unsigned char> &output)
+{
+    std::vector<int32_t> channels((size_t)vertexCount * CHANNEL_COUNT);
+    for (int i = 0; i < vertexCount; i++)
+        quantizeVertex(vertices + (size_t)i * vertexStride, 1.0f / positionStep, &channels[(size_t)i * CHANNEL_COUNT]);
+
+    int32_t previous[CHANNEL_COUNT] = {};
+    uint32_t values[GROUP_SIZE];
+
+    for (int group = 0; group < vertexCount; group += GROUP_SIZE)
+    {
+        size_t widthOffset = output.size();
+        output.resize(widthOffset + CHANNEL_COUNT);
+
+        for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+        {
+            // the last group is padded with zero deltas
+            uint32_t maxValue = 0;
+            for (int i = 0; i < GROUP_SIZE; i++)
+            {
+                int32_t value = (group + i < vertexCount) ? channels[(size_t)(group + i) * CHANNEL_COUNT + channel] : previous[channel];
+                values[i] = zigzag((int32_t)((uint32_t)value - (uint32_t)previous[channel]));
+                previous[channel] = value;
+                maxValue |= values[i];
+            }
+
+            int width = 0;
+            while ((width < 32) && ((maxValue >> width) != 0))
+                width++;
+
+            output[widthOffset + channel] = (unsigned char)width;
+
+            // least significant bits first, 2 * width bytes per group
+            uint64_t bits = 0;
+            int bitCount = 0;
+            for (int i = 0; i < GROUP_SIZE; i++)
+            {
+                bits |= (uint64_t)values[i] << bitCount;
+                bitCount += width;
+                for (; bitCount >= 8; bitCount -= 8, bits >>= 8)
+                    output.push_back((unsigned char)bits);
+            }
+        }
+    }
+
+    output.insert(output.end(), STREAM_PADDING, 0);
+}
+
+void MeshEncoder::encodeIndices(const uint32_t *indices, size_t indexCount, std::vector<unsigned char> &output)
+{
+    // the decoder runs the same state updates from the codes
+    uint32_t edgeFifo[EDGE_FIFO_SIZE][2];
+    uint32_t vertexFifo[VERTEX_FIFO_SIZE];
+    memset(edgeFifo, 0xff, sizeof(edgeFifo));
+    memset(vertexFifo, 0xff, sizeof(vertexFifo));
+    int edgeOffset = 0;
+    int vertexOffset = 0;
+
+    uint32_t next = 0; // next vertex in order of first use
+    uint32_t last = 0; // last explicit vertex
+
+    auto pushEdge = [&](uint32_t a, uint32_t b)
+    {
+        edgeFifo[edgeOffset][0] = a;
+        edgeFifo[edgeOffset][1] = b;
+        edgeOffset = (edgeOffset + 1) % EDGE_FIFO_SIZE;
+    };
+
+    auto pushVertex = [&](uint32_t vertex)
+    {
+        vertexFifo[vertexOffset] = vertex;
+        vertexOffset = (vertexOffset + 1) % VERTEX_FIFO_SIZE;
+    };
+
+    // 0: next vertex, 1-14: vertex FIFO entry, 15: explicit, delta coded in the stream
+    auto encodeVertex = [&](uint32_t vertex) -> int
+    {
+        if (vertex == next)
+        {
+            next++;
+            pushVertex(vertex);
+            return 0;
+        }
+
+        for (int i = 0; i < VERTEX_FIFO_SIZE - 2; i++)
+        {
+            if (vertexFifo[(vertexOffset + VERTEX_FIFO_SIZE - 1 - i) % VERTEX_FIFO_SIZE] == vertex)
+                return i + 1;
+        }
+
+        writeVarint(output, zigzag((int32_t)(vertex - last)));
+        last = vertex;
+        next = std::max(next, vertex + 1);
+        pushVertex(vertex);
+        return 15;
+    };
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        // rotation of the triangle starting with a recent edge, most recent first
+        int edge = -1;
+        uint32_t triangle[3];
+        for (int j = 0; (j < EDGE_FIFO_SIZE - 1) && (edge < 0); j++)
+        {
+            const uint32_t *fifoEdge = edgeFifo[(edgeOffset + EDGE_FIFO_SIZE - 1 - j) % EDGE_FIFO_SIZE];
+            for (int k = 0; k < 3; k++)
+            {
+                if ((indices[i + k] == fifoEdge[0]) && (indices[i + (k + 1) % 3] == fifoEdge[1]))
+                {
+                    edge = j;
+                    triangle[0] = indices[i + k];
+                    triangle[1] = indices[i + (k + 1) % 3];
+                    triangle[2] = indices[i + (k + 2) % 3];
+                    break;
+                }
+            }
+        }
+
+        size_t codeOffset = output.size();
+        if (edge >= 0)
+        {
+            output.push_back(0);
+            output[codeOffset] = (unsigned char)((edge << 4) | encodeVertex(triangle[2]));
+
+            // edges as seen from the neighbouring triangles
+            pushEdge(triangle[2], triangle[1]);
+            pushEdge(triangle[0], triangle[2]);
+        }
+        else
+        {
+            uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+
+            output.resize(codeOffset + 2);
+            int codeA = encodeVertex(a);
+            int codeB = encodeVertex(b);
+            int codeC = encodeVertex(c);
+            output[codeOffset] = (unsigned char)(0xf0 | codeA);
+            output[codeOffset + 1] = (unsigned char)((codeB << 4) | codeC);
+
+            pushEdge(b, a);
+            pushEdge(c, b);
+            pushEdge(a, c);
+        }
+    }
+}
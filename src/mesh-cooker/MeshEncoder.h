@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Compressed streams of mesh blobs, decoded by MeshCodec in the engine.
+ *
+ * Vertices are quantized to what the engine uploads (VertexFormat): positions
+ * on a power of two grid, octahedral normals and tangents, half float uvs.
+ * Each component is delta coded against the previous vertex and bit packed
+ * in groups of 16 vertices, with one width byte per component and group.
+ *
+ * Index lists are coded per triangle from a FIFO of recent edges and a FIFO
+ * of recent vertices; with vertices in order of first use, most triangles
+ * take a single byte.
+ */
+class MeshEncoder
+{
+    public:
+        // first word of compressed blobs, never a valid vertex count
+        static const uint32_t magic = 0x31434d4c; // "LMC1"
+
+        // bits of the largest position coordinate
+        static const int positionBits = 20;
+
+        // power of two grid step, keeping positionBits for the largest coordinate
+        static float computePositionStep(const float *vertices, int vertexCount, int vertexStride);
+
+        // vertices have vertexStride floats: position, normal, tangent with bitangent sign, uv
+        static void encodeVertices(const float *vertices, int vertexCount, int vertexStride, float positionStep, std::vector<unsigned char> &output);
+
+        static void encodeIndices(const uint32_t *indices, size_t indexCount, std::vector<unsigned char> &output);
+};
@@ -0,0 +1,806 @@
+#include <mesh-cooker/MeshOptimizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#include <mesh-cooker/MeshEncoder.h>
+#include <mesh-cooker/MeshSimplifier.h>
+
+// vertex cache optimization parameters, from Forsyth's article
+static const int FORSYTH_CACHE_SIZE = 32;
+static const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+static const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+static const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+static const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+// clusters: submeshes smaller than this are not split
+static const size_t CLUSTER_MIN_TRIANGLE_COUNT = 4096;
+static const size_t CLUSTER_MAX_TRIANGLE_COUNT = 128;
+
+// cosine between a triangle normal and the average normal of the cluster it joins
+static const float CLUSTER_MIN_NORMAL_DOT = 0.7f;
+
+// levels of detail: meshes smaller than this are not simplified
+static const size_t LOD_MIN_TRIANGLE_COUNT = 64;
+
+// simplification stops at this error, relative to the bounding sphere radius
+static const float LOD_MAX_ERROR = 0.25f;
+
+// a level that keeps more than this fraction of the previous level's triangles is dropped
+static const float LOD_MIN_REDUCTION = 0.75f;
+
+template <typename Type>
+static void writeValues(std::vector<unsigned char> &output, const Type *values, size_t count)
+{
+    size_t offset = output.size();
+    output.resize(offset + sizeof(Type) * count);
+    if (count > 0)
+        memcpy(&output[offset], values, sizeof(Type) * count);
+}
+
+void MeshOptimizer::setVertices(std::vector<float> &vertices)
+{
+    this->vertices.swap(vertices);
+    this->vertexCount = (int)(this->vertices.size() / MeshOptimizer::vertexStride);
+}
+
+void MeshOptimizer::addSubMesh(const std::string &materialName, std::vector<uint32_t> &indices)
+{
+    this->subMeshes.push_back(SubMesh());
+    this->subMeshes.back().materialName = materialName;
+    this->subMeshes.back().indices.swap(indices);
+}
+
+void MeshOptimizer::write(std::vector<unsigned char> &output) const
+{
+    output.clear();
+
+    // streams are preceded by their size, so that the decoder can walk the blob before decoding
+    auto writeIndices = [&output](const std::vector<uint32_t> &indices)
+    {
+        uint32_t indexCount = (uint32_t)indices.size();
+        writeValues(output, &indexCount, 1);
+
+        size_t sizeOffset = output.size();
+        output.resize(sizeOffset + sizeof(uint32_t));
+        MeshEncoder::encodeIndices(indices.data(), indices.size(), output);
+
+        uint32_t dataSize = (uint32_t)(output.size() - sizeOffset - sizeof(uint32_t));
+        memcpy(&output[sizeOffset], &dataSize, sizeof(dataSize));
+    };
+
+    uint32_t magic = MeshEncoder::magic;
+    writeValues(output, &magic, 1);
+
+    uint32_t vertexCount = (uint32_t)this->vertexCount;
+    writeValues(output, &vertexCount, 1);
+
+    float positionStep = MeshEncoder::computePositionStep(this->vertices.data(), this->vertexCount, MeshOptimizer::vertexStride);
+    writeValues(output, &positionStep, 1);
+
+    size_t sizeOffset = output.size();
+    output.resize(sizeOffset + sizeof(uint32_t));
+    MeshEncoder::encodeVertices(this->vertices.data(), this->vertexCount, MeshOptimizer::vertexStride, positionStep, output);
+
+    uint32_t vertexDataSize = (uint32_t)(output.size() - sizeOffset - sizeof(uint32_t));
+    memcpy(&output[sizeOffset], &vertexDataSize, sizeof(vertexDataSize));
+
+    uint32_t materialCount = (uint32_t)this->subMeshes.size();
+    writeValues(output, &materialCount, 1);
+    for (const auto &subMesh : this->subMeshes)
+    {
+        uint32_t nameSize = (uint32_t)subMesh.materialName.size();
+        writeValues(output, &nameSize, 1);
+        writeValues(output, subMesh.materialName.data(), nameSize);
+
+        writeIndices(subMesh.indices);
+    }
+
+    // levels of detail, one index list per material in the same order
+    uint32_t lodCount = (uint32_t)this->lods.size();
+    writeValues(output, &lodCount, 1);
+    for (const auto &lod : this->lods)
+    {
+        writeValues(output, &lod.error, 1);
+        for (const auto &indices : lod.subMeshIndices)
+            writeIndices(indices);
+    }
+
+    // clusters of each material, covering its full detail index list
+    for (const auto &subMesh : this->subMeshes)
+    {
+        uint32_t clusterCount = (uint32_t)subMesh.clusters.size();
+        writeValues(output, &clusterCount, 1);
+        writeValues(output, subMesh.clusters.data(), clusterCount);
+    }
+}
+
+size_t MeshOptimizer::computeRawSize() const
+{
+    size_t size = sizeof(uint32_t) + this->vertices.size() * sizeof(float) + sizeof(uint32_t);
+    for (const auto &subMesh : this->subMeshes)
+        size += sizeof(uint32_t) + subMesh.materialName.size() + sizeof(uint32_t) + subMesh.indices.size() * sizeof(uint32_t);
+
+    size += sizeof(uint32_t);
+    for (const auto &lod : this->lods)
+    {
+        size += sizeof(float);
+        for (const auto &indices : lod.subMeshIndices)
+            size += sizeof(uint32_t) + indices.size() * sizeof(uint32_t);
+    }
+
+    for (const auto &subMesh : this->subMeshes)
+        size += sizeof(uint32_t) + subMesh.clusters.size() * sizeof(Cluster);
+
+    return size;
+}
+
+void MeshOptimizer::optimize(bool withLods, Stats *stats)
+{
+    stats->vertexCountBefore = this->vertexCount;
+    stats->acmrBefore = this->computeACMR(MeshOptimizer::fifoCacheSize);
+
+    this->weldVertices();
+
+    for (auto &subMesh : this->subMeshes)
+    {
+        this->optimizeVertexCache(subMesh.indices);
+        this->optimizeOverdraw(subMesh.indices);
+        this->buildClusters(subMesh);
+    }
+
+    this->optimizeVertexFetch();
+
+    // simplified levels only use vertices of the full detail one
+    this->lods.clear();
+    if (withLods)
+        this->generateLods();
+
+    for (auto &lod : this->lods)
+    {
+        for (auto &indices : lod.subMeshIndices)
+        {
+            this->optimizeVertexCache(indices);
+            this->optimizeOverdraw(indices);
+        }
+    }
+
+    stats->vertexCountAfter = this->vertexCount;
+    stats->acmrAfter = this->computeACMR(MeshOptimizer::fifoCacheSize);
+
+    stats->clusterCount = 0;
+    for (const auto &subMesh : this->subMeshes)
+        stats->clusterCount += (int)subMesh.clusters.size();
+
+    memset(stats->lodTriangleCounts, 0, sizeof(stats->lodTriangleCounts));
+    stats->lodCount = (int)this->lods.size();
+    for (const auto &subMesh : this->subMeshes)
+        stats->lodTriangleCounts[0] += (int)subMesh.indices.size() / 3;
+    for (int i = 0; i < (int)this->lods.size(); i++)
+    {
+        for (const auto &indices : this->lods[i].subMeshIndices)
+            stats->lodTriangleCounts[i + 1] += (int)indices.size() / 3;
+    }
+}
+
+// FIFO cache simulation; a vertex is cached if less than cacheSize misses happened since it was loaded
+class FifoCache
+{
+    public:
+        FifoCache(int vertexCount, int cacheSize)
+            : timestamps(vertexCount, -cacheSize - 1)
+            , cacheSize(cacheSize)
+            , missCount(0)
+        {}
+
+        // returns true on a miss
+        bool access(uint32_t vertex)
+        {
+            if (this->missCount - this->timestamps[vertex] < this->cacheSize)
+                return false;
+
+            this->timestamps[vertex] = this->missCount++;
+            return true;
+        }
+
+        int getMissCount() const { return this->missCount; }
+
+    private:
+        std::vector<int> timestamps;
+        int cacheSize;
+        int missCount;
+};
+
+float MeshOptimizer::computeACMR(int cacheSize) const
+{
+    FifoCache cache(this->vertexCount, cacheSize);
+
+    size_t triangleCount = 0;
+    for (const auto &subMesh : this->subMeshes)
+    {
+        for (uint32_t index : subMesh.indices)
+            cache.access(index);
+
+        triangleCount += subMesh.indices.size() / 3;
+    }
+
+    return (triangleCount > 0) ? (float)cache.getMissCount() / (float)triangleCount : 0.0f;
+}
+
+// FNV-1a over the attribute bits, one word at a time
+static uint32_t hashVertex(const float *vertex)
+{
+    uint32_t bits[MeshOptimizer::vertexStride];
+    memcpy(bits, vertex, sizeof(bits));
+
+    uint32_t hash = 2166136261u;
+    for (uint32_t value : bits)
+        hash = (hash ^ value) * 16777619u;
+
+    // multiplications only carry upwards, mix the high bits down for the table mask (murmur3 finalizer)
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+void MeshOptimizer::weldVertices()
+{
+    const size_t vertexSize = sizeof(float) * MeshOptimizer::vertexStride;
+
+    // open addressing over welded vertex indices, at most half full
+    size_t tableSize = 1;
+    while (tableSize < (size_t)this->vertexCount * 2)
+        tableSize *= 2;
+    std::vector<uint32_t> table(tableSize, UINT32_MAX);
+
+    std::vector<uint32_t> remap(this->vertexCount);
+    std::vector<float> weldedVertices;
+    weldedVertices.reserve(this->vertices.size());
+
+    for (int i = 0; i < this->vertexCount; i++)
+    {
+        const float *vertex = &this->vertices[i * MeshOptimizer::vertexStride];
+
+        // linear probing until the same bits or an empty slot are found
+        size_t slot = hashVertex(vertex) & (tableSize - 1);
+        while ((table[slot] != UINT32_MAX) && (memcmp(&weldedVertices[table[slot] * MeshOptimizer::vertexStride], vertex, vertexSize) != 0))
+            slot = (slot + 1) & (tableSize - 1);
+
+        if (table[slot] == UINT32_MAX)
+        {
+            table[slot] = (uint32_t)(weldedVertices.size() / MeshOptimizer::vertexStride);
+            weldedVertices.insert(weldedVertices.end(), vertex, vertex + MeshOptimizer::vertexStride);
+        }
+
+        remap[i] = table[slot];
+    }
+
+    for (auto &subMesh : this->subMeshes)
+    {
+        for (uint32_t &index : subMesh.indices)
+            index = remap[index];
+    }
+
+    this->vertices.swap(weldedVertices);
+    this->vertexCount = (int)(this->vertices.size() / MeshOptimizer::vertexStride);
+}
+
+// valences past this share the score of the last entry
+static const int FORSYTH_MAX_VALENCE = 64;
+
+// the formulas from the article, tabulated once as they are evaluated for every cached vertex at each step
+struct VertexScoreTables
+{
+    float cache[FORSYTH_CACHE_SIZE + 1]; // shifted by one, the first entry is for vertices out of the cache
+    float valence[FORSYTH_MAX_VALENCE + 1];
+
+    VertexScoreTables()
+    {
+        this->cache[0] = 0.0f;
+        for (int i = 0; i < FORSYTH_CACHE_SIZE; i++)
+        {
+            // the last triangle's vertices get a fixed score, to avoid favoring strips
+            if (i < 3)
+                this->cache[i + 1] = FORSYTH_LAST_TRIANGLE_SCORE;
+            else
+                this->cache[i + 1] = powf(1.0f - (float)(i - 3) / (float)(FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+        }
+
+        // boost vertices with few triangles left, to get rid of lone triangles
+        this->valence[0] = 0.0f;
+        for (int i = 1; i <= FORSYTH_MAX_VALENCE; i++)
+            this->valence[i] = FORSYTH_VALENCE_BOOST_SCALE * powf((float)i, -FORSYTH_VALENCE_BOOST_POWER);
+    }
+};
+
+static const VertexScoreTables vertexScoreTables;
+
+static float computeVertexScore(int cachePosition, int remainingTriangles)
+{
+    // no triangle left to use this vertex
+    if (remainingTriangles == 0)
+        return -1.0f;
+
+    return vertexScoreTables.cache[cachePosition + 1] + vertexScoreTables.valence[std::min(remainingTriangles, FORSYTH_MAX_VALENCE)];
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t> &indices) const
+{
+    int triangleCount = (int)indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // vertex to triangle adjacency; the remaining triangles of a vertex are kept at the front of its range
+    std::vector<int> remainingTriangles(this->vertexCount, 0);
+    for (uint32_t index : indices)
+        remainingTriangles[index]++;
+
+    std::vector<int> adjacencyOffsets(this->vertexCount + 1, 0);
+    for (int i = 0; i < this->vertexCount; i++)
+        adjacencyOffsets[i + 1] = adjacencyOffsets[i] + remainingTriangles[i];
+
+    std::vector<int> adjacency(indices.size());
+    std::vector<int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (int i = 0; i < triangleCount * 3; i++)
+        adjacency[fill[indices[i]]++] = i / 3;
+
+    std::vector<int> cachePositions(this->vertexCount, -1);
+    std::vector<float> vertexScores(this->vertexCount);
+    for (int i = 0; i < this->vertexCount; i++)
+        vertexScores[i] = computeVertexScore(-1, remainingTriangles[i]);
+
+    std::vector<float> triangleScores(triangleCount);
+    for (int i = 0; i < triangleCount; i++)
+        triangleScores[i] = vertexScores[indices[i * 3]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    // the 3 new vertices are pushed at the front; entries past the cache size are evicted
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    int bestTriangle = (int)(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+    int scanPosition = 0;
+
+    while ((int)result.size() < triangleCount * 3)
+    {
+        if (bestTriangle < 0)
+        {
+            // nothing adjacent to the cache, restart from the next triangle in input order
+            while (emitted[scanPosition])
+                scanPosition++;
+            bestTriangle = scanPosition;
+        }
+
+        emitted[bestTriangle] = 1;
+
+        const uint32_t *triangle = &indices[bestTriangle * 3];
+        nextCache.assign(triangle, triangle + 3);
+
+        for (int i = 0; i < 3; i++)
+        {
+            uint32_t vertex = triangle[i];
+
+            // move the triangle past the remaining range of the vertex
+            int *begin = &adjacency[adjacencyOffsets[vertex]];
+            int *last = begin + remainingTriangles[vertex] - 1;
+            *std::find(begin, last + 1, bestTriangle) = *last;
+            *last = bestTriangle;
+            remainingTriangles[vertex]--;
+
+            result.push_back(vertex);
+        }
+
+        for (uint32_t vertex : cache)
+        {
+            if ((vertex != triangle[0]) && (vertex != triangle[1]) && (vertex != triangle[2]))
+                nextCache.push_back(vertex);
+        }
+
+        // evicted vertices lose their cache score
+        for (size_t i = FORSYTH_CACHE_SIZE; i < nextCache.size(); i++)
+            cachePositions[nextCache[i]] = -1;
+
+        if (nextCache.size() > FORSYTH_CACHE_SIZE)
+        {
+            for (size_t i = FORSYTH_CACHE_SIZE; i < nextCache.size(); i++)
+            {
+                uint32_t vertex = nextCache[i];
+                float score = computeVertexScore(-1, remainingTriangles[vertex]);
+                float delta = score - vertexScores[vertex];
+                vertexScores[vertex] = score;
+
+                for (int j = 0; j < remainingTriangles[vertex]; j++)
+                    triangleScores[adjacency[adjacencyOffsets[vertex] + j]] += delta;
+            }
+
+            nextCache.resize(FORSYTH_CACHE_SIZE);
+        }
+
+        // rescore cached vertices, and pick the best triangle among their remaining ones
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (int i = 0; i < (int)nextCache.size(); i++)
+        {
+            uint32_t vertex = nextCache[i];
+            cachePositions[vertex] = i;
+
+            float score = computeVertexScore(i, remainingTriangles[vertex]);
+            float delta = score - vertexScores[vertex];
+            vertexScores[vertex] = score;
+
+            for (int j = 0; j < remainingTriangles[vertex]; j++)
+                triangleScores[adjacency[adjacencyOffsets[vertex] + j]] += delta;
+        }
+
+        for (uint32_t vertex : nextCache)
+        {
+            for (int j = 0; j < remainingTriangles[vertex]; j++)
+            {
+                int candidate = adjacency[adjacencyOffsets[vertex] + j];
+                if (triangleScores[candidate] > bestScore)
+                {
+                    bestScore = triangleScores[candidate];
+                    bestTriangle = candidate;
+                }
+            }
+        }
+
+        cache.swap(nextCache);
+    }
+
+    indices.swap(result);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t> &indices) const
+{
+    int triangleCount = (int)indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // a triangle missing all its vertices starts a new cluster; reordering clusters
+    // keeps the cache efficiency as the cache is cold at these boundaries anyway
+    std::vector<int> clusterStarts;
+    FifoCache cache(this->vertexCount, MeshOptimizer::fifoCacheSize);
+    for (int i = 0; i < triangleCount; i++)
+    {
+        int misses = 0;
+        for (int j = 0; j < 3; j++)
+            misses += cache.access(indices[i * 3 + j]) ? 1 : 0;
+
+        if (misses == 3)
+            clusterStarts.push_back(i);
+    }
+    clusterStarts.push_back(triangleCount);
+
+    int clusterCount = (int)clusterStarts.size() - 1;
+    if (clusterCount < 2)
+        return;
+
+    // area weighted centroids and normals
+    auto position = [this](uint32_t vertex) -> const float * { return &this->vertices[vertex * MeshOptimizer::vertexStride]; };
+
+    std::vector<float> clusterData(clusterCount * 6, 0.0f); // centroid * area, normal * area
+    std::vector<float> clusterAreas(clusterCount, 0.0f);
+    float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+
+    for (int cluster = 0; cluster < clusterCount; cluster++)
+    {
+        float *data = &clusterData[cluster * 6];
+        for (int i = clusterStarts[cluster]; i < clusterStarts[cluster + 1]; i++)
+        {
+            const float *p0 = position(indices[i * 3]);
+            const float *p1 = position(indices[i * 3 + 1]);
+            const float *p2 = position(indices[i * 3 + 2]);
+
+            float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            float area = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+            for (int k = 0; k < 3; k++)
+            {
+                float center = (p0[k] + p1[k] + p2[k]) / 3.0f;
+                data[k] += center * area;
+                data[3 + k] += normal[k];
+                meshCentroid[k] += center * area;
+            }
+
+            clusterAreas[cluster] += area;
+            meshArea += area;
+        }
+    }
+
+    if (meshArea <= 0.0f)
+        return;
+
+    for (int k = 0; k < 3; k++)
+        meshCentroid[k] /= meshArea;
+
+    // clusters facing away from the center are more likely to occlude the others
+    std::vector<float> sortKeys(clusterCount, 0.0f);
+    for (int cluster = 0; cluster < clusterCount; cluster++)
+    {
+        const float *data = &clusterData[cluster * 6];
+        float area = clusterAreas[cluster];
+        float normalLength = sqrtf(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+        if ((area <= 0.0f) || (normalLength <= 0.0f))
+            continue;
+
+        for (int k = 0; k < 3; k++)
+            sortKeys[cluster] += (data[k] / area - meshCentroid[k]) * data[3 + k] / normalLength;
+    }
+
+    std::vector<int> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](int a, int b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (int cluster : order)
+        result.insert(result.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+
+    indices.swap(result);
+}
+
+void MeshOptimizer::buildClusters(SubMesh &subMesh) const
+{
+    const std::vector<uint32_t> &indices = subMesh.indices;
+    int triangleCount = (int)indices.size() / 3;
+    if ((size_t)triangleCount < CLUSTER_MIN_TRIANGLE_COUNT)
+        return;
+
+    auto position = [this](uint32_t vertex) -> const float * { return &this->vertices[vertex * MeshOptimizer::vertexStride]; };
+
+    // unit face normals, zero for degenerate triangles
+    std::vector<float> normals(triangleCount * 3, 0.0f);
+    for (int i = 0; i < triangleCount; i++)
+    {
+        const float *p0 = position(indices[i * 3]);
+        const float *p1 = position(indices[i * 3 + 1]);
+        const float *p2 = position(indices[i * 3 + 2]);
+
+        float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float *normal = &normals[i * 3];
+        normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+        float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (int k = 0; (k < 3) && (length > 0.0f); k++)
+            normal[k] /= length;
+    }
+
+    // triangles around each vertex
+    std::vector<int> adjacencyOffsets(this->vertexCount + 1, 0);
+    for (uint32_t index : indices)
+        adjacencyOffsets[index + 1]++;
+    for (int i = 0; i < this->vertexCount; i++)
+        adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+
+    std::vector<int> adjacency(indices.size());
+    std::vector<int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+        adjacency[fill[indices[i]]++] = (int)(i / 3);
+
+    std::vector<uint32_t> clusteredIndices;
+    clusteredIndices.reserve(indices.size());
+    subMesh.clusters.clear();
+
+    std::vector<uint8_t> assigned(triangleCount, 0);
+    std::vector<int> queue;
+    queue.reserve(CLUSTER_MAX_TRIANGLE_COUNT * 4);
+
+    // each unassigned triangle, in the optimized order, seeds a cluster grown breadth first over shared vertices
+    for (int seed = 0; seed < triangleCount; seed++)
+    {
+        if (assigned[seed])
+            continue;
+
+        queue.assign(1, seed);
+        assigned[seed] = 1;
+
+        float normalSum[3] = { normals[seed * 3], normals[seed * 3 + 1], normals[seed * 3 + 2] };
+        size_t head = 0;
+        for (; (head < queue.size()) && (head < CLUSTER_MAX_TRIANGLE_COUNT); head++)
+        {
+            int triangle = queue[head];
+            if (head > 0)
+            {
+                for (int k = 0; k < 3; k++)
+                    normalSum[k] += normals[triangle * 3 + k];
+            }
+
+            float sumLength = sqrtf(normalSum[0] * normalSum[0] + normalSum[1] * normalSum[1] + normalSum[2] * normalSum[2]);
+            for (int j = 0; j < 3; j++)
+            {
+                uint32_t vertex = indices[triangle * 3 + j];
+                for (int k = adjacencyOffsets[vertex]; k < adjacencyOffsets[vertex + 1]; k++)
+                {
+                    int neighbour = adjacency[k];
+                    if (assigned[neighbour])
+                        continue;
+
+                    const float *normal = &normals[neighbour * 3];
+                    float dot = normal[0] * normalSum[0] + normal[1] * normalSum[1] + normal[2] * normalSum[2];
+                    bool degenerate = (normal[0] == 0.0f) && (normal[1] == 0.0f) && (normal[2] == 0.0f);
+                    if (!degenerate && (dot < CLUSTER_MIN_NORMAL_DOT * sumLength))
+                        continue;
+
+                    assigned[neighbour] = 1;
+                    queue.push_back(neighbour);
+                }
+            }
+        }
+
+        // triangles queued past the size limit are left for the next clusters
+        for (size_t i = head; i < queue.size(); i++)
+            assigned[queue[i]] = 0;
+        queue.resize(head);
+
+        std::sort(queue.begin(), queue.end());
+
+        Cluster cluster;
+        cluster.triangleCount = (uint32_t)queue.size();
+
+        float minBound[3], maxBound[3];
+        for (size_t i = 0; i < queue.size(); i++)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                uint32_t vertex = indices[queue[i] * 3 + j];
+                clusteredIndices.push_back(vertex);
+
+                for (int k = 0; k < 3; k++)
+                {
+                    minBound[k] = ((i == 0) && (j == 0)) ? position(vertex)[k] : std::min(minBound[k], position(vertex)[k]);
+                    maxBound[k] = ((i == 0) && (j == 0)) ? position(vertex)[k] : std::max(maxBound[k], position(vertex)[k]);
+                }
+            }
+        }
+
+        // sphere around the box center
+        for (int k = 0; k < 3; k++)
+            cluster.center[k] = (minBound[k] + maxBound[k]) * 0.5f;
+
+        float radiusSquared = 0.0f;
+        for (int triangle : queue)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                const float *p = position(indices[triangle * 3 + j]);
+                float d[3] = { p[0] - cluster.center[0], p[1] - cluster.center[1], p[2] - cluster.center[2] };
+                radiusSquared = std::max(radiusSquared, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            }
+        }
+        cluster.radius = sqrtf(radiusSquared);
+
+        // the cone contains all face normals; triangles are all back facing when seen from
+        // a direction within (90 degrees - cone angle) of the axis
+        float axisLength = 0.0f;
+        for (int k = 0; k < 3; k++)
+        {
+            cluster.coneAxis[k] = 0.0f;
+            for (int triangle : queue)
+                cluster.coneAxis[k] += normals[triangle * 3 + k];
+
+            axisLength += cluster.coneAxis[k] * cluster.coneAxis[k];
+        }
+
+        axisLength = sqrtf(axisLength);
+        float minDot = (axisLength > 0.0f) ? 1.0f : -1.0f;
+        for (int k = 0; k < 3; k++)
+            cluster.coneAxis[k] = (axisLength > 0.0f) ? cluster.coneAxis[k] / axisLength : 0.0f;
+
+        for (int triangle : queue)
+        {
+            const float *normal = &normals[triangle * 3];
+            minDot = std::min(minDot, normal[0] * cluster.coneAxis[0] + normal[1] * cluster.coneAxis[1] + normal[2] * cluster.coneAxis[2]);
+        }
+
+        cluster.coneCutoff = (minDot > 0.0f) ? sqrtf(1.0f - minDot * minDot) : 1.0f;
+
+        subMesh.clusters.push_back(cluster);
+    }
+
+    subMesh.indices.swap(clusteredIndices);
+}
+
+void MeshOptimizer::optimizeVertexFetch()
+{
+    std::vector<uint32_t> remap(this->vertexCount, UINT32_MAX);
+    std::vector<float> orderedVertices;
+    orderedVertices.reserve(this->vertices.size());
+
+    // unreferenced vertices are dropped
+    for (auto &subMesh : this->subMeshes)
+    {
+        for (uint32_t &index : subMesh.indices)
+        {
+            if (remap[index] == UINT32_MAX)
+            {
+                remap[index] = (uint32_t)(orderedVertices.size() / MeshOptimizer::vertexStride);
+                orderedVertices.insert(orderedVertices.end(), &this->vertices[index * MeshOptimizer::vertexStride], &this->vertices[(index + 1) * MeshOptimizer::vertexStride]);
+            }
+
+            index = remap[index];
+        }
+    }
+
+    this->vertices.swap(orderedVertices);
+    this->vertexCount = (int)(this->vertices.size() / MeshOptimizer::vertexStride);
+}
+
+void MeshOptimizer::generateLods()
+{
+    this->lods.clear();
+
+    std::vector<std::vector<uint32_t>> indices;
+    size_t triangleCount = 0;
+    for (const auto &subMesh : this->subMeshes)
+    {
+        indices.push_back(subMesh.indices);
+        triangleCount += subMesh.indices.size() / 3;
+    }
+
+    if ((triangleCount < LOD_MIN_TRIANGLE_COUNT) || (this->vertexCount == 0))
+        return;
+
+    // same bounding sphere as computed by the engine: around the bounds center, through the farthest vertex
+    float minBound[3], maxBound[3];
+    for (int k = 0; k < 3; k++)
+        minBound[k] = maxBound[k] = this->vertices[k];
+
+    for (int i = 1; i < this->vertexCount; i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            minBound[k] = std::min(minBound[k], this->vertices[i * MeshOptimizer::vertexStride + k]);
+            maxBound[k] = std::max(maxBound[k], this->vertices[i * MeshOptimizer::vertexStride + k]);
+        }
+    }
+
+    float squaredRadius = 0.0f;
+    for (int i = 0; i < this->vertexCount; i++)
+    {
+        float squaredDistance = 0.0f;
+        for (int k = 0; k < 3; k++)
+        {
+            float delta = this->vertices[i * MeshOptimizer::vertexStride + k] - (minBound[k] + maxBound[k]) * 0.5f;
+            squaredDistance += delta * delta;
+        }
+        squaredRadius = std::max(squaredRadius, squaredDistance);
+    }
+
+    float radius = sqrtf(squaredRadius);
+    if (radius <= 0.0f)
+        return;
+
+    // each level is simplified from the previous one
+    MeshSimplifier simplifier(this->vertices.data(), this->vertexCount, MeshOptimizer::vertexStride, indices);
+    while (((int)this->lods.size() < MeshOptimizer::maxLodCount) && (triangleCount >= LOD_MIN_TRIANGLE_COUNT))
+    {
+        float error = simplifier.simplify(indices, triangleCount / 2, LOD_MAX_ERROR * radius);
+
+        size_t lodTriangleCount = 0;
+        for (const auto &subMeshIndices : indices)
+            lodTriangleCount += subMeshIndices.size() / 3;
+
+        if (lodTriangleCount > triangleCount * LOD_MIN_REDUCTION)
+            break;
+
+        this->lods.push_back({ error / radius, indices });
+        triangleCount = lodTriangleCount;
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Cook time optimization of exported meshes, with fewer vertices and better
+ * ordered triangles, followed by simplified index lists for levels of detail.
+ * The blob read by Mesh::load is compressed with MeshEncoder; the raw layout
+ * (vertex count, 12 floats per vertex, then one index list per material and
+ * level) is only kept in the engine for older exports.
+ */
+class MeshOptimizer
+{
+    public:
+        // position, normal, tangent, uv
+        static const int vertexStride = 3 + 3 + 4 + 2;
+
+        // post-transform cache size used for statistics and cluster splitting
+        static const int fifoCacheSize = 16;
+
+        // simplified levels, beyond the full detail one
+        static const int maxLodCount = 4;
+
+        struct Stats
+        {
+            int vertexCountBefore;
+            int vertexCountAfter;
+            float acmrBefore; // average cache miss ratio, transformed vertices per triangle
+            float acmrAfter;
+            int lodCount;
+            int lodTriangleCounts[1 + maxLodCount]; // full detail first
+            int rawSize; // blob bytes without compression
+            int compressedSize;
+            int clusterCount;
+        };
+
+        // the vectors are swapped in
+        void setVertices(std::vector<float> &vertices);
+        void addSubMesh(const std::string &materialName, std::vector<uint32_t> &indices);
+
+        void write(std::vector<unsigned char> &output) const;
+
+        // size of the uncompressed layout, for statistics
+        size_t computeRawSize() const;
+
+        // without levels of detail, the mesh is always drawn at full detail
+        void optimize(bool withLods, Stats *stats);
+
+        // over all submeshes, in draw order
+        float computeACMR(int cacheSize) const;
+
+    private:
+        // contiguous triangles of a submesh, in index order
+        struct Cluster
+        {
+            uint32_t triangleCount;
+            float center[3];
+            float radius;
+            float coneAxis[3]; // average normal
+            float coneCutoff; // sine of the cone angle, 1 when the cluster can't be culled by orientation
+        };
+
+        struct SubMesh
+        {
+            std::string materialName;
+            std::vector<uint32_t> indices;
+            std::vector<Cluster> clusters; // only for large submeshes
+        };
+
+        // merge vertices with identical attributes
+        void weldVertices();
+
+        // Forsyth's linear-speed vertex cache optimization
+        void optimizeVertexCache(std::vector<uint32_t> &indices) const;
+
+        // Sander et al.: split in clusters at cache boundaries, draw outer facing clusters first
+        void optimizeOverdraw(std::vector<uint32_t> &indices) const;
+
+        // splits large submeshes in patches of similar orientation for runtime culling, keeping the
+        // triangle order within each patch and the order of patches by their first triangle
+        void buildClusters(SubMesh &subMesh) const;
+
+        // vertices in the order of first use
+        void optimizeVertexFetch();
+
+        // chain of simplified index lists, each half of the previous one at most
+        void generateLods();
+
+        int vertexCount = 0;
+        std::vector<float> vertices;
+        std::vector<SubMesh> subMeshes;
+
+        struct Lod
+        {
+            float error; // relative to the bounding sphere radius
+            std::vector<std::vector<uint32_t>> subMeshIndices;
+        };
+        std::vector<Lod> lods;
+};
@@ -0,0 +1,292 @@
+#include <mesh-cooker/MeshSimplifier.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+// relative to the normal lengths, rejects collapses that turn triangles over or make them degenerate
+static const float FLIP_THRESHOLD = 1e-2f;
+
+static void cross(const float *a, const float *b, const float *c, float *normal)
+{
+    float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+void MeshSimplifier::Quadric::add(const Quadric &other)
+{
+    this->a00 += other.a00;
+    this->a11 += other.a11;
+    this->a22 += other.a22;
+    this->a01 += other.a01;
+    this->a02 += other.a02;
+    this->a12 += other.a12;
+    this->b0 += other.b0;
+    this->b1 += other.b1;
+    this->b2 += other.b2;
+    this->c += other.c;
+    this->weight += other.weight;
+}
+
+double MeshSimplifier::Quadric::evaluate(const float *position) const
+{
+    double x = position[0], y = position[1], z = position[2];
+
+    double result = x * x * this->a00 + y * y * this->a11 + z * z * this->a22
+        + 2.0 * (x * y * this->a01 + x * z * this->a02 + y * z * this->a12)
+        + 2.0 * (x * this->b0 + y * this->b1 + z * this->b2)
+        + this->c;
+
+    return (this->weight > 0.0) ? std::max(result / this->weight, 0.0) : 0.0;
+}
+
+MeshSimplifier::MeshSimplifier(const float *vertices, int vertexCount, int vertexStride, const std::vector<std::vector<uint32_t>> &subMeshIndices)
+    : vertices(vertices)
+    , vertexCount(vertexCount)
+    , vertexStride(vertexStride)
+    , quadrics(vertexCount)
+    , locked(vertexCount, 0)
+{
+    memset(this->quadrics.data(), 0, sizeof(Quadric) * this->quadrics.size());
+
+    // plane of each triangle, weighted by area
+    for (const auto &indices : subMeshIndices)
+    {
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            const float *p0 = this->getPosition(indices[i]);
+
+            float normal[3];
+            cross(p0, this->getPosition(indices[i + 1]), this->getPosition(indices[i + 2]), normal);
+
+            double length = sqrt((double)normal[0] * normal[0] + (double)normal[1] * normal[1] + (double)normal[2] * normal[2]);
+            if (length <= 0.0)
+                continue;
+
+            double a = normal[0] / length, b = normal[1] / length, c = normal[2] / length;
+            double d = -(a * p0[0] + b * p0[1] + c * p0[2]);
+            double weight = length * 0.5;
+
+            Quadric quadric = { a * a * weight, b * b * weight, c * c * weight, a * b * weight, a * c * weight, b * c * weight, a * d * weight, b * d * weight, c * d * weight, d * d * weight, weight };
+            for (int j = 0; j < 3; j++)
+                this->quadrics[indices[i + j]].add(quadric);
+        }
+
+        this->lockOpenEdges(indices);
+    }
+
+    this->lockSeams();
+}
+
+void MeshSimplifier::lockOpenEdges(const std::vector<uint32_t> &indices)
+{
+    // directed edges; an edge without its opposite is a border, or a seam
+    // or a material boundary as vertices or submeshes differ on the other side
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        for (int j = 0; j < 3; j++)
+            edges.push_back(((uint64_t)indices[i + j] << 32) | indices[i + (j + 1) % 3]);
+    }
+
+    std::sort(edges.begin(), edges.end());
+
+    for (uint64_t edge : edges)
+    {
+        uint32_t from = (uint32_t)(edge >> 32);
+        uint32_t to = (uint32_t)edge;
+        if (!std::binary_search(edges.begin(), edges.end(), ((uint64_t)to << 32) | from))
+        {
+            this->locked[from] = 1;
+            this->locked[to] = 1;
+        }
+    }
+}
+
+void MeshSimplifier::lockSeams()
+{
+    // vertices sharing a position with another vertex
+    std::vector<uint32_t> order(this->vertexCount);
+    std::iota(order.begin(), order.end(), 0);
+
+    auto comparePositions = [this](uint32_t a, uint32_t b) { return memcmp(this->getPosition(a), this->getPosition(b), sizeof(float) * 3) < 0; };
+    std::sort(order.begin(), order.end(), comparePositions);
+
+    for (size_t i = 1; i < order.size(); i++)
+    {
+        if (memcmp(this->getPosition(order[i - 1]), this->getPosition(order[i]), sizeof(float) * 3) == 0)
+        {
+            this->locked[order[i - 1]] = 1;
+            this->locked[order[i]] = 1;
+        }
+    }
+}
+
+bool MeshSimplifier::flipsTriangle(uint32_t vertex, uint32_t target, const std::vector<uint32_t> &indices, const std::vector<int> &adjacencyOffsets, const std::vector<int> &adjacency) const
+{
+    const float *targetPosition = this->getPosition(target);
+
+    for (int i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; i++)
+    {
+        const uint32_t *triangle = &indices[adjacency[i] * 3];
+
+        // triangles on the collapsed edge disappear
+        if ((triangle[0] == target) || (triangle[1] == target) || (triangle[2] == target))
+            continue;
+
+        // rotate so that the moved vertex is first
+        int k = (triangle[0] == vertex) ? 0 : ((triangle[1] == vertex) ? 1 : 2);
+        const float *p1 = this->getPosition(triangle[(k + 1) % 3]);
+        const float *p2 = this->getPosition(triangle[(k + 2) % 3]);
+
+        float before[3], after[3];
+        cross(this->getPosition(vertex), p1, p2, before);
+        cross(targetPosition, p1, p2, after);
+
+        float dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+        float lengths = sqrtf(before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) * sqrtf(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+        if (dot <= FLIP_THRESHOLD * lengths)
+            return true;
+    }
+
+    return false;
+}
+
+float MeshSimplifier::simplify(std::vector<std::vector<uint32_t>> &subMeshIndices, size_t targetTriangleCount, float maxError)
+{
+    // all submeshes are simplified together, triangles remember their submesh
+    std::vector<uint32_t> indices;
+    std::vector<int> triangleSubMeshes;
+    for (size_t i = 0; i < subMeshIndices.size(); i++)
+    {
+        indices.insert(indices.end(), subMeshIndices[i].begin(), subMeshIndices[i].end());
+        triangleSubMeshes.insert(triangleSubMeshes.end(), subMeshIndices[i].size() / 3, (int)i);
+    }
+
+    struct Collapse
+    {
+        uint32_t vertex;
+        uint32_t target;
+        float cost;
+    };
+    std::vector<Collapse> collapses;
+
+    std::vector<int> adjacencyOffsets;
+    std::vector<int> adjacency;
+    std::vector<uint32_t> remap(this->vertexCount);
+    std::vector<uint8_t> touched(this->vertexCount);
+
+    double maxCost = (double)maxError * (double)maxError;
+
+    // each pass collapses a set of independent edges, cheapest first
+    while (indices.size() / 3 > targetTriangleCount)
+    {
+        size_t triangleCount = indices.size() / 3;
+
+        adjacencyOffsets.assign(this->vertexCount + 1, 0);
+        for (uint32_t index : indices)
+            adjacencyOffsets[index + 1]++;
+        for (int i = 0; i < this->vertexCount; i++)
+            adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+
+        adjacency.resize(indices.size());
+        std::vector<int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency[fill[indices[i]]++] = (int)(i / 3);
+
+        // cheapest collapse of each vertex
+        collapses.assign(this->vertexCount, { 0, 0, FLT_MAX });
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                uint32_t a = indices[i + j];
+                uint32_t b = indices[i + (j + 1) % 3];
+
+                if (!this->locked[a])
+                {
+                    float cost = (float)this->quadrics[a].evaluate(this->getPosition(b));
+                    if (cost < collapses[a].cost)
+                        collapses[a] = { a, b, cost };
+                }
+
+                if (!this->locked[b])
+                {
+                    float cost = (float)this->quadrics[b].evaluate(this->getPosition(a));
+                    if (cost < collapses[b].cost)
+                        collapses[b] = { b, a, cost };
+                }
+            }
+        }
+
+        collapses.erase(std::remove_if(collapses.begin(), collapses.end(), [](const Collapse &collapse) { return collapse.cost == FLT_MAX; }), collapses.end());
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+        // a collapse removes two triangles on closed surfaces
+        size_t collapseLimit = std::max((triangleCount - targetTriangleCount) / 2, (size_t)1);
+        size_t collapseCount = 0;
+
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), 0);
+
+        for (const Collapse &collapse : collapses)
+        {
+            if ((collapseCount >= collapseLimit) || (collapse.cost > maxCost))
+                break;
+
+            if (touched[collapse.vertex] || touched[collapse.target])
+                continue;
+
+            if (this->flipsTriangle(collapse.vertex, collapse.target, indices, adjacencyOffsets, adjacency))
+                continue;
+
+            remap[collapse.vertex] = collapse.target;
+            this->quadrics[collapse.target].add(this->quadrics[collapse.vertex]);
+            this->error = std::max(this->error, sqrtf(collapse.cost));
+
+            // the triangles around the moved vertex change, their vertices wait for the next pass
+            for (int i = adjacencyOffsets[collapse.vertex]; i < adjacencyOffsets[collapse.vertex + 1]; i++)
+            {
+                const uint32_t *triangle = &indices[adjacency[i] * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+            }
+
+            collapseCount++;
+        }
+
+        if (collapseCount == 0)
+            break;
+
+        // remove the triangles that became degenerate
+        size_t writeTriangle = 0;
+        for (size_t i = 0; i < triangleCount; i++)
+        {
+            uint32_t a = remap[indices[i * 3]], b = remap[indices[i * 3 + 1]], c = remap[indices[i * 3 + 2]];
+            if ((a == b) || (b == c) || (c == a))
+                continue;
+
+            indices[writeTriangle * 3] = a;
+            indices[writeTriangle * 3 + 1] = b;
+            indices[writeTriangle * 3 + 2] = c;
+            triangleSubMeshes[writeTriangle] = triangleSubMeshes[i];
+            writeTriangle++;
+        }
+
+        indices.resize(writeTriangle * 3);
+        triangleSubMeshes.resize(writeTriangle);
+    }
+
+    for (auto &subMesh : subMeshIndices)
+        subMesh.clear();
+
+    for (size_t i = 0; i < triangleSubMeshes.size(); i++)
+        subMeshIndices[triangleSubMeshes[i]].insert(subMeshIndices[triangleSubMeshes[i]].end(), &indices[i * 3], &indices[i * 3 + 3]);
+
+    return this->error;
+}
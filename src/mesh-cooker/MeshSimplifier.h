@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Edge collapse simplification with quadric error metrics (Garland & Heckbert).
+ * Vertices only collapse onto existing neighbours, so that all levels share the
+ * vertex buffer. Vertices on borders, attribute seams and material boundaries
+ * are locked: they can be collapsed onto but never move.
+ *
+ * Quadrics are kept between calls, so that a chain of levels is built by
+ * simplifying the previous level again.
+ */
+class MeshSimplifier
+{
+    public:
+        // vertices have vertexStride floats, position first
+        MeshSimplifier(const float *vertices, int vertexCount, int vertexStride, const std::vector<std::vector<uint32_t>> &subMeshIndices);
+
+        // collapses edges until there are at most targetTriangleCount triangles left, or until the next
+        // collapse would exceed maxError (object space distance); returns the error reached so far
+        float simplify(std::vector<std::vector<uint32_t>> &subMeshIndices, size_t targetTriangleCount, float maxError);
+
+    private:
+        struct Quadric
+        {
+            double a00, a11, a22, a01, a02, a12; // symmetric 3x3
+            double b0, b1, b2;
+            double c;
+            double weight;
+
+            void add(const Quadric &other);
+            double evaluate(const float *position) const; // squared distance, normalized by weight
+        };
+
+        const float *getPosition(uint32_t vertex) const { return &this->vertices[vertex * this->vertexStride]; }
+
+        void lockOpenEdges(const std::vector<uint32_t> &indices);
+        void lockSeams();
+
+        bool flipsTriangle(uint32_t vertex, uint32_t target, const std::vector<uint32_t> &indices, const std::vector<int> &adjacencyOffsets, const std::vector<int> &adjacency) const;
+
+        const float *vertices;
+        int vertexCount;
+        int vertexStride;
+
+        std::vector<Quadric> quadrics;
+        std::vector<uint8_t> locked;
+
+        float error = 0.0f;
+};
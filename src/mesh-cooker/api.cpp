@@ -0,0 +1,68 @@
+#include <mesh-cooker/api.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <mesh-cooker/MeshCooker.h>
+
+static_assert(sizeof(MeshCookingStats) == sizeof(MeshOptimizer::Stats), "stats are shared with the python side");
+
+static void cookMesh(const MeshCookingInput &input, bool generateLods, MeshCookingOutput &output)
+{
+    output.data = nullptr;
+    output.size = 0;
+    memset(&output.stats, 0, sizeof(output.stats));
+
+    MeshOptimizer::Stats stats;
+    std::vector<unsigned char> blob;
+    if (!MeshCooker::cook(input, generateLods, blob, &stats))
+        return;
+
+    void *data = malloc(blob.size());
+    memcpy(data, blob.data(), blob.size());
+
+    output.data = data;
+    output.size = blob.size();
+    output.stats.vertexCountBefore = stats.vertexCountBefore;
+    output.stats.vertexCountAfter = stats.vertexCountAfter;
+    output.stats.acmrBefore = stats.acmrBefore;
+    output.stats.acmrAfter = stats.acmrAfter;
+    output.stats.lodCount = stats.lodCount;
+    memcpy(output.stats.lodTriangleCounts, stats.lodTriangleCounts, sizeof(stats.lodTriangleCounts));
+    output.stats.rawSize = stats.rawSize;
+    output.stats.compressedSize = stats.compressedSize;
+    output.stats.clusterCount = stats.clusterCount;
+}
+
+LEAFMESHCOOKER_API void leaf_cook_meshes(const MeshCookingInput *inputs, int count, int generateLods, MeshCookingOutput *outputs)
+{
+    assert(inputs && outputs);
+
+    // meshes are independent, each thread picks the next one until none is left
+    std::atomic<int> nextMesh(0);
+    auto cookMeshes = [&]()
+    {
+        for (int i = nextMesh++; i < count; i = nextMesh++)
+            cookMesh(inputs[i], generateLods != 0, outputs[i]);
+    };
+
+    int threadCount = std::min((int)std::thread::hardware_concurrency(), count) - 1;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; i++)
+        threads.push_back(std::thread(cookMeshes));
+
+    cookMeshes();
+
+    for (auto &thread : threads)
+        thread.join();
+}
+
+LEAFMESHCOOKER_API void leaf_free_mesh(const void *data)
+{
+    free((void *)data);
+}
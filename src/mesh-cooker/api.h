@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+
+#ifdef LEAFMESHCOOKER_EXPORTS
+#define LEAFMESHCOOKER_API extern "C" __declspec(dllexport)
+#else
+#define LEAFMESHCOOKER_API extern "C" __declspec(dllimport)
+#endif
+
+// flat Blender mesh arrays, as filled by foreach_get
+struct MeshCookingInput
+{
+    int vertexCount;
+    const float *positions; // 3 per vertex
+
+    int loopCount;
+    const int *loopVertexIndices;
+    const float *loopNormals; // 3 per loop
+    const float *loopTangents; // 3 per loop
+    const float *loopBitangentSigns;
+    const float *loopUVs; // 2 per loop, optional
+
+    int polygonCount;
+    const int *polygonLoopStarts;
+    const int *polygonLoopTotals;
+    const int *polygonMaterialIndices;
+
+    // polygons with a material index past the count are not exported
+    int materialCount;
+    const char *const *materialNames;
+};
+
+struct MeshCookingStats
+{
+    int vertexCountBefore;
+    int vertexCountAfter;
+    float acmrBefore;
+    float acmrAfter;
+    int lodCount;
+    int lodTriangleCounts[5]; // full detail first, then each level of detail
+    int rawSize; // blob bytes without compression
+    int compressedSize;
+    int clusterCount; // clusters of all submeshes, for culling at runtime
+};
+
+struct MeshCookingOutput
+{
+    const void *data; // mesh blob, null if the input is invalid; release with leaf_free_mesh
+    size_t size;
+    MeshCookingStats stats;
+};
+
+// cooks each input in a compressed mesh blob (welded, reordered, with levels of detail), meshes are spread over threads;
+// generating levels of detail is the slowest step, live editing cooks can skip it
+LEAFMESHCOOKER_API void leaf_cook_meshes(const MeshCookingInput *inputs, int count, int generateLods, MeshCookingOutput *outputs);
+LEAFMESHCOOKER_API void leaf_free_mesh(const void *data);
@@ -99,9 +99,9 @@ int main(int argc, char **argv)
         previousTime = currentTime;
 
         float animationTime = (float)(currentTime - startTime) * 0.001f * fps + startFrame;
-        leaf_update(animationTime);
 
-        leaf_render(width, height, deltaTime);
+        // the scene update of this frame overlaps the rendering of the previous one
+        leaf_update_and_render(animationTime, width, height, deltaTime);
     }
 
     ShowCursor(TRUE);
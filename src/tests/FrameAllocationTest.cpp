@@ -0,0 +1,128 @@
+#include <tests/Test.h>
+
+#include <cstdlib>
+#include <new>
+
+#include <glm/mat4x4.hpp>
+
+#include <engine/memory/FrameAllocator.h>
+#include <engine/render/graph/Batch.h>
+#include <engine/render/graph/Job.h>
+#include <engine/render/graph/Pass.h>
+#include <engine/render/graph/ResourcePlanner.h>
+
+// the global allocation functions are replaced for the whole test program, they only count while enabled
+static bool countingAllocations = false;
+static int allocationCount = 0;
+
+void *operator new(size_t size)
+{
+    if (countingAllocations)
+        allocationCount++;
+
+    void *memory = malloc(size > 0 ? size : 1);
+    if (memory == nullptr)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+static const int PASS_COUNT = 16;
+static const int BATCH_COUNT = 8;
+static const int JOB_COUNT = 64;
+
+// builds the nodes of a frame the way the renderer does, and plans its transient targets
+// the way FrameGraph::planTransientTargets does; none of it touches the device
+static void buildFrame(FrameAllocator &allocator, ResourcePlanner &planner)
+{
+    static const ResourcePlanner::ResourceDesc desc = { 1920, 1080, 10, 1920 * 1080 * 8 };
+
+    planner.clear();
+
+    ID3D11ShaderResourceView *resource = nullptr;
+    int previousResource = -1;
+    for (int i = 0; i < PASS_COUNT; i++)
+    {
+        Pass *pass = allocator.create<Pass>("Pass", L"Pass", &allocator);
+        pass->setTargets({ nullptr, nullptr }, nullptr);
+        pass->setViewport(1920.0f, 1080.0f, glm::mat4(1.0f), glm::mat4(1.0f));
+
+        for (int j = 0; j < BATCH_COUNT; j++)
+        {
+            Batch *batch = pass->addBatch("Batch");
+            batch->setResources({ resource, resource, resource, resource });
+            batch->setSamplers({ 0, 0 });
+
+            for (int k = 0; k < JOB_COUNT; k++)
+            {
+                Job *job = batch->addJob();
+                job->setBuffers(nullptr, nullptr, DXGI_FORMAT_R16_UINT, 0, 36);
+                job->addInstance();
+            }
+        }
+
+        int plannedPass = planner.addPass(i == PASS_COUNT - 1);
+        if (previousResource >= 0)
+            planner.addRead(plannedPass, previousResource);
+
+        previousResource = planner.addResource(desc);
+        planner.addWrite(plannedPass, previousResource);
+    }
+
+    planner.compile();
+}
+
+void testFrameAllocations()
+{
+    FrameAllocator allocator(64 * 1024);
+    ResourcePlanner planner;
+
+    // the first frame grows the allocator blocks and the planner arrays; the allocator merges
+    // its blocks when it is reset, so the next frames fit in a single one
+    allocationCount = 0;
+    countingAllocations = true;
+
+    buildFrame(allocator, planner);
+    allocator.reset();
+
+    countingAllocations = false;
+
+    CHECK(allocationCount > 0);
+
+    for (int frame = 0; frame < 2; frame++)
+    {
+        allocationCount = 0;
+        countingAllocations = true;
+
+        buildFrame(allocator, planner);
+        allocator.reset();
+
+        countingAllocations = false;
+
+        CHECK(allocationCount == 0);
+    }
+}
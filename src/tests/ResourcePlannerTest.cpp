@@ -0,0 +1,179 @@
+#include <tests/Test.h>
+
+#include <engine/render/graph/ResourcePlanner.h>
+
+// formats are opaque to the planner, any value works
+static const ResourcePlanner::ResourceDesc fullResolution = { 1920, 1080, 10, 1920 * 1080 * 8 };
+static const ResourcePlanner::ResourceDesc halfResolution = { 960, 540, 10, 960 * 540 * 8 };
+
+static void testCulling()
+{
+    ResourcePlanner planner;
+    planner.clear();
+
+    int unused = planner.addResource(fullResolution);
+    int used = planner.addResource(fullResolution);
+
+    // nobody reads what this pass writes
+    int unusedWriter = planner.addPass(false);
+    planner.addWrite(unusedWriter, unused);
+
+    int usedWriter = planner.addPass(false);
+    planner.addWrite(usedWriter, used);
+
+    // reading is not enough, a pass must write something needed
+    int unusedReader = planner.addPass(false);
+    planner.addRead(unusedReader, unused);
+
+    int output = planner.addPass(true);
+    planner.addRead(output, used);
+
+    planner.compile();
+
+    CHECK(planner.isPassCulled(unusedWriter));
+    CHECK(!planner.isPassCulled(usedWriter));
+    CHECK(planner.isPassCulled(unusedReader));
+    CHECK(!planner.isPassCulled(output));
+
+    CHECK(planner.getResourceStorage(unused) == -1);
+    CHECK(planner.getResourceStorage(used) >= 0);
+    CHECK(planner.getStorageCount() == 1);
+}
+
+static void testCullingChain()
+{
+    ResourcePlanner planner;
+    planner.clear();
+
+    int first = planner.addResource(fullResolution);
+    int second = planner.addResource(fullResolution);
+
+    // the first pass is only needed through the second one
+    int firstWriter = planner.addPass(false);
+    planner.addWrite(firstWriter, first);
+
+    int secondWriter = planner.addPass(false);
+    planner.addRead(secondWriter, first);
+    planner.addWrite(secondWriter, second);
+
+    planner.compile();
+
+    CHECK(planner.isPassCulled(firstWriter));
+    CHECK(planner.isPassCulled(secondWriter));
+    CHECK(planner.getStorageCount() == 0);
+    CHECK(planner.getRequestedSize() == 0);
+}
+
+static void testAliasing()
+{
+    ResourcePlanner planner;
+    planner.clear();
+
+    int bright = planner.addResource(fullResolution);
+    int blurred = planner.addResource(fullResolution);
+    int composed = planner.addResource(fullResolution);
+    int downsampled = planner.addResource(halfResolution);
+
+    int extract = planner.addPass(false);
+    planner.addWrite(extract, bright);
+
+    int downsample = planner.addPass(false);
+    planner.addRead(downsample, bright);
+    planner.addWrite(downsample, downsampled);
+
+    // bright is not used anymore, blurred can take its memory
+    int blur = planner.addPass(false);
+    planner.addRead(blur, downsampled);
+    planner.addWrite(blur, blurred);
+
+    int compose = planner.addPass(false);
+    planner.addRead(compose, blurred);
+    planner.addWrite(compose, composed);
+
+    int output = planner.addPass(true);
+    planner.addRead(output, composed);
+
+    planner.compile();
+
+    CHECK(!planner.isPassCulled(extract) && !planner.isPassCulled(downsample) && !planner.isPassCulled(blur) && !planner.isPassCulled(compose));
+
+    // non-overlapping lifetimes share storage
+    CHECK(planner.getResourceStorage(blurred) == planner.getResourceStorage(bright));
+
+    // overlapping lifetimes don't
+    CHECK(planner.getResourceStorage(composed) != planner.getResourceStorage(blurred));
+
+    // different descriptions never do
+    CHECK(planner.getResourceStorage(downsampled) != planner.getResourceStorage(bright));
+    CHECK(planner.getStorageDesc(planner.getResourceStorage(downsampled)) == halfResolution);
+
+    CHECK(planner.getStorageCount() == 3);
+}
+
+static void testReportedSizes()
+{
+    ResourcePlanner planner;
+
+    // the planner is reused from frame to frame, sizes don't accumulate
+    for (int frame = 0; frame < 2; frame++)
+    {
+        planner.clear();
+
+        int first = planner.addResource(fullResolution);
+        int second = planner.addResource(fullResolution);
+        int unused = planner.addResource(halfResolution);
+
+        int firstWriter = planner.addPass(false);
+        planner.addWrite(firstWriter, first);
+
+        int firstReader = planner.addPass(false);
+        planner.addRead(firstReader, first);
+        planner.addWrite(firstReader, second);
+
+        int unusedWriter = planner.addPass(false);
+        planner.addWrite(unusedWriter, unused);
+
+        int output = planner.addPass(true);
+        planner.addRead(output, second);
+
+        planner.compile();
+
+        // first and second overlap on the second pass, the culled resource is not counted
+        CHECK(planner.getRequestedSize() == 2 * fullResolution.size);
+        CHECK(planner.getAllocatedSize() == 2 * fullResolution.size);
+    }
+
+    planner.clear();
+
+    int resources[4];
+    for (int i = 0; i < 4; i++)
+        resources[i] = planner.addResource(fullResolution);
+
+    // a chain where each resource is only read by the next pass needs two storages
+    int writer = planner.addPass(false);
+    planner.addWrite(writer, resources[0]);
+    for (int i = 1; i < 4; i++)
+    {
+        int pass = planner.addPass(false);
+        planner.addRead(pass, resources[i - 1]);
+        planner.addWrite(pass, resources[i]);
+    }
+
+    int output = planner.addPass(true);
+    planner.addRead(output, resources[3]);
+
+    planner.compile();
+
+    CHECK(planner.getStorageCount() == 2);
+    CHECK(planner.getRequestedSize() == 4 * fullResolution.size);
+    CHECK(planner.getAllocatedSize() == 2 * fullResolution.size);
+    CHECK(planner.getRequestedSize() - planner.getAllocatedSize() == 2 * fullResolution.size);
+}
+
+void testResourcePlanner()
+{
+    testCulling();
+    testCullingChain();
+    testAliasing();
+    testReportedSizes();
+}
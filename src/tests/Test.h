@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdio>
+
+// minimal checks for the headless tests; a failed check is reported and the test goes on
+extern int testFailureCount;
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); \
+            testFailureCount++; \
+        } \
+    } while (0)
+
+void testResourcePlanner();
+void testFrameAllocations();
+void testTexturePacker();
@@ -0,0 +1,139 @@
+#include <tests/Test.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <engine/render/TexturePacker.h>
+
+static const TexturePacker::Texture largeColor = { DXGI_FORMAT_BC1_UNORM, 1024, 1024, 11 };
+static const TexturePacker::Texture largeNormal = { DXGI_FORMAT_BC5_UNORM, 1024, 1024, 11 };
+
+static void testArrays()
+{
+    std::vector<TexturePacker::Texture> textures = { largeColor, largeNormal, largeColor, { DXGI_FORMAT_BC1_UNORM, 1024, 1024, 1 }, { DXGI_FORMAT_BC1_UNORM, 0, 1024, 11 } };
+    std::vector<TexturePacker::Array> arrays;
+    std::vector<TexturePacker::Placement> placements;
+    TexturePacker::pack(textures, arrays, placements);
+
+    CHECK(placements.size() == textures.size());
+
+    // same format, size and mip count share an array, one slice each
+    CHECK(placements[0].arrayIndex >= 0);
+    CHECK(placements[2].arrayIndex == placements[0].arrayIndex);
+    CHECK(placements[0].slice != placements[2].slice);
+    CHECK(arrays[placements[0].arrayIndex].sliceCount == 2);
+    CHECK(!arrays[placements[0].arrayIndex].atlas);
+    CHECK(arrays[placements[0].arrayIndex].mipLevels == 11);
+
+    // any difference makes another array
+    CHECK(placements[1].arrayIndex != placements[0].arrayIndex);
+    CHECK(placements[3].arrayIndex != placements[0].arrayIndex);
+    CHECK(arrays[placements[1].arrayIndex].format == DXGI_FORMAT_BC5_UNORM);
+
+    // textures of plain arrays fill their slice
+    CHECK((placements[0].x == 0) && (placements[0].y == 0));
+
+    // empty textures are not packed
+    CHECK(placements[4].arrayIndex == -1);
+    CHECK(arrays.size() == 3);
+}
+
+static void testSliceCount()
+{
+    // past D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION slices, textures go to a new array
+    std::vector<TexturePacker::Texture> textures(2049, { DXGI_FORMAT_R8G8B8A8_UNORM, 128, 128, 8 });
+    std::vector<TexturePacker::Array> arrays;
+    std::vector<TexturePacker::Placement> placements;
+    TexturePacker::pack(textures, arrays, placements);
+
+    CHECK(arrays.size() == 2);
+    CHECK(arrays[0].sliceCount == 2048);
+    CHECK(arrays[1].sliceCount == 1);
+    CHECK((placements[2048].arrayIndex == 1) && (placements[2048].slice == 0));
+}
+
+static void testAtlas()
+{
+    std::vector<TexturePacker::Texture> textures = {
+        { DXGI_FORMAT_BC1_UNORM, 16, 16, 5 },
+        { DXGI_FORMAT_BC1_UNORM, 64, 64, 7 },
+        { DXGI_FORMAT_BC1_UNORM, 32, 16, 6 },
+        { DXGI_FORMAT_BC1_UNORM, 64, 64, 7 },
+        { DXGI_FORMAT_BC1_UNORM, 32, 32, 6 },
+        { DXGI_FORMAT_BC1_UNORM, 48, 48, 6 }, // not a power of two
+    };
+    std::vector<TexturePacker::Array> arrays;
+    std::vector<TexturePacker::Placement> placements;
+    TexturePacker::pack(textures, arrays, placements);
+
+    CHECK(!arrays[placements[5].arrayIndex].atlas);
+
+    // small power of two textures of a format and mip count share pages
+    const TexturePacker::Array &page = arrays[placements[1].arrayIndex];
+    CHECK(page.atlas);
+    CHECK(placements[3].arrayIndex == placements[1].arrayIndex);
+
+    // the 64 texel pages keep the mips down to 4 texels, 16 texel textures keep 3 levels, in other pages
+    CHECK(page.mipLevels == 5);
+    CHECK(placements[0].arrayIndex != placements[1].arrayIndex);
+    CHECK(arrays[placements[0].arrayIndex].mipLevels == 3);
+
+    // 32x16 and 32x32 textures both keep 4 levels
+    CHECK(placements[2].arrayIndex == placements[4].arrayIndex);
+    CHECK(arrays[placements[2].arrayIndex].mipLevels == 4);
+
+    // pages shrink to their content: two 64 texel cells fit in 128 texels
+    CHECK((page.width == 128) && (page.height == 128));
+    CHECK(page.sliceCount == 1);
+
+    for (int i = 0; i < 5; i++)
+    {
+        const TexturePacker::Array &array = arrays[placements[i].arrayIndex];
+        int cellSize = std::max(textures[i].width, textures[i].height);
+
+        // cells are aligned on their size, inside the page
+        CHECK((placements[i].x % cellSize == 0) && (placements[i].y % cellSize == 0));
+        CHECK((placements[i].x + cellSize <= array.width) && (placements[i].y + cellSize <= array.height));
+
+        // and keep whole compression blocks down to the last mip
+        CHECK((cellSize >> (array.mipLevels - 1)) >= 4);
+
+        for (int j = 0; j < i; j++)
+        {
+            if ((placements[j].arrayIndex != placements[i].arrayIndex) || (placements[j].slice != placements[i].slice))
+                continue;
+
+            int otherSize = std::max(textures[j].width, textures[j].height);
+            bool separate = (placements[i].x + cellSize <= placements[j].x) || (placements[j].x + otherSize <= placements[i].x)
+                || (placements[i].y + cellSize <= placements[j].y) || (placements[j].y + otherSize <= placements[i].y);
+            CHECK(separate);
+        }
+    }
+}
+
+static void testAtlasPages()
+{
+    // 300 cells of 64 texels overflow a 1024 texel page of 256 cells
+    std::vector<TexturePacker::Texture> textures(300, { DXGI_FORMAT_BC3_UNORM, 64, 64, 7 });
+    std::vector<TexturePacker::Array> arrays;
+    std::vector<TexturePacker::Placement> placements;
+    TexturePacker::pack(textures, arrays, placements);
+
+    CHECK(arrays.size() == 1);
+    CHECK(arrays[0].atlas);
+    CHECK((arrays[0].width == 1024) && (arrays[0].sliceCount == 2));
+
+    int secondPageCount = 0;
+    for (const TexturePacker::Placement &placement : placements)
+        secondPageCount += (placement.slice == 1) ? 1 : 0;
+
+    CHECK(secondPageCount == 300 - 256);
+}
+
+void testTexturePacker()
+{
+    testArrays();
+    testSliceCount();
+    testAtlas();
+    testAtlasPages();
+}
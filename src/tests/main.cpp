@@ -0,0 +1,22 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include <tests/Test.h>
+
+int testFailureCount = 0;
+
+int main()
+{
+    testResourcePlanner();
+    testFrameAllocations();
+    testTexturePacker();
+
+    if (testFailureCount > 0)
+    {
+        printf("%d check(s) failed\n", testFailureCount);
+        return EXIT_FAILURE;
+    }
+
+    printf("all tests passed\n");
+    return EXIT_SUCCESS;
+}